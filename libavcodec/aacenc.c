@@ -827,6 +827,115 @@ static void copy_input_samples(AACEncContext *s, const AVFrame *frame)
     }
 }
 
+/**
+ * Search the quantizers and coding tools of one channel element.
+ * Runs on the thread context of threadnr, so elements can be coded in parallel.
+ */
+static int encode_channel_element(AVCodecContext *avctx, void *arg,
+                                  int jobnr, int threadnr)
+{
+    AACEncContext *s = avctx->priv_data;
+    AACEncContext *t = s->thread_ctx[threadnr];
+    AACEncElement *el = &s->el[jobnr];
+    const FFPsyWindowInfo *wi = (const FFPsyWindowInfo *)arg + el->start_ch;
+    ChannelElement *cpe = &s->cpe[jobnr];
+    SingleChannelElement *sce;
+    int tag   = s->chan_map[jobnr + 1];
+    int chans = tag == TYPE_CPE ? 2 : 1;
+    int ch, w;
+
+    t->lambda           = s->lambda;
+    t->psy.bitres.alloc = el->bitres_alloc;
+    t->cur_type         = tag;
+    /* with threads, every element has its own PNS noise sequence */
+    if (s->nb_threads > 1)
+        t->random_state = el->random_state;
+    el->is_mode = el->tns_mode = el->pred_mode = 0;
+
+    cpe->common_window = 0;
+    memset(cpe->is_mask, 0, sizeof(cpe->is_mask));
+    memset(cpe->ms_mask, 0, sizeof(cpe->ms_mask));
+    for (ch = 0; ch < chans; ch++) {
+        t->cur_channel = el->start_ch + ch;
+        if (t->options.pns && t->coder->mark_pns)
+            t->coder->mark_pns(t, avctx, &cpe->ch[ch]);
+        t->coder->search_for_quantizers(avctx, t, &cpe->ch[ch], t->lambda);
+    }
+    if (chans > 1
+        && wi[0].window_type[0] == wi[1].window_type[0]
+        && wi[0].window_shape   == wi[1].window_shape) {
+
+        cpe->common_window = 1;
+        for (w = 0; w < wi[0].num_windows; w++) {
+            if (wi[0].grouping[w] != wi[1].grouping[w]) {
+                cpe->common_window = 0;
+                break;
+            }
+        }
+    }
+    for (ch = 0; ch < chans; ch++) { /* TNS and PNS */
+        sce = &cpe->ch[ch];
+        t->cur_channel = el->start_ch + ch;
+        if (t->options.tns && t->coder->search_for_tns)
+            t->coder->search_for_tns(t, sce);
+        if (t->options.tns && t->coder->apply_tns_filt)
+            t->coder->apply_tns_filt(t, sce);
+        if (sce->tns.present)
+            el->tns_mode = 1;
+        if (t->options.pns && t->coder->search_for_pns)
+            t->coder->search_for_pns(t, avctx, sce);
+    }
+    t->cur_channel = el->start_ch;
+    if (t->options.intensity_stereo) { /* Intensity Stereo */
+        if (t->coder->search_for_is)
+            t->coder->search_for_is(t, avctx, cpe);
+        if (cpe->is_mode) el->is_mode = 1;
+        apply_intensity_stereo(cpe);
+    }
+    if (t->options.pred) { /* Prediction */
+        for (ch = 0; ch < chans; ch++) {
+            sce = &cpe->ch[ch];
+            t->cur_channel = el->start_ch + ch;
+            if (t->options.pred && t->coder->search_for_pred)
+                t->coder->search_for_pred(t, sce);
+            if (cpe->ch[ch].ics.predictor_present) el->pred_mode = 1;
+        }
+        if (t->coder->adjust_common_pred)
+            t->coder->adjust_common_pred(t, cpe);
+        for (ch = 0; ch < chans; ch++) {
+            sce = &cpe->ch[ch];
+            t->cur_channel = el->start_ch + ch;
+            if (t->options.pred && t->coder->apply_main_pred)
+                t->coder->apply_main_pred(t, sce);
+        }
+        t->cur_channel = el->start_ch;
+    }
+    if (t->options.mid_side) { /* Mid/Side stereo */
+        if (t->options.mid_side == -1 && t->coder->search_for_ms)
+            t->coder->search_for_ms(t, cpe);
+        else if (cpe->common_window)
+            memset(cpe->ms_mask, 1, sizeof(cpe->ms_mask));
+        apply_mid_side_stereo(cpe);
+    }
+    adjust_frame_information(cpe, chans);
+    if (t->options.ltp) { /* LTP */
+        for (ch = 0; ch < chans; ch++) {
+            sce = &cpe->ch[ch];
+            t->cur_channel = el->start_ch + ch;
+            if (t->coder->search_for_ltp)
+                t->coder->search_for_ltp(t, sce, cpe->common_window);
+            if (sce->ics.ltp.present) el->pred_mode = 1;
+        }
+        t->cur_channel = el->start_ch;
+        if (t->coder->adjust_common_ltp)
+            t->coder->adjust_common_ltp(t, cpe);
+    }
+    el->random_state = t->random_state;
+    el->cutoff       = t->psy.cutoff;
+
+    return 0;
+}
+
 static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                             const AVFrame *frame, int *got_packet_ptr)
 {
@@ -969,11 +1078,6 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
             tag      = s->chan_map[i+1];
             chans    = tag == TYPE_CPE ? 2 : 1;
             cpe      = &s->cpe[i];
-            cpe->common_window = 0;
-            memset(cpe->is_mask, 0, sizeof(cpe->is_mask));
-            memset(cpe->ms_mask, 0, sizeof(cpe->ms_mask));
-            put_bits(&s->pb, 3, tag);
-            put_bits(&s->pb, 4, chan_el_counter[tag]++);
             for (ch = 0; ch < chans; ch++) {
                 sce = &cpe->ch[ch];
                 coeffs[ch] = sce->coeffs;
@@ -995,82 +1099,31 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                     * (s->lambda / (avctx->global_quality ? avctx->global_quality : 120));
                 s->psy.bitres.alloc /= chans;
             }
-            s->cur_type = tag;
-            for (ch = 0; ch < chans; ch++) {
-                s->cur_channel = start_ch + ch;
-                if (s->options.pns && s->coder->mark_pns)
-                    s->coder->mark_pns(s, avctx, &cpe->ch[ch]);
-                s->coder->search_for_quantizers(avctx, s, &cpe->ch[ch], s->lambda);
-            }
-            if (chans > 1
-                && wi[0].window_type[0] == wi[1].window_type[0]
-                && wi[0].window_shape   == wi[1].window_shape) {
-
-                cpe->common_window = 1;
-                for (w = 0; w < wi[0].num_windows; w++) {
-                    if (wi[0].grouping[w] != wi[1].grouping[w]) {
-                        cpe->common_window = 0;
-                        break;
-                    }
-                }
-            }
-            for (ch = 0; ch < chans; ch++) { /* TNS and PNS */
-                sce = &cpe->ch[ch];
-                s->cur_channel = start_ch + ch;
-                if (s->options.tns && s->coder->search_for_tns)
-                    s->coder->search_for_tns(s, sce);
-                if (s->options.tns && s->coder->apply_tns_filt)
-                    s->coder->apply_tns_filt(s, sce);
-                if (sce->tns.present)
-                    tns_mode = 1;
-                if (s->options.pns && s->coder->search_for_pns)
-                    s->coder->search_for_pns(s, avctx, sce);
-            }
-            s->cur_channel = start_ch;
-            if (s->options.intensity_stereo) { /* Intensity Stereo */
-                if (s->coder->search_for_is)
-                    s->coder->search_for_is(s, avctx, cpe);
-                if (cpe->is_mode) is_mode = 1;
-                apply_intensity_stereo(cpe);
-            }
-            if (s->options.pred) { /* Prediction */
-                for (ch = 0; ch < chans; ch++) {
-                    sce = &cpe->ch[ch];
-                    s->cur_channel = start_ch + ch;
-                    if (s->options.pred && s->coder->search_for_pred)
-                        s->coder->search_for_pred(s, sce);
-                    if (cpe->ch[ch].ics.predictor_present) pred_mode = 1;
-                }
-                if (s->coder->adjust_common_pred)
-                    s->coder->adjust_common_pred(s, cpe);
-                for (ch = 0; ch < chans; ch++) {
-                    sce = &cpe->ch[ch];
-                    s->cur_channel = start_ch + ch;
-                    if (s->options.pred && s->coder->apply_main_pred)
-                        s->coder->apply_main_pred(s, sce);
-                }
-                s->cur_channel = start_ch;
-            }
-            if (s->options.mid_side) { /* Mid/Side stereo */
-                if (s->options.mid_side == -1 && s->coder->search_for_ms)
-                    s->coder->search_for_ms(s, cpe);
-                else if (cpe->common_window)
-                    memset(cpe->ms_mask, 1, sizeof(cpe->ms_mask));
-                apply_mid_side_stereo(cpe);
-            }
-            adjust_frame_information(cpe, chans);
-            if (s->options.ltp) { /* LTP */
-                for (ch = 0; ch < chans; ch++) {
-                    sce = &cpe->ch[ch];
-                    s->cur_channel = start_ch + ch;
-                    if (s->coder->search_for_ltp)
-                        s->coder->search_for_ltp(s, sce, cpe->common_window);
-                    if (sce->ics.ltp.present) pred_mode = 1;
-                }
-                s->cur_channel = start_ch;
-                if (s->coder->adjust_common_ltp)
-                    s->coder->adjust_common_ltp(s, cpe);
-            }
+            s->el[i].start_ch     = start_ch;
+            s->el[i].bitres_alloc = s->psy.bitres.alloc;
+            start_ch += chans;
+            /* Without threads, code the element right away, the analysis of
+             * the next one uses the cutoff chosen by the coder. */
+            if (s->nb_threads == 1)
+                encode_channel_element(avctx, windows, i, 0);
+        }
+
+        /* The psy model keeps running state across elements, so only the
+         * coefficient coding below is split over the threads. */
+        if (s->nb_threads > 1) {
+            avctx->execute2(avctx, encode_channel_element, windows, NULL, s->chan_map[0]);
+            s->psy.cutoff = s->el[s->chan_map[0] - 1].cutoff;
+        }
+
+        for (i = 0; i < s->chan_map[0]; i++) {
+            tag      = s->chan_map[i+1];
+            chans    = tag == TYPE_CPE ? 2 : 1;
+            cpe      = &s->cpe[i];
+            is_mode   |= s->el[i].is_mode;
+            tns_mode  |= s->el[i].tns_mode;
+            pred_mode |= s->el[i].pred_mode;
+            put_bits(&s->pb, 3, tag);
+            put_bits(&s->pb, 4, chan_el_counter[tag]++);
             if (chans == 2) {
                 put_bits(&s->pb, 1, cpe->common_window);
                 if (cpe->common_window) {
@@ -1084,10 +1137,9 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                 }
             }
             for (ch = 0; ch < chans; ch++) {
-                s->cur_channel = start_ch + ch;
+                s->cur_channel = s->el[i].start_ch + ch;
                 encode_individual_channel(avctx, s, &cpe->ch[ch], cpe->common_window);
             }
-            start_ch += chans;
         }
 
         if (avctx->flags & AV_CODEC_FLAG_QSCALE) {
@@ -1170,6 +1222,37 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
     return 0;
 }
 
+static av_cold int init_thread_contexts(AVCodecContext *avctx, AACEncContext *s)
+{
+    int i, ret;
+
+    s->nb_threads = 1;
+    if (avctx->active_thread_type & FF_THREAD_SLICE)
+        s->nb_threads = av_clip(avctx->thread_count, 1, s->chan_map[0]);
+
+    s->thread_ctx = av_calloc(s->nb_threads, sizeof(*s->thread_ctx));
+    if (!s->thread_ctx)
+        return AVERROR(ENOMEM);
+    s->thread_ctx[0] = s;
+
+    for (i = 1; i < s->nb_threads; i++) {
+        AACEncContext *t = av_memdup(s, sizeof(*s));
+        if (!t)
+            return AVERROR(ENOMEM);
+        s->thread_ctx[i] = t;
+
+        /* coder scratch buffers and the LPC context are private,
+         * everything else is shared with the main context */
+        t->thread_ctx = NULL;
+        memset(&t->lpc, 0, sizeof(t->lpc));
+        ret = ff_lpc_init(&t->lpc, 2*avctx->frame_size, TNS_MAX_ORDER, FF_LPC_TYPE_LEVINSON);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
 static av_cold int aac_encode_end(AVCodecContext *avctx)
 {
     AACEncContext *s = avctx->priv_data;
@@ -1180,6 +1263,14 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
     av_tx_uninit(&s->mdct128);
     ff_psy_end(&s->psy);
     ff_lpc_end(&s->lpc);
+    if (s->thread_ctx) {
+        for (int i = 1; i < s->nb_threads; i++) {
+            if (s->thread_ctx[i])
+                ff_lpc_end(&s->thread_ctx[i]->lpc);
+            av_freep(&s->thread_ctx[i]);
+        }
+        av_freep(&s->thread_ctx);
+    }
     if (s->psypp)
         ff_psy_preprocess_end(s->psypp);
     av_freep(&s->buffer.samples);
@@ -1368,6 +1459,8 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
     s->psypp = ff_psy_preprocess_init(avctx);
     ff_lpc_init(&s->lpc, 2*avctx->frame_size, TNS_MAX_ORDER, FF_LPC_TYPE_LEVINSON);
     s->random_state = 0x1f2e3d4c;
+    for (i = 0; i < s->chan_map[0]; i++)
+        s->el[i].random_state = s->random_state;
 
     s->abs_pow34   = abs_pow34_v;
     s->quant_bands = quantize_bands;
@@ -1383,7 +1476,7 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
     ff_af_queue_init(avctx, &s->afq);
     ff_aac_tableinit();
 
-    return 0;
+    return init_thread_contexts(avctx, s);
 }
 
 #define AACENC_FLAGS AV_OPT_FLAG_ENCODING_PARAM | AV_OPT_FLAG_AUDIO_PARAM
@@ -1421,7 +1514,7 @@ const FFCodec ff_aac_encoder = {
     .p.type         = AVMEDIA_TYPE_AUDIO,
     .p.id           = AV_CODEC_ID_AAC,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
-                      AV_CODEC_CAP_SMALL_LAST_FRAME,
+                      AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_SLICE_THREADS,
     .priv_data_size = sizeof(AACEncContext),
     .init           = aac_encode_init,
     FF_CODEC_ENCODE_CB(aac_encode_frame),
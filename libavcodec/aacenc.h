@@ -102,6 +102,19 @@ typedef struct AACPCEInfo {
     uint8_t reorder_map[16];                     ///< maps channels from lavc to aac order
 } AACPCEInfo;
 
+/**
+ * Per channel element coding state
+ */
+typedef struct AACEncElement {
+    int start_ch;                                ///< first channel of the element
+    int bitres_alloc;                            ///< psy bit allocation for each channel of the element
+    int random_state;                            ///< PNS random state of the element, with threads
+    int cutoff;                                  ///< psy cutoff chosen by the coder for the element
+    int is_mode;                                 ///< element uses intensity stereo in the current frame
+    int tns_mode;                                ///< element uses TNS in the current frame
+    int pred_mode;                               ///< element uses prediction or LTP in the current frame
+} AACEncElement;
+
 /**
  * AAC encoder context
  */
@@ -137,6 +150,10 @@ typedef struct AACEncContext {
     int lambda_count;                            ///< count(lambda), for Qvg reporting
     enum RawDataBlockType cur_type;              ///< channel group type cur_channel belongs to
 
+    AACEncElement el[MAX_ELEM_ID];               ///< per channel element coding state
+    struct AACEncContext **thread_ctx;           ///< per-thread coder contexts, thread_ctx[0] is the main context
+    int nb_threads;                              ///< number of coder contexts
+
     AudioFrameQueue afq;
     DECLARE_ALIGNED(16, int,   qcoefs)[96];      ///< quantized coefficients
     DECLARE_ALIGNED(32, float, scoefs)[1024];    ///< scaled coefficients
@@ -1512,6 +1512,7 @@ typedef struct AVCodecContext {
     int thread_type;
 #define FF_THREAD_FRAME   1 ///< Decode more than one frame at once
 #define FF_THREAD_SLICE   2 ///< Decode more than one part of a single frame at once
+#define FF_THREAD_GOP     4 ///< Encode independent closed GOPs at once, encoding only
 
     /**
      * Which multithreading methods are in use by the codec.
@@ -2063,6 +2064,29 @@ typedef struct AVCodecContext {
      *   an error.
      */
     int64_t frame_num;
+
+    /**
+     * A reference to a thread pool created with avcodec_thread_pool_create().
+     *
+     * If set, slice threading runs its jobs on the threads of this pool,
+     * which can be shared by any number of codec contexts, instead of
+     * creating threads for this context. thread_count then only limits
+     * how many threads work on this context at once; if it is 0, it is
+     * derived from the size of the pool.
+     *
+     * Only slice threading can run on a pool. Frame threading, frame-threaded
+     * encoding and GOP-threaded encoding (FF_THREAD_GOP) need threads of their
+     * own and are disabled for contexts attached to a pool, even if requested
+     * in thread_type. Codecs that support only those fall back to running on
+     * the calling thread.
+     *
+     * libavcodec takes ownership of the reference and unrefs it when the
+     * context is closed.
+     *
+     * - encoding: May be set by the caller before avcodec_open2().
+     * - decoding: May be set by the caller before avcodec_open2().
+     */
+    AVBufferRef *thread_pool;
 } AVCodecContext;
 
 /**
@@ -2797,6 +2821,21 @@ int avcodec_get_hw_frames_parameters(AVCodecContext *avctx,
 
 
 
+/**
+ * Create a thread pool that can be shared by several codec contexts through
+ * AVCodecContext.thread_pool.
+ *
+ * The threads of the pool take jobs from all attached contexts, so the
+ * number of threads stays the same no matter how many contexts are open.
+ * The threads calling into libavcodec take part in the work of their own
+ * contexts as well.
+ *
+ * @param pool       on success, a reference to the new pool is written here
+ * @param nb_threads number of worker threads, 0 for the number of CPUs
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int avcodec_thread_pool_create(AVBufferRef **pool, int nb_threads);
+
 /**
  * @defgroup lavc_parsing Frame parsing
  * @{
@@ -3033,6 +3072,36 @@ int av_parser_parse2(AVCodecParserContext *s,
                      int64_t pts, int64_t dts,
                      int64_t pos);
 
+/**
+ * Parse a packet into a reference-counted output packet.
+ *
+ * This works like av_parser_parse2(), except for how the output is returned.
+ * When the parsed frame lies entirely within the input data, the output
+ * packet references buf and no data is copied. Only frames straddling input
+ * boundaries, which the parser had to combine, are copied into a new buffer.
+ *
+ * @param s     parser context.
+ * @param avctx codec context.
+ * @param out   blank packet; on output data, size and buf are set if a
+ *              frame was completed, otherwise size is 0. No other fields
+ *              are touched.
+ * @param buf   reference to the buffer holding data, may be NULL, in which
+ *              case the output is always copied. data must be followed by
+ *              AV_INPUT_BUFFER_PADDING_SIZE bytes of padding, as for
+ *              av_parser_parse2().
+ * @param data  input data, 0 size signals EOF.
+ * @param size  size of the input data in bytes, without the padding.
+ * @param pts   input presentation timestamp.
+ * @param dts   input decoding timestamp.
+ * @param pos   input byte position in stream.
+ * @return the number of bytes of the input used, or a negative AVERROR code
+ *         on failure.
+ */
+int av_parser_parse_ref(AVCodecParserContext *s, AVCodecContext *avctx,
+                        AVPacket *out, const AVBufferRef *buf,
+                        const uint8_t *data, int size,
+                        int64_t pts, int64_t dts, int64_t pos);
+
 void av_parser_close(AVCodecParserContext *s);
 
 /**
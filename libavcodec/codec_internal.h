@@ -88,6 +88,14 @@
  * encoders do.
  */
 #define FF_CODEC_CAP_EOF_FLUSH              (1 << 10)
+/**
+ * The encoder can be run on independent chunks of the input, each starting
+ * with a keyframe, by the frame thread encoder with FF_THREAD_GOP.
+ * Every chunk is coded by a separate instance of the encoder and the packets
+ * are concatenated, so the encoder must not depend on state carried over
+ * from earlier frames besides its own options.
+ */
+#define FF_CODEC_CAP_GOP_THREADS            (1 << 11)
 
 /**
  * FFCodec.codec_tags termination value
@@ -128,6 +128,22 @@ typedef struct FlacEncodeContext {
 
     int flushed;
     int64_t next_pts;
+
+    /* Frame-parallel encoding: up to nb_threads input frames are queued and
+     * encoded at once, each in its own copy of the context, while the MD5
+     * sum is updated in order by an extra job. thread_ctx[0] is the context
+     * itself. */
+    struct FlacEncodeContext **thread_ctx;
+    int *thread_ret;
+    int nb_threads;
+    int nb_queued;          ///< number of queued input frames
+    int nb_encoded;         ///< number of encoded frames in the current batch
+    int next_output;        ///< index of the next encoded frame to return
+
+    /* per-thread state */
+    AVFrame *input;         ///< input frame being encoded
+    uint8_t *frame_buf;     ///< encoded frame, max_framesize bytes
+    int frame_bytes;        ///< size of the encoded frame
 } FlacEncodeContext;
 
 
@@ -266,6 +282,54 @@ static av_cold void dprint_compression_options(FlacEncodeContext *s)
 }
 
 
+static av_cold int init_thread_contexts(FlacEncodeContext *s)
+{
+    AVCodecContext *avctx = s->avctx;
+    int i, ret;
+
+    s->nb_threads = 1;
+    if (avctx->active_thread_type & FF_THREAD_SLICE)
+        s->nb_threads = FFMAX(avctx->thread_count, 1);
+
+    s->thread_ctx = av_calloc(s->nb_threads, sizeof(*s->thread_ctx));
+    s->thread_ret = av_calloc(s->nb_threads + 1, sizeof(*s->thread_ret));
+    if (!s->thread_ctx || !s->thread_ret)
+        return AVERROR(ENOMEM);
+
+    s->input     = av_frame_alloc();
+    s->frame_buf = av_malloc(s->max_framesize);
+    if (!s->input || !s->frame_buf)
+        return AVERROR(ENOMEM);
+    s->thread_ctx[0] = s;
+
+    for (i = 1; i < s->nb_threads; i++) {
+        FlacEncodeContext *t = av_memdup(s, sizeof(*s));
+        if (!t)
+            return AVERROR(ENOMEM);
+        s->thread_ctx[i] = t;
+
+        /* the MD5 state belongs to the main context only */
+        t->md5ctx           = NULL;
+        t->md5_buffer       = NULL;
+        t->md5_buffer_size  = 0;
+        t->thread_ctx       = NULL;
+        t->thread_ret       = NULL;
+        memset(&t->lpc_ctx, 0, sizeof(t->lpc_ctx));
+
+        t->input     = av_frame_alloc();
+        t->frame_buf = av_malloc(s->max_framesize);
+        if (!t->input || !t->frame_buf)
+            return AVERROR(ENOMEM);
+        ret = ff_lpc_init(&t->lpc_ctx, avctx->frame_size,
+                          s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+
 static av_cold int flac_encode_init(AVCodecContext *avctx)
 {
     int freq = avctx->sample_rate;
@@ -465,13 +529,15 @@ static av_cold int flac_encode_init(AVCodecContext *avctx)
 
     ret = ff_lpc_init(&s->lpc_ctx, avctx->frame_size,
                       s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+    if (ret < 0)
+        return ret;
 
     ff_bswapdsp_init(&s->bdsp);
     ff_flacencdsp_init(&s->flac_dsp);
 
     dprint_compression_options(s);
 
-    return ret;
+    return init_thread_contexts(s);
 }
 
 
@@ -1561,9 +1627,9 @@ static void write_frame_footer(FlacEncodeContext *s)
 }
 
 
-static int write_frame(FlacEncodeContext *s, AVPacket *avpkt)
+static int write_frame(FlacEncodeContext *s, uint8_t *buf, int buf_size)
 {
-    init_put_bits(&s->pb, avpkt->data, avpkt->size);
+    init_put_bits(&s->pb, buf, buf_size);
     write_frame_header(s);
     write_subframes(s);
     write_frame_footer(s);
@@ -1571,10 +1637,10 @@ static int write_frame(FlacEncodeContext *s, AVPacket *avpkt)
 }
 
 
-static int update_md5_sum(FlacEncodeContext *s, const void *samples)
+static int update_md5_sum(FlacEncodeContext *s, const void *samples, int nb_samples)
 {
     const uint8_t *buf;
-    int buf_size = s->frame.blocksize * s->channels *
+    int buf_size = nb_samples * s->channels *
                    ((s->avctx->bits_per_raw_sample + 7) / 8);
 
     if (s->avctx->bits_per_raw_sample > 16 || HAVE_BIGENDIAN) {
@@ -1595,7 +1661,7 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
         const int32_t *samples0 = samples;
         uint8_t *tmp            = s->md5_buffer;
 
-        for (i = 0; i < s->frame.blocksize * s->channels; i++) {
+        for (i = 0; i < nb_samples * s->channels; i++) {
             int32_t v = samples0[i] >> 8;
             AV_WL24(tmp + 3*i, v);
         }
@@ -1606,7 +1672,7 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
         const int32_t *samples0 = samples;
         uint8_t *tmp            = s->md5_buffer;
 
-        for (i = 0; i < s->frame.blocksize * s->channels; i++)
+        for (i = 0; i < nb_samples * s->channels; i++)
             AV_WL32(tmp + 4*i, samples0[i]);
         buf = s->md5_buffer;
     }
@@ -1616,41 +1682,20 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
 }
 
 
-static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
-                             const AVFrame *frame, int *got_packet_ptr)
+/**
+ * Encode s->input into s->frame_buf.
+ */
+static int encode_input_frame(FlacEncodeContext *s)
 {
-    FlacEncodeContext *s;
-    int frame_bytes, out_bytes, ret;
-
-    s = avctx->priv_data;
-
-    /* when the last block is reached, update the header in extradata */
-    if (!frame) {
-        s->max_framesize = s->max_encoded_framesize;
-        av_md5_final(s->md5ctx, s->md5sum);
-        write_streaminfo(s, avctx->extradata);
-
-        if (!s->flushed) {
-            uint8_t *side_data = av_packet_new_side_data(avpkt, AV_PKT_DATA_NEW_EXTRADATA,
-                                                         avctx->extradata_size);
-            if (!side_data)
-                return AVERROR(ENOMEM);
-            memcpy(side_data, avctx->extradata, avctx->extradata_size);
-
-            avpkt->pts = s->next_pts;
-
-            *got_packet_ptr = 1;
-            s->flushed = 1;
-        }
-
-        return 0;
-    }
+    const AVFrame *frame = s->input;
+    int max_framesize = s->max_framesize;
+    int frame_bytes;
 
     /* change max_framesize for small final frame */
-    if (frame->nb_samples < s->frame.blocksize) {
-        s->max_framesize = flac_get_max_frame_size(frame->nb_samples,
-                                                   s->channels,
-                                                   avctx->bits_per_raw_sample);
+    if (frame->nb_samples < s->max_blocksize) {
+        max_framesize = flac_get_max_frame_size(frame->nb_samples,
+                                                s->channels,
+                                                s->avctx->bits_per_raw_sample);
     }
 
     init_frame(s, frame->nb_samples);
@@ -1665,37 +1710,129 @@ static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 
     /* Fall back on verbatim mode if the compressed frame is larger than it
        would be if encoded uncompressed. */
-    if (frame_bytes < 0 || frame_bytes > s->max_framesize) {
+    if (frame_bytes < 0 || frame_bytes > max_framesize) {
         s->frame.verbatim_only = 1;
         frame_bytes = encode_frame(s);
         if (frame_bytes < 0) {
-            av_log(avctx, AV_LOG_ERROR, "Bad frame count\n");
+            av_log(s->avctx, AV_LOG_ERROR, "Bad frame count\n");
             return frame_bytes;
         }
     }
 
-    if ((ret = ff_get_encode_buffer(avctx, avpkt, frame_bytes, 0)) < 0)
-        return ret;
+    s->frame_bytes = write_frame(s, s->frame_buf, frame_bytes);
+
+    return 0;
+}
+
+
+/**
+ * Encode one queued frame, or update the MD5 sum with all queued frames
+ * in order for the extra last job.
+ */
+static int encode_thread(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+
+    if (jobnr == s->nb_queued) {
+        for (int i = 0; i < s->nb_queued; i++) {
+            const AVFrame *frame = s->thread_ctx[i]->input;
+            int ret = update_md5_sum(s, frame->data[0], frame->nb_samples);
+            if (ret < 0) {
+                av_log(avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
+                return ret;
+            }
+        }
+        return 0;
+    }
+
+    return encode_input_frame(s->thread_ctx[jobnr]);
+}
 
-    out_bytes = write_frame(s, avpkt);
+
+static int flac_receive_packet(AVCodecContext *avctx, AVPacket *avpkt)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacEncodeContext *t;
+    AVFrame *frame;
+    int ret;
+
+    if (s->next_output == s->nb_encoded) {
+        s->next_output = s->nb_encoded = 0;
+
+        /* queue as many frames as there are threads before encoding,
+         * unless the input is exhausted */
+        while (s->nb_queued < s->nb_threads) {
+            t   = s->thread_ctx[s->nb_queued];
+            ret = ff_encode_get_frame(avctx, t->input);
+            if (ret == AVERROR_EOF)
+                break;
+            if (ret < 0)
+                return ret;
+            t->frame_count = s->frame_count + s->nb_queued;
+            s->nb_queued++;
+        }
+
+        /* when the last block is reached, update the header in extradata */
+        if (!s->nb_queued) {
+            if (s->flushed)
+                return AVERROR_EOF;
+
+            s->max_framesize = s->max_encoded_framesize;
+            av_md5_final(s->md5ctx, s->md5sum);
+            write_streaminfo(s, avctx->extradata);
+
+            {
+                uint8_t *side_data = av_packet_new_side_data(avpkt, AV_PKT_DATA_NEW_EXTRADATA,
+                                                             avctx->extradata_size);
+                if (!side_data)
+                    return AVERROR(ENOMEM);
+                memcpy(side_data, avctx->extradata, avctx->extradata_size);
+            }
+
+            avpkt->pts = avpkt->dts = s->next_pts;
+            s->flushed = 1;
+            return 0;
+        }
+
+        avctx->execute2(avctx, encode_thread, NULL, s->thread_ret,
+                        s->nb_queued + 1);
+
+        s->nb_encoded = s->nb_queued;
+        s->nb_queued  = 0;
+
+        for (int i = 0; i <= s->nb_encoded; i++)
+            if (s->thread_ret[i] < 0) {
+                for (int j = 0; j < s->nb_encoded; j++)
+                    av_frame_unref(s->thread_ctx[j]->input);
+                s->next_output = s->nb_encoded;
+                return s->thread_ret[i];
+            }
+    }
+
+    t     = s->thread_ctx[s->next_output++];
+    frame = t->input;
+
+    if ((ret = ff_get_encode_buffer(avctx, avpkt, t->frame_bytes, 0)) < 0)
+        goto end;
+    memcpy(avpkt->data, t->frame_buf, t->frame_bytes);
 
     s->frame_count++;
     s->sample_count += frame->nb_samples;
-    if ((ret = update_md5_sum(s, frame->data[0])) < 0) {
-        av_log(avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
-        return ret;
-    }
-    if (out_bytes > s->max_encoded_framesize)
-        s->max_encoded_framesize = out_bytes;
-    if (out_bytes < s->min_framesize)
-        s->min_framesize = out_bytes;
+    if (t->frame_bytes > s->max_encoded_framesize)
+        s->max_encoded_framesize = t->frame_bytes;
+    if (t->frame_bytes < s->min_framesize)
+        s->min_framesize = t->frame_bytes;
 
-    s->next_pts = frame->pts + ff_samples_to_time_base(avctx, frame->nb_samples);
+    avpkt->pts      = avpkt->dts = frame->pts;
+    avpkt->duration = frame->duration ? frame->duration :
+                      ff_samples_to_time_base(avctx, frame->nb_samples);
+    ret = ff_encode_reordered_opaque(avctx, avpkt, frame);
 
-    av_shrink_packet(avpkt, out_bytes);
+    s->next_pts = frame->pts + ff_samples_to_time_base(avctx, frame->nb_samples);
 
-    *got_packet_ptr = 1;
-    return 0;
+end:
+    av_frame_unref(frame);
+    return ret;
 }
 
 
@@ -1703,6 +1840,22 @@ static av_cold int flac_encode_close(AVCodecContext *avctx)
 {
     FlacEncodeContext *s = avctx->priv_data;
 
+    if (s->thread_ctx) {
+        for (int i = 1; i < s->nb_threads; i++) {
+            FlacEncodeContext *t = s->thread_ctx[i];
+            if (!t)
+                break;
+            av_frame_free(&t->input);
+            av_freep(&t->frame_buf);
+            ff_lpc_end(&t->lpc_ctx);
+            av_freep(&s->thread_ctx[i]);
+        }
+        av_freep(&s->thread_ctx);
+    }
+    av_freep(&s->thread_ret);
+    av_frame_free(&s->input);
+    av_freep(&s->frame_buf);
+
     av_freep(&s->md5ctx);
     av_freep(&s->md5_buffer);
     ff_lpc_end(&s->lpc_ctx);
@@ -1755,14 +1908,15 @@ const FFCodec ff_flac_encoder = {
     .p.id           = AV_CODEC_ID_FLAC,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
                       AV_CODEC_CAP_SMALL_LAST_FRAME |
+                      AV_CODEC_CAP_SLICE_THREADS |
                       AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE,
     .priv_data_size = sizeof(FlacEncodeContext),
     .init           = flac_encode_init,
-    FF_CODEC_ENCODE_CB(flac_encode_frame),
+    FF_CODEC_RECEIVE_PACKET_CB(flac_receive_packet),
     .close          = flac_encode_close,
     .p.sample_fmts  = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_S16,
                                                      AV_SAMPLE_FMT_S32,
                                                      AV_SAMPLE_FMT_NONE },
     .p.priv_class   = &flac_encoder_class,
-    .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP | FF_CODEC_CAP_EOF_FLUSH,
+    .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP,
 };
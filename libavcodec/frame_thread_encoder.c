@@ -24,9 +24,12 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/cpu.h"
+#include "libavutil/fifo.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
 #include "avcodec.h"
+#include "codec_internal.h"
 #include "encode.h"
 #include "internal.h"
 #include "pthread_internal.h"
@@ -38,12 +41,23 @@
  * the number of buffers. */
 #define BUFFER_SIZE (MAX_THREADS + 2)
 
+/* FF_THREAD_GOP buffers the input of every chunk being encoded plus the one
+ * being filled; fewer chunks are encoded in parallel when these raw frames
+ * would take more memory than this. */
+#define GOP_MAX_BUFFERED_SIZE (1LL << 30)
+
 typedef struct{
     AVFrame  *indata;
     AVPacket *outdata;
     int       return_code;
     int       finished;
     int       got_packet;
+
+    /* FF_THREAD_GOP: a chunk of input frames and its encoded packets */
+    AVFifo   *frames;
+    AVFifo   *packets;
+    int       nb_frames;
+    int64_t   start_frame;  ///< index of the first frame of the chunk
 } Task;
 
 typedef struct{
@@ -64,6 +78,13 @@ typedef struct{
 
     pthread_t worker[MAX_THREADS];
     atomic_int exit;
+
+    /* FF_THREAD_GOP */
+    int gop_mode;
+    int chunk_size;
+    AVCodecContext *template_avctx; ///< unopened copy of the user settings
+    AVFifo *out_packets;            ///< packets of finished chunks, in order
+    int64_t nb_frames_in;           ///< number of frames received so far
 } ThreadContext;
 
 #define OFF(member) offsetof(ThreadContext, member)
@@ -72,58 +93,236 @@ DEFINE_OFFSET_ARRAY(ThreadContext, thread_ctx, pthread_init_cnt,
                     (OFF(task_fifo_cond),  OFF(finished_task_cond)));
 #undef OFF
 
+/**
+ * Wait for the next task. Returns NULL when the threads shall exit.
+ */
+static Task *get_task(ThreadContext *c)
+{
+    unsigned task_index;
+
+    pthread_mutex_lock(&c->task_fifo_mutex);
+    while (c->next_task_index == c->task_index || atomic_load(&c->exit)) {
+        if (atomic_load(&c->exit)) {
+            pthread_mutex_unlock(&c->task_fifo_mutex);
+            return NULL;
+        }
+        pthread_cond_wait(&c->task_fifo_cond, &c->task_fifo_mutex);
+    }
+    task_index         = c->next_task_index;
+    c->next_task_index = (c->next_task_index + 1) % c->max_tasks;
+    pthread_mutex_unlock(&c->task_fifo_mutex);
+    /* The main thread ensures that any two outstanding tasks have
+     * different indices, ergo each worker thread owns its element
+     * of c->tasks with the exception of finished, which is shared
+     * with the main thread and guarded by finished_task_mutex. */
+    return &c->tasks[task_index];
+}
+
+static void finish_task(ThreadContext *c, Task *task, int ret)
+{
+    pthread_mutex_lock(&c->finished_task_mutex);
+    task->return_code = ret;
+    task->finished    = 1;
+    pthread_cond_signal(&c->finished_task_cond);
+    pthread_mutex_unlock(&c->finished_task_mutex);
+}
+
 static void * attribute_align_arg worker(void *v){
     AVCodecContext *avctx = v;
     ThreadContext *c = avctx->internal->frame_thread_encoder;
+    Task *task;
 
-    while (!atomic_load(&c->exit)) {
-        int ret;
-        AVPacket *pkt;
-        AVFrame *frame;
-        Task *task;
-        unsigned task_index;
+    while ((task = get_task(c))) {
+        int ret = ff_encode_encode_cb(avctx, task->outdata, task->indata,
+                                      &task->got_packet);
+        finish_task(c, task, ret);
+    }
 
-        pthread_mutex_lock(&c->task_fifo_mutex);
-        while (c->next_task_index == c->task_index || atomic_load(&c->exit)) {
-            if (atomic_load(&c->exit)) {
-                pthread_mutex_unlock(&c->task_fifo_mutex);
+    avcodec_close(avctx);
+    av_freep(&avctx);
+    return NULL;
+}
+
+/**
+ * Allocate an unopened encoder context with the settings of src,
+ * to be used by a single thread.
+ */
+static int clone_context(AVCodecContext **dst, const AVCodecContext *src)
+{
+    AVCodecContext *avctx = avcodec_alloc_context3(src->codec);
+    void *tmpv;
+    int ret;
+
+    *dst = avctx;
+    if (!avctx)
+        return AVERROR(ENOMEM);
+
+    tmpv = avctx->priv_data;
+    *avctx = *src;
+    avctx->priv_data       = tmpv;
+    avctx->internal        = NULL;
+    avctx->hw_frames_ctx   = NULL;
+    avctx->hw_device_ctx   = NULL;
+    avctx->thread_pool     = NULL;
+    avctx->extradata       = NULL;
+    avctx->extradata_size  = 0;
+    avctx->coded_side_data = NULL;
+    avctx->nb_coded_side_data = 0;
+    ret = av_opt_copy(avctx, src);
+    if (ret < 0)
+        return ret;
+    if (src->codec->priv_class) {
+        ret = av_opt_copy(avctx->priv_data, src->priv_data);
+        if (ret < 0)
+            return ret;
+    }
+    avctx->thread_count = 1;
+    avctx->thread_type &= ~FF_THREAD_GOP;
+    avctx->active_thread_type &= ~FF_THREAD_FRAME;
+
+    return 0;
+}
+
+static void free_context(AVCodecContext **avctx)
+{
+    avcodec_close(*avctx);
+    av_freep(avctx);
+}
+
+/**
+ * Encode one chunk of frames with a fresh encoder instance.
+ * The frames keep their timestamps and the instance is told the position
+ * of the chunk in the stream, so that the time codes written in the GOP
+ * headers continue across chunks.
+ */
+static int encode_chunk(ThreadContext *c, Task *task)
+{
+    AVCodecContext *avctx;
+    AVFrame *frame = NULL;
+    AVPacket *pkt  = NULL;
+    int ret;
+
+    ret = clone_context(&avctx, c->template_avctx);
+    if (ret < 0)
+        goto end;
+    ret = avcodec_open2(avctx, avctx->codec, NULL);
+    if (ret < 0)
+        goto end;
+    avctx->internal->gop_chunk_start = task->start_frame;
+
+    pkt = av_packet_alloc();
+    if (!pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    do {
+        frame = NULL;
+        av_fifo_read(task->frames, &frame, 1);
+        ret = avcodec_send_frame(avctx, frame);
+        av_frame_free(&frame);
+        if (ret < 0)
+            goto end;
+
+        while ((ret = avcodec_receive_packet(avctx, pkt)) >= 0) {
+            AVPacket *out = av_packet_alloc();
+            if (!out) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            av_packet_move_ref(out, pkt);
+            ret = av_fifo_write(task->packets, &out, 1);
+            if (ret < 0) {
+                av_packet_free(&out);
                 goto end;
             }
-            pthread_cond_wait(&c->task_fifo_cond, &c->task_fifo_mutex);
         }
-        task_index         = c->next_task_index;
-        c->next_task_index = (c->next_task_index + 1) % c->max_tasks;
-        pthread_mutex_unlock(&c->task_fifo_mutex);
-        /* The main thread ensures that any two outstanding tasks have
-         * different indices, ergo each worker thread owns its element
-         * of c->tasks with the exception of finished, which is shared
-         * with the main thread and guarded by finished_task_mutex. */
-        task  = &c->tasks[task_index];
-        frame = task->indata;
-        pkt   = task->outdata;
-
-        ret = ff_encode_encode_cb(avctx, pkt, frame, &task->got_packet);
-        pthread_mutex_lock(&c->finished_task_mutex);
-        task->return_code = ret;
-        task->finished    = 1;
-        pthread_cond_signal(&c->finished_task_cond);
-        pthread_mutex_unlock(&c->finished_task_mutex);
-    }
+    } while (ret == AVERROR(EAGAIN));
+    if (ret == AVERROR_EOF)
+        ret = 0;
+
 end:
-    avcodec_close(avctx);
-    av_freep(&avctx);
+    while (av_fifo_read(task->frames, &frame, 1) >= 0)
+        av_frame_free(&frame);
+    av_packet_free(&pkt);
+    free_context(&avctx);
+    return ret;
+}
+
+static void * attribute_align_arg gop_worker(void *v)
+{
+    ThreadContext *c = v;
+    Task *task;
+
+    while ((task = get_task(c)))
+        finish_task(c, task, encode_chunk(c, task));
+
     return NULL;
 }
 
+/**
+ * Check whether the input can be encoded in independent chunks.
+ */
+static int use_gop_mode(AVCodecContext *avctx)
+{
+    if (!(avctx->thread_type & FF_THREAD_GOP) ||
+        !(ffcodec(avctx->codec)->caps_internal & FF_CODEC_CAP_GOP_THREADS))
+        return 0;
+
+    if (avctx->flags & (AV_CODEC_FLAG_PASS1 | AV_CODEC_FLAG_PASS2 |
+                        AV_CODEC_FLAG_RECON_FRAME)) {
+        av_log(avctx, AV_LOG_WARNING,
+               "GOP threading does not support two-pass encoding or "
+               "reconstructed frame output, disabling it\n");
+        return 0;
+    }
+    if (avctx->gop_size <= 1) {
+        av_log(avctx, AV_LOG_DEBUG, "Not using GOP threading for intra-only encoding\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Limit the number of threads so that the frames buffered for GOP
+ * threading stay below GOP_MAX_BUFFERED_SIZE.
+ */
+static void limit_gop_threads(AVCodecContext *avctx)
+{
+    int frame_size = av_image_get_buffer_size(avctx->pix_fmt, avctx->width,
+                                              avctx->height, 1);
+    int64_t max_chunks;
+
+    if (frame_size <= 0)
+        return;
+    max_chunks = GOP_MAX_BUFFERED_SIZE / ((int64_t)frame_size * avctx->gop_size);
+    if (avctx->thread_count + 1 <= max_chunks)
+        return;
+
+    av_log(avctx, AV_LOG_WARNING,
+           "GOP threading with %d threads would buffer %d frames of %d bytes, "
+           "limiting it to %"PRId64" threads\n", avctx->thread_count,
+           (avctx->thread_count + 1) * avctx->gop_size, frame_size,
+           FFMAX(max_chunks - 1, 1));
+    avctx->thread_count = FFMAX(max_chunks - 1, 1);
+}
+
 av_cold int ff_frame_thread_encoder_init(AVCodecContext *avctx)
 {
     int i=0;
     ThreadContext *c;
     AVCodecContext *thread_avctx = NULL;
+    int gop_mode = use_gop_mode(avctx);
     int ret;
 
-    if(   !(avctx->thread_type & FF_THREAD_FRAME)
-       || !(avctx->codec->capabilities & AV_CODEC_CAP_FRAME_THREADS))
+    /* the worker contexts need threads of their own */
+    if (avctx->thread_pool)
+        return 0;
+
+    if(   !gop_mode
+       && (   !(avctx->thread_type & FF_THREAD_FRAME)
+           || !(avctx->codec->capabilities & AV_CODEC_CAP_FRAME_THREADS)))
         return 0;
 
     if(   !avctx->thread_count
@@ -166,6 +365,9 @@ av_cold int ff_frame_thread_encoder_init(AVCodecContext *avctx)
         avctx->thread_count = FFMIN(avctx->thread_count, MAX_THREADS);
     }
 
+    if (gop_mode)
+        limit_gop_threads(avctx);
+
     if(avctx->thread_count <= 1)
         return 0;
 
@@ -178,6 +380,8 @@ av_cold int ff_frame_thread_encoder_init(AVCodecContext *avctx)
         return AVERROR(ENOMEM);
 
     c->parent_avctx = avctx;
+    c->gop_mode     = gop_mode;
+    c->chunk_size   = avctx->gop_size;
 
     ret = ff_pthread_init(c, thread_ctx_offsets);
     if (ret < 0)
@@ -186,35 +390,45 @@ av_cold int ff_frame_thread_encoder_init(AVCodecContext *avctx)
 
     c->max_tasks = avctx->thread_count + 2;
     for (unsigned j = 0; j < c->max_tasks; j++) {
-        if (!(c->tasks[j].indata  = av_frame_alloc()) ||
-            !(c->tasks[j].outdata = av_packet_alloc())) {
+        if (gop_mode) {
+            if (!(c->tasks[j].frames  = av_fifo_alloc2(16, sizeof(AVFrame*),  AV_FIFO_FLAG_AUTO_GROW)) ||
+                !(c->tasks[j].packets = av_fifo_alloc2(16, sizeof(AVPacket*), AV_FIFO_FLAG_AUTO_GROW))) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+        } else if (!(c->tasks[j].indata  = av_frame_alloc()) ||
+                   !(c->tasks[j].outdata = av_packet_alloc())) {
             ret = AVERROR(ENOMEM);
             goto fail;
         }
     }
 
-    for(i=0; i<avctx->thread_count ; i++){
-        void *tmpv;
-        thread_avctx = avcodec_alloc_context3(avctx->codec);
-        if (!thread_avctx) {
+    if (gop_mode) {
+        c->out_packets = av_fifo_alloc2(16, sizeof(AVPacket*), AV_FIFO_FLAG_AUTO_GROW);
+        if (!c->out_packets) {
             ret = AVERROR(ENOMEM);
             goto fail;
         }
-        tmpv = thread_avctx->priv_data;
-        *thread_avctx = *avctx;
-        thread_avctx->priv_data = tmpv;
-        thread_avctx->internal = NULL;
-        thread_avctx->hw_frames_ctx = NULL;
-        ret = av_opt_copy(thread_avctx, avctx);
+        /* The chunk encoders are opened by the workers, from a copy
+         * of the settings taken before the main context is opened. */
+        ret = clone_context(&c->template_avctx, avctx);
         if (ret < 0)
             goto fail;
-        if (avctx->codec->priv_class) {
-            ret = av_opt_copy(thread_avctx->priv_data, avctx->priv_data);
-            if (ret < 0)
+        for (i = 0; i < avctx->thread_count; i++) {
+            if ((ret = pthread_create(&c->worker[i], NULL, gop_worker, c))) {
+                ret = AVERROR(ret);
                 goto fail;
+            }
         }
-        thread_avctx->thread_count = 1;
-        thread_avctx->active_thread_type &= ~FF_THREAD_FRAME;
+        avctx->active_thread_type = FF_THREAD_GOP;
+
+        return 0;
+    }
+
+    for(i=0; i<avctx->thread_count ; i++){
+        ret = clone_context(&thread_avctx, avctx);
+        if (ret < 0)
+            goto fail;
 
         if ((ret = avcodec_open2(thread_avctx, avctx->codec, NULL)) < 0)
             goto fail;
@@ -238,6 +452,28 @@ fail:
     return ret;
 }
 
+static void free_frames(AVFifo **fifo)
+{
+    AVFrame *frame;
+
+    if (!*fifo)
+        return;
+    while (av_fifo_read(*fifo, &frame, 1) >= 0)
+        av_frame_free(&frame);
+    av_fifo_freep2(fifo);
+}
+
+static void free_packets(AVFifo **fifo)
+{
+    AVPacket *pkt;
+
+    if (!*fifo)
+        return;
+    while (av_fifo_read(*fifo, &pkt, 1) >= 0)
+        av_packet_free(&pkt);
+    av_fifo_freep2(fifo);
+}
+
 av_cold void ff_frame_thread_encoder_free(AVCodecContext *avctx)
 {
     ThreadContext *c= avctx->internal->frame_thread_encoder;
@@ -258,12 +494,95 @@ av_cold void ff_frame_thread_encoder_free(AVCodecContext *avctx)
     for (unsigned i = 0; i < c->max_tasks; i++) {
         av_frame_free(&c->tasks[i].indata);
         av_packet_free(&c->tasks[i].outdata);
+        free_frames(&c->tasks[i].frames);
+        free_packets(&c->tasks[i].packets);
     }
+    free_packets(&c->out_packets);
+    if (c->template_avctx)
+        free_context(&c->template_avctx);
 
     ff_pthread_free(c, thread_ctx_offsets);
     av_freep(&avctx->internal->frame_thread_encoder);
 }
 
+static void submit_task(ThreadContext *c)
+{
+    pthread_mutex_lock(&c->task_fifo_mutex);
+    c->task_index = (c->task_index + 1) % c->max_tasks;
+    pthread_cond_signal(&c->task_fifo_cond);
+    pthread_mutex_unlock(&c->task_fifo_mutex);
+}
+
+static int gop_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
+                            AVFrame *frame, int *got_packet_ptr)
+{
+    ThreadContext *c = avctx->internal->frame_thread_encoder;
+    Task *intask = &c->tasks[c->task_index];
+    AVPacket *out;
+    int ret = 0;
+
+    if (frame) {
+        AVFrame *in = av_frame_alloc();
+        if (!in)
+            return AVERROR(ENOMEM);
+        av_frame_move_ref(in, frame);
+        ret = av_fifo_write(intask->frames, &in, 1);
+        if (ret < 0) {
+            av_frame_free(&in);
+            return ret;
+        }
+        if (!intask->nb_frames)
+            intask->start_frame = c->nb_frames_in;
+        c->nb_frames_in++;
+        if (++intask->nb_frames == c->chunk_size) {
+            intask->nb_frames = 0;
+            submit_task(c);
+        }
+    } else if (intask->nb_frames) {
+        intask->nb_frames = 0;
+        submit_task(c);
+    }
+
+    /* Collect the packets of all finished chunks, in order. Wait for the
+     * oldest chunk only when there is nothing to return and either no more
+     * input is coming or all threads are busy. */
+    while (c->finished_task_index != c->task_index) {
+        Task *outtask = &c->tasks[c->finished_task_index];
+
+        pthread_mutex_lock(&c->finished_task_mutex);
+        if (!outtask->finished &&
+            (av_fifo_can_read(c->out_packets) ||
+             (frame && (c->task_index - c->finished_task_index + c->max_tasks) % c->max_tasks <= avctx->thread_count))) {
+            pthread_mutex_unlock(&c->finished_task_mutex);
+            break;
+        }
+        while (!outtask->finished)
+            pthread_cond_wait(&c->finished_task_cond, &c->finished_task_mutex);
+        pthread_mutex_unlock(&c->finished_task_mutex);
+
+        outtask->finished = 0;
+        c->finished_task_index = (c->finished_task_index + 1) % c->max_tasks;
+        while (av_fifo_read(outtask->packets, &out, 1) >= 0) {
+            if (outtask->return_code >= 0)
+                ret = av_fifo_write(c->out_packets, &out, 1);
+            if (outtask->return_code < 0 || ret < 0)
+                av_packet_free(&out);
+        }
+        if (outtask->return_code < 0)
+            return outtask->return_code;
+        if (ret < 0)
+            return ret;
+    }
+
+    if (av_fifo_read(c->out_packets, &out, 1) >= 0) {
+        av_packet_move_ref(pkt, out);
+        av_packet_free(&out);
+        *got_packet_ptr = 1;
+    }
+
+    return 0;
+}
+
 int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                                  AVFrame *frame, int *got_packet_ptr)
 {
@@ -272,6 +591,9 @@ int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
 
     av_assert1(!*got_packet_ptr);
 
+    if (c->gop_mode)
+        return gop_encode_frame(avctx, pkt, frame, got_packet_ptr);
+
     if(frame){
         av_frame_move_ref(c->tasks[c->task_index].indata, frame);
 
@@ -28,6 +28,7 @@
 #include <inttypes.h>
 
 #include "libavutil/imgutils.h"
+#include "libavutil/thread.h"
 #include "mathops.h"
 #include "avcodec.h"
 #include "h264data.h"
@@ -588,22 +589,58 @@ fail:
     return AVERROR_INVALIDDATA;
 }
 
-static void init_dequant8_coeff_table(PPS *pps, const SPS *sps)
+static uint32_t flat_dequant4_table[QP_MAX_NUM + 1][16];
+static uint32_t flat_dequant8_table[QP_MAX_NUM + 1][64];
+
+static av_cold void init_flat_dequant_tables(void)
+{
+    for (int q = 0; q < QP_MAX_NUM + 1; q++) {
+        int shift = ff_h264_quant_div6[q];
+        int idx   = ff_h264_quant_rem6[q];
+        for (int x = 0; x < 16; x++)
+            flat_dequant4_table[q][(x >> 2) | ((x << 2) & 0xF)] =
+                ((uint32_t)ff_h264_dequant4_coeff_init[idx][(x & 1) + ((x >> 2) & 1)] * 16) << (shift + 2);
+        for (int x = 0; x < 64; x++)
+            flat_dequant8_table[q][(x >> 3) | ((x & 7) << 3)] =
+                ((uint32_t)ff_h264_dequant8_coeff_init[idx][ff_h264_dequant8_coeff_init_scan[((x >> 1) & 12) | (x & 3)]] * 16) << shift;
+    }
+}
+
+static int is_flat_matrix(const uint8_t *matrix, int size)
+{
+    for (int i = 0; i < size; i++)
+        if (matrix[i] != 16)
+            return 0;
+    return 1;
+}
+
+static int init_dequant8_coeff_table(PPS *pps, const SPS *sps)
 {
     int i, j, q, x;
     const int max_qp = 51 + 6 * (sps->bit_depth_luma - 8);
 
     for (i = 0; i < 6; i++) {
-        pps->dequant8_coeff[i] = pps->dequant8_buffer[i];
+        /* transform bypass patches the tables, so it needs private ones */
+        if (!sps->transform_bypass && is_flat_matrix(pps->scaling_matrix8[i], 64)) {
+            pps->dequant8_coeff[i] = flat_dequant8_table;
+            continue;
+        }
         for (j = 0; j < i; j++)
             if (!memcmp(pps->scaling_matrix8[j], pps->scaling_matrix8[i],
                         64 * sizeof(uint8_t))) {
-                pps->dequant8_coeff[i] = pps->dequant8_buffer[j];
+                pps->dequant8_coeff[i] = pps->dequant8_coeff[j];
                 break;
             }
         if (j < i)
             continue;
 
+        if (!pps->dequant8_buffer) {
+            pps->dequant8_buffer = av_malloc_array(6, sizeof(*pps->dequant8_buffer));
+            if (!pps->dequant8_buffer)
+                return AVERROR(ENOMEM);
+        }
+        pps->dequant8_coeff[i] = pps->dequant8_buffer[i];
+
         for (q = 0; q < max_qp + 1; q++) {
             int shift = ff_h264_quant_div6[q];
             int idx   = ff_h264_quant_rem6[q];
@@ -613,23 +650,35 @@ static void init_dequant8_coeff_table(PPS *pps, const SPS *sps)
                      pps->scaling_matrix8[i][x]) << shift;
         }
     }
+
+    return 0;
 }
 
-static void init_dequant4_coeff_table(PPS *pps, const SPS *sps)
+static int init_dequant4_coeff_table(PPS *pps, const SPS *sps)
 {
     int i, j, q, x;
     const int max_qp = 51 + 6 * (sps->bit_depth_luma - 8);
     for (i = 0; i < 6; i++) {
-        pps->dequant4_coeff[i] = pps->dequant4_buffer[i];
+        if (!sps->transform_bypass && is_flat_matrix(pps->scaling_matrix4[i], 16)) {
+            pps->dequant4_coeff[i] = flat_dequant4_table;
+            continue;
+        }
         for (j = 0; j < i; j++)
             if (!memcmp(pps->scaling_matrix4[j], pps->scaling_matrix4[i],
                         16 * sizeof(uint8_t))) {
-                pps->dequant4_coeff[i] = pps->dequant4_buffer[j];
+                pps->dequant4_coeff[i] = pps->dequant4_coeff[j];
                 break;
             }
         if (j < i)
             continue;
 
+        if (!pps->dequant4_buffer) {
+            pps->dequant4_buffer = av_malloc_array(6, sizeof(*pps->dequant4_buffer));
+            if (!pps->dequant4_buffer)
+                return AVERROR(ENOMEM);
+        }
+        pps->dequant4_coeff[i] = pps->dequant4_buffer[i];
+
         for (q = 0; q < max_qp + 1; q++) {
             int shift = ff_h264_quant_div6[q] + 2;
             int idx   = ff_h264_quant_rem6[q];
@@ -639,16 +688,27 @@ static void init_dequant4_coeff_table(PPS *pps, const SPS *sps)
                      pps->scaling_matrix4[i][x]) << shift;
         }
     }
+
+    return 0;
 }
 
-static void init_dequant_tables(PPS *pps, const SPS *sps)
+static int init_dequant_tables(PPS *pps, const SPS *sps)
 {
-    int i, x;
-    init_dequant4_coeff_table(pps, sps);
+    static AVOnce init_static_once = AV_ONCE_INIT;
+    int i, x, ret;
+
+    ff_thread_once(&init_static_once, init_flat_dequant_tables);
+
+    ret = init_dequant4_coeff_table(pps, sps);
+    if (ret < 0)
+        return ret;
     memset(pps->dequant8_coeff, 0, sizeof(pps->dequant8_coeff));
 
-    if (pps->transform_8x8_mode)
-        init_dequant8_coeff_table(pps, sps);
+    if (pps->transform_8x8_mode) {
+        ret = init_dequant8_coeff_table(pps, sps);
+        if (ret < 0)
+            return ret;
+    }
     if (sps->transform_bypass) {
         for (i = 0; i < 6; i++)
             for (x = 0; x < 16; x++)
@@ -658,6 +718,8 @@ static void init_dequant_tables(PPS *pps, const SPS *sps)
                 for (x = 0; x < 64; x++)
                     pps->dequant8_coeff[i][0][x] = 1 << 6;
     }
+
+    return 0;
 }
 
 static void build_qp_table(PPS *pps, int t, int index, const int depth)
@@ -688,6 +750,8 @@ static void pps_free(void *opaque, uint8_t *data)
     PPS *pps = (PPS*)data;
 
     av_buffer_unref(&pps->sps_ref);
+    av_freep(&pps->dequant4_buffer);
+    av_freep(&pps->dequant8_buffer);
 
     av_freep(&data);
 }
@@ -821,7 +885,9 @@ int ff_h264_decode_picture_parameter_set(GetBitContext *gb, AVCodecContext *avct
     build_qp_table(pps, 1, pps->chroma_qp_index_offset[1],
                    sps->bit_depth_luma);
 
-    init_dequant_tables(pps, sps);
+    ret = init_dequant_tables(pps, sps);
+    if (ret < 0)
+        goto fail;
 
     if (pps->chroma_qp_index_offset[0] != pps->chroma_qp_index_offset[1])
         pps->chroma_qp_diff = 1;
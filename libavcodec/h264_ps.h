@@ -125,8 +125,10 @@ typedef struct PPS {
     uint8_t data[4096];
     size_t data_size;
 
-    uint32_t dequant4_buffer[6][QP_MAX_NUM + 1][16];
-    uint32_t dequant8_buffer[6][QP_MAX_NUM + 1][64];
+    /* Tables for non-flat scaling lists; NULL when all lists are flat and
+     * dequant*_coeff point to tables shared by all decoder instances. */
+    uint32_t (*dequant4_buffer)[QP_MAX_NUM + 1][16];
+    uint32_t (*dequant8_buffer)[QP_MAX_NUM + 1][64];
     uint32_t(*dequant4_coeff[6])[16];
     uint32_t(*dequant8_coeff[6])[64];
 
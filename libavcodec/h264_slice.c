@@ -407,6 +407,7 @@ int ff_h264_update_thread_context(AVCodecContext *dst,
     // extradata/NAL handling
     h->is_avc = h1->is_avc;
     h->nal_length_size = h1->nal_length_size;
+    h->allocated_bytes = h1->allocated_bytes;
 
     memcpy(&h->poc,        &h1->poc,        sizeof(h->poc));
 
@@ -463,6 +464,7 @@ int ff_h264_update_thread_context_for_user(AVCodecContext *dst,
 
     h->is_avc = h1->is_avc;
     h->nal_length_size = h1->nal_length_size;
+    h->allocated_bytes = h1->allocated_bytes;
 
     return 0;
 }
@@ -1278,7 +1280,8 @@ static int h264_select_output_frame(H264Context *h)
 
     if (sps->bitstream_restriction_flag ||
         h->avctx->strict_std_compliance >= FF_COMPLIANCE_STRICT) {
-        h->avctx->has_b_frames = FFMAX(h->avctx->has_b_frames, sps->num_reorder_frames);
+        h->avctx->has_b_frames = FFMAX(h->avctx->has_b_frames,
+                                       get_num_reorder_frames(h, sps));
     }
 
     for (i = 0; 1; i++) {
@@ -1302,8 +1305,13 @@ static int h264_select_output_frame(H264Context *h)
         cur->mmco_reset = 1;
     } else if(h->avctx->has_b_frames < out_of_order && !sps->bitstream_restriction_flag){
         int loglevel = h->avctx->frame_num > 1 ? AV_LOG_WARNING : AV_LOG_VERBOSE;
-        av_log(h->avctx, loglevel, "Increasing reorder buffer to %d\n", out_of_order);
-        h->avctx->has_b_frames = out_of_order;
+        int max_delay = h->low_memory ? get_num_reorder_frames(h, sps) : out_of_order;
+
+        if (h->avctx->has_b_frames < max_delay) {
+            out_of_order = FFMIN(out_of_order, max_delay);
+            av_log(h->avctx, loglevel, "Increasing reorder buffer to %d\n", out_of_order);
+            h->avctx->has_b_frames = out_of_order;
+        }
     }
 
     pics = 0;
@@ -1384,8 +1392,8 @@ static int h264_field_start(H264Context *h, const H264SliceContext *sl,
     sps = h->ps.sps;
 
     if (sps && sps->bitstream_restriction_flag &&
-        h->avctx->has_b_frames < sps->num_reorder_frames) {
-        h->avctx->has_b_frames = sps->num_reorder_frames;
+        h->avctx->has_b_frames < get_num_reorder_frames(h, sps)) {
+        h->avctx->has_b_frames = get_num_reorder_frames(h, sps);
     }
 
     last_pic_droppable   = h->droppable;
@@ -2385,6 +2393,43 @@ static int fill_filter_caches(const H264Context *h, H264SliceContext *sl, int mb
     return 0;
 }
 
+#if HAVE_THREADS
+static void report_mb_progress(AVCodecContext *avctx, int filtered, int n)
+{
+    H264Context *h = avctx->priv_data;
+
+    pthread_mutex_lock(&h->progress_mutex);
+    atomic_store_explicit(filtered ? &h->mb_filtered : &h->mb_decoded, n,
+                          memory_order_release);
+    pthread_cond_broadcast(&h->progress_cond);
+    pthread_mutex_unlock(&h->progress_mutex);
+}
+
+/**
+ * Wait until n macroblocks of the picture are decoded or filtered.
+ *
+ * @return 0 once they are, 1 if decoding of the slice ended before
+ */
+static int await_mb_progress(AVCodecContext *avctx, int filtered, int n)
+{
+    H264Context *h = avctx->priv_data;
+    atomic_int *progress = filtered ? &h->mb_filtered : &h->mb_decoded;
+    int ret;
+
+    if (atomic_load_explicit(progress, memory_order_acquire) >= n)
+        return 0;
+
+    pthread_mutex_lock(&h->progress_mutex);
+    while (atomic_load_explicit(progress, memory_order_relaxed) < n &&
+           !h->slice_decoded)
+        pthread_cond_wait(&h->progress_cond, &h->progress_mutex);
+    ret = atomic_load_explicit(progress, memory_order_relaxed) < n;
+    pthread_mutex_unlock(&h->progress_mutex);
+
+    return ret;
+}
+#endif
+
 static void loop_filter(const H264Context *h, H264SliceContext *sl, int start_x, int end_x)
 {
     uint8_t *dest_y, *dest_cb, *dest_cr;
@@ -2397,6 +2442,14 @@ static void loop_filter(const H264Context *h, H264SliceContext *sl, int start_x,
     if (h->postpone_filter)
         return;
 
+#if HAVE_THREADS
+    if (sl->filter_pipeline) {
+        report_mb_progress(h->avctx, 0, sl->mb_y * h->mb_width + end_x);
+        sl->mb_x = end_x;
+        return;
+    }
+#endif
+
     if (sl->deblocking_filter) {
         for (mb_x = start_x; mb_x < end_x; mb_x++)
             for (mb_y = end_mb_y - FRAME_MBAFF(h); mb_y <= end_mb_y; mb_y++) {
@@ -2455,6 +2508,21 @@ static void loop_filter(const H264Context *h, H264SliceContext *sl, int start_x,
     sl->chroma_qp[1] = get_chroma_qp(h->ps.pps, 1, sl->qscale);
 }
 
+/**
+ * With the loop filter pipelined, wait until the macroblocks above the
+ * current one, whose unfiltered bottom line is swapped in for intra
+ * prediction, are deblocked.
+ */
+static av_always_inline void await_loop_filter(const H264Context *h,
+                                               const H264SliceContext *sl)
+{
+#if HAVE_THREADS
+    if (sl->filter_pipeline && sl->mb_y)
+        await_mb_progress(h->avctx, 1, (sl->mb_y - 1) * h->mb_width +
+                                       FFMIN(sl->mb_x + 2, h->mb_width));
+#endif
+}
+
 static void predict_field_decoding_flag(const H264Context *h, H264SliceContext *sl)
 {
     const int mb_xy = sl->mb_x + sl->mb_y * h->mb_stride;
@@ -2536,6 +2604,13 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
     sl->is_complex = FRAME_MBAFF(h) || h->picture_structure != PICT_FRAME ||
                      (CONFIG_GRAY && (h->flags & AV_CODEC_FLAG_GRAY));
 
+#if HAVE_THREADS
+    if (sl->filter_pipeline) {
+        *h->filter_sl = *sl;
+        h->filter_sl->filter_pipeline = 0;
+    }
+#endif
+
     if (!(h->avctx->active_thread_type & FF_THREAD_SLICE) && h->picture_structure == PICT_FRAME && sl->er->error_status_table) {
         const int start_i  = av_clip(sl->resync_mb_x + sl->resync_mb_y * h->mb_width, 0, h->mb_num - 1);
         if (start_i) {
@@ -2571,6 +2646,7 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
 
             ret = ff_h264_decode_mb_cabac(h, sl);
 
+            await_loop_filter(h, sl);
             if (ret >= 0)
                 ff_h264_hl_decode_mb(h, sl);
 
@@ -2642,6 +2718,7 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
 
             ret = ff_h264_decode_mb_cavlc(h, sl);
 
+            await_loop_filter(h, sl);
             if (ret >= 0)
                 ff_h264_hl_decode_mb(h, sl);
 
@@ -2718,6 +2795,43 @@ finish:
     return 0;
 }
 
+#if HAVE_THREADS
+static int decode_slice_pipeline(AVCodecContext *avctx, void *arg,
+                                 int jobnr, int threadnr)
+{
+    H264Context *h = avctx->priv_data;
+    int ret = decode_slice(avctx, arg);
+
+    pthread_mutex_lock(&h->progress_mutex);
+    h->slice_decoded = 1;
+    pthread_cond_broadcast(&h->progress_cond);
+    pthread_mutex_unlock(&h->progress_mutex);
+
+    return ret;
+}
+
+/**
+ * Deblock the macroblocks of the slice in raster order, each as soon as
+ * the row containing it is decoded.
+ */
+static int loop_filter_proc(AVCodecContext *avctx)
+{
+    H264Context *h       = avctx->priv_data;
+    H264SliceContext *sl = h->filter_sl;
+    int mb_index = atomic_load_explicit(&h->mb_filtered, memory_order_relaxed);
+
+    while (!await_mb_progress(avctx, 0, mb_index + 1)) {
+        int mb_x = mb_index % h->mb_width;
+
+        sl->mb_y = mb_index / h->mb_width;
+        loop_filter(h, sl, mb_x, mb_x + 1);
+        report_mb_progress(avctx, 1, ++mb_index);
+    }
+
+    return 0;
+}
+#endif
+
 /**
  * Call decode_slice() for each context.
  *
@@ -2743,6 +2857,24 @@ int ff_h264_execute_decode_slices(H264Context *h)
         h->slice_ctx[0].next_slice_idx = h->mb_width * h->mb_height;
         h->postpone_filter = 0;
 
+#if HAVE_THREADS
+        sl = &h->slice_ctx[0];
+        if (h->pthread_init_cnt && sl->deblocking_filter &&
+            h->picture_structure == PICT_FRAME && !FRAME_MBAFF(h) &&
+            !avctx->draw_horiz_band &&
+            (h->filter_sl || (h->filter_sl = av_mallocz(sizeof(*h->filter_sl))))) {
+            int mb_index = sl->mb_y * h->mb_width + sl->mb_x;
+
+            sl->filter_pipeline = 1;
+            h->slice_decoded    = 0;
+            atomic_store(&h->mb_decoded,  mb_index);
+            atomic_store(&h->mb_filtered, mb_index);
+
+            ff_slice_thread_execute_with_mainfunc(avctx, decode_slice_pipeline,
+                                                  loop_filter_proc, sl, &ret, 1);
+            sl->filter_pipeline = 0;
+        } else
+#endif
         ret = decode_slice(avctx, &h->slice_ctx[0]);
         h->mb_y = h->slice_ctx[0].mb_y;
         if (ret < 0)
@@ -48,6 +48,7 @@
 #include "hwconfig.h"
 #include "mpegutils.h"
 #include "profiles.h"
+#include "pthread_internal.h"
 #include "rectangle.h"
 #include "thread.h"
 #include "threadframe.h"
@@ -57,7 +58,7 @@ const uint16_t ff_h264_mb_sizes[4] = { 256, 384, 512, 768 };
 int avpriv_h264_has_num_reorder_frames(AVCodecContext *avctx)
 {
     H264Context *h = avctx->priv_data;
-    return h && h->ps.sps ? h->ps.sps->num_reorder_frames : 0;
+    return h && h->ps.sps ? get_num_reorder_frames(h, h->ps.sps) : 0;
 }
 
 static void h264_er_decode_mb(void *opaque, int ref, int mv_dir, int mv_type,
@@ -196,6 +197,16 @@ int ff_h264_alloc_tables(H264Context *h)
         !FF_ALLOCZ_TYPED_ARRAY(h->mb2b_xy,                big_mb_num)      ||
         !FF_ALLOCZ_TYPED_ARRAY(h->mb2br_xy,               big_mb_num))
         return AVERROR(ENOMEM);
+    h->tables_size = row_mb_num * 8 * (sizeof(*h->intra4x4_pred_mode) +
+                                       2 * sizeof(*h->mvd_table[0])) +
+                     st_size * sizeof(*h->slice_table_base) +
+                     big_mb_num * (sizeof(*h->non_zero_count)         +
+                                   sizeof(*h->cbp_table)              +
+                                   sizeof(*h->chroma_pred_mode_table) +
+                                   4 * sizeof(*h->direct_table)       +
+                                   sizeof(*h->list_counts)            +
+                                   sizeof(*h->mb2b_xy)                +
+                                   sizeof(*h->mb2br_xy));
     h->slice_ctx[0].intra4x4_pred_mode = h->intra4x4_pred_mode;
     h->slice_ctx[0].mvd_table[0] = h->mvd_table[0];
     h->slice_ctx[0].mvd_table[1] = h->mvd_table[1];
@@ -211,7 +222,8 @@ int ff_h264_alloc_tables(H264Context *h)
             h->mb2br_xy[mb_xy] = 8 * (FMO ? mb_xy : (mb_xy % (2 * h->mb_stride)));
         }
 
-    if (CONFIG_ERROR_RESILIENCE) {
+    /* the tables are only needed if error concealment may run */
+    if (CONFIG_ERROR_RESILIENCE && h->enable_er) {
         const int er_size = h->mb_height * h->mb_stride * (4*sizeof(int) + 1);
         int mb_array_size = h->mb_height * h->mb_stride;
         int y_size  = (2 * h->mb_width + 1) * (2 * h->mb_height + 1);
@@ -235,6 +247,10 @@ int ff_h264_alloc_tables(H264Context *h)
             !FF_ALLOCZ_TYPED_ARRAY(er->er_temp_buffer,     er_size)       ||
             !FF_ALLOCZ_TYPED_ARRAY(h->dc_val_base,         yc_size))
             return AVERROR(ENOMEM); // ff_h264_free_tables will clean up for us
+        h->tables_size += (h->mb_num + 1) * sizeof(*er->mb_index2xy)       +
+                          mb_array_size   * sizeof(*er->error_status_table) +
+                          er_size         * sizeof(*er->er_temp_buffer)     +
+                          yc_size         * sizeof(*h->dc_val_base);
 
         for (y = 0; y < h->mb_height; y++)
             for (x = 0; x < h->mb_width; x++)
@@ -280,6 +296,12 @@ static int h264_init_pic(H264Picture *pic)
     return 0;
 }
 
+#if HAVE_THREADS
+DEFINE_OFFSET_ARRAY(H264Context, h264_context, pthread_init_cnt,
+                    (offsetof(H264Context, progress_mutex)),
+                    (offsetof(H264Context, progress_cond)));
+#endif
+
 static int h264_init_context(AVCodecContext *avctx, H264Context *h)
 {
     int i, ret;
@@ -326,6 +348,14 @@ static int h264_init_context(AVCodecContext *avctx, H264Context *h)
     for (i = 0; i < h->nb_slice_ctx; i++)
         h->slice_ctx[i].h264 = h;
 
+#if HAVE_THREADS
+    if (avctx->active_thread_type & FF_THREAD_SLICE) {
+        ret = ff_pthread_init(h, h264_context_offsets);
+        if (ret < 0)
+            return ret;
+    }
+#endif
+
     return 0;
 }
 
@@ -354,6 +384,12 @@ static av_cold int h264_decode_end(AVCodecContext *avctx)
     av_freep(&h->slice_ctx);
     h->nb_slice_ctx = 0;
 
+#if HAVE_THREADS
+    /* the buffers of filter_sl belong to slice_ctx[0] */
+    av_freep(&h->filter_sl);
+    ff_pthread_free(h, h264_context_offsets);
+#endif
+
     ff_h264_sei_uninit(&h->sei);
     ff_h264_ps_uninit(&h->ps);
 
@@ -402,8 +438,8 @@ static av_cold int h264_decode_init(AVCodecContext *avctx)
     }
 
     if (h->ps.sps && h->ps.sps->bitstream_restriction_flag &&
-        h->avctx->has_b_frames < h->ps.sps->num_reorder_frames) {
-        h->avctx->has_b_frames = h->ps.sps->num_reorder_frames;
+        h->avctx->has_b_frames < get_num_reorder_frames(h, h->ps.sps)) {
+        h->avctx->has_b_frames = get_num_reorder_frames(h, h->ps.sps);
     }
 
     ff_h264_flush_change(h);
@@ -890,10 +926,70 @@ static int is_avcc_extradata(const uint8_t *buf, int buf_size)
     return 1;
 }
 
+static int64_t buffer_size(const AVBufferRef *buf)
+{
+    return buf ? buf->size : 0;
+}
+
+static int64_t frame_buffers_size(const AVFrame *f)
+{
+    int64_t size = 0;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(f->buf) && f->buf[i]; i++)
+        size += f->buf[i]->size;
+    for (int i = 0; i < f->nb_extended_buf; i++)
+        size += f->extended_buf[i]->size;
+
+    return size;
+}
+
+/**
+ * Sum up the memory referenced by this context: the pictures in the DPB
+ * with their per-picture tables, the per-context tables and the parameter
+ * sets. Buffers shared between frame threads are counted once per thread.
+ */
+static void update_allocated_bytes(H264Context *h)
+{
+    int64_t size = h->tables_size;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(h->ps.sps_list); i++)
+        if (h->ps.sps_list[i])
+            size += h->ps.sps_list[i]->size;
+    for (int i = 0; i < FF_ARRAY_ELEMS(h->ps.pps_list); i++) {
+        const PPS *pps;
+
+        if (!h->ps.pps_list[i])
+            continue;
+        pps   = (const PPS*)h->ps.pps_list[i]->data;
+        size += h->ps.pps_list[i]->size;
+        if (pps->dequant4_buffer)
+            size += 6 * sizeof(*pps->dequant4_buffer);
+        if (pps->dequant8_buffer)
+            size += 6 * sizeof(*pps->dequant8_buffer);
+    }
+
+    for (int i = 0; i < H264_MAX_PICTURE_COUNT; i++) {
+        const H264Picture *pic = &h->DPB[i];
+
+        if (!pic->f->buf[0])
+            continue;
+        size += frame_buffers_size(pic->f) + frame_buffers_size(pic->f_grain);
+        size += buffer_size(pic->qscale_table_buf) + buffer_size(pic->mb_type_buf) +
+                buffer_size(pic->hwaccel_priv_buf);
+        for (int j = 0; j < 2; j++)
+            size += buffer_size(pic->motion_val_buf[j]) +
+                    buffer_size(pic->ref_index_buf[j]);
+    }
+
+    h->allocated_bytes = size;
+}
+
 static int finalize_frame(H264Context *h, AVFrame *dst, H264Picture *out, int *got_frame)
 {
     int ret;
 
+    update_allocated_bytes(h);
+
     if (((h->avctx->flags & AV_CODEC_FLAG_OUTPUT_CORRUPT) ||
          (h->avctx->flags2 & AV_CODEC_FLAG2_SHOW_ALL) ||
          out->recovered)) {
@@ -1049,6 +1145,8 @@ static const AVOption h264_options[] = {
     { "is_avc", "is avc", OFFSET(is_avc), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, VDX },
     { "nal_length_size", "nal_length_size", OFFSET(nal_length_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 4, VDX },
     { "enable_er", "Enable error resilience on damaged frames (unsafe)", OFFSET(enable_er), AV_OPT_TYPE_BOOL, { .i64 = -1 }, -1, 1, VD },
+    { "low_memory", "Bound the reorder buffer by max_num_ref_frames instead of the level limits", OFFSET(low_memory), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, VD },
+    { "allocated_bytes", "Bytes held by the decoder for frames, tables and parameter sets", OFFSET(allocated_bytes), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, VDX | AV_OPT_FLAG_READONLY },
     { "x264_build", "Assume this x264 version if no x264 version found in any SEI", OFFSET(x264_build), AV_OPT_TYPE_INT, {.i64 = -1}, -1, INT_MAX, VD },
     { NULL },
 };
@@ -1097,7 +1195,8 @@ const FFCodec ff_h264_decoder = {
                                NULL
                            },
     .caps_internal         = FF_CODEC_CAP_EXPORTS_CROPPING |
-                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP,
+                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP |
+                             FF_CODEC_CAP_SLICE_THREAD_HAS_MF,
     .flush                 = h264_decode_flush,
     UPDATE_THREAD_CONTEXT(ff_h264_update_thread_context),
     UPDATE_THREAD_CONTEXT_FOR_USER(ff_h264_update_thread_context_for_user),
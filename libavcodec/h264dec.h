@@ -28,9 +28,12 @@
 #ifndef AVCODEC_H264DEC_H
 #define AVCODEC_H264DEC_H
 
+#include <stdatomic.h>
+
 #include "libavutil/buffer.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem_internal.h"
+#include "libavutil/thread.h"
 
 #include "cabac.h"
 #include "error_resilience.h"
@@ -279,6 +282,12 @@ typedef struct H264SliceContext {
     int edge_emu_buffer_allocated;
     int top_borders_allocated[2];
 
+    /**
+     * Set while the loop filter of this slice runs on another thread,
+     * see ff_h264_execute_decode_slices().
+     */
+    int filter_pipeline;
+
     /**
      * non zero coeff count cache.
      * is 64 if not available.
@@ -366,6 +375,18 @@ typedef struct H264Context {
      */
     int postpone_filter;
 
+#if HAVE_THREADS
+    /* Loop filter pipelining with slice threads: the deblocking of a lone
+     * slice trails its decoding by one macroblock row on another thread. */
+    H264SliceContext *filter_sl;    ///< context the loop filter runs with
+    pthread_mutex_t progress_mutex;
+    pthread_cond_t progress_cond;
+    atomic_int mb_decoded;          ///< macroblocks in raster order ready to be filtered
+    atomic_int mb_filtered;         ///< macroblocks in raster order filtered
+    int slice_decoded;
+    unsigned pthread_init_cnt;
+#endif
+
     /*
      * Set to 1 when the current picture is IDR, 0 otherwise.
      */
@@ -545,6 +566,10 @@ typedef struct H264Context {
     ERContext er;
     int16_t *dc_val_base;
 
+    int low_memory;
+    int64_t allocated_bytes;    ///< exported, see update_allocated_bytes()
+    size_t tables_size;         ///< bytes allocated by ff_h264_alloc_tables()
+
     H264SEIContext sei;
 
     AVBufferPool *qscale_table_pool;
@@ -767,6 +792,20 @@ static av_always_inline void write_back_motion(const H264Context *h,
     }
 }
 
+/**
+ * Get the number of frames that may have to be buffered for reordering.
+ * Without VUI bitstream restrictions the SPS carries a worst-case value
+ * derived from the level limits, which low-memory mode bounds by
+ * max_num_ref_frames instead. In low-memory mode this also caps the reorder
+ * buffer grown when out-of-order frames are detected.
+ */
+static inline int get_num_reorder_frames(const H264Context *h, const SPS *sps)
+{
+    if (h->low_memory && !sps->bitstream_restriction_flag)
+        return FFMIN(sps->num_reorder_frames, sps->ref_frame_count);
+    return sps->num_reorder_frames;
+}
+
 static av_always_inline int get_dct8x8_allowed(const H264Context *h, H264SliceContext *sl)
 {
     if (h->ps.sps->direct_8x8_inference_flag)
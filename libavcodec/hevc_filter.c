@@ -720,17 +720,84 @@ static int boundary_strength(const HEVCContext *s, const MvField *curr, const Mv
     return 1;
 }
 
+static void deblocking_bs_upper(const HEVCContext *s, int x0, int y0, int size,
+                                const RefPicList *rpl_top)
+{
+    const MvField *tab_mvf = s->ref->tab_mvf;
+    int log2_min_pu_size = s->ps.sps->log2_min_pu_size;
+    int log2_min_tu_size = s->ps.sps->log2_min_tb_size;
+    int min_pu_width     = s->ps.sps->min_pu_width;
+    int min_tu_width     = s->ps.sps->min_tb_width;
+    int yp_pu = (y0 - 1) >> log2_min_pu_size;
+    int yq_pu =  y0      >> log2_min_pu_size;
+    int yp_tu = (y0 - 1) >> log2_min_tu_size;
+    int yq_tu =  y0      >> log2_min_tu_size;
+    int i, bs;
+
+    for (i = 0; i < size; i += 4) {
+        int x_pu = (x0 + i) >> log2_min_pu_size;
+        int x_tu = (x0 + i) >> log2_min_tu_size;
+        const MvField *top  = &tab_mvf[yp_pu * min_pu_width + x_pu];
+        const MvField *curr = &tab_mvf[yq_pu * min_pu_width + x_pu];
+        uint8_t top_cbf_luma  = s->cbf_luma[yp_tu * min_tu_width + x_tu];
+        uint8_t curr_cbf_luma = s->cbf_luma[yq_tu * min_tu_width + x_tu];
+
+        if (curr->pred_flag == PF_INTRA || top->pred_flag == PF_INTRA)
+            bs = 2;
+        else if (curr_cbf_luma || top_cbf_luma)
+            bs = 1;
+        else
+            bs = boundary_strength(s, curr, top, rpl_top);
+        s->horizontal_bs[((x0 + i) + y0 * s->bs_width) >> 2] = bs;
+    }
+}
+
+static void deblocking_bs_left(const HEVCContext *s, int x0, int y0, int size,
+                               const RefPicList *rpl_left)
+{
+    const MvField *tab_mvf = s->ref->tab_mvf;
+    int log2_min_pu_size = s->ps.sps->log2_min_pu_size;
+    int log2_min_tu_size = s->ps.sps->log2_min_tb_size;
+    int min_pu_width     = s->ps.sps->min_pu_width;
+    int min_tu_width     = s->ps.sps->min_tb_width;
+    int xp_pu = (x0 - 1) >> log2_min_pu_size;
+    int xq_pu =  x0      >> log2_min_pu_size;
+    int xp_tu = (x0 - 1) >> log2_min_tu_size;
+    int xq_tu =  x0      >> log2_min_tu_size;
+    int i, bs;
+
+    for (i = 0; i < size; i += 4) {
+        int y_pu      = (y0 + i) >> log2_min_pu_size;
+        int y_tu      = (y0 + i) >> log2_min_tu_size;
+        const MvField *left = &tab_mvf[y_pu * min_pu_width + xp_pu];
+        const MvField *curr = &tab_mvf[y_pu * min_pu_width + xq_pu];
+        uint8_t left_cbf_luma = s->cbf_luma[y_tu * min_tu_width + xp_tu];
+        uint8_t curr_cbf_luma = s->cbf_luma[y_tu * min_tu_width + xq_tu];
+
+        if (curr->pred_flag == PF_INTRA || left->pred_flag == PF_INTRA)
+            bs = 2;
+        else if (curr_cbf_luma || left_cbf_luma)
+            bs = 1;
+        else
+            bs = boundary_strength(s, curr, left, rpl_left);
+        s->vertical_bs[(x0 + (y0 + i) * s->bs_width) >> 2] = bs;
+    }
+}
+
 void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, int x0, int y0,
                                            int log2_trafo_size)
 {
     const HEVCContext *s = lc->parent;
     const MvField *tab_mvf = s->ref->tab_mvf;
     int log2_min_pu_size = s->ps.sps->log2_min_pu_size;
-    int log2_min_tu_size = s->ps.sps->log2_min_tb_size;
     int min_pu_width     = s->ps.sps->min_pu_width;
-    int min_tu_width     = s->ps.sps->min_tb_width;
     int is_intra = tab_mvf[(y0 >> log2_min_pu_size) * min_pu_width +
                            (x0 >> log2_min_pu_size)].pred_flag == PF_INTRA;
+    /* with tiles decoded in parallel, the neighbouring tile may not be
+     * decoded yet, ff_hevc_deblocking_boundary_strengths_tile() is called
+     * for the tile boundaries instead */
+    int tile_edges = s->ps.pps->loop_filter_across_tiles_enabled_flag &&
+                     !s->enable_parallel_tiles;
     int boundary_upper, boundary_left;
     int i, j, bs;
 
@@ -739,7 +806,7 @@ void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, int x0, int y0,
         ((!s->sh.slice_loop_filter_across_slices_enabled_flag &&
           lc->boundary_flags & BOUNDARY_UPPER_SLICE &&
           (y0 % (1 << s->ps.sps->log2_ctb_size)) == 0) ||
-         (!s->ps.pps->loop_filter_across_tiles_enabled_flag &&
+         (!tile_edges &&
           lc->boundary_flags & BOUNDARY_UPPER_TILE &&
           (y0 % (1 << s->ps.sps->log2_ctb_size)) == 0)))
         boundary_upper = 0;
@@ -748,27 +815,7 @@ void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, int x0, int y0,
         const RefPicList *rpl_top = (lc->boundary_flags & BOUNDARY_UPPER_SLICE) ?
                                     ff_hevc_get_ref_list(s, s->ref, x0, y0 - 1) :
                                     s->ref->refPicList;
-        int yp_pu = (y0 - 1) >> log2_min_pu_size;
-        int yq_pu =  y0      >> log2_min_pu_size;
-        int yp_tu = (y0 - 1) >> log2_min_tu_size;
-        int yq_tu =  y0      >> log2_min_tu_size;
-
-            for (i = 0; i < (1 << log2_trafo_size); i += 4) {
-                int x_pu = (x0 + i) >> log2_min_pu_size;
-                int x_tu = (x0 + i) >> log2_min_tu_size;
-                const MvField *top  = &tab_mvf[yp_pu * min_pu_width + x_pu];
-                const MvField *curr = &tab_mvf[yq_pu * min_pu_width + x_pu];
-                uint8_t top_cbf_luma  = s->cbf_luma[yp_tu * min_tu_width + x_tu];
-                uint8_t curr_cbf_luma = s->cbf_luma[yq_tu * min_tu_width + x_tu];
-
-                if (curr->pred_flag == PF_INTRA || top->pred_flag == PF_INTRA)
-                    bs = 2;
-                else if (curr_cbf_luma || top_cbf_luma)
-                    bs = 1;
-                else
-                    bs = boundary_strength(s, curr, top, rpl_top);
-                s->horizontal_bs[((x0 + i) + y0 * s->bs_width) >> 2] = bs;
-            }
+        deblocking_bs_upper(s, x0, y0, 1 << log2_trafo_size, rpl_top);
     }
 
     // bs for vertical TU boundaries
@@ -777,7 +824,7 @@ void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, int x0, int y0,
         ((!s->sh.slice_loop_filter_across_slices_enabled_flag &&
           lc->boundary_flags & BOUNDARY_LEFT_SLICE &&
           (x0 % (1 << s->ps.sps->log2_ctb_size)) == 0) ||
-         (!s->ps.pps->loop_filter_across_tiles_enabled_flag &&
+         (!tile_edges &&
           lc->boundary_flags & BOUNDARY_LEFT_TILE &&
           (x0 % (1 << s->ps.sps->log2_ctb_size)) == 0)))
         boundary_left = 0;
@@ -786,27 +833,7 @@ void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, int x0, int y0,
         const RefPicList *rpl_left = (lc->boundary_flags & BOUNDARY_LEFT_SLICE) ?
                                      ff_hevc_get_ref_list(s, s->ref, x0 - 1, y0) :
                                      s->ref->refPicList;
-        int xp_pu = (x0 - 1) >> log2_min_pu_size;
-        int xq_pu =  x0      >> log2_min_pu_size;
-        int xp_tu = (x0 - 1) >> log2_min_tu_size;
-        int xq_tu =  x0      >> log2_min_tu_size;
-
-            for (i = 0; i < (1 << log2_trafo_size); i += 4) {
-                int y_pu      = (y0 + i) >> log2_min_pu_size;
-                int y_tu      = (y0 + i) >> log2_min_tu_size;
-                const MvField *left = &tab_mvf[y_pu * min_pu_width + xp_pu];
-                const MvField *curr = &tab_mvf[y_pu * min_pu_width + xq_pu];
-                uint8_t left_cbf_luma = s->cbf_luma[y_tu * min_tu_width + xp_tu];
-                uint8_t curr_cbf_luma = s->cbf_luma[y_tu * min_tu_width + xq_tu];
-
-                if (curr->pred_flag == PF_INTRA || left->pred_flag == PF_INTRA)
-                    bs = 2;
-                else if (curr_cbf_luma || left_cbf_luma)
-                    bs = 1;
-                else
-                    bs = boundary_strength(s, curr, left, rpl_left);
-                s->vertical_bs[(x0 + (y0 + i) * s->bs_width) >> 2] = bs;
-            }
+        deblocking_bs_left(s, x0, y0, 1 << log2_trafo_size, rpl_left);
     }
 
     if (log2_trafo_size > log2_min_pu_size && !is_intra) {
@@ -844,6 +871,44 @@ void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, int x0, int y0,
     }
 }
 
+void ff_hevc_deblocking_boundary_strengths_tile(HEVCLocalContext *lc,
+                                                int x_ctb, int y_ctb)
+{
+    const HEVCContext *s = lc->parent;
+    int ctb_size    = 1 << s->ps.sps->log2_ctb_size;
+    int ctb_addr_rs = (y_ctb >> s->ps.sps->log2_ctb_size) * s->ps.sps->ctb_width +
+                      (x_ctb >> s->ps.sps->log2_ctb_size);
+    int ctb_addr_ts = s->ps.pps->ctb_addr_rs_to_ts[ctb_addr_rs];
+    const int *tile_id = s->ps.pps->tile_id;
+
+    if (!s->ps.pps->loop_filter_across_tiles_enabled_flag)
+        return;
+
+    if (y_ctb > 0 &&
+        tile_id[ctb_addr_ts] != tile_id[s->ps.pps->ctb_addr_rs_to_ts[ctb_addr_rs - s->ps.sps->ctb_width]]) {
+        int other_slice = s->tab_slice_address[ctb_addr_rs] !=
+                          s->tab_slice_address[ctb_addr_rs - s->ps.sps->ctb_width];
+
+        if (!other_slice || s->sh.slice_loop_filter_across_slices_enabled_flag)
+            deblocking_bs_upper(s, x_ctb, y_ctb,
+                                FFMIN(ctb_size, s->ps.sps->width - x_ctb),
+                                other_slice ? ff_hevc_get_ref_list(s, s->ref, x_ctb, y_ctb - 1) :
+                                              s->ref->refPicList);
+    }
+
+    if (x_ctb > 0 &&
+        tile_id[ctb_addr_ts] != tile_id[s->ps.pps->ctb_addr_rs_to_ts[ctb_addr_rs - 1]]) {
+        int other_slice = s->tab_slice_address[ctb_addr_rs] !=
+                          s->tab_slice_address[ctb_addr_rs - 1];
+
+        if (!other_slice || s->sh.slice_loop_filter_across_slices_enabled_flag)
+            deblocking_bs_left(s, x_ctb, y_ctb,
+                               FFMIN(ctb_size, s->ps.sps->height - y_ctb),
+                               other_slice ? ff_hevc_get_ref_list(s, s->ref, x_ctb - 1, y_ctb) :
+                                             s->ref->refPicList);
+    }
+}
+
 #undef LUMA
 #undef CB
 #undef CR
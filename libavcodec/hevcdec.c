@@ -50,6 +50,7 @@
 #include "hwconfig.h"
 #include "internal.h"
 #include "profiles.h"
+#include "pthread_internal.h"
 #include "thread.h"
 #include "threadframe.h"
 
@@ -941,8 +942,11 @@ static int hls_slice_header(HEVCContext *s)
                 sh->entry_point_offset[i] = val + 1; // +1; // +1 to get the size
             }
             if (s->threads_number > 1 && (s->ps.pps->num_tile_rows > 1 || s->ps.pps->num_tile_columns > 1)) {
-                s->enable_parallel_tiles = 0; // TODO: you can enable tiles in parallel here
-                s->threads_number = 1;
+                if (s->ps.pps->entropy_coding_sync_enabled_flag) {
+                    s->enable_parallel_tiles = 0;
+                    s->threads_number = 1;
+                } else
+                    s->enable_parallel_tiles = 1;
             } else
                 s->enable_parallel_tiles = 0;
         } else
@@ -2477,6 +2481,42 @@ static void hls_decode_neighbour(HEVCLocalContext *lc, int x_ctb, int y_ctb,
     lc->ctb_up_left_flag = ((x_ctb > 0) && (y_ctb > 0)  && (ctb_addr_in_slice-1 >= s->ps.sps->ctb_width) && (s->ps.pps->tile_id[ctb_addr_ts] == s->ps.pps->tile_id[s->ps.pps->ctb_addr_rs_to_ts[ctb_addr_rs-1 - s->ps.sps->ctb_width]]));
 }
 
+#if HAVE_THREADS
+DEFINE_OFFSET_ARRAY(HEVCContext, hevc_context, pthread_init_cnt,
+                    (offsetof(HEVCContext, progress_mutex)),
+                    (offsetof(HEVCContext, progress_cond)));
+
+static void hevc_report_ctb_progress(HEVCContext *s, int ctb_addr_ts)
+{
+    pthread_mutex_lock(&s->progress_mutex);
+    atomic_store_explicit(&s->ctb_decoded, ctb_addr_ts, memory_order_release);
+    pthread_cond_signal(&s->progress_cond);
+    pthread_mutex_unlock(&s->progress_mutex);
+}
+
+/**
+ * Wait until the CTB at ctb_addr_ts is decoded.
+ *
+ * @return 0 once it is, 1 if the slice segment ended before it
+ */
+static int hevc_await_ctb_progress(HEVCContext *s, int ctb_addr_ts)
+{
+    int ret;
+
+    if (atomic_load_explicit(&s->ctb_decoded, memory_order_acquire) > ctb_addr_ts)
+        return 0;
+
+    pthread_mutex_lock(&s->progress_mutex);
+    while (atomic_load_explicit(&s->ctb_decoded, memory_order_relaxed) <= ctb_addr_ts &&
+           !s->slice_decoded)
+        pthread_cond_wait(&s->progress_cond, &s->progress_mutex);
+    ret = atomic_load_explicit(&s->ctb_decoded, memory_order_relaxed) <= ctb_addr_ts;
+    pthread_mutex_unlock(&s->progress_mutex);
+
+    return ret;
+}
+#endif
+
 static int hls_decode_entry(AVCodecContext *avctxt, void *isFilterThread)
 {
     HEVCContext *s  = avctxt->priv_data;
@@ -2529,16 +2569,85 @@ static int hls_decode_entry(AVCodecContext *avctxt, void *isFilterThread)
 
         ctb_addr_ts++;
         ff_hevc_save_states(lc, ctb_addr_ts);
+#if HAVE_THREADS
+        if (s->filter_pipeline) {
+            hevc_report_ctb_progress(s, ctb_addr_ts);
+            continue;
+        }
+#endif
         ff_hevc_hls_filters(lc, x_ctb, y_ctb, ctb_size);
     }
 
-    if (x_ctb + ctb_size >= s->ps.sps->width &&
+    if (!s->filter_pipeline &&
+        x_ctb + ctb_size >= s->ps.sps->width &&
         y_ctb + ctb_size >= s->ps.sps->height)
         ff_hevc_hls_filter(lc, x_ctb, y_ctb, ctb_size);
 
     return ctb_addr_ts;
 }
 
+static int hls_alloc_local_contexts(HEVCContext *s)
+{
+    for (int i = 1; i < s->threads_number; i++) {
+        if (s->HEVClcList[i])
+            continue;
+        s->HEVClcList[i] = av_mallocz(sizeof(HEVCLocalContext));
+        if (!s->HEVClcList[i])
+            return AVERROR(ENOMEM);
+        s->HEVClcList[i]->logctx = s->avctx;
+        s->HEVClcList[i]->parent = s;
+        s->HEVClcList[i]->common_cabac_state = &s->cabac;
+    }
+    return 0;
+}
+
+#if HAVE_THREADS
+static int hls_decode_entry_pipeline(AVCodecContext *avctxt, void *arg,
+                                     int job, int self_id)
+{
+    HEVCContext *s = avctxt->priv_data;
+    int ret = hls_decode_entry(avctxt, arg);
+
+    pthread_mutex_lock(&s->progress_mutex);
+    s->slice_decoded = 1;
+    pthread_cond_signal(&s->progress_cond);
+    pthread_mutex_unlock(&s->progress_mutex);
+
+    return ret;
+}
+
+/**
+ * Run the in-loop filters of the slice segment in the same order as
+ * hls_decode_entry() would, as soon as each CTB is decoded.
+ */
+static int hls_filter_pipeline(AVCodecContext *avctxt)
+{
+    HEVCContext *s       = avctxt->priv_data;
+    HEVCLocalContext *lc = s->HEVClcList[1];
+    const HEVCSPS *sps   = s->ps.sps;
+    const HEVCPPS *pps   = s->ps.pps;
+    int ctb_size    = 1 << sps->log2_ctb_size;
+    int ctb_addr_ts = pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
+    int x_ctb       = -1;
+    int y_ctb       = -1;
+
+    while (!hevc_await_ctb_progress(s, ctb_addr_ts)) {
+        int ctb_addr_rs = pps->ctb_addr_ts_to_rs[ctb_addr_ts++];
+
+        x_ctb = (ctb_addr_rs % sps->ctb_width) << sps->log2_ctb_size;
+        y_ctb = (ctb_addr_rs / sps->ctb_width) << sps->log2_ctb_size;
+        ff_hevc_hls_filters(lc, x_ctb, y_ctb, ctb_size);
+    }
+
+    if (x_ctb >= 0 &&
+        x_ctb + ctb_size >= sps->width &&
+        y_ctb + ctb_size >= sps->height)
+        ff_hevc_hls_filter(lc, x_ctb, y_ctb, ctb_size);
+
+    return 0;
+}
+#endif
+
 static int hls_slice_data(HEVCContext *s)
 {
     int arg[2];
@@ -2547,6 +2656,23 @@ static int hls_slice_data(HEVCContext *s)
     arg[0] = 0;
     arg[1] = 1;
 
+#if HAVE_THREADS
+    /* Deblocking and SAO of a CTB only touch samples which are not used for
+     * the prediction of the CTBs following it, so they can trail the
+     * decoding on another thread. */
+    if (s->threads_number > 1 && s->pthread_init_cnt &&
+        hls_alloc_local_contexts(s) >= 0) {
+        s->filter_pipeline = 1;
+        s->slice_decoded   = 0;
+        atomic_store(&s->ctb_decoded, s->ps.pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs]);
+
+        ff_slice_thread_execute_with_mainfunc(s->avctx, hls_decode_entry_pipeline,
+                                              hls_filter_pipeline, arg, ret, 1);
+        s->filter_pipeline = 0;
+        return ret[0];
+    }
+#endif
+
     s->avctx->execute(s->avctx, hls_decode_entry, arg, ret , 1, sizeof(int));
     return ret[0];
 }
@@ -2633,34 +2759,22 @@ error:
     return ret;
 }
 
-static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
+/**
+ * Allocate the local contexts of the slice threads and locate the
+ * substreams of the slice segment from its entry points.
+ */
+static int hls_slice_data_substreams(HEVCContext *s, const H2645NAL *nal)
 {
     const uint8_t *data = nal->data;
     int length          = nal->size;
     HEVCLocalContext *lc = s->HEVClc;
-    int *ret;
     int64_t offset;
     int64_t startheader, cmpt = 0;
-    int i, j, res = 0;
-
-    if (s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * s->ps.sps->ctb_width >= s->ps.sps->ctb_width * s->ps.sps->ctb_height) {
-        av_log(s->avctx, AV_LOG_ERROR, "WPP ctb addresses are wrong (%d %d %d %d)\n",
-            s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets,
-            s->ps.sps->ctb_width, s->ps.sps->ctb_height
-        );
-        return AVERROR_INVALIDDATA;
-    }
+    int i, j, ret;
 
-    for (i = 1; i < s->threads_number; i++) {
-        if (s->HEVClcList[i])
-            continue;
-        s->HEVClcList[i] = av_mallocz(sizeof(HEVCLocalContext));
-        if (!s->HEVClcList[i])
-            return AVERROR(ENOMEM);
-        s->HEVClcList[i]->logctx = s->avctx;
-        s->HEVClcList[i]->parent = s;
-        s->HEVClcList[i]->common_cabac_state = &s->cabac;
-    }
+    ret = hls_alloc_local_contexts(s);
+    if (ret < 0)
+        return ret;
 
     offset = (lc->gb.index >> 3);
 
@@ -2696,6 +2810,26 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
     }
     s->data = data;
 
+    return 0;
+}
+
+static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
+{
+    int *ret;
+    int i, res = 0;
+
+    if (s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * s->ps.sps->ctb_width >= s->ps.sps->ctb_width * s->ps.sps->ctb_height) {
+        av_log(s->avctx, AV_LOG_ERROR, "WPP ctb addresses are wrong (%d %d %d %d)\n",
+            s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets,
+            s->ps.sps->ctb_width, s->ps.sps->ctb_height
+        );
+        return AVERROR_INVALIDDATA;
+    }
+
+    res = hls_slice_data_substreams(s, nal);
+    if (res < 0)
+        return res;
+
     for (i = 1; i < s->threads_number; i++) {
         s->HEVClcList[i]->first_qp_group = 1;
         s->HEVClcList[i]->qp_y = s->HEVClc->qp_y;
@@ -2720,6 +2854,251 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
     return res;
 }
 
+typedef struct HEVCTileJobs {
+    HEVCLocalContext **lc_list;
+    int first_tile;             ///< tile index of the first substream
+    int first_offset;           ///< byte offset of the first substream
+    int first_size;
+    int *tiles;                 ///< tiles filtered by the current job batch
+    int start_ts, end_ts;       ///< CTBs of the slice segment, in tile scan
+
+    /* state of s->HEVClc after the slice header, for the first substream */
+    uint8_t cabac_state[HEVC_CONTEXTS];
+    uint8_t stat_coeff[HEVC_STAT_COEFFS];
+    uint8_t first_qp_group;
+    int8_t  qp_y;
+    int     end_of_tiles_x;
+
+    HEVCLocalContext *last_lc;  ///< local context which decoded the last tile
+} HEVCTileJobs;
+
+static int hls_decode_entry_tile(AVCodecContext *avctxt, void *arg,
+                                 int job, int self_id)
+{
+    HEVCTileJobs *tj      = arg;
+    HEVCContext *s        = avctxt->priv_data;
+    HEVCLocalContext *lc  = tj->lc_list[self_id];
+    const HEVCSPS *sps    = s->ps.sps;
+    const HEVCPPS *pps    = s->ps.pps;
+    int tile              = tj->first_tile + job;
+    int more_data         = 1;
+    int ctb_addr_ts, ret;
+
+    if (job) {
+        int col = tile % pps->num_tile_columns;
+
+        ret = init_get_bits8(&lc->gb, s->data + s->sh.offset[job - 1], s->sh.size[job - 1]);
+        ctb_addr_ts = pps->ctb_addr_rs_to_ts[pps->tile_pos_rs[tile]];
+        lc->first_qp_group = 1;
+        lc->qp_y           = tj->qp_y;
+        lc->end_of_tiles_x = (pps->col_bd[col] + pps->column_width[col]) << sps->log2_ctb_size;
+    } else {
+        ret = init_get_bits8(&lc->gb, s->data + tj->first_offset, tj->first_size);
+        ctb_addr_ts = pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
+        memcpy(lc->cabac_state, tj->cabac_state, sizeof(lc->cabac_state));
+        memcpy(lc->stat_coeff,  tj->stat_coeff,  sizeof(lc->stat_coeff));
+        lc->first_qp_group = tj->first_qp_group;
+        lc->qp_y           = tj->qp_y;
+        lc->end_of_tiles_x = tj->end_of_tiles_x;
+    }
+    if (ret < 0)
+        return ret;
+    lc->tu.cu_qp_offset_cb = 0;
+    lc->tu.cu_qp_offset_cr = 0;
+
+    while (more_data && ctb_addr_ts < sps->ctb_size && pps->tile_id[ctb_addr_ts] == tile) {
+        int ctb_addr_rs = pps->ctb_addr_ts_to_rs[ctb_addr_ts];
+        int x_ctb = (ctb_addr_rs % sps->ctb_width) << sps->log2_ctb_size;
+        int y_ctb = (ctb_addr_rs / sps->ctb_width) << sps->log2_ctb_size;
+
+        hls_decode_neighbour(lc, x_ctb, y_ctb, ctb_addr_ts);
+
+        ret = ff_hevc_cabac_init(lc, ctb_addr_ts);
+        if (ret < 0) {
+            s->tab_slice_address[ctb_addr_rs] = -1;
+            return ret;
+        }
+
+        hls_sao_param(lc, x_ctb >> sps->log2_ctb_size, y_ctb >> sps->log2_ctb_size);
+
+        s->deblock[ctb_addr_rs].beta_offset = s->sh.beta_offset;
+        s->deblock[ctb_addr_rs].tc_offset   = s->sh.tc_offset;
+        s->filter_slice_edges[ctb_addr_rs]  = s->sh.slice_loop_filter_across_slices_enabled_flag;
+
+        more_data = hls_coding_quadtree(lc, x_ctb, y_ctb, sps->log2_ctb_size, 0);
+        if (more_data < 0) {
+            s->tab_slice_address[ctb_addr_rs] = -1;
+            return more_data;
+        }
+        ctb_addr_ts++;
+    }
+
+    if (job == s->sh.num_entry_point_offsets)
+        tj->last_lc = lc;
+
+    return ctb_addr_ts;
+}
+
+/**
+ * Run the in-loop filters that the sequential decoder would have run while
+ * decoding the CTBs of one tile, in the same order.
+ */
+static int hls_filter_tile(AVCodecContext *avctxt, void *arg, int job, int self_id)
+{
+    HEVCTileJobs *tj      = arg;
+    HEVCContext *s        = avctxt->priv_data;
+    HEVCLocalContext *lc  = tj->lc_list[self_id];
+    const HEVCSPS *sps    = s->ps.sps;
+    const HEVCPPS *pps    = s->ps.pps;
+    int tile              = tj->tiles[job];
+    int ctb_size          = 1 << sps->log2_ctb_size;
+    int ctb_addr_ts       = FFMAX(pps->ctb_addr_rs_to_ts[pps->tile_pos_rs[tile]], tj->start_ts);
+    int ts;
+
+    for (ts = ctb_addr_ts; ts < tj->end_ts && pps->tile_id[ts] == tile; ts++) {
+        int ctb_addr_rs = pps->ctb_addr_ts_to_rs[ts];
+        int x_ctb = (ctb_addr_rs % sps->ctb_width) << sps->log2_ctb_size;
+        int y_ctb = (ctb_addr_rs / sps->ctb_width) << sps->log2_ctb_size;
+
+        if (x_ctb == pps->col_bd[tile % pps->num_tile_columns] << sps->log2_ctb_size ||
+            y_ctb == pps->row_bd[tile / pps->num_tile_columns] << sps->log2_ctb_size)
+            ff_hevc_deblocking_boundary_strengths_tile(lc, x_ctb, y_ctb);
+    }
+
+    for (ts = ctb_addr_ts; ts < tj->end_ts && pps->tile_id[ts] == tile; ts++) {
+        int ctb_addr_rs = pps->ctb_addr_ts_to_rs[ts];
+        int x_ctb = (ctb_addr_rs % sps->ctb_width) << sps->log2_ctb_size;
+        int y_ctb = (ctb_addr_rs / sps->ctb_width) << sps->log2_ctb_size;
+
+        ff_hevc_hls_filters(lc, x_ctb, y_ctb, ctb_size);
+        if (x_ctb + ctb_size >= sps->width &&
+            y_ctb + ctb_size >= sps->height)
+            ff_hevc_hls_filter(lc, x_ctb, y_ctb, ctb_size);
+    }
+
+    return 0;
+}
+
+/**
+ * Decode the tiles of a slice segment concurrently. The tiles are
+ * independent for parsing and reconstruction; the in-loop filters, which
+ * cross tile boundaries, are run afterwards in batches of tiles which do
+ * not touch each other.
+ */
+static int hls_slice_data_tiles(HEVCContext *s, const H2645NAL *nal)
+{
+    const HEVCSPS *sps = s->ps.sps;
+    const HEVCPPS *pps = s->ps.pps;
+    HEVCLocalContext *lc = s->HEVClc;
+    HEVCTileJobs tj = { 0 };
+    int nb_tiles = pps->num_tile_columns * pps->num_tile_rows;
+    int start_ts = pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
+    int nb_jobs  = s->sh.num_entry_point_offsets + 1;
+    int end_ts, last_tile, min_width, i, res;
+    int *ret;
+
+    tj.first_tile = pps->tile_id[start_ts];
+    last_tile     = tj.first_tile + s->sh.num_entry_point_offsets;
+    if (last_tile >= nb_tiles ||
+        pps->tile_pos_rs[tj.first_tile] != s->sh.slice_ctb_addr_rs) {
+        av_log(s->avctx, AV_LOG_ERROR, "Tile entry points are wrong (%d %d %d)\n",
+               s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets, nb_tiles);
+        return AVERROR_INVALIDDATA;
+    }
+    if (!start_ts && s->sh.dependent_slice_segment_flag) {
+        av_log(s->avctx, AV_LOG_ERROR, "Impossible initial tile.\n");
+        return AVERROR_INVALIDDATA;
+    }
+    if (s->sh.dependent_slice_segment_flag) {
+        int prev_rs = pps->ctb_addr_ts_to_rs[start_ts - 1];
+        if (s->tab_slice_address[prev_rs] != s->sh.slice_addr) {
+            av_log(s->avctx, AV_LOG_ERROR, "Previous slice segment missing\n");
+            return AVERROR_INVALIDDATA;
+        }
+    }
+
+    tj.first_offset = lc->gb.index >> 3;
+    res = hls_slice_data_substreams(s, nal);
+    if (res < 0)
+        return res;
+    tj.first_size = s->sh.offset[0] - tj.first_offset;
+
+    tj.lc_list        = s->HEVClcList;
+    tj.first_qp_group = lc->first_qp_group;
+    tj.qp_y           = lc->qp_y;
+    tj.end_of_tiles_x = lc->end_of_tiles_x;
+    memcpy(tj.cabac_state, lc->cabac_state, sizeof(tj.cabac_state));
+    memcpy(tj.stat_coeff,  lc->stat_coeff,  sizeof(tj.stat_coeff));
+
+    /* the boundary flags of a CTB depend on the slice of its neighbours,
+     * which may belong to a tile that is still being decoded */
+    end_ts = last_tile + 1 < nb_tiles ?
+             pps->ctb_addr_rs_to_ts[pps->tile_pos_rs[last_tile + 1]] : sps->ctb_size;
+    for (i = start_ts; i < end_ts; i++)
+        s->tab_slice_address[pps->ctb_addr_ts_to_rs[i]] = s->sh.slice_addr;
+
+    ret = av_calloc(nb_jobs, sizeof(*ret));
+    tj.tiles = av_malloc_array(nb_jobs, sizeof(*tj.tiles));
+    if (!ret || !tj.tiles) {
+        res = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    s->avctx->execute2(s->avctx, hls_decode_entry_tile, &tj, ret, nb_jobs);
+
+    res = ret[nb_jobs - 1];
+    for (i = 0; i < nb_jobs; i++) {
+        if (ret[i] < 0) {
+            res = ret[i];
+            goto end;
+        }
+    }
+    tj.start_ts = start_ts;
+    tj.end_ts   = res;
+
+    if (tj.last_lc && tj.last_lc != lc) {
+        memcpy(lc->cabac_state, tj.last_lc->cabac_state, sizeof(lc->cabac_state));
+        memcpy(lc->stat_coeff,  tj.last_lc->stat_coeff,  sizeof(lc->stat_coeff));
+        lc->first_qp_group = tj.last_lc->first_qp_group;
+        lc->qp_y           = tj.last_lc->qp_y;
+        lc->end_of_tiles_x = tj.last_lc->end_of_tiles_x;
+    }
+
+    /* Filtering a tile touches up to three CTBs into the tiles to its left
+     * and above, so tile (r, c) has to wait for tiles (r, c - 1) and
+     * (r - 1, c + 1). All tiles with the same 2 * r + c are independent if
+     * the tiles are wide enough to keep their filtered areas apart. */
+    min_width = INT_MAX;
+    for (i = 0; i < pps->num_tile_columns; i++)
+        min_width = FFMIN(min_width, pps->column_width[i]);
+
+    if (min_width >= 4) {
+        int first_wave = 2 * (tj.first_tile / pps->num_tile_columns) +
+                             tj.first_tile % pps->num_tile_columns;
+        int last_wave  = 2 * (last_tile / pps->num_tile_columns) +
+                             last_tile % pps->num_tile_columns;
+
+        for (int wave = first_wave; wave <= last_wave; wave++) {
+            int nb = 0;
+            for (int tile = tj.first_tile; tile <= last_tile; tile++)
+                if (2 * (tile / pps->num_tile_columns) + tile % pps->num_tile_columns == wave)
+                    tj.tiles[nb++] = tile;
+            if (nb)
+                s->avctx->execute2(s->avctx, hls_filter_tile, &tj, NULL, nb);
+        }
+    } else {
+        for (int tile = tj.first_tile; tile <= last_tile; tile++) {
+            tj.tiles[0] = tile;
+            hls_filter_tile(s->avctx, &tj, 0, 0);
+        }
+    }
+
+end:
+    av_free(tj.tiles);
+    av_free(ret);
+    return res;
+}
+
 static int set_side_data(HEVCContext *s)
 {
     AVFrame *out = s->ref->frame;
@@ -3109,7 +3488,10 @@ static int decode_nal_unit(HEVCContext *s, const H2645NAL *nal)
             if (ret < 0)
                 goto fail;
         } else {
-            if (s->threads_number > 1 && s->sh.num_entry_point_offsets > 0)
+            if (s->threads_number > 1 && s->sh.num_entry_point_offsets > 0 &&
+                s->enable_parallel_tiles)
+                ctb_addr_ts = hls_slice_data_tiles(s, nal);
+            else if (s->threads_number > 1 && s->sh.num_entry_point_offsets > 0)
                 ctb_addr_ts = hls_slice_data_wpp(s, nal);
             else
                 ctb_addr_ts = hls_slice_data(s);
@@ -3483,6 +3865,10 @@ static av_cold int hevc_decode_free(AVCodecContext *avctx)
     av_freep(&s->HEVClc);
     av_freep(&s->HEVClcList);
 
+#if HAVE_THREADS
+    ff_pthread_free(s, hevc_context_offsets);
+#endif
+
     ff_h2645_packet_uninit(&s->pkt);
 
     ff_hevc_reset_sei(&s->sei);
@@ -3642,6 +4028,11 @@ static av_cold int hevc_decode_init(AVCodecContext *avctx)
         ret = ff_slice_thread_init_progress(avctx);
         if (ret < 0)
             return ret;
+#if HAVE_THREADS
+        ret = ff_pthread_init(s, hevc_context_offsets);
+        if (ret < 0)
+            return ret;
+#endif
     } else
         s->threads_number = 1;
 
@@ -3716,7 +4107,8 @@ const FFCodec ff_hevc_decoder = {
     .p.capabilities        = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
                              AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS,
     .caps_internal         = FF_CODEC_CAP_EXPORTS_CROPPING |
-                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP,
+                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP |
+                             FF_CODEC_CAP_SLICE_THREAD_HAS_MF,
     .p.profiles            = NULL_IF_CONFIG_SMALL(ff_hevc_profiles),
     .hw_configs            = (const AVCodecHWConfigInternal *const []) {
 #if CONFIG_HEVC_DXVA2_HWACCEL
@@ -27,6 +27,7 @@
 
 #include "libavutil/buffer.h"
 #include "libavutil/mem_internal.h"
+#include "libavutil/thread.h"
 
 #include "avcodec.h"
 #include "bswapdsp.h"
@@ -578,6 +579,19 @@ typedef struct HEVCContext {
     int enable_parallel_tiles;
     atomic_int wpp_err;
 
+    /**
+     * Set while the in-loop filters of a slice segment run on the calling
+     * thread, trailing its decoding on a slice thread.
+     */
+    int filter_pipeline;
+#if HAVE_THREADS
+    pthread_mutex_t progress_mutex;
+    pthread_cond_t progress_cond;
+    atomic_int ctb_decoded;     ///< tile scan address of the next CTB to be decoded
+    int slice_decoded;          ///< decoding of the slice segment has ended
+    unsigned pthread_init_cnt;
+#endif
+
     const uint8_t *data;
 
     H2645Packet pkt;
@@ -700,6 +714,8 @@ void ff_hevc_set_qPy(HEVCLocalContext *lc, int xBase, int yBase,
                      int log2_cb_size);
 void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, int x0, int y0,
                                            int log2_trafo_size);
+void ff_hevc_deblocking_boundary_strengths_tile(HEVCLocalContext *lc,
+                                                int x_ctb, int y_ctb);
 int ff_hevc_cu_qp_delta_sign_flag(HEVCLocalContext *lc);
 int ff_hevc_cu_qp_delta_abs(HEVCLocalContext *lc);
 int ff_hevc_cu_chroma_qp_offset_flag(HEVCLocalContext *lc);
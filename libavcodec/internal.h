@@ -104,6 +104,13 @@ typedef struct AVCodecInternal {
 
     void *frame_thread_encoder;
 
+    /**
+     * FF_THREAD_GOP: index in the whole stream of the first frame given
+     * to this encoder instance, for the time codes written in headers.
+     * 0 for other encoders.
+     */
+    int64_t gop_chunk_start;
+
     /**
      * The input frame is stored here for encoders implementing the simple
      * encode API.
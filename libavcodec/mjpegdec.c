@@ -32,6 +32,8 @@
 
 #include "config_components.h"
 
+#include <stdatomic.h>
+
 #include "libavutil/display.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/avassert.h"
@@ -50,6 +52,7 @@
 #include "jpeglsdec.h"
 #include "profiles.h"
 #include "put_bits.h"
+#include "thread.h"
 #include "tiff.h"
 #include "exif.h"
 #include "bytestream.h"
@@ -712,7 +715,7 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
                 s->avctx->pix_fmt,
                 AV_PIX_FMT_NONE,
             };
-            s->hwaccel_pix_fmt = ff_get_format(s->avctx, pix_fmts);
+            s->hwaccel_pix_fmt = ff_thread_get_format(s->avctx, pix_fmts);
             if (s->hwaccel_pix_fmt < 0)
                 return AVERROR(EINVAL);
 
@@ -728,7 +731,7 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
         }
 
         av_frame_unref(s->picture_ptr);
-        if (ff_get_buffer(s->avctx, s->picture_ptr, AV_GET_BUFFER_FLAG_REF) < 0)
+        if (ff_thread_get_buffer(s->avctx, s->picture_ptr, AV_GET_BUFFER_FLAG_REF) < 0)
             return -1;
         s->picture_ptr->pict_type = AV_PICTURE_TYPE_I;
         s->picture_ptr->key_frame = 1;
@@ -787,10 +790,11 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
     return 0;
 }
 
-static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
+static inline int mjpeg_decode_dc(MJpegDecodeContext *s, GetBitContext *gb,
+                                  int dc_index)
 {
     int code;
-    code = get_vlc2(&s->gb, s->vlcs[0][dc_index].table, 9, 2);
+    code = get_vlc2(gb, s->vlcs[0][dc_index].table, 9, 2);
     if (code < 0 || code > 16) {
         av_log(s->avctx, AV_LOG_WARNING,
                "mjpeg_decode_dc: bad vlc: %d:%d (%p)\n",
@@ -799,47 +803,48 @@ static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
     }
 
     if (code)
-        return get_xbits(&s->gb, code);
+        return get_xbits(gb, code);
     else
         return 0;
 }
 
 /* decode block and dequantize */
-static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
+static int decode_block(MJpegDecodeContext *s, GetBitContext *gb, int *last_dc,
+                        int16_t *block, int component,
                         int dc_index, int ac_index, uint16_t *quant_matrix)
 {
     int code, i, j, level, val;
 
     /* DC coef */
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, gb, dc_index);
     if (val == 0xfffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
     }
-    val = val * (unsigned)quant_matrix[0] + s->last_dc[component];
+    val = val * (unsigned)quant_matrix[0] + last_dc[component];
     val = av_clip_int16(val);
-    s->last_dc[component] = val;
+    last_dc[component] = val;
     block[0] = val;
     /* AC coefs */
     i = 0;
-    {OPEN_READER(re, &s->gb);
+    {OPEN_READER(re, gb);
     do {
-        UPDATE_CACHE(re, &s->gb);
-        GET_VLC(code, re, &s->gb, s->vlcs[1][ac_index].table, 9, 2);
+        UPDATE_CACHE(re, gb);
+        GET_VLC(code, re, gb, s->vlcs[1][ac_index].table, 9, 2);
 
         i += ((unsigned)code) >> 4;
             code &= 0xf;
         if (code) {
             if (code > MIN_CACHE_BITS - 16)
-                UPDATE_CACHE(re, &s->gb);
+                UPDATE_CACHE(re, gb);
 
             {
-                int cache = GET_CACHE(re, &s->gb);
+                int cache = GET_CACHE(re, gb);
                 int sign  = (~cache) >> 31;
                 level     = (NEG_USR32(sign ^ cache,code) ^ sign) - sign;
             }
 
-            LAST_SKIP_BITS(re, &s->gb, code);
+            LAST_SKIP_BITS(re, gb, code);
 
             if (i > 63) {
                 av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
@@ -849,7 +854,7 @@ static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
             block[j] = level * quant_matrix[i];
         }
     } while (i < 63);
-    CLOSE_READER(re, &s->gb);}
+    CLOSE_READER(re, gb);}
 
     return 0;
 }
@@ -860,7 +865,7 @@ static int decode_dc_progressive(MJpegDecodeContext *s, int16_t *block,
 {
     unsigned val;
     s->bdsp.clear_block(block);
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, &s->gb, dc_index);
     if (val == 0xfffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
@@ -1154,7 +1159,7 @@ static int ljpeg_decode_rgb_scan(MJpegDecodeContext *s, int nb_components, int p
                 topleft[i] = top[i];
                 top[i]     = buffer[mb_x][i];
 
-                dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                 if(dc == 0xFFFFF)
                     return -1;
 
@@ -1288,7 +1293,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for(j=0; j<n; j++) {
                         int pred, dc;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFFF)
                             return -1;
                         if (   h * mb_x + x >= s->width
@@ -1359,7 +1364,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for (j = 0; j < n; j++) {
                         int pred;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFFF)
                             return -1;
                         if (   h * mb_x + x >= s->width
@@ -1428,6 +1433,149 @@ static void shift_output(MJpegDecodeContext *s, uint8_t *ptr, int linesize)
     }
 }
 
+typedef struct MJpegScanSlices {
+    const uint8_t *buf;     ///< scan data, fixed before the jobs start
+    int buf_size;
+    int nb_components;
+    int start;              ///< offset of the first restart interval in the scan
+    const int *markers;     ///< offsets of the RSTn markers ending each interval
+    int nb_intervals;
+    int nb_jobs;
+    uint8_t *data[MAX_COMPONENTS];
+    int chroma_width, chroma_height;
+    GetBitContext gb;       ///< reader positioned after the last interval
+    atomic_int error;
+} MJpegScanSlices;
+
+static int mjpeg_decode_scan_slice(AVCodecContext *avctx, void *arg,
+                                   int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    MJpegScanSlices *sl = arg;
+    const uint8_t *buf  = sl->buf;
+    int buf_size        = sl->buf_size;
+    int bytes_per_pixel = 1 + (s->bits > 8);
+    int first = (int64_t)sl->nb_intervals *  jobnr      / sl->nb_jobs;
+    int last  = (int64_t)sl->nb_intervals * (jobnr + 1) / sl->nb_jobs;
+    int nb_mbs = s->mb_width * s->mb_height;
+    int last_dc[MAX_COMPONENTS];
+    DECLARE_ALIGNED(32, int16_t, block)[64];
+    GetBitContext gb;
+    int ret = 0;
+
+    for (int k = first; k < last; k++) {
+        int offset = k ? sl->markers[k - 1] + 2 : sl->start;
+        int mb_end = FFMIN((int64_t)(k + 1) * s->restart_interval, nb_mbs);
+
+        init_get_bits8(&gb, buf + offset, buf_size - offset);
+        for (int i = 0; i < sl->nb_components; i++)
+            last_dc[i] = 4 << s->bits;
+
+        for (int mb = k * s->restart_interval; mb < mb_end; mb++) {
+            int mb_x = mb % s->mb_width;
+            int mb_y = mb / s->mb_width;
+
+            if (get_bits_left(&gb) < 0) {
+                av_log(avctx, AV_LOG_ERROR, "overread %d\n", -get_bits_left(&gb));
+                ret = AVERROR_INVALIDDATA;
+                break;
+            }
+            for (int i = 0; i < sl->nb_components; i++) {
+                int n = s->nb_blocks[i];
+                int c = s->comp_index[i];
+                int h = s->h_scount[i];
+                int v = s->v_scount[i];
+                int linesize = s->linesize[c];
+                int x = 0, y = 0;
+
+                for (int j = 0; j < n; j++) {
+                    int block_offset = (((linesize * (v * mb_y + y) * 8) +
+                                         (h * mb_x + x) * 8 * bytes_per_pixel) >> avctx->lowres);
+
+                    if (s->interlaced && s->bottom_field)
+                        block_offset += linesize >> 1;
+                    s->bdsp.clear_block(block);
+                    if (decode_block(s, &gb, last_dc, block, i,
+                                     s->dc_index[i], s->ac_index[i],
+                                     s->quant_matrixes[s->quant_sindex[i]]) < 0) {
+                        av_log(avctx, AV_LOG_ERROR,
+                               "error y=%d x=%d\n", mb_y, mb_x);
+                        ret = AVERROR_INVALIDDATA;
+                        goto next_interval;
+                    }
+                    if (linesize &&
+                        8*(h * mb_x + x) < ((c == 1) || (c == 2) ? sl->chroma_width  : s->width) &&
+                        8*(v * mb_y + y) < ((c == 1) || (c == 2) ? sl->chroma_height : s->height)) {
+                        uint8_t *ptr = sl->data[c] + block_offset;
+                        s->idsp.idct_put(ptr, linesize, block);
+                        if (s->bits & 7)
+                            shift_output(s, ptr, linesize);
+                    }
+                    if (++x == h) {
+                        x = 0;
+                        y++;
+                    }
+                }
+            }
+        }
+next_interval:
+        /* the caller continues parsing after the last interval; s->gb must
+         * not be touched here as the other jobs may not have started yet */
+        if (k == sl->nb_intervals - 1)
+            sl->gb = gb;
+    }
+    if (ret < 0)
+        atomic_store(&sl->error, ret);
+    return ret;
+}
+
+/**
+ * Decode a baseline scan by distributing its restart intervals over the
+ * slice threads.
+ *
+ * @return 1 if the RSTn markers of the scan could not all be located and
+ *         the scan has to be decoded sequentially, <0 on error, 0 otherwise
+ */
+static int mjpeg_decode_scan_slices(MJpegDecodeContext *s, int nb_components,
+                                    uint8_t *data[MAX_COMPONENTS],
+                                    int chroma_width, int chroma_height)
+{
+    MJpegScanSlices sl = { 0 };
+    int nb_mbs = s->mb_width * s->mb_height;
+    int first;
+
+    sl.nb_intervals = (nb_mbs + s->restart_interval - 1) / s->restart_interval;
+    sl.start        = get_bits_count(&s->gb) >> 3;
+    if (sl.nb_intervals < 2 || s->nb_restart_markers < sl.nb_intervals - 1 ||
+        get_bits_count(&s->gb) & 7)
+        return 1;
+
+    for (first = 0; first < s->nb_restart_markers; first++)
+        if (s->restart_markers[first] >= sl.start)
+            break;
+    if (s->nb_restart_markers - first < sl.nb_intervals - 1)
+        return 1;
+    for (int k = 0; k < sl.nb_intervals - 1; k++)
+        if (s->gb.buffer[s->restart_markers[first + k] + 1] != RST0 + (k & 7))
+            return 1;
+
+    sl.buf           = s->gb.buffer;
+    sl.buf_size      = s->gb.size_in_bits >> 3;
+    sl.gb            = s->gb;
+    sl.nb_components = nb_components;
+    sl.markers       = s->restart_markers + first;
+    sl.nb_jobs       = FFMIN(sl.nb_intervals, s->avctx->thread_count);
+    sl.chroma_width  = chroma_width;
+    sl.chroma_height = chroma_height;
+    memcpy(sl.data, data, sizeof(sl.data));
+    atomic_init(&sl.error, 0);
+
+    s->avctx->execute2(s->avctx, mjpeg_decode_scan_slice, &sl, NULL, sl.nb_jobs);
+    s->gb = sl.gb;
+
+    return atomic_load(&sl.error);
+}
+
 static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                              int Al, const uint8_t *mb_bitmask,
                              int mb_bitmask_size,
@@ -1463,6 +1611,15 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
         s->coefs_finished[c] |= 1;
     }
 
+    if (!mb_bitmask && !s->progressive && s->restart_interval &&
+        s->avctx->active_thread_type & FF_THREAD_SLICE &&
+        s->avctx->codec_id != AV_CODEC_ID_THP) {
+        int ret = mjpeg_decode_scan_slices(s, nb_components, data,
+                                           chroma_width, chroma_height);
+        if (ret <= 0)
+            return ret;
+    }
+
     for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
         for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
             const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
@@ -1504,7 +1661,8 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
 
                         } else {
                             s->bdsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
+                            if (decode_block(s, &s->gb, s->last_dc,
+                                             s->block, i,
                                              s->dc_index[i], s->ac_index[i],
                                              s->quant_matrixes[s->quant_sindex[i]]) < 0) {
                                 av_log(s->avctx, AV_LOG_ERROR,
@@ -2238,10 +2396,16 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
             }                                         \
         } while (0)
 
+        s->nb_restart_markers = 0;
+
         if (s->avctx->codec_id == AV_CODEC_ID_THP) {
             ptr = buf_end;
             copy_data_segment(0);
         } else {
+            /* remember where the restart intervals start, so that they can
+             * be decoded in parallel by mjpeg_decode_scan_slices() */
+            int find_rst = s->avctx->active_thread_type & FF_THREAD_SLICE;
+
             while (ptr < buf_end) {
                 uint8_t x = *(ptr++);
 
@@ -2266,6 +2430,18 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                         copy_data_segment(1);
                         if (x)
                             break;
+                    } else if (find_rst && s->nb_restart_markers >= 0) {
+                        int *markers = s->restart_markers;
+
+                        if (skip > 1 ||
+                            !(markers = av_fast_realloc(s->restart_markers,
+                                                        &s->restart_markers_size,
+                                                        (s->nb_restart_markers + 1) * sizeof(*markers)))) {
+                            s->nb_restart_markers = -1;
+                        } else {
+                            s->restart_markers = markers;
+                            markers[s->nb_restart_markers++] = (dst - s->buffer) + (ptr - 2 - src);
+                        }
                     }
                 }
             }
@@ -2345,6 +2521,23 @@ static void reset_icc_profile(MJpegDecodeContext *s)
     s->iccnum  = 0;
 }
 
+/**
+ * Check that no marker up to the end of the packet changes state which is
+ * inherited by the next frame (tables, frame header, application data).
+ */
+static int mjpeg_state_final(const uint8_t *buf, const uint8_t *buf_end)
+{
+    while (buf_end - buf >= 2) {
+        buf = memchr(buf, 0xff, buf_end - buf - 1);
+        if (!buf)
+            break;
+        if (buf[1] >= SOF0 && buf[1] != 0xff && (buf[1] < RST0 || buf[1] > SOS))
+            return 0;
+        buf++;
+    }
+    return 1;
+}
+
 int ff_mjpeg_decode_frame_from_buf(AVCodecContext *avctx, AVFrame *frame,
                                    int *got_frame, const AVPacket *avpkt,
                                    const uint8_t *buf, const int buf_size)
@@ -2358,6 +2551,7 @@ int ff_mjpeg_decode_frame_from_buf(AVCodecContext *avctx, AVFrame *frame,
     int i, index;
     int ret = 0;
     int is16bit;
+    int setup_finished = 0;
     AVDictionaryEntry *e = NULL;
 
     s->force_pal8 = 0;
@@ -2557,6 +2751,16 @@ eoi_parser:
                 break;
             }
 
+            /* Field pairs and JPEG-LS state are carried over to the next
+             * packet, only release the next frame thread early for
+             * self-contained pictures. */
+            if (avctx->active_thread_type & FF_THREAD_FRAME && !setup_finished &&
+                !s->interlaced && !s->ls && !avctx->hwaccel &&
+                mjpeg_state_final(buf_ptr, buf_end)) {
+                ff_thread_finish_setup(avctx);
+                setup_finished = 1;
+            }
+
             if ((ret = ff_mjpeg_decode_sos(s, NULL, 0, NULL)) < 0 &&
                 (avctx->err_recognition & AV_EF_EXPLODE))
                 goto fail;
@@ -2897,6 +3101,7 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     av_frame_free(&s->smv_frame);
 
     av_freep(&s->buffer);
+    av_freep(&s->restart_markers);
     av_freep(&s->stereo3d);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
@@ -2929,6 +3134,88 @@ static void decode_flush(AVCodecContext *avctx)
 }
 
 #if CONFIG_MJPEG_DECODER
+#if HAVE_THREADS
+static int mjpeg_update_thread_context(AVCodecContext *dst,
+                                       const AVCodecContext *src)
+{
+    MJpegDecodeContext *s = dst->priv_data;
+    const MJpegDecodeContext *s1 = src->priv_data;
+    int ret;
+
+    if (dst == src)
+        return 0;
+
+    for (int class = 0; class < 2; class++) {
+        for (int index = 0; index < 4; index++) {
+            const uint8_t *lengths = s1->raw_huffman_lengths[class][index];
+            const uint8_t *values  = s1->raw_huffman_values[class][index];
+            uint8_t bits_table[17] = { 0 };
+            int n = 0;
+
+            for (int i = 0; i < 16; i++)
+                n += lengths[i];
+            if (!memcmp(s->raw_huffman_lengths[class][index], lengths, 16) &&
+                !memcmp(s->raw_huffman_values[class][index], values, n))
+                continue;
+
+            memcpy(bits_table + 1, lengths, 16);
+            ff_free_vlc(&s->vlcs[class][index]);
+            if ((ret = ff_mjpeg_build_vlc(&s->vlcs[class][index], bits_table,
+                                          values, class > 0, dst)) < 0)
+                return ret;
+            if (class > 0) {
+                ff_free_vlc(&s->vlcs[2][index]);
+                if ((ret = ff_mjpeg_build_vlc(&s->vlcs[2][index], bits_table,
+                                              values, 0, dst)) < 0)
+                    return ret;
+            }
+            memcpy(s->raw_huffman_lengths[class][index], lengths, 16);
+            memcpy(s->raw_huffman_values[class][index],  values, 256);
+        }
+    }
+    memcpy(s->quant_matrixes, s1->quant_matrixes, sizeof(s->quant_matrixes));
+    memcpy(s->qscale,         s1->qscale,         sizeof(s->qscale));
+
+    if (s->bits != s1->bits)
+        init_idct(dst);
+
+    s->width              = s1->width;
+    s->height             = s1->height;
+    s->bits               = s1->bits;
+    memcpy(s->h_count, s1->h_count, sizeof(s->h_count));
+    memcpy(s->v_count, s1->v_count, sizeof(s->v_count));
+    s->first_picture      = s1->first_picture;
+    s->interlaced         = s1->interlaced;
+    s->bottom_field       = s1->bottom_field;
+    s->rgb                = s1->rgb;
+    s->rct                = s1->rct;
+    s->pegasus_rct        = s1->pegasus_rct;
+    s->colr               = s1->colr;
+    s->xfrm               = s1->xfrm;
+    s->flipped            = s1->flipped;
+    s->buggy_avid         = s1->buggy_avid;
+    s->cs_itu601          = s1->cs_itu601;
+    s->interlace_polarity = s1->interlace_polarity;
+    s->multiscope         = s1->multiscope;
+    s->hwaccel_pix_fmt    = s1->hwaccel_pix_fmt;
+    s->hwaccel_sw_pix_fmt = s1->hwaccel_sw_pix_fmt;
+
+    /* The second field of an interlaced picture may arrive in the next
+     * packet; setup is only finished early for progressive pictures, so
+     * the source thread is done with the picture here. */
+    av_frame_unref(s->picture_ptr);
+    s->got_picture = s1->interlaced && s1->got_picture;
+    if (s->got_picture) {
+        if ((ret = av_frame_ref(s->picture_ptr, s1->picture_ptr)) < 0)
+            return ret;
+        memcpy(s->linesize, s1->linesize, sizeof(s->linesize));
+        s->pix_desc = s1->pix_desc;
+    }
+
+    return 0;
+}
+#endif
+
 #define OFFSET(x) offsetof(MJpegDecodeContext, x)
 #define VD AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_DECODING_PARAM
 static const AVOption options[] = {
@@ -2953,8 +3240,10 @@ const FFCodec ff_mjpeg_decoder = {
     .init           = ff_mjpeg_decode_init,
     .close          = ff_mjpeg_decode_end,
     FF_CODEC_DECODE_CB(ff_mjpeg_decode_frame),
+    UPDATE_THREAD_CONTEXT(mjpeg_update_thread_context),
     .flush          = decode_flush,
-    .p.capabilities = AV_CODEC_CAP_DR1,
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .p.max_lowres   = 3,
     .p.priv_class   = &mjpegdec_class,
     .p.profiles     = NULL_IF_CONFIG_SMALL(ff_mjpeg_profiles),
@@ -123,6 +123,9 @@ typedef struct MJpegDecodeContext {
 
     int restart_interval;
     int restart_count;
+    int *restart_markers;          ///< offsets of the RSTn markers in the unescaped scan
+    unsigned int restart_markers_size;
+    int nb_restart_markers;        ///< number of markers found, -1 if they could not all be located
 
     int buggy_avid;
     int cs_itu601;
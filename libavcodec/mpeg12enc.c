@@ -39,6 +39,7 @@
 
 #include "avcodec.h"
 #include "codec_internal.h"
+#include "internal.h"
 #include "mathops.h"
 #include "mpeg12.h"
 #include "mpeg12data.h"
@@ -420,6 +421,7 @@ static void mpeg1_encode_sequence_header(MpegEncContext *s)
      * fake MPEG frame rate in case of low frame rate */
     fps       = (framerate.num + framerate.den / 2) / framerate.den;
     time_code = s->current_picture_ptr->coded_picture_number +
+                s->avctx->internal->gop_chunk_start +
                 mpeg12->timecode_frame_start;
 
     mpeg12->gop_picture_number = s->current_picture_ptr->coded_picture_number;
@@ -1247,7 +1249,7 @@ const FFCodec ff_mpeg1video_encoder = {
                                                            AV_PIX_FMT_NONE },
     .p.capabilities       = AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS |
                             AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE,
-    .caps_internal        = FF_CODEC_CAP_INIT_CLEANUP,
+    .caps_internal        = FF_CODEC_CAP_INIT_CLEANUP | FF_CODEC_CAP_GOP_THREADS,
     .p.priv_class         = &mpeg1_class,
 };
 
@@ -1266,7 +1268,7 @@ const FFCodec ff_mpeg2video_encoder = {
                                                            AV_PIX_FMT_NONE },
     .p.capabilities       = AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS |
                             AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE,
-    .caps_internal        = FF_CODEC_CAP_INIT_CLEANUP,
+    .caps_internal        = FF_CODEC_CAP_INIT_CLEANUP | FF_CODEC_CAP_GOP_THREADS,
     .p.priv_class         = &mpeg2_class,
 };
 #endif /* CONFIG_MPEG1VIDEO_ENCODER || CONFIG_MPEG2VIDEO_ENCODER */
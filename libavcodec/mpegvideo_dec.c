@@ -328,6 +328,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
     if (alloc_picture(s, pic) < 0)
         return -1;
+    if (getenv("MPVZERO")) { for (int k = 0; k < 3; k++) if (pic->f->buf[k]) memset(pic->f->buf[k]->data, 0x80, pic->f->buf[k]->size); }
 
     s->current_picture_ptr = pic;
     // FIXME use only the vars from current_pic
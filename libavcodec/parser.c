@@ -25,6 +25,7 @@
 #include <string.h>
 
 #include "libavutil/avassert.h"
+#include "libavutil/buffer.h"
 #include "libavutil/mem.h"
 
 #include "parser.h"
@@ -186,6 +187,50 @@ int av_parser_parse2(AVCodecParserContext *s, AVCodecContext *avctx,
     return index;
 }
 
+int av_parser_parse_ref(AVCodecParserContext *s, AVCodecContext *avctx,
+                        AVPacket *out, const AVBufferRef *buf,
+                        const uint8_t *data, int size,
+                        int64_t pts, int64_t dts, int64_t pos)
+{
+    uint8_t *outbuf;
+    int outbuf_size, len, in_buf = 0;
+
+    len = av_parser_parse2(s, avctx, &outbuf, &outbuf_size,
+                           data, size, pts, dts, pos);
+
+    out->size = 0;
+    if (!outbuf_size)
+        return len;
+
+    /* Output pointing into the input, including its padding, can be
+     * referenced; anything else lives in the parser's internal buffer,
+     * which is reused by the next call. The pointers may belong to
+     * different objects, so compare them as integers. */
+    if (buf) {
+        uintptr_t start = (uintptr_t)buf->data;
+        uintptr_t pos   = (uintptr_t)outbuf;
+        in_buf = pos >= start && pos - start <= buf->size &&
+                 outbuf_size + AV_INPUT_BUFFER_PADDING_SIZE <= buf->size - (pos - start);
+    }
+
+    if (in_buf) {
+        out->buf = av_buffer_ref(buf);
+        if (!out->buf)
+            return AVERROR(ENOMEM);
+    } else {
+        out->buf = av_buffer_alloc(outbuf_size + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!out->buf)
+            return AVERROR(ENOMEM);
+        memcpy(out->buf->data, outbuf, outbuf_size);
+        memset(out->buf->data + outbuf_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+        outbuf = out->buf->data;
+    }
+    out->data = outbuf;
+    out->size = outbuf_size;
+
+    return len;
+}
+
 void av_parser_close(AVCodecParserContext *s)
 {
     if (s) {
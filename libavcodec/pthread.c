@@ -42,12 +42,14 @@
  * Threading requires more than one thread.
  * Frame threading requires entire frames to be passed to the codec,
  * and introduces extra decoding delay, so is incompatible with low_delay.
+ * It needs threads of its own, so it is not used with a shared thread pool.
  *
  * @param avctx The context.
  */
 static void validate_thread_parameters(AVCodecContext *avctx)
 {
     int frame_threading_supported = (avctx->codec->capabilities & AV_CODEC_CAP_FRAME_THREADS)
+                                && !avctx->thread_pool
                                 && !(avctx->flags  & AV_CODEC_FLAG_LOW_DELAY)
                                 && !(avctx->flags2 & AV_CODEC_FLAG2_CHUNKS);
     if (avctx->thread_count == 1) {
@@ -29,6 +29,7 @@
 #include "internal.h"
 #include "pthread_internal.h"
 #include "thread.h"
+#include "threadpool.h"
 
 #include "libavutil/avassert.h"
 #include "libavutil/common.h"
@@ -48,6 +49,7 @@ typedef struct Progress {
 
 typedef struct SliceThreadContext {
     AVSliceThread *thread;
+    FFThreadPool *pool;         ///< shared pool used instead of thread, if set
     action_func *func;
     action_func2 *func2;
     main_func *mainfunc;
@@ -112,7 +114,12 @@ static int thread_execute(AVCodecContext *avctx, action_func* func, void *arg, i
     c->func = func;
     c->rets = ret;
 
-    avpriv_slicethread_execute(c->thread, job_count, !!c->mainfunc  );
+    if (c->pool)
+        ff_thread_pool_execute(c->pool, avctx, worker_func,
+                               c->mainfunc ? main_function : NULL,
+                               job_count, avctx->thread_count);
+    else
+        avpriv_slicethread_execute(c->thread, job_count, !!c->mainfunc  );
     return 0;
 }
 
@@ -126,9 +133,14 @@ static int thread_execute2(AVCodecContext *avctx, action_func2* func2, void *arg
 int ff_slice_thread_execute_with_mainfunc(AVCodecContext *avctx, action_func2* func2, main_func *mainfunc, void *arg, int *ret, int job_count)
 {
     SliceThreadContext *c = avctx->internal->thread_ctx;
+    int err;
+
     c->func2 = func2;
     c->mainfunc = mainfunc;
-    return thread_execute(avctx, NULL, arg, ret, job_count, 0);
+    err = thread_execute(avctx, NULL, arg, ret, job_count, 0);
+    /* the plain execute callbacks must not run it */
+    c->mainfunc = NULL;
+    return err;
 }
 
 int ff_slice_thread_init(AVCodecContext *avctx)
@@ -145,6 +157,9 @@ int ff_slice_thread_init(AVCodecContext *avctx)
 
     if (!thread_count) {
         int nb_cpus = av_cpu_count();
+        // with a pool, the calling thread works next to the pool threads
+        if (avctx->thread_pool)
+            nb_cpus = ff_thread_pool_nb_threads((FFThreadPool*)avctx->thread_pool->data) + 1;
         if  (avctx->height)
             nb_cpus = FFMIN(nb_cpus, (avctx->height+15)/16);
         // use number of cores + 1 as thread count if there is more than one
@@ -161,7 +176,9 @@ int ff_slice_thread_init(AVCodecContext *avctx)
 
     avctx->internal->thread_ctx = c = av_mallocz(sizeof(*c));
     mainfunc = ffcodec(avctx->codec)->caps_internal & FF_CODEC_CAP_SLICE_THREAD_HAS_MF ? &main_function : NULL;
-    if (!c || (thread_count = avpriv_slicethread_create(&c->thread, avctx, worker_func, mainfunc, thread_count)) <= 1) {
+    if (c && avctx->thread_pool) {
+        c->pool = (FFThreadPool*)avctx->thread_pool->data;
+    } else if (!c || (thread_count = avpriv_slicethread_create(&c->thread, avctx, worker_func, mainfunc, thread_count)) <= 1) {
         if (c)
             avpriv_slicethread_free(&c->thread);
         av_freep(&avctx->internal->thread_ctx);
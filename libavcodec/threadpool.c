@@ -0,0 +1,288 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Thread pool shared between codec contexts
+ *
+ * Every execute() call of an attached context queues a batch of jobs.
+ * Idle workers join the first pending batch and move it to the end of the
+ * queue, so that they are spread over all contexts with pending work. Once
+ * joined, a thread takes jobs from the batch until none are left. The
+ * thread that queued the batch works on it as well (unless it runs a main
+ * function), so a batch always completes, even if all workers are busy.
+ */
+
+#include <stdatomic.h>
+
+#include "config.h"
+
+#include "libavutil/avassert.h"
+#include "libavutil/buffer.h"
+#include "libavutil/cpu.h"
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "avcodec.h"
+#include "threadpool.h"
+
+#if HAVE_THREADS
+
+typedef struct PoolBatch {
+    struct PoolBatch *next;
+
+    void *priv;
+    void (*worker_func)(void *priv, int jobnr, int threadnr,
+                        int nb_jobs, int nb_threads);
+    int nb_jobs;
+    int nb_slots;           ///< maximum number of threads working on the batch
+    atomic_int next_job;
+
+    /* protected by the pool mutex */
+    int next_slot;
+    int nb_active;          ///< number of threads working on the batch
+    int queued;
+    pthread_cond_t done_cond;
+} PoolBatch;
+
+struct FFThreadPool {
+    pthread_t *threads;
+    int nb_threads;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    PoolBatch *first, *last;
+    int finished;
+};
+
+static void queue_batch(FFThreadPool *pool, PoolBatch *b)
+{
+    b->next = NULL;
+    if (pool->last)
+        pool->last->next = b;
+    else
+        pool->first = b;
+    pool->last = b;
+    b->queued  = 1;
+}
+
+static void unqueue_batch(FFThreadPool *pool, PoolBatch *b)
+{
+    PoolBatch **p = &pool->first, *prev = NULL;
+
+    while (*p != b) {
+        prev = *p;
+        p    = &prev->next;
+    }
+    *p = b->next;
+    if (pool->last == b)
+        pool->last = prev;
+    b->next   = NULL;
+    b->queued = 0;
+}
+
+/* must be called with the pool mutex held */
+static PoolBatch *join_batch(FFThreadPool *pool, int *slot)
+{
+    PoolBatch *b = pool->first;
+
+    *slot = b->next_slot++;
+    b->nb_active++;
+
+    unqueue_batch(pool, b);
+    if (b->next_slot < b->nb_slots &&
+        atomic_load_explicit(&b->next_job, memory_order_relaxed) < b->nb_jobs)
+        queue_batch(pool, b);
+
+    return b;
+}
+
+static void run_batch(PoolBatch *b, int slot)
+{
+    int jobnr;
+
+    while ((jobnr = atomic_fetch_add_explicit(&b->next_job, 1,
+                                              memory_order_acq_rel)) < b->nb_jobs)
+        b->worker_func(b->priv, jobnr, slot, b->nb_jobs, b->nb_slots);
+}
+
+static void *attribute_align_arg pool_worker(void *arg)
+{
+    FFThreadPool *pool = arg;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (1) {
+        PoolBatch *b;
+        int slot;
+
+        while (!pool->finished && !pool->first)
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        if (pool->finished)
+            break;
+
+        b = join_batch(pool, &slot);
+        pthread_mutex_unlock(&pool->mutex);
+
+        run_batch(b, slot);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (!--b->nb_active)
+            pthread_cond_signal(&b->done_cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+int ff_thread_pool_nb_threads(const FFThreadPool *pool)
+{
+    return pool->nb_threads;
+}
+
+void ff_thread_pool_execute(FFThreadPool *pool, void *priv,
+                            void (*worker_func)(void *priv, int jobnr, int threadnr,
+                                                int nb_jobs, int nb_threads),
+                            void (*main_func)(void *priv),
+                            int nb_jobs, int max_threads)
+{
+    PoolBatch b = {
+        .priv        = priv,
+        .worker_func = worker_func,
+        .nb_jobs     = nb_jobs,
+        .nb_slots    = FFMIN(nb_jobs, max_threads),
+    };
+    int slot = -1;
+
+    av_assert0(nb_jobs > 0 && max_threads > 0);
+    atomic_init(&b.next_job, 0);
+    pthread_cond_init(&b.done_cond, NULL);
+
+    pthread_mutex_lock(&pool->mutex);
+    if (!main_func) {
+        slot = b.next_slot++;
+        b.nb_active++;
+    }
+    if (b.next_slot < b.nb_slots) {
+        queue_batch(pool, &b);
+        pthread_cond_broadcast(&pool->cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (main_func)
+        main_func(priv);
+    else
+        run_batch(&b, slot);
+
+    pthread_mutex_lock(&pool->mutex);
+    if (slot >= 0)
+        b.nb_active--;
+    /* with a main function, the jobs may not even be started yet */
+    while (b.nb_active ||
+           atomic_load_explicit(&b.next_job, memory_order_relaxed) < b.nb_jobs)
+        pthread_cond_wait(&b.done_cond, &pool->mutex);
+    if (b.queued)
+        unqueue_batch(pool, &b);
+    pthread_mutex_unlock(&pool->mutex);
+
+    pthread_cond_destroy(&b.done_cond);
+}
+
+static void pool_free(void *opaque, uint8_t *data)
+{
+    FFThreadPool *pool = (FFThreadPool*)data;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->finished = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->nb_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->mutex);
+    av_freep(&pool->threads);
+    av_free(pool);
+}
+
+int avcodec_thread_pool_create(AVBufferRef **pool_ref, int nb_threads)
+{
+    FFThreadPool *pool;
+    AVBufferRef *buf;
+    int err;
+
+    *pool_ref = NULL;
+
+    if (nb_threads < 0)
+        return AVERROR(EINVAL);
+    if (!nb_threads)
+        nb_threads = av_cpu_count();
+
+    pool = av_mallocz(sizeof(*pool));
+    if (!pool)
+        return AVERROR(ENOMEM);
+    pool->threads = av_calloc(nb_threads, sizeof(*pool->threads));
+    if (!pool->threads) {
+        av_free(pool);
+        return AVERROR(ENOMEM);
+    }
+
+    if ((err = pthread_mutex_init(&pool->mutex, NULL))) {
+        av_freep(&pool->threads);
+        av_free(pool);
+        return AVERROR(err);
+    }
+    if ((err = pthread_cond_init(&pool->cond, NULL))) {
+        pthread_mutex_destroy(&pool->mutex);
+        av_freep(&pool->threads);
+        av_free(pool);
+        return AVERROR(err);
+    }
+
+    buf = av_buffer_create((uint8_t*)pool, sizeof(*pool), pool_free, NULL, 0);
+    if (!buf) {
+        pthread_cond_destroy(&pool->cond);
+        pthread_mutex_destroy(&pool->mutex);
+        av_freep(&pool->threads);
+        av_free(pool);
+        return AVERROR(ENOMEM);
+    }
+
+    for (; pool->nb_threads < nb_threads; pool->nb_threads++) {
+        err = pthread_create(&pool->threads[pool->nb_threads], NULL,
+                             pool_worker, pool);
+        if (err) {
+            av_buffer_unref(&buf);
+            return AVERROR(err);
+        }
+    }
+
+    *pool_ref = buf;
+    return 0;
+}
+
+#else
+
+int avcodec_thread_pool_create(AVBufferRef **pool_ref, int nb_threads)
+{
+    *pool_ref = NULL;
+    return AVERROR(ENOSYS);
+}
+
+#endif /* HAVE_THREADS */
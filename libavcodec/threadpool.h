@@ -0,0 +1,53 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_THREADPOOL_H
+#define AVCODEC_THREADPOOL_H
+
+#include "libavutil/buffer.h"
+
+/**
+ * Thread pool shared between codec contexts, see
+ * avcodec_thread_pool_create(). The AVBufferRef data points to it.
+ */
+typedef struct FFThreadPool FFThreadPool;
+
+/**
+ * @return the number of worker threads of the pool
+ */
+int ff_thread_pool_nb_threads(const FFThreadPool *pool);
+
+/**
+ * Run a set of jobs on the pool, with the same semantics as
+ * avpriv_slicethread_execute().
+ *
+ * If main_func is NULL, the calling thread works on the jobs as well,
+ * so the call completes even if all workers are busy with jobs from other
+ * contexts. Otherwise the calling thread runs main_func and the jobs are
+ * left to the workers.
+ *
+ * Each thread taking part gets its own threadnr, which is smaller than
+ * min(nb_jobs, max_threads).
+ */
+void ff_thread_pool_execute(FFThreadPool *pool, void *priv,
+                            void (*worker_func)(void *priv, int jobnr, int threadnr,
+                                                int nb_jobs, int nb_threads),
+                            void (*main_func)(void *priv),
+                            int nb_jobs, int max_threads);
+
+#endif /* AVCODEC_THREADPOOL_H */
@@ -166,6 +166,20 @@ enum Imode {
 };
 /** @} */ //imode defines
 
+/**
+ * A slice queued for slice-threaded decoding
+ */
+typedef struct VC1SliceJob {
+    const struct VC1Context *state; ///< decoder state to decode the slice with
+    GetBitContext gb;
+    int start_mb_y, end_mb_y;
+    int second_field;
+    int parallel_fields; ///< decoded together with the first field, see VC1Context.parallel_fields
+    int error_count;     ///< ER error count of the slice alone
+    int error_occurred;
+    int ret;
+} VC1SliceJob;
+
 /** The VC1 Context
  * @todo Change size wherever another size is more efficient
  * Many members are only used for Advanced Profile
@@ -344,8 +358,11 @@ typedef struct VC1Context{
     int fieldtx_is_raw;
     uint8_t zzi_8x8[64];
     uint8_t *blk_mv_type_base, *blk_mv_type;    ///< 0: frame MV, 1: field MV (interlaced frame)
-    uint8_t *mv_f_base, *mv_f[2];               ///< 0: MV obtained from same field, 1: opposite field
-    uint8_t *mv_f_next_base, *mv_f_next[2];
+    AVBufferRef *mv_f_buf;
+    uint8_t *mv_f[2];                           ///< 0: MV obtained from same field, 1: opposite field
+    AVBufferRef *mv_f_next_buf;                 ///< mv_f of the next reference picture, shared between frame threads
+    uint8_t *mv_f_next[2];
+    int mv_f_swap;                              ///< mv_f becomes mv_f_next at the start of the next picture
     int field_mode;         ///< 1 for interlaced field pictures
     int fptype;
     int second_field;
@@ -396,6 +413,30 @@ typedef struct VC1Context{
 
     int parse_only;              ///< Context is used within parser
     int resync_marker;           ///< could this stream contain resync markers
+
+    /** Slice threading */
+    //@{
+    struct VC1Context *slice_ctx[MAX_THREADS]; ///< per-thread decoder states, NULL without slice threading
+    struct VC1Context *field_state;            ///< first field state while second field slices are queued
+    VC1SliceJob *slice_jobs;
+    unsigned int slice_jobs_size;
+    int nb_slice_jobs;
+    int nb_slice_threads;
+    uint8_t *field_planes[6];    ///< bitplanes of the second field while the first field is queued
+    int field_planes_swapped;
+    /**
+     * The second field does not reference the first one and is decoded in
+     * the same batch. Both fields index the same rows of the DC, coded
+     * block, MB type and quantizer tables, so the second field then uses
+     * the copies below.
+     */
+    int parallel_fields;
+    int16_t *field_dc_val_base;
+    uint8_t *field_coded_block_base;
+    uint8_t *field_mb_type_base;
+    int8_t  *field_qscale_base;
+    uint8_t *field_er_status;
+    //@}
 } VC1Context;
 
 /**
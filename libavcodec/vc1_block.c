@@ -31,6 +31,7 @@
 #include "mpegvideo.h"
 #include "mpegvideodec.h"
 #include "msmpeg4_vc1_data.h"
+#include "threadframe.h"
 #include "unary.h"
 #include "vc1.h"
 #include "vc1_pred.h"
@@ -74,6 +75,35 @@ static inline void update_block_index(MpegEncContext *s)
 
 /** @} */ //Bitplane group
 
+/**
+ * Report the rows of a reference picture that are final after the current
+ * row has been decoded. The overlap and loop filters trail the decoding loop
+ * by two rows, and the vertical loop filter also modifies the bottom line of
+ * the row above the one it filters. Field pictures are only reported as a
+ * whole by ff_mpv_frame_end().
+ */
+static inline void vc1_report_decode_progress(VC1Context *v)
+{
+    MpegEncContext *s = &v->s;
+
+    if (s->pict_type != AV_PICTURE_TYPE_B && !v->field_mode &&
+        !s->er.error_occurred && s->mb_y >= 3)
+        ff_thread_report_progress(&s->current_picture_ptr->tf, s->mb_y - 3, 0);
+}
+
+/**
+ * Wait until the reference picture has been decoded down to the current
+ * macroblock row with frame threading.
+ */
+static inline void vc1_await_ref_row(VC1Context *v, const Picture *ref)
+{
+    MpegEncContext *s = &v->s;
+
+    if (HAVE_THREADS && ref && s->avctx->active_thread_type & FF_THREAD_FRAME)
+        ff_thread_await_progress(&ref->tf, v->field_mode ? s->mb_height - 1 :
+                                 FFMIN(s->mb_y, s->mb_height - 1), 0);
+}
+
 static void vc1_put_blocks_clamped(VC1Context *v, int put_signed)
 {
     MpegEncContext *s = &v->s;
@@ -427,10 +457,12 @@ static inline int ff_vc1_pred_dc(MpegEncContext *s, int overlap, int pq, int n,
 
     /* B A
      * C X
+     * Only read available neighbours: with slice threading, the row above
+     * the first line of a slice belongs to another slice.
      */
-    c = dc_val[ - 1];
-    b = dc_val[ - 1 - wrap];
-    a = dc_val[ - wrap];
+    c = c_avail            ? dc_val[ - 1]        : 0;
+    b = a_avail && c_avail ? dc_val[ - 1 - wrap] : 0;
+    a = a_avail            ? dc_val[ - wrap]     : 0;
 
     if (c_avail && (n != 1 && n != 3)) {
         q2 = FFABS(s->current_picture.qscale_table[mb_pos - 1]);
@@ -487,10 +519,15 @@ static inline int vc1_coded_block_pred(MpegEncContext * s, int n,
 
     /* B C
      * A X
+     * The row above the first line of a slice counts as not coded.
      */
-    a = s->coded_block[xy - 1       ];
-    b = s->coded_block[xy - 1 - wrap];
-    c = s->coded_block[xy     - wrap];
+    a = s->coded_block[xy - 1];
+    if (s->first_slice_line && n < 2) {
+        b = c = 0;
+    } else {
+        b = s->coded_block[xy - 1 - wrap];
+        c = s->coded_block[xy     - wrap];
+    }
 
     if (b == c) {
         pred = a;
@@ -799,6 +836,10 @@ static int vc1_decode_i_block_adv(VC1Context *v, int16_t block[64], int n,
     //AC Decoding
     i = 1;
 
+    /* Cleared up front, so that a block failing to decode does not leave
+     * stale predictors for its neighbours. */
+    memset(ac_val2, 0, 16 * 2);
+
     if (coded) {
         int last = 0, skip, value;
         const uint8_t *zz_table;
@@ -870,8 +911,6 @@ static int vc1_decode_i_block_adv(VC1Context *v, int16_t block[64], int n,
     } else { // no AC coeffs
         int k;
 
-        memset(ac_val2, 0, 16 * 2);
-
         /* apply AC prediction if needed */
         if (use_pred) {
             int sh;
@@ -999,6 +1038,10 @@ static int vc1_decode_intra_block(VC1Context *v, int16_t block[64], int n,
         q2 = q1;
     if (n == 3) q2 = q1;
 
+    /* Cleared up front, so that a block failing to decode does not leave
+     * stale predictors for its neighbours. */
+    memset(ac_val2, 0, 16 * 2);
+
     if (coded) {
         int last = 0, skip, value;
         int k;
@@ -1068,7 +1111,6 @@ static int vc1_decode_intra_block(VC1Context *v, int16_t block[64], int n,
     } else { // no AC coeffs
         int k;
 
-        memset(ac_val2, 0, 16 * 2);
         if (dc_pred_dir) { // left
             if (use_pred) {
                 memcpy(ac_val2, ac_val, 8 * 2);
@@ -2645,6 +2687,7 @@ static void vc1_decode_i_blocks(VC1Context *v)
             v->cur_blk_idx = (v->cur_blk_idx + 1) % (v->end_mb_x + 2);
         }
 
+        vc1_report_decode_progress(v);
         s->first_slice_line = 0;
     }
 
@@ -2699,12 +2742,6 @@ static int vc1_decode_i_blocks_adv(VC1Context *v)
     s->mb_intra         = 1;
     s->first_slice_line = 1;
     s->mb_y             = s->start_mb_y;
-    if (s->start_mb_y) {
-        s->mb_x = 0;
-        init_block_index(v);
-        memset(&s->coded_block[s->block_index[0] - s->b8_stride], 0,
-               (1 + s->b8_stride) * sizeof(*s->coded_block));
-    }
     for (; s->mb_y < s->end_mb_y; s->mb_y++) {
         s->mb_x = 0;
         init_block_index(v);
@@ -2785,6 +2822,7 @@ static int vc1_decode_i_blocks_adv(VC1Context *v)
             inc_blk_idx(v->left_blk_idx);
             inc_blk_idx(v->cur_blk_idx);
         }
+        vc1_report_decode_progress(v);
         s->first_slice_line = 0;
     }
 
@@ -2825,7 +2863,6 @@ static void vc1_decode_p_blocks(VC1Context *v)
 
     apply_loop_filter   = s->loop_filter && !(s->avctx->skip_loop_filter >= AVDISCARD_NONKEY);
     s->first_slice_line = 1;
-    memset(v->cbp_base, 0, sizeof(v->cbp_base[0]) * 3 * s->mb_stride);
     for (s->mb_y = s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
         s->mb_x = 0;
         init_block_index(v);
@@ -2875,6 +2912,7 @@ static void vc1_decode_p_blocks(VC1Context *v)
         memmove(v->luma_mv_base,
                 v->luma_mv - s->mb_stride,
                 sizeof(v->luma_mv_base[0]) * 2 * s->mb_stride);
+        vc1_report_decode_progress(v);
         s->first_slice_line = 0;
     }
     ff_er_add_slice(&s->er, 0, s->start_mb_y << v->field_mode, s->mb_width - 1,
@@ -2914,6 +2952,8 @@ static void vc1_decode_b_blocks(VC1Context *v)
     for (s->mb_y = s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
         s->mb_x = 0;
         init_block_index(v);
+        /* direct prediction reads the co-located motion vectors */
+        vc1_await_ref_row(v, s->next_picture_ptr);
         for (; s->mb_x < s->mb_width; s->mb_x++) {
             update_block_index(s);
 
@@ -2972,6 +3012,7 @@ static void vc1_decode_skip_blocks(VC1Context *v)
         s->mb_x = 0;
         init_block_index(v);
         update_block_index(s);
+        vc1_await_ref_row(v, s->last_picture_ptr);
         memcpy(s->dest[0], s->last_picture.f->data[0] + s->mb_y * 16 * s->linesize,   s->linesize   * 16);
         memcpy(s->dest[1], s->last_picture.f->data[1] + s->mb_y *  8 * s->uvlinesize, s->uvlinesize *  8);
         memcpy(s->dest[2], s->last_picture.f->data[2] + s->mb_y *  8 * s->uvlinesize, s->uvlinesize *  8);
@@ -2979,9 +3020,47 @@ static void vc1_decode_skip_blocks(VC1Context *v)
     }
 }
 
-void ff_vc1_decode_blocks(VC1Context *v)
+/* Clear the prediction tables of the rows of the slice, which a macroblock
+ * failing to decode may leave holding values of an earlier picture. The
+ * motion vectors and macroblock types of the picture are cleared as well, as
+ * I pictures do not write them and the picture buffers are reused. */
+static void vc1_clear_slice_tables(VC1Context *v)
 {
+    MpegEncContext *s = &v->s;
+    int rows  = s->end_mb_y - s->start_mb_y;
+    int mb    = s->mb_stride * s->start_mb_y;
+    int luma  = s->b8_stride * 2 * s->start_mb_y;
+    int cb    = s->b8_stride * 2 * s->mb_height + s->mb_stride * (s->start_mb_y + 1);
+    int cr    = cb + s->mb_stride * (s->mb_height + 1);
+    /* stop at the last block of the slice: the table of the last row has no
+     * room for the padding entry that follows it */
+    int luma_size   = s->b8_stride * 2 * rows - 1;
+    int mb_size     = s->mb_stride * rows - 1;
+
+    memset(s->coded_block + luma, 0, luma_size);
+    memset(v->mb_type[0]  + luma, 0, luma_size);
+    memset(v->mb_type[0]  + cb,   0, mb_size);
+    memset(v->mb_type[0]  + cr,   0, mb_size);
+    memset(s->dc_val[0]   + luma, 0, sizeof(*s->dc_val[0]) * luma_size);
+    memset(s->dc_val[0]   + cb,   0, sizeof(*s->dc_val[0]) * mb_size);
+    memset(s->dc_val[0]   + cr,   0, sizeof(*s->dc_val[0]) * mb_size);
+    memset(s->ac_val[0]   + luma, 0, sizeof(*s->ac_val[0]) * luma_size);
+    memset(s->ac_val[0]   + cb,   0, sizeof(*s->ac_val[0]) * mb_size);
+    memset(s->ac_val[0]   + cr,   0, sizeof(*s->ac_val[0]) * mb_size);
+
+    memset(s->current_picture.mb_type + mb + v->mb_off, 0,
+           sizeof(*s->current_picture.mb_type) * mb_size);
+    for (int dir = 0; dir < 2; dir++) {
+        memset(s->current_picture.motion_val[dir] + luma + v->blocks_off, 0,
+               sizeof(*s->current_picture.motion_val[dir]) * luma_size);
+        memset(v->mv_f[dir] + luma + v->blocks_off, 0, luma_size);
+        memset(v->mv_f[dir] + cb   + v->mb_off,     0, mb_size);
+        memset(v->mv_f[dir] + cr   + v->mb_off,     0, mb_size);
+    }
+}
 
+void ff_vc1_decode_blocks(VC1Context *v)
+{
     v->s.esc3_level_length = 0;
     if (v->x8_type) {
         ff_intrax8_decode_picture(&v->x8, &v->s.current_picture,
@@ -2997,6 +3076,16 @@ void ff_vc1_decode_blocks(VC1Context *v)
         v->left_blk_idx    = -1;
         v->topleft_blk_idx =  1;
         v->top_blk_idx     =  2;
+        /* A macroblock that fails to decode leaves its blocks, motion vectors
+         * and loop filter parameters untouched; clear them so that a slice
+         * never depends on what was decoded before it. */
+        memset(v->s.mv,          0, sizeof(v->s.mv));
+        memset(v->block,         0, sizeof(*v->block)           * v->n_allocated_blks);
+        memset(v->cbp_base,      0, sizeof(v->cbp_base[0])      * 3 * v->s.mb_stride);
+        memset(v->ttblk_base,    0, sizeof(v->ttblk_base[0])    * 3 * v->s.mb_stride);
+        memset(v->is_intra_base, 0, sizeof(v->is_intra_base[0]) * 3 * v->s.mb_stride);
+        memset(v->luma_mv_base,  0, sizeof(v->luma_mv_base[0])  * 3 * v->s.mb_stride);
+        vc1_clear_slice_tables(v);
         switch (v->s.pict_type) {
         case AV_PICTURE_TYPE_I:
             if (v->profile == PROFILE_ADVANCED)
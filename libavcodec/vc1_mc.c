@@ -30,6 +30,7 @@
 #include "h264chroma.h"
 #include "mathops.h"
 #include "mpegvideo.h"
+#include "threadframe.h"
 #include "vc1.h"
 
 static av_always_inline void vc1_scale_luma(uint8_t *srcY,
@@ -166,6 +167,33 @@ static av_always_inline int get_chroma_mv(VC1Context *v, int dir, int16_t *tx, i
     return valid_count;
 }
 
+/**
+ * Wait until the reference picture is decoded far enough for a block of
+ * height h (in luma lines) starting at luma line src_y to be read from it.
+ * Field pictures and interlaced references are read with a doubled stride.
+ * ref is NULL when the block is predicted from the current picture.
+ */
+static void vc1_await_reference(VC1Context *v, const Picture *ref,
+                                int src_y, int h, int interlace)
+{
+    MpegEncContext *s = &v->s;
+    int bottom;
+
+    if (!HAVE_THREADS || !ref ||
+        !(s->avctx->active_thread_type & FF_THREAD_FRAME))
+        return;
+
+    /* include the bicubic filter taps below the block */
+    if (v->field_mode)
+        bottom = 2 * (src_y + h + 3) + 1;
+    else if (interlace || v->fcm == ILACE_FRAME)
+        bottom = src_y + 2 * (h + 3) + 1;
+    else
+        bottom = src_y + h + 3;
+
+    ff_thread_await_progress(&ref->tf, av_clip(bottom >> 4, 0, s->mb_height - 1), 0);
+}
+
 /** Do motion compensation over 1 macroblock
  * Mostly adapted hpel_motion and qpel_motion from mpegvideo.c
  */
@@ -178,6 +206,7 @@ void ff_vc1_mc_1mv(VC1Context *v, int dir)
     int v_edge_pos = s->v_edge_pos >> v->field_mode;
     int i;
     uint8_t (*luty)[256], (*lutuv)[256];
+    const Picture *ref;
     int use_ic;
     int interlace;
     int linesize, uvlinesize;
@@ -226,6 +255,7 @@ void ff_vc1_mc_1mv(VC1Context *v, int dir)
             lutuv = v->curr_lutuv;
             use_ic = *v->curr_use_ic;
             interlace = 1;
+            ref = NULL;
         } else {
             srcY = s->last_picture.f->data[0];
             srcU = s->last_picture.f->data[1];
@@ -234,6 +264,7 @@ void ff_vc1_mc_1mv(VC1Context *v, int dir)
             lutuv = v->last_lutuv;
             use_ic = v->last_use_ic;
             interlace = s->last_picture.f->interlaced_frame;
+            ref = s->last_picture_ptr;
         }
     } else {
         srcY = s->next_picture.f->data[0];
@@ -243,6 +274,7 @@ void ff_vc1_mc_1mv(VC1Context *v, int dir)
         lutuv = v->next_lutuv;
         use_ic = v->next_use_ic;
         interlace = s->next_picture.f->interlaced_frame;
+        ref = s->next_picture_ptr;
     }
 
     if (!srcY || !srcU) {
@@ -272,6 +304,9 @@ void ff_vc1_mc_1mv(VC1Context *v, int dir)
         }
     }
 
+    vc1_await_reference(v, ref, src_y, 16, interlace);
+    vc1_await_reference(v, ref, 2 * uvsrc_y, 18, interlace);
+
     srcY += src_y   * s->linesize   + src_x;
     srcU += uvsrc_y * s->uvlinesize + uvsrc_x;
     srcV += uvsrc_y * s->uvlinesize + uvsrc_x;
@@ -458,6 +493,7 @@ void ff_vc1_mc_4mv_luma(VC1Context *v, int n, int dir, int avg)
     int fieldmv = (v->fcm == ILACE_FRAME) ? v->blk_mv_type[s->block_index[n]] : 0;
     int v_edge_pos = s->v_edge_pos >> v->field_mode;
     uint8_t (*luty)[256];
+    const Picture *ref;
     int use_ic;
     int interlace;
     int linesize;
@@ -478,17 +514,20 @@ void ff_vc1_mc_4mv_luma(VC1Context *v, int n, int dir, int avg)
             luty = v->curr_luty;
             use_ic = *v->curr_use_ic;
             interlace = 1;
+            ref = NULL;
         } else {
             srcY = s->last_picture.f->data[0];
             luty = v->last_luty;
             use_ic = v->last_use_ic;
             interlace = s->last_picture.f->interlaced_frame;
+            ref = s->last_picture_ptr;
         }
     } else {
         srcY = s->next_picture.f->data[0];
         luty = v->next_luty;
         use_ic = v->next_use_ic;
         interlace = s->next_picture.f->interlaced_frame;
+        ref = s->next_picture_ptr;
     }
 
     if (!srcY) {
@@ -553,6 +592,8 @@ void ff_vc1_mc_4mv_luma(VC1Context *v, int n, int dir, int avg)
             src_y = av_clip(src_y, -18, s->avctx->coded_height + 1);
     }
 
+    vc1_await_reference(v, ref, src_y, 8 << fieldmv, interlace);
+
     srcY += src_y * s->linesize + src_x;
     if (v->field_mode && v->ref_field_type[dir])
         srcY += linesize;
@@ -641,6 +682,7 @@ void ff_vc1_mc_4mv_chroma(VC1Context *v, int dir)
     int chroma_ref_type;
     int v_edge_pos = s->v_edge_pos >> v->field_mode;
     uint8_t (*lutuv)[256];
+    const Picture *ref;
     int use_ic;
     int interlace;
     int uvlinesize;
@@ -703,12 +745,14 @@ void ff_vc1_mc_4mv_chroma(VC1Context *v, int dir)
             lutuv = v->curr_lutuv;
             use_ic = *v->curr_use_ic;
             interlace = 1;
+            ref = NULL;
         } else {
             srcU = s->last_picture.f->data[1];
             srcV = s->last_picture.f->data[2];
             lutuv = v->last_lutuv;
             use_ic = v->last_use_ic;
             interlace = s->last_picture.f->interlaced_frame;
+            ref = s->last_picture_ptr;
         }
     } else {
         srcU = s->next_picture.f->data[1];
@@ -716,6 +760,7 @@ void ff_vc1_mc_4mv_chroma(VC1Context *v, int dir)
         lutuv = v->next_lutuv;
         use_ic = v->next_use_ic;
         interlace = s->next_picture.f->interlaced_frame;
+        ref = s->next_picture_ptr;
     }
 
     if (!srcU) {
@@ -723,6 +768,8 @@ void ff_vc1_mc_4mv_chroma(VC1Context *v, int dir)
         return;
     }
 
+    vc1_await_reference(v, ref, 2 * uvsrc_y, 18, interlace);
+
     srcU += uvsrc_y * s->uvlinesize + uvsrc_x;
     srcV += uvsrc_y * s->uvlinesize + uvsrc_x;
 
@@ -848,6 +895,7 @@ void ff_vc1_mc_4mv_chroma4(VC1Context *v, int dir, int dir2, int avg)
     static const uint8_t s_rndtblfield[16] = { 0, 0, 1, 2, 4, 4, 5, 6, 2, 2, 3, 8, 6, 6, 7, 12 };
     int v_dist = fieldmv ? 1 : 4; // vertical offset for lower sub-blocks
     int v_edge_pos = s->v_edge_pos >> 1;
+    const Picture *ref;
     int use_ic;
     int interlace;
     int uvlinesize;
@@ -885,15 +933,18 @@ void ff_vc1_mc_4mv_chroma4(VC1Context *v, int dir, int dir2, int avg)
             lutuv  = v->next_lutuv;
             use_ic = v->next_use_ic;
             interlace = s->next_picture.f->interlaced_frame;
+            ref = s->next_picture_ptr;
         } else {
             srcU = s->last_picture.f->data[1];
             srcV = s->last_picture.f->data[2];
             lutuv  = v->last_lutuv;
             use_ic = v->last_use_ic;
             interlace = s->last_picture.f->interlaced_frame;
+            ref = s->last_picture_ptr;
         }
         if (!srcU)
             return;
+        vc1_await_reference(v, ref, 2 * uvsrc_y, 10 << fieldmv, interlace);
         srcU += uvsrc_y * s->uvlinesize + uvsrc_x;
         srcV += uvsrc_y * s->uvlinesize + uvsrc_x;
         uvmx_field[i] = (uvmx_field[i] & 3) << 1;
@@ -1058,6 +1109,9 @@ void ff_vc1_interp_mc(VC1Context *v)
         }
     }
 
+    vc1_await_reference(v, s->next_picture_ptr, src_y, 16, interlace);
+    vc1_await_reference(v, s->next_picture_ptr, 2 * uvsrc_y, 18, interlace);
+
     srcY += src_y   * s->linesize   + src_x;
     srcU += uvsrc_y * s->uvlinesize + uvsrc_x;
     srcV += uvsrc_y * s->uvlinesize + uvsrc_x;
@@ -41,6 +41,7 @@
 #include "msmpeg4_vc1_data.h"
 #include "profiles.h"
 #include "simple_idct.h"
+#include "thread.h"
 #include "vc1.h"
 #include "vc1data.h"
 #include "vc1_vlc_data.h"
@@ -330,6 +331,15 @@ static void vc1_sprite_flush(AVCodecContext *avctx)
 
 #endif
 
+static void vc1_set_mv_f(const MpegEncContext *s, uint8_t *mv_f[2],
+                         const AVBufferRef *buf)
+{
+    int mb_height = FFALIGN(s->mb_height, 2);
+
+    mv_f[0] = buf->data + s->b8_stride + 1;
+    mv_f[1] = mv_f[0] + (s->b8_stride * (mb_height * 2 + 1) + s->mb_stride * (mb_height + 1) * 2);
+}
+
 static av_cold int vc1_decode_init_alloc_tables(VC1Context *v)
 {
     MpegEncContext *s = &v->s;
@@ -379,16 +389,13 @@ static av_cold int vc1_decode_init_alloc_tables(VC1Context *v)
     if (!v->blk_mv_type_base)
         return AVERROR(ENOMEM);
     v->blk_mv_type      = v->blk_mv_type_base + s->b8_stride + 1;
-    v->mv_f_base        = av_mallocz(2 * (s->b8_stride * (mb_height * 2 + 1) + s->mb_stride * (mb_height + 1) * 2));
-    if (!v->mv_f_base)
-        return AVERROR(ENOMEM);
-    v->mv_f[0]          = v->mv_f_base + s->b8_stride + 1;
-    v->mv_f[1]          = v->mv_f[0] + (s->b8_stride * (mb_height * 2 + 1) + s->mb_stride * (mb_height + 1) * 2);
-    v->mv_f_next_base   = av_mallocz(2 * (s->b8_stride * (mb_height * 2 + 1) + s->mb_stride * (mb_height + 1) * 2));
-    if (!v->mv_f_next_base)
+    v->mv_f_buf         = av_buffer_allocz(2 * (s->b8_stride * (mb_height * 2 + 1) + s->mb_stride * (mb_height + 1) * 2));
+    v->mv_f_next_buf    = av_buffer_allocz(2 * (s->b8_stride * (mb_height * 2 + 1) + s->mb_stride * (mb_height + 1) * 2));
+    if (!v->mv_f_buf || !v->mv_f_next_buf)
         return AVERROR(ENOMEM);
-    v->mv_f_next[0]     = v->mv_f_next_base + s->b8_stride + 1;
-    v->mv_f_next[1]     = v->mv_f_next[0] + (s->b8_stride * (mb_height * 2 + 1) + s->mb_stride * (mb_height + 1) * 2);
+    vc1_set_mv_f(s, v->mv_f,      v->mv_f_buf);
+    vc1_set_mv_f(s, v->mv_f_next, v->mv_f_next_buf);
+    v->mv_f_swap        = 0;
 
     if (s->avctx->codec_id == AV_CODEC_ID_WMV3IMAGE || s->avctx->codec_id == AV_CODEC_ID_VC1IMAGE) {
         for (i = 0; i < 4; i++)
@@ -405,6 +412,57 @@ static av_cold int vc1_decode_init_alloc_tables(VC1Context *v)
     return 0;
 }
 
+/* Per-thread copies of the row buffers, which are all that slices of the
+ * same picture do not share. */
+static av_cold int vc1_decode_init_slice_contexts(VC1Context *v)
+{
+    MpegEncContext *s = &v->s;
+    int mb_height = FFALIGN(s->mb_height, 2);
+    int y_size, c_size, yc_size, i;
+
+    for (i = 0; i < s->slice_context_count; i++) {
+        VC1Context *sv = av_mallocz(sizeof(*sv));
+        if (!sv)
+            return AVERROR(ENOMEM);
+        v->slice_ctx[i] = sv;
+        sv->block         = av_malloc(sizeof(*sv->block) * v->n_allocated_blks);
+        sv->cbp_base      = av_malloc(sizeof(sv->cbp_base[0]) * 3 * s->mb_stride);
+        sv->ttblk_base    = av_malloc(sizeof(sv->ttblk_base[0]) * 3 * s->mb_stride);
+        sv->is_intra_base = av_mallocz(sizeof(sv->is_intra_base[0]) * 3 * s->mb_stride);
+        sv->luma_mv_base  = av_mallocz(sizeof(sv->luma_mv_base[0]) * 3 * s->mb_stride);
+        if (!sv->block || !sv->cbp_base || !sv->ttblk_base ||
+            !sv->is_intra_base || !sv->luma_mv_base)
+            return AVERROR(ENOMEM);
+    }
+
+    v->field_state = av_mallocz(sizeof(*v->field_state));
+    if (!v->field_state)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < FF_ARRAY_ELEMS(v->field_planes); i++)
+        if (!(v->field_planes[i] = av_mallocz(s->mb_stride * mb_height)))
+            return AVERROR(ENOMEM);
+
+    /* same layouts as the frame tables in MpegEncContext and VC1Context */
+    y_size  = s->b8_stride * (2 * s->mb_height + 1);
+    c_size  = s->mb_stride * (s->mb_height + 1);
+    yc_size = y_size + 2 * c_size;
+    if (s->mb_height & 1)
+        yc_size += 2 * s->b8_stride + 2 * s->mb_stride;
+    v->field_dc_val_base      = av_malloc_array(yc_size, sizeof(*v->field_dc_val_base));
+    v->field_coded_block_base = av_mallocz(y_size + (s->mb_height & 1) * 2 * s->b8_stride);
+    v->field_mb_type_base     = av_mallocz(s->b8_stride * (mb_height * 2 + 1) +
+                                           s->mb_stride * (mb_height + 1) * 2);
+    v->field_qscale_base      = av_mallocz(s->mb_stride * (mb_height + 3));
+    v->field_er_status        = av_malloc(s->mb_stride * s->mb_height);
+    if (!v->field_dc_val_base || !v->field_coded_block_base ||
+        !v->field_mb_type_base || !v->field_qscale_base || !v->field_er_status)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < yc_size; i++)
+        v->field_dc_val_base[i] = 1024;
+
+    return 0;
+}
+
 static enum AVPixelFormat vc1_get_format(AVCodecContext *avctx)
 {
     if (avctx->codec_id == AV_CODEC_ID_MSS2)
@@ -447,6 +505,8 @@ av_cold int ff_vc1_decode_init(AVCodecContext *avctx)
                       ff_wmv1_scantable[1]);
 
     ret = vc1_decode_init_alloc_tables(v);
+    if (ret >= 0 && s->slice_context_count > 1)
+        ret = vc1_decode_init_slice_contexts(v);
     if (ret < 0) {
         ff_vc1_decode_end(avctx);
         return ret;
@@ -804,17 +864,347 @@ av_cold int ff_vc1_decode_end(AVCodecContext *avctx)
     av_freep(&v->over_flags_plane);
     av_freep(&v->mb_type_base);
     av_freep(&v->blk_mv_type_base);
-    av_freep(&v->mv_f_base);
-    av_freep(&v->mv_f_next_base);
+    av_buffer_unref(&v->mv_f_buf);
+    av_buffer_unref(&v->mv_f_next_buf);
     av_freep(&v->block);
     av_freep(&v->cbp_base);
     av_freep(&v->ttblk_base);
     av_freep(&v->is_intra_base); // FIXME use v->mb_type[]
     av_freep(&v->luma_mv_base);
+    for (i = 0; i < FF_ARRAY_ELEMS(v->slice_ctx); i++) {
+        VC1Context *sv = v->slice_ctx[i];
+        if (!sv)
+            continue;
+        av_freep(&sv->block);
+        av_freep(&sv->cbp_base);
+        av_freep(&sv->ttblk_base);
+        av_freep(&sv->is_intra_base);
+        av_freep(&sv->luma_mv_base);
+        av_freep(&v->slice_ctx[i]);
+    }
+    av_freep(&v->field_state);
+    for (i = 0; i < FF_ARRAY_ELEMS(v->field_planes); i++)
+        av_freep(&v->field_planes[i]);
+    av_freep(&v->field_dc_val_base);
+    av_freep(&v->field_coded_block_base);
+    av_freep(&v->field_mb_type_base);
+    av_freep(&v->field_qscale_base);
+    av_freep(&v->field_er_status);
+    av_freep(&v->slice_jobs);
+    v->slice_jobs_size = 0;
     ff_intrax8_common_end(&v->x8);
     return 0;
 }
 
+#if HAVE_THREADS
+static int vc1_update_thread_context(AVCodecContext *dst,
+                                     const AVCodecContext *src)
+{
+    VC1Context *v = dst->priv_data;
+    const VC1Context *v1 = src->priv_data;
+    MpegEncContext *s = &v->s;
+    const MpegEncContext *s1 = &v1->s;
+    int ret;
+
+    if (dst == src || !s1->context_initialized)
+        return 0;
+
+    /* The VC-1 tables are sized after the MpegEncContext, so (re)initialize
+     * the whole decoder rather than letting ff_mpeg_update_thread_context()
+     * set up or resize the MpegEncContext on its own. */
+    if (s->context_initialized &&
+        (s->width != s1->width || s->height != s1->height))
+        ff_vc1_decode_end(dst);
+    if (!s->context_initialized) {
+        ret = ff_vc1_decode_init(dst);
+        if (ret < 0)
+            return ret;
+    }
+
+    ret = ff_mpeg_update_thread_context(dst, src);
+    if (ret < 0)
+        return ret;
+
+    s->h_edge_pos  = s1->h_edge_pos;
+    s->v_edge_pos  = s1->v_edge_pos;
+    s->loop_filter = s1->loop_filter;
+
+    // entry point header
+    v->broken_link      = v1->broken_link;
+    v->closed_entry     = v1->closed_entry;
+    v->panscanflag      = v1->panscanflag;
+    v->refdist_flag     = v1->refdist_flag;
+    v->fastuvmc         = v1->fastuvmc;
+    v->extended_mv      = v1->extended_mv;
+    v->dquant           = v1->dquant;
+    v->vstransform      = v1->vstransform;
+    v->overlap          = v1->overlap;
+    v->quantizer_mode   = v1->quantizer_mode;
+    v->extended_dmv     = v1->extended_dmv;
+    v->range_mapy_flag  = v1->range_mapy_flag;
+    v->range_mapy       = v1->range_mapy;
+    v->range_mapuv_flag = v1->range_mapuv_flag;
+    v->range_mapuv      = v1->range_mapuv;
+
+    // picture header state inherited from the previous pictures
+    v->rnd         = v1->rnd;
+    v->respic      = v1->respic;
+    v->refdist     = v1->refdist;
+    v->qs_last     = v1->qs_last;
+    v->last_use_ic = v1->last_use_ic;
+    v->next_use_ic = v1->next_use_ic;
+    v->aux_use_ic  = v1->aux_use_ic;
+
+    memcpy(v->last_luty,  v1->last_luty,  sizeof(v->last_luty));
+    memcpy(v->last_lutuv, v1->last_lutuv, sizeof(v->last_lutuv));
+    memcpy(v->next_luty,  v1->next_luty,  sizeof(v->next_luty));
+    memcpy(v->next_lutuv, v1->next_lutuv, sizeof(v->next_lutuv));
+    memcpy(v->aux_luty,   v1->aux_luty,   sizeof(v->aux_luty));
+    memcpy(v->aux_lutuv,  v1->aux_lutuv,  sizeof(v->aux_lutuv));
+
+    /* The field flags of the motion vectors of the next reference picture,
+     * used by B field pictures for direct prediction. If the source thread
+     * is decoding a reference field picture, they are still being written;
+     * the B picture rows wait for the whole reference before reading them.
+     * The buffer is not written again by the source thread, which decodes
+     * its next picture into a copy if the buffer is shared. */
+    if (v1->field_mode && s1->pict_type != AV_PICTURE_TYPE_B &&
+        s1->pict_type != AV_PICTURE_TYPE_BI)
+        ret = av_buffer_replace(&v->mv_f_next_buf, v1->mv_f_buf);
+    else
+        ret = av_buffer_replace(&v->mv_f_next_buf, v1->mv_f_swap ? v1->mv_f_buf :
+                                                                  v1->mv_f_next_buf);
+    if (ret < 0)
+        return ret;
+    vc1_set_mv_f(s, v->mv_f_next, v->mv_f_next_buf);
+    v->mv_f_swap = 0;
+
+    return 0;
+}
+#endif
+
+/* Copy a decoder state, including the intensity compensation table pointers
+ * that point into the context itself. */
+static void vc1_copy_state(VC1Context *dst, const VC1Context *src)
+{
+#define RELOCATE(field)                                                     \
+    if (src->field)                                                         \
+        dst->field = (void *)((uint8_t *)dst +                              \
+                              ((const uint8_t *)src->field - (const uint8_t *)src))
+    memcpy(dst, src, sizeof(*dst));
+    RELOCATE(curr_luty);
+    RELOCATE(curr_lutuv);
+    RELOCATE(curr_use_ic);
+#undef RELOCATE
+}
+
+static void vc1_swap_field_planes(VC1Context *v)
+{
+    FFSWAP(uint8_t *, v->mv_type_mb_plane, v->field_planes[0]);
+    FFSWAP(uint8_t *, v->direct_mb_plane,  v->field_planes[1]);
+    FFSWAP(uint8_t *, v->forward_mb_plane, v->field_planes[2]);
+    FFSWAP(uint8_t *, v->fieldtx_plane,    v->field_planes[3]);
+    FFSWAP(uint8_t *, v->acpred_plane,     v->field_planes[4]);
+    FFSWAP(uint8_t *, v->over_flags_plane, v->field_planes[5]);
+    v->field_planes_swapped ^= 1;
+}
+
+/* Whether the second field can be decoded at the same time as the first,
+ * i.e. it does not predict from it. */
+static int vc1_second_field_is_intra_or_refs_previous(const VC1Context *v)
+{
+    const MpegEncContext *s = &v->s;
+
+    if (s->pict_type == AV_PICTURE_TYPE_I ||
+        (s->pict_type == AV_PICTURE_TYPE_B && v->bi_type))
+        return 1;
+    return s->pict_type == AV_PICTURE_TYPE_P && !v->numref &&
+           v->ref_field_type[0] == v->cur_field_type;
+}
+
+/* Set up the state of slice thread k for decoding one queued slice. */
+static int vc1_slice_context_setup(VC1Context *v, int k, const VC1SliceJob *job)
+{
+    VC1Context *sv = v->slice_ctx[k];
+    const VC1Context *src = job->state;
+    int16_t (*block)[6][64]      = sv->block;
+    uint32_t *cbp_base           = sv->cbp_base;
+    int *ttblk_base              = sv->ttblk_base;
+    uint8_t *is_intra_base       = sv->is_intra_base;
+    int16_t (*luma_mv_base)[2]   = sv->luma_mv_base;
+    MpegEncContext *s;
+    int ret;
+
+    if (k) {
+        MpegEncContext *t = v->s.thread_context[k];
+        ret = ff_update_duplicate_context(t, &src->s);
+        if (ret < 0)
+            return ret;
+        vc1_copy_state(sv, src);
+        sv->s = *t;
+    } else {
+        vc1_copy_state(sv, src);
+    }
+    s = &sv->s;
+
+    sv->block         = block;
+    sv->cbp_base      = cbp_base;
+    sv->cbp           = cbp_base      + 2 * s->mb_stride;
+    sv->ttblk_base    = ttblk_base;
+    sv->ttblk         = ttblk_base    + 2 * s->mb_stride;
+    sv->is_intra_base = is_intra_base;
+    sv->is_intra      = is_intra_base + 2 * s->mb_stride;
+    sv->luma_mv_base  = luma_mv_base;
+    sv->luma_mv       = luma_mv_base  + 2 * s->mb_stride;
+
+    if (job->parallel_fields) {
+        for (int i = 0; i < 3; i++) {
+            s->dc_val[i]   = v->field_dc_val_base  + (v->s.dc_val[i] - v->s.dc_val_base);
+            sv->mb_type[i] = v->field_mb_type_base + (v->mb_type[i]  - v->mb_type_base);
+        }
+        s->coded_block                  = v->field_coded_block_base + (v->s.coded_block - v->s.coded_block_base);
+        s->current_picture.qscale_table = v->field_qscale_base + 2 * s->mb_stride + 1;
+        s->er.error_status_table        = v->field_er_status;
+    }
+
+    s->gb         = job->gb;
+    s->start_mb_y = job->start_mb_y;
+    s->end_mb_y   = job->end_mb_y;
+    atomic_init(&s->er.error_count, 0);
+    s->er.error_occurred = 0;
+
+    return 0;
+}
+
+static int vc1_decode_slice_thread(AVCodecContext *avctx, void *arg,
+                                   int jobnr, int threadnr)
+{
+    VC1Context *v = avctx->priv_data;
+    int i;
+
+    for (i = jobnr; i < v->nb_slice_jobs; i += v->nb_slice_threads) {
+        VC1SliceJob *job = &v->slice_jobs[i];
+        VC1Context *sv   = v->slice_ctx[jobnr];
+
+        job->ret = vc1_slice_context_setup(v, jobnr, job);
+        if (job->ret < 0)
+            continue;
+        ff_vc1_decode_blocks(sv);
+        job->error_count    = atomic_load(&sv->s.er.error_count);
+        job->error_occurred = sv->s.er.error_occurred;
+    }
+    return 0;
+}
+
+/* Decode the queued slices, as many as there are slice threads at a time. */
+static int vc1_decode_slice_jobs(VC1Context *v)
+{
+    MpegEncContext *s = &v->s;
+    int i, y, ret = 0;
+
+    if (!v->nb_slice_jobs)
+        return 0;
+
+    if (v->nb_slice_jobs == 1 && v->slice_jobs[0].state == v &&
+        !v->slice_jobs[0].parallel_fields) {
+        /* nothing to run in parallel, decode in place */
+        GetBitContext gb = s->gb;
+        s->gb         = v->slice_jobs[0].gb;
+        s->start_mb_y = v->slice_jobs[0].start_mb_y;
+        s->end_mb_y   = v->slice_jobs[0].end_mb_y;
+        ff_vc1_decode_blocks(v);
+        s->gb = gb;
+        v->nb_slice_jobs = 0;
+        return 0;
+    }
+
+    v->nb_slice_threads = FFMIN(s->slice_context_count, v->nb_slice_jobs);
+    s->avctx->execute2(s->avctx, vc1_decode_slice_thread, NULL, NULL,
+                       v->nb_slice_threads);
+
+    /* Merge the error state in bitstream order. Each slice either adds to
+     * the count or marks the whole picture as damaged. */
+    for (i = 0; i < v->nb_slice_jobs; i++) {
+        const VC1SliceJob *job = &v->slice_jobs[i];
+        if (job->ret < 0) {
+            ret = job->ret;
+            continue;
+        }
+        if (job->error_count == INT_MAX)
+            atomic_store(&s->er.error_count, INT_MAX);
+        else
+            atomic_fetch_add(&s->er.error_count, job->error_count);
+        s->er.error_occurred |= job->error_occurred;
+        /* export the quantizers of the second field as without threads */
+        if (job->parallel_fields)
+            for (y = job->start_mb_y; y < job->end_mb_y; y++)
+                memcpy(s->current_picture.qscale_table + y * s->mb_stride,
+                       v->field_qscale_base + (y + 2) * s->mb_stride + 1,
+                       s->mb_width);
+    }
+    v->nb_slice_jobs = 0;
+
+    return ret;
+}
+
+/* Queue the slice set up in v->s for slice-threaded decoding. */
+static int vc1_queue_slice(VC1Context *v)
+{
+    MpegEncContext *s = &v->s;
+    VC1SliceJob *job;
+    int i, ret;
+
+    /* damaged slice addresses may overlap an earlier slice */
+    for (i = 0; i < v->nb_slice_jobs; i++) {
+        job = &v->slice_jobs[i];
+        if (job->second_field == v->second_field &&
+            job->start_mb_y < s->end_mb_y && s->start_mb_y < job->end_mb_y) {
+            if ((ret = vc1_decode_slice_jobs(v)) < 0)
+                return ret;
+            break;
+        }
+    }
+
+    job = &v->slice_jobs[v->nb_slice_jobs++];
+    job->state           = v;
+    job->gb              = s->gb;
+    job->start_mb_y      = s->start_mb_y;
+    job->end_mb_y        = s->end_mb_y;
+    job->second_field    = v->second_field;
+    job->parallel_fields = v->second_field && v->parallel_fields;
+    job->ret             = 0;
+
+    /* A slice header may turn a reference picture into a B picture that
+     * predicts from itself; its slices then depend on the decoding order. */
+    if (s->pict_type == AV_PICTURE_TYPE_B && !v->bi_type &&
+        s->next_picture_ptr == s->current_picture_ptr)
+        return vc1_decode_slice_jobs(v);
+    return 0;
+}
+
+/* Keep the state of the queued first field slices, and give the second
+ * field header its own bitplanes. */
+static void vc1_queue_second_field(VC1Context *v)
+{
+    int i;
+
+    vc1_copy_state(v->field_state, v);
+    for (i = 0; i < v->nb_slice_jobs; i++)
+        if (v->slice_jobs[i].state == v)
+            v->slice_jobs[i].state = v->field_state;
+    vc1_swap_field_planes(v);
+}
+
+/* Decode the remaining queued slices and restore the picture state. */
+static int vc1_finish_slice_jobs(VC1Context *v)
+{
+    int ret = vc1_decode_slice_jobs(v);
+
+    if (v->field_planes_swapped)
+        vc1_swap_field_planes(v);
+    v->parallel_fields = 0;
+    return ret;
+}
 
 /** Decode a VC1/WMV3 frame
  * @todo TODO: Handle VC-1 IDUs (Transport level?)
@@ -829,6 +1219,10 @@ static int vc1_decode_frame(AVCodecContext *avctx, AVFrame *pict,
     uint8_t *buf2 = NULL;
     const uint8_t *buf_start = buf, *buf_start_second_field = NULL;
     int mb_height, n_slices1=-1;
+    /* set if a slice after the last picture or field header repeats the
+     * picture header, which may still update the intensity compensation
+     * state inherited by the following pictures */
+    int slice_pic_header = 0;
     struct {
         uint8_t *buf;
         GetBitContext gb;
@@ -902,6 +1296,7 @@ static int vc1_decode_frame(AVCodecContext *avctx, AVFrame *pict,
                     slices[n_slices].raw_size = size + 4;
                     n_slices1 = n_slices - 1; // index of the last slice of the first field
                     n_slices++;
+                    slice_pic_header = 0;
                     break;
                 }
                 case VC1_CODE_ENTRYPOINT: /* it should be before frame data */
@@ -929,6 +1324,7 @@ static int vc1_decode_frame(AVCodecContext *avctx, AVFrame *pict,
                     slices[n_slices].mby_start = get_bits(&slices[n_slices].gb, 9);
                     slices[n_slices].rawbuf = start;
                     slices[n_slices].raw_size = size + 4;
+                    slice_pic_header |= show_bits1(&slices[n_slices].gb);
                     n_slices++;
                     break;
                 }
@@ -1088,6 +1484,27 @@ static int vc1_decode_frame(AVCodecContext *avctx, AVFrame *pict,
         s->current_picture_ptr->f->repeat_pict = v->rptfrm * 2;
     }
 
+    if (!avctx->hwaccel) {
+        if (v->mv_f_swap) {
+            FFSWAP(AVBufferRef *, v->mv_f_next_buf, v->mv_f_buf);
+            FFSWAP(uint8_t *, v->mv_f_next[0], v->mv_f[0]);
+            FFSWAP(uint8_t *, v->mv_f_next[1], v->mv_f[1]);
+            v->mv_f_swap = 0;
+        }
+        /* with frame threading, other threads may still read the field
+         * flags of a previous picture from this buffer */
+        if (!av_buffer_is_writable(v->mv_f_buf)) {
+            if ((ret = av_buffer_make_writable(&v->mv_f_buf)) < 0)
+                goto err;
+            vc1_set_mv_f(s, v->mv_f, v->mv_f_buf);
+        }
+    }
+
+    /* For field pictures, the state needed by the next picture is only
+     * complete once the second field header has been parsed. */
+    if (!avctx->hwaccel && !v->field_mode && !slice_pic_header)
+        ff_thread_finish_setup(avctx);
+
     if (avctx->hwaccel) {
         s->mb_y = 0;
         if (v->field_mode && buf_start_second_field) {
@@ -1227,6 +1644,15 @@ static int vc1_decode_frame(AVCodecContext *avctx, AVFrame *pict,
 
         av_assert0 (mb_height > 0);
 
+        if (v->slice_ctx[0]) {
+            av_fast_malloc(&v->slice_jobs, &v->slice_jobs_size,
+                           (n_slices + 1) * sizeof(*v->slice_jobs));
+            if (!v->slice_jobs) {
+                ret = AVERROR(ENOMEM);
+                goto err;
+            }
+        }
+
         for (i = 0; i <= n_slices; i++) {
             if (i > 0 &&  slices[i - 1].mby_start >= mb_height) {
                 if (v->field_mode <= 0) {
@@ -1235,6 +1661,8 @@ static int vc1_decode_frame(AVCodecContext *avctx, AVFrame *pict,
                            slices[i - 1].mby_start, mb_height);
                     continue;
                 }
+                if (v->nb_slice_jobs && !v->second_field)
+                    vc1_queue_second_field(v);
                 v->second_field = 1;
                 av_assert0((s->mb_height & 1) == 0);
                 v->blocks_off   = s->b8_stride * (s->mb_height&~1);
@@ -1254,8 +1682,18 @@ static int vc1_decode_frame(AVCodecContext *avctx, AVFrame *pict,
                             goto err;
                         continue;
                     }
+                    /* decode both fields at once unless the second one
+                     * predicts from the first */
+                    if (vc1_second_field_is_intra_or_refs_previous(v))
+                        v->parallel_fields = v->field_planes_swapped;
+                    else if ((ret = vc1_decode_slice_jobs(v)) < 0)
+                        goto err;
+                    if (!slice_pic_header)
+                        ff_thread_finish_setup(avctx);
                 } else if (get_bits1(&s->gb)) {
                     v->pic_header_flag = 1;
+                    if ((ret = vc1_decode_slice_jobs(v)) < 0)
+                        goto err;
                     if ((header_ret = ff_vc1_parse_frame_header_adv(v, &s->gb)) < 0) {
                         av_log(v->s.avctx, AV_LOG_ERROR, "Slice header damaged\n");
                         ret = AVERROR_INVALIDDATA;
@@ -1287,11 +1725,17 @@ static int vc1_decode_frame(AVCodecContext *avctx, AVFrame *pict,
                 av_log(v->s.avctx, AV_LOG_ERROR, "missing cbpcy_vlc\n");
                 continue;
             }
-            ff_vc1_decode_blocks(v);
+            if (v->slice_ctx[0]) {
+                if ((ret = vc1_queue_slice(v)) < 0)
+                    goto err;
+            } else
+                ff_vc1_decode_blocks(v);
             if (i != n_slices) {
                 s->gb = slices[i].gb;
             }
         }
+        if ((ret = vc1_finish_slice_jobs(v)) < 0)
+            goto err;
         if (v->field_mode) {
             v->second_field = 0;
             s->current_picture.f->linesize[0] >>= 1;
@@ -1299,10 +1743,10 @@ static int vc1_decode_frame(AVCodecContext *avctx, AVFrame *pict,
             s->current_picture.f->linesize[2] >>= 1;
             s->linesize                      >>= 1;
             s->uvlinesize                    >>= 1;
-            if (v->s.pict_type != AV_PICTURE_TYPE_BI && v->s.pict_type != AV_PICTURE_TYPE_B) {
-                FFSWAP(uint8_t *, v->mv_f_next[0], v->mv_f[0]);
-                FFSWAP(uint8_t *, v->mv_f_next[1], v->mv_f[1]);
-            }
+            /* Swapped when the next picture starts, so that the buffers
+             * are not modified while other threads copy them. */
+            if (v->s.pict_type != AV_PICTURE_TYPE_BI && v->s.pict_type != AV_PICTURE_TYPE_B)
+                v->mv_f_swap = 1;
         }
         ff_dlog(s->avctx, "Consumed %i/%i bits\n",
                 get_bits_count(&s->gb), s->gb.size_in_bits);
@@ -1362,6 +1806,7 @@ end:
     return buf_size;
 
 err:
+    vc1_finish_slice_jobs(v);
     av_free(buf2);
     for (i = 0; i < n_slices; i++)
         av_free(slices[i].buf);
@@ -1401,7 +1846,10 @@ const FFCodec ff_vc1_decoder = {
     .close          = ff_vc1_decode_end,
     FF_CODEC_DECODE_CB(vc1_decode_frame),
     .flush          = ff_mpeg_flush,
-    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY,
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
+                      AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS,
+    .caps_internal  = FF_CODEC_CAP_ALLOCATE_PROGRESS,
+    UPDATE_THREAD_CONTEXT(vc1_update_thread_context),
     .p.pix_fmts     = vc1_hwaccel_pixfmt_list_420,
     .hw_configs     = (const AVCodecHWConfigInternal *const []) {
 #if CONFIG_VC1_DXVA2_HWACCEL
@@ -1438,7 +1886,10 @@ const FFCodec ff_wmv3_decoder = {
     .close          = ff_vc1_decode_end,
     FF_CODEC_DECODE_CB(vc1_decode_frame),
     .flush          = ff_mpeg_flush,
-    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY,
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
+                      AV_CODEC_CAP_FRAME_THREADS,
+    .caps_internal  = FF_CODEC_CAP_ALLOCATE_PROGRESS,
+    UPDATE_THREAD_CONTEXT(vc1_update_thread_context),
     .p.pix_fmts     = vc1_hwaccel_pixfmt_list_420,
     .hw_configs     = (const AVCodecHWConfigInternal *const []) {
 #if CONFIG_WMV3_DXVA2_HWACCEL
@@ -0,0 +1,345 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * scale one input to several output sizes in one pass
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+typedef struct MultiScaleContext {
+    const AVClass *class;
+
+    char *sizes_str;
+    enum AVPixelFormat format;
+    char *flags_str;
+    int pyramid;
+
+    int *w, *h;
+    enum AVPixelFormat *formats;
+    AVFrame **frames;
+
+    SwsMultiContext *sws;
+    enum AVColorRange in_range;
+} MultiScaleContext;
+
+#define OFFSET(x) offsetof(MultiScaleContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_FILTERING_PARAM
+static const AVOption multiscale_options[] = {
+    { "sizes",   "set the '|'-separated list of output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING,    { .str = NULL },            0, 0,       FLAGS },
+    { "format",  "set the output pixel format",                OFFSET(format),    AV_OPT_TYPE_PIXEL_FMT, { .i64 = AV_PIX_FMT_NONE }, -1, INT_MAX, FLAGS },
+    { "flags",   "set the libswscale flags",                   OFFSET(flags_str), AV_OPT_TYPE_STRING,    { .str = "" },              0, 0,       FLAGS },
+    { "pyramid", "scale small outputs from larger ones",       OFFSET(pyramid),   AV_OPT_TYPE_BOOL,      { .i64 = 0 },               0, 1,       FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(multiscale);
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    MultiScaleContext *s = ctx->priv;
+    const int i = FF_OUTLINK_IDX(outlink);
+
+    outlink->w = s->w[i];
+    outlink->h = s->h[i];
+
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){ outlink->h * inlink->w,
+                                                              outlink->w * inlink->h },
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    /* the scaler is created on the first frame, once the range is known */
+    sws_multi_free(&s->sws);
+
+    return 0;
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    char *sizes, *saveptr = NULL, *size;
+    int nb_sizes = 1, ret = 0;
+
+    if (!s->sizes_str || !*s->sizes_str) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes specified\n");
+        return AVERROR(EINVAL);
+    }
+
+    for (const char *p = s->sizes_str; *p; p++)
+        nb_sizes += *p == '|';
+
+    s->w       = av_calloc(nb_sizes, sizeof(*s->w));
+    s->h       = av_calloc(nb_sizes, sizeof(*s->h));
+    s->formats = av_calloc(nb_sizes, sizeof(*s->formats));
+    s->frames  = av_calloc(nb_sizes, sizeof(*s->frames));
+    sizes      = av_strdup(s->sizes_str);
+    if (!s->w || !s->h || !s->formats || !s->frames || !sizes) {
+        av_free(sizes);
+        return AVERROR(ENOMEM);
+    }
+
+    for (size = av_strtok(sizes, "|", &saveptr); size;
+         size = av_strtok(NULL, "|", &saveptr)) {
+        AVFilterPad pad = { 0 };
+        int i = ctx->nb_outputs;
+
+        if ((ret = av_parse_video_size(&s->w[i], &s->h[i], size)) < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid size '%s'\n", size);
+            break;
+        }
+
+        pad.type         = AVMEDIA_TYPE_VIDEO;
+        pad.config_props = config_output;
+        pad.name         = av_asprintf("output%d", i);
+        if (!pad.name) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        if ((ret = ff_append_outpad_free_name(ctx, &pad)) < 0)
+            break;
+    }
+    av_free(sizes);
+
+    if (ret >= 0 && !ctx->nb_outputs) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes specified\n");
+        ret = AVERROR(EINVAL);
+    }
+
+    s->in_range = AVCOL_RANGE_UNSPECIFIED;
+
+    return ret;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+
+    sws_multi_free(&s->sws);
+    av_freep(&s->w);
+    av_freep(&s->h);
+    av_freep(&s->formats);
+    av_freep(&s->frames);
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    AVFilterFormats *formats = NULL;
+    const AVPixFmtDescriptor *desc = NULL;
+    int ret;
+
+    while ((desc = av_pix_fmt_desc_next(desc))) {
+        enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+
+        if (sws_isSupportedInput(pix_fmt) &&
+            (s->format != AV_PIX_FMT_NONE || sws_isSupportedOutput(pix_fmt)) &&
+            (ret = ff_add_format(&formats, pix_fmt)) < 0)
+            return ret;
+    }
+
+    /* without an explicit format, all links share the same list and thus
+     * end up with the same format */
+    if (s->format == AV_PIX_FMT_NONE)
+        return ff_set_common_formats(ctx, formats);
+
+    if ((ret = ff_formats_ref(formats, &ctx->inputs[0]->outcfg.formats)) < 0)
+        return ret;
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        formats = NULL;
+        if ((ret = ff_add_format(&formats, s->format)) < 0 ||
+            (ret = ff_formats_ref(formats, &ctx->outputs[i]->incfg.formats)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int init_scaler(AVFilterContext *ctx, const AVFrame *in)
+{
+    MultiScaleContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    struct SwsContext *opts;
+    int full_range = in->color_range == AVCOL_RANGE_JPEG;
+    int ret;
+
+    sws_multi_free(&s->sws);
+
+    opts = sws_alloc_context();
+    if (!opts)
+        return AVERROR(ENOMEM);
+
+    av_opt_set_int(opts, "srcw",       inlink->w,      0);
+    av_opt_set_int(opts, "srch",       inlink->h,      0);
+    av_opt_set_int(opts, "src_format", inlink->format, 0);
+    av_opt_set_int(opts, "src_range",  full_range,     0);
+    av_opt_set_int(opts, "dst_range",  full_range,     0);
+    av_opt_set_int(opts, "threads",    ff_filter_get_nb_threads(ctx), 0);
+
+    /* use the MPEG-2 chroma position for yuv420p, as the scale filter does */
+    if (inlink->format == AV_PIX_FMT_YUV420P)
+        av_opt_set_int(opts, "src_v_chr_pos", 128, 0);
+    if (ctx->outputs[0]->format == AV_PIX_FMT_YUV420P)
+        av_opt_set_int(opts, "dst_v_chr_pos", 128, 0);
+
+    if (*s->flags_str && (ret = av_opt_set(opts, "sws_flags", s->flags_str, 0)) < 0)
+        goto end;
+
+    for (int i = 0; i < ctx->nb_outputs; i++)
+        s->formats[i] = ctx->outputs[i]->format;
+
+    ret = sws_multi_create(&s->sws, opts, ctx->nb_outputs, s->w, s->h, s->formats,
+                           s->pyramid ? SWS_MULTI_PYRAMID : 0);
+    if (ret >= 0)
+        s->in_range = in->color_range;
+
+end:
+    sws_freeContext(opts);
+    return ret;
+}
+
+static int scale_frame(AVFilterContext *ctx, AVFrame *in)
+{
+    MultiScaleContext *s = ctx->priv;
+    int i, ret = 0;
+
+    if (!s->sws || in->color_range != s->in_range) {
+        ret = init_scaler(ctx, in);
+        if (ret < 0)
+            return ret;
+    }
+
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+
+        s->frames[i] = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!s->frames[i]) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        ret = av_frame_copy_props(s->frames[i], in);
+        if (ret < 0)
+            goto fail;
+        s->frames[i]->sample_aspect_ratio = outlink->sample_aspect_ratio;
+    }
+
+    ret = sws_multi_scale_frame(s->sws, s->frames, in);
+    if (ret < 0)
+        goto fail;
+
+    /* closed outputs are still scaled, smaller outputs may be based on them */
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        AVFrame *out = s->frames[i];
+
+        s->frames[i] = NULL;
+        if (ff_outlink_get_status(ctx->outputs[i])) {
+            av_frame_free(&out);
+            continue;
+        }
+        ret = ff_filter_frame(ctx->outputs[i], out);
+        if (ret < 0)
+            goto fail;
+    }
+
+    return 0;
+
+fail:
+    for (i = 0; i < ctx->nb_outputs; i++)
+        av_frame_free(&s->frames[i]);
+    return ret;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    AVFilterLink *inlink = ctx->inputs[0];
+    int status, ret;
+    AVFrame *in;
+    int64_t pts;
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        FF_FILTER_FORWARD_STATUS_BACK_ALL(ctx->outputs[i], ctx);
+    }
+
+    ret = ff_inlink_consume_frame(inlink, &in);
+    if (ret < 0)
+        return ret;
+    if (ret > 0) {
+        ret = scale_frame(ctx, in);
+        av_frame_free(&in);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+        for (int i = 0; i < ctx->nb_outputs; i++) {
+            if (ff_outlink_get_status(ctx->outputs[i]))
+                continue;
+            ff_outlink_set_status(ctx->outputs[i], status, pts);
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        if (ff_outlink_get_status(ctx->outputs[i]))
+            continue;
+
+        if (ff_outlink_frame_wanted(ctx->outputs[i])) {
+            ff_inlink_request_frame(inlink);
+            return 0;
+        }
+    }
+
+    return FFERROR_NOT_READY;
+}
+
+static const AVFilterPad multiscale_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+    },
+};
+
+const AVFilter ff_vf_multiscale = {
+    .name          = "multiscale",
+    .description   = NULL_IF_CONFIG_SMALL("Scale the input video to several sizes."),
+    .priv_size     = sizeof(MultiScaleContext),
+    .priv_class    = &multiscale_class,
+    .init          = init,
+    .uninit        = uninit,
+    .activate      = activate,
+    FILTER_INPUTS(multiscale_inputs),
+    .outputs       = NULL,
+    FILTER_QUERY_FUNC(query_formats),
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+};
@@ -1243,6 +1243,12 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_FAST_SEEK   0x80000 ///< Enable fast, but inaccurate seeks for some formats
 #define AVFMT_FLAG_SHORTEST   0x100000 ///< Stop muxing when the shortest stream stops.
 #define AVFMT_FLAG_AUTO_BSF   0x200000 ///< Add bitstream filters as requested by the muxer
+/**
+ * Make avformat_find_stream_info() consider a stream analyzed as soon as its
+ * codec parameters are known, without decoding frames to guess the decoder
+ * delay or reading additional frames for frame rate estimation.
+ */
+#define AVFMT_FLAG_FAST_PROBE 0x400000
 
     /**
      * Maximum number of bytes read from input in order to determine stream
@@ -1713,6 +1719,15 @@ typedef struct AVFormatContext {
      * @return 0 on success, a negative AVERROR code on failure
      */
     int (*io_close2)(struct AVFormatContext *s, AVIOContext *pb);
+
+    /**
+     * Number of threads used by avformat_find_stream_info() to decode
+     * different streams concurrently. 1 decodes all streams serially on the
+     * calling thread, 0 picks the number of threads automatically.
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    int probe_threads;
 } AVFormatContext;
 
 /**
@@ -31,6 +31,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/time.h"
 #include "libavutil/timestamp.h"
 
@@ -1137,9 +1138,14 @@ static int parse_packet(AVFormatContext *s, AVPacket *pkt,
         int64_t next_dts = pkt->dts;
         int len;
 
-        len = av_parser_parse2(sti->parser, sti->avctx,
-                               &out_pkt->data, &out_pkt->size, data, size,
-                               pkt->pts, pkt->dts, pkt->pos);
+        /* The output references pkt->buf when the frame lies within it,
+         * only frames combined by the parser are copied. */
+        len = av_parser_parse_ref(sti->parser, sti->avctx, out_pkt, pkt->buf,
+                                  data, size, pkt->pts, pkt->dts, pkt->pos);
+        if (len < 0) {
+            ret = len;
+            goto fail;
+        }
 
         pkt->pts = pkt->dts = AV_NOPTS_VALUE;
         pkt->pos = -1;
@@ -1153,22 +1159,6 @@ static int parse_packet(AVFormatContext *s, AVPacket *pkt,
         if (!out_pkt->size)
             continue;
 
-        if (pkt->buf && out_pkt->data == pkt->data) {
-            /* reference pkt->buf only when out_pkt->data is guaranteed to point
-             * to data in it and not in the parser's internal buffer. */
-            /* XXX: Ensure this is the case with all parsers when sti->parser->flags
-             * is PARSER_FLAG_COMPLETE_FRAMES and check for that instead? */
-            out_pkt->buf = av_buffer_ref(pkt->buf);
-            if (!out_pkt->buf) {
-                ret = AVERROR(ENOMEM);
-                goto fail;
-            }
-        } else {
-            ret = av_packet_make_refcounted(out_pkt);
-            if (ret < 0)
-                goto fail;
-        }
-
         if (pkt->side_data) {
             out_pkt->side_data       = pkt->side_data;
             out_pkt->side_data_elems = pkt->side_data_elems;
@@ -1365,6 +1355,14 @@ FF_ENABLE_DEPRECATION_WARNINGS
         AVStream *const st  = s->streams[pkt->stream_index];
         FFStream *const sti = ffstream(st);
         int discard_padding = 0;
+        /* index keyframes as soon as they are read, so that no keyframe
+         * is missed if buffered packets are flushed by a seek; packets
+         * output by a parser may not know their position */
+        if (si->generic_index && pkt->flags & AV_PKT_FLAG_KEY &&
+            pkt->dts != AV_NOPTS_VALUE && pkt->pos >= 0) {
+            ff_reduce_index(s, st->index);
+            av_add_index_entry(st, pkt->pos, pkt->dts, 0, 0, AVINDEX_KEYFRAME);
+        }
         if (sti->first_discard_sample && pkt->pts != AV_NOPTS_VALUE) {
             int64_t pts = pkt->pts - (is_relative(pkt->pts) ? RELATIVE_TS_BASE : 0);
             int64_t sample = ts_to_samples(st, pts);
@@ -1984,7 +1982,8 @@ static int has_codec_parameters(const AVStream *st, const char **errmsg_ptr)
 
 /* returns 1 or 0 if or if not decoded data was returned, or a negative error */
 static int try_decode_frame(AVFormatContext *s, AVStream *st,
-                            const AVPacket *pkt, AVDictionary **options)
+                            const AVPacket *pkt, int codec_info_nb_frames,
+                            AVDictionary **options)
 {
     FFStream *const sti = ffstream(st);
     AVCodecContext *const avctx = sti->avctx;
@@ -2045,9 +2044,11 @@ static int try_decode_frame(AVFormatContext *s, AVStream *st,
 
     while ((pkt_to_send || (!pkt->data && got_picture)) &&
            ret >= 0 &&
-           (!has_codec_parameters(st, NULL) || !has_decode_delay_been_guessed(st) ||
-            (!sti->codec_info_nb_frames &&
-             (avctx->codec->capabilities & AV_CODEC_CAP_CHANNEL_CONF)))) {
+           (!has_codec_parameters(st, NULL) ||
+            !(s->flags & AVFMT_FLAG_FAST_PROBE) &&
+            (!has_decode_delay_been_guessed(st) ||
+             (!codec_info_nb_frames &&
+              (avctx->codec->capabilities & AV_CODEC_CAP_CHANNEL_CONF))))) {
         got_picture = 0;
         if (avctx->codec_type == AVMEDIA_TYPE_VIDEO ||
             avctx->codec_type == AVMEDIA_TYPE_AUDIO) {
@@ -2085,6 +2086,149 @@ fail:
     return ret;
 }
 
+typedef struct ProbeDecodeContext {
+    AVFormatContext *ic;
+    AVDictionary **options;
+    int orig_nb_streams;
+
+    AVSliceThread *thread;
+    int nb_threads;
+    AVPacket **pkts;        ///< one packet per worker thread
+    unsigned *jobs;         ///< stream indexes handled by the current batch
+    unsigned nb_jobs_allocated;
+    int nb_queued;
+    int flush;              ///< drain the decoders after the queued packets
+} ProbeDecodeContext;
+
+static void probe_decode_worker(void *priv, int jobnr, int threadnr,
+                                int nb_jobs, int nb_threads)
+{
+    ProbeDecodeContext *const pd = priv;
+    const unsigned idx  = pd->jobs[jobnr];
+    AVStream *const st  = pd->ic->streams[idx];
+    FFStream *const sti = ffstream(st);
+    AVDictionary **options = (pd->options && idx < pd->orig_nb_streams) ?
+                             &pd->options[idx] : NULL;
+    AVPacket *const pkt = pd->pkts[threadnr];
+
+    while (avpriv_packet_list_get(&sti->info->probe_queue, pkt) >= 0) {
+        try_decode_frame(pd->ic, st, pkt, sti->info->probe_queue_frame++, options);
+        av_packet_unref(pkt);
+    }
+
+    if (pd->flush && sti->info->found_decoder == 1) {
+        int err = try_decode_frame(pd->ic, st, pkt,
+                                   sti->codec_info_nb_frames, options);
+        if (err < 0)
+            av_log(pd->ic, AV_LOG_INFO,
+                   "decoding for stream %d failed\n", st->index);
+    }
+}
+
+static av_cold int probe_decode_init(ProbeDecodeContext *pd, AVFormatContext *ic,
+                                     AVDictionary **options, int orig_nb_streams)
+{
+    int ret;
+
+    pd->ic              = ic;
+    pd->options         = options;
+    pd->orig_nb_streams = orig_nb_streams;
+
+    if (ic->probe_threads == 1)
+        return 0;
+
+    ret = avpriv_slicethread_create(&pd->thread, pd, probe_decode_worker,
+                                    NULL, ic->probe_threads);
+    if (ret == AVERROR(ENOSYS) || ret == 1) {
+        /* no threading support or only one thread: decode inline */
+        avpriv_slicethread_free(&pd->thread);
+        return 0;
+    } else if (ret < 0)
+        return ret;
+    pd->nb_threads = ret;
+
+    pd->pkts = av_calloc(pd->nb_threads, sizeof(*pd->pkts));
+    if (!pd->pkts)
+        return AVERROR(ENOMEM);
+    for (int i = 0; i < pd->nb_threads; i++) {
+        pd->pkts[i] = av_packet_alloc();
+        if (!pd->pkts[i])
+            return AVERROR(ENOMEM);
+    }
+
+    av_log(ic, AV_LOG_DEBUG, "Decoding streams with %d probe threads\n",
+           pd->nb_threads);
+    return 0;
+}
+
+/**
+ * Decode all queued packets, each stream being processed by one job.
+ * If flush is set, the decoders of all streams are drained as well.
+ */
+static int probe_decode_run(ProbeDecodeContext *pd, int flush)
+{
+    AVFormatContext *const ic = pd->ic;
+    unsigned nb_jobs = 0;
+
+    if (!pd->thread)
+        return 0;
+
+    if (pd->nb_jobs_allocated < ic->nb_streams) {
+        unsigned *jobs = av_realloc_array(pd->jobs, ic->nb_streams, sizeof(*jobs));
+        if (!jobs)
+            return AVERROR(ENOMEM);
+        pd->jobs              = jobs;
+        pd->nb_jobs_allocated = ic->nb_streams;
+    }
+
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        const FFStream *const sti = cffstream(ic->streams[i]);
+        if (sti->info->probe_queue.head ||
+            flush && sti->info->found_decoder == 1)
+            pd->jobs[nb_jobs++] = i;
+    }
+
+    pd->nb_queued = 0;
+    pd->flush     = flush;
+    if (nb_jobs)
+        avpriv_slicethread_execute(pd->thread, nb_jobs, 0);
+    return 0;
+}
+
+/**
+ * Queue a packet for decoding by the probe threads. The queued packets
+ * are decoded in batches, as long as the batch stays small the stream
+ * analysis reads at most a few more packets than it does serially.
+ */
+static int probe_decode_queue(ProbeDecodeContext *pd, AVStream *st,
+                              const AVPacket *pkt)
+{
+    FFStream *const sti = ffstream(st);
+    int ret;
+
+    if (!sti->info->probe_queue.head)
+        sti->info->probe_queue_frame = sti->codec_info_nb_frames;
+    ret = avpriv_packet_list_put(&sti->info->probe_queue,
+                                 (AVPacket*)pkt, av_packet_ref, 0);
+    if (ret < 0)
+        return ret;
+
+    if (++pd->nb_queued >= 4 * pd->nb_threads)
+        return probe_decode_run(pd, 0);
+    return 0;
+}
+
+static av_cold void probe_decode_uninit(ProbeDecodeContext *pd)
+{
+    avpriv_slicethread_free(&pd->thread);
+    if (pd->pkts) {
+        for (int i = 0; i < pd->nb_threads; i++)
+            av_packet_free(&pd->pkts[i]);
+        av_freep(&pd->pkts);
+    }
+    av_freep(&pd->jobs);
+}
+
 static int chapter_start_cmp(const void *p1, const void *p2)
 {
     const AVChapter *const ch1 = *(AVChapter**)p1;
@@ -2431,13 +2575,14 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     int64_t old_offset  = avio_tell(ic->pb);
     // new streams might appear, no options for those
     int orig_nb_streams = ic->nb_streams;
-    int flush_codecs;
+    int flush_codecs, err;
     int64_t max_analyze_duration = ic->max_analyze_duration;
     int64_t max_stream_analyze_duration;
     int64_t max_subtitle_analyze_duration;
     int64_t probesize = ic->probesize;
     int eof_reached = 0;
     int *missing_streams = av_opt_ptr(ic->iformat->priv_class, ic->priv_data, "missing_streams");
+    ProbeDecodeContext pd = { 0 };
 
     flush_codecs = probesize > 0;
 
@@ -2517,6 +2662,10 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             av_dict_free(&thread_opt);
     }
 
+    ret = probe_decode_init(&pd, ic, options, orig_nb_streams);
+    if (ret < 0)
+        goto find_stream_info_err;
+
     read_size = 0;
     for (;;) {
         const AVPacket *pkt;
@@ -2549,6 +2698,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
                 fps_analyze_framecount = 0;
             if (ic->fps_probe_size >= 0)
                 fps_analyze_framecount = ic->fps_probe_size;
+            if (ic->flags & AVFMT_FLAG_FAST_PROBE)
+                fps_analyze_framecount = 0;
             if (st->disposition & AV_DISPOSITION_ATTACHED_PIC)
                 fps_analyze_framecount = 0;
             /* variable fps and no guess at the real fps */
@@ -2562,7 +2713,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             }
             // Look at the first 3 frames if there is evidence of frame delay
             // but the decoder delay is not set.
-            if (sti->info->frame_delay_evidence && count < 2 && sti->avctx->has_b_frames == 0)
+            if (sti->info->frame_delay_evidence && count < 2 && sti->avctx->has_b_frames == 0 &&
+                !(ic->flags & AVFMT_FLAG_FAST_PROBE))
                 break;
             if (!sti->avctx->extradata &&
                 (!sti->extract_extradata.inited || sti->extract_extradata.bsf) &&
@@ -2745,8 +2897,13 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
          * least one frame of codec data, this makes sure the codec initializes
          * the channel configuration and does not only trust the values from
          * the container. */
-        try_decode_frame(ic, st, pkt,
-                         (options && i < orig_nb_streams) ? &options[i] : NULL);
+        if (pd.thread) {
+            ret = probe_decode_queue(&pd, st, pkt);
+            if (ret < 0)
+                goto unref_then_goto_end;
+        } else
+            try_decode_frame(ic, st, pkt, sti->codec_info_nb_frames,
+                             (options && i < orig_nb_streams) ? &options[i] : NULL);
 
         if (ic->flags & AVFMT_FLAG_NOBUFFER)
             av_packet_unref(pkt1);
@@ -2755,6 +2912,12 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         count++;
     }
 
+    /* decode what is left in the queues before the decoders are inspected */
+    if ((err = probe_decode_run(&pd, 0)) < 0) {
+        ret = err;
+        goto find_stream_info_err;
+    }
+
     if (eof_reached) {
         for (unsigned stream_index = 0; stream_index < ic->nb_streams; stream_index++) {
             AVStream *const st = ic->streams[stream_index];
@@ -2780,9 +2943,13 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         }
     }
 
-    if (flush_codecs) {
+    if (flush_codecs && pd.thread) {
+        if ((err = probe_decode_run(&pd, 1)) < 0) {
+            ret = err;
+            goto find_stream_info_err;
+        }
+    } else if (flush_codecs) {
         AVPacket *empty_pkt = si->pkt;
-        int err = 0;
         av_packet_unref(empty_pkt);
 
         for (unsigned i = 0; i < ic->nb_streams; i++) {
@@ -2791,9 +2958,9 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 
             /* flush the decoders */
             if (sti->info->found_decoder == 1) {
-                err = try_decode_frame(ic, st, empty_pkt,
-                                        (options && i < orig_nb_streams)
-                                        ? &options[i] : NULL);
+                err = try_decode_frame(ic, st, empty_pkt, sti->codec_info_nb_frames,
+                                       (options && i < orig_nb_streams)
+                                       ? &options[i] : NULL);
 
                 if (err < 0) {
                     av_log(ic, AV_LOG_INFO,
@@ -2963,6 +3130,7 @@ find_stream_info_err:
         AVStream *const st  = ic->streams[i];
         FFStream *const sti = ffstream(st);
         if (sti->info) {
+            avpriv_packet_list_free(&sti->info->probe_queue);
             av_freep(&sti->info->duration_error);
             av_freep(&sti->info);
         }
@@ -2972,6 +3140,7 @@ find_stream_info_err:
         av_channel_layout_copy(&sti->avctx->ch_layout, &st->codecpar->ch_layout);
         av_bsf_free(&sti->extract_extradata.bsf);
     }
+    probe_decode_uninit(&pd);
     if (ic->pb) {
         FFIOContext *const ctx = ffiocontext(ic->pb);
         av_log(ic, AV_LOG_DEBUG, "After avformat_find_stream_info() pos: %"PRId64" bytes read:%"PRId64" seeks:%d frames:%d\n",
@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include "libavutil/rational.h"
 #include "libavcodec/packet.h"
+#include "libavcodec/packet_internal.h"
 #include "avformat.h"
 
 #define MAX_STD_TIMEBASES (30*12+30+3+6)
@@ -53,6 +54,16 @@ typedef struct FFStreamInfo {
     int     fps_first_dts_idx;
     int64_t fps_last_dts;
     int     fps_last_dts_idx;
+
+    /**
+     * Packets waiting to be decoded by a probe worker thread,
+     * only used if AVFormatContext.probe_threads != 1.
+     */
+    PacketList probe_queue;
+    /**
+     * Value of codec_info_nb_frames for the first packet in probe_queue.
+     */
+    int probe_queue_frame;
 } FFStreamInfo;
 
 /**
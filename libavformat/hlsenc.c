@@ -22,6 +22,7 @@
 
 #include "config.h"
 #include "config_components.h"
+#include <stdatomic.h>
 #include <stdint.h>
 #if HAVE_UNISTD_H
 #include <unistd.h>
@@ -40,6 +41,8 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
 #include "libavutil/log.h"
+#include "libavutil/thread.h"
+#include "libavutil/threadmessage.h"
 #include "libavutil/time.h"
 #include "libavutil/time_internal.h"
 
@@ -117,6 +120,26 @@ typedef enum {
     SEGMENT_TYPE_FMP4,
 } SegmentType;
 
+typedef enum {
+    HLS_JOB_WRITE,  ///< write a buffer to a file, renaming it in place if requested
+    HLS_JOB_DELETE, ///< delete a segment which is no longer listed
+} HLSJobType;
+
+/**
+ * Unit of work for the I/O thread. Jobs are run in submission order, so a
+ * playlist is never uploaded before the segments it references.
+ */
+typedef struct HLSJob {
+    HLSJobType type;
+    uint8_t *data;         ///< file content
+    int size;
+    char *filename;        ///< file to write or delete
+    char *final_filename;  ///< name to rename the written file to, if any
+    int styp;              ///< prefix the file with a styp box
+    const char *proto;     ///< protocol used for deleting
+    AVDictionary *options; ///< options to open the file with
+} HLSJob;
+
 typedef struct VariantStream {
     unsigned var_stream_idx;
     unsigned number;
@@ -258,6 +281,14 @@ typedef struct HLSContext {
     char *headers;
     int has_default_key; /* has DEFAULT field of var_stream_map */
     int has_video_m3u8; /* has video stream m3u8 list */
+
+    int async;             ///< upload segments and playlists in a background thread
+#if HAVE_THREADS
+    pthread_t io_thread;
+    int io_thread_started;
+    AVThreadMessageQueue *io_queue; ///< jobs for the I/O thread
+    atomic_int io_error;   ///< first error of a background job
+#endif
 } HLSContext;
 
 static int strftime_expand(const char *fmt, char **dest)
@@ -589,6 +620,222 @@ static int hls_delete_file(HLSContext *hls, AVFormatContext *avf,
     return 0;
 }
 
+static int hls_async_active(HLSContext *hls)
+{
+#if HAVE_THREADS
+    return hls->io_thread_started;
+#else
+    return 0;
+#endif
+}
+
+#if HAVE_THREADS
+static void hls_job_free(HLSJob *job)
+{
+    av_freep(&job->data);
+    av_freep(&job->filename);
+    av_freep(&job->final_filename);
+    av_dict_free(&job->options);
+}
+
+static int hls_job_write(AVFormatContext *s, HLSJob *job)
+{
+    AVIOContext *pb = NULL;
+    int ret;
+
+    ret = s->io_open(s, &pb, job->filename, AVIO_FLAG_WRITE, &job->options);
+    if (ret < 0)
+        return ret;
+    if (job->styp)
+        write_styp(pb);
+    avio_write(pb, job->data, job->size);
+    return ff_format_io_close(s, &pb);
+}
+
+static int hls_job_run(AVFormatContext *s, HLSJob *job)
+{
+    HLSContext *hls = s->priv_data;
+    int ret;
+
+    if (job->type == HLS_JOB_DELETE)
+        return hls_delete_file(hls, s, job->filename, job->proto);
+
+    ret = hls_job_write(s, job);
+    if (ret < 0) {
+        av_log(s, AV_LOG_WARNING, "upload of '%s' failed,"
+               " will retry with a new http session.\n", job->filename);
+        ret = hls_job_write(s, job);
+    }
+    if (ret < 0) {
+        av_log(s, hls->ignore_io_errors ? AV_LOG_WARNING : AV_LOG_ERROR,
+               "Failed to upload file '%s'\n", job->filename);
+        return hls->ignore_io_errors ? 0 : ret;
+    }
+    if (job->final_filename)
+        ff_rename(job->filename, job->final_filename, s);
+    return 0;
+}
+
+static void *hls_io_thread(void *arg)
+{
+    AVFormatContext *s = arg;
+    HLSContext *hls = s->priv_data;
+    HLSJob job;
+
+    ff_thread_setname("hls-io");
+
+    while (av_thread_message_queue_recv(hls->io_queue, &job, 0) >= 0) {
+        int ret = hls_job_run(s, &job);
+
+        if (ret < 0) {
+            int expected = 0;
+            atomic_compare_exchange_strong(&hls->io_error, &expected, ret);
+        }
+        hls_job_free(&job);
+    }
+    return NULL;
+}
+
+static int hls_job_submit(AVFormatContext *s, HLSJob *job)
+{
+    HLSContext *hls = s->priv_data;
+    int ret = atomic_load(&hls->io_error);
+
+    if (ret >= 0)
+        ret = av_thread_message_queue_send(hls->io_queue, job, 0);
+    if (ret < 0)
+        hls_job_free(job);
+    return ret;
+}
+
+/**
+ * Queue the content of the dynamic buffer *pb to be written to filename,
+ * and renamed to final_filename if set. *pb is freed.
+ */
+static int hls_submit_dynbuf(AVFormatContext *s, AVIOContext **pb,
+                             const char *filename, const char *final_filename)
+{
+    HLSContext *hls = s->priv_data;
+    HLSJob job = { .type = HLS_JOB_WRITE };
+
+    if (!*pb)
+        return 0;
+    job.size = avio_close_dyn_buf(*pb, &job.data);
+    *pb = NULL;
+
+    job.filename = av_strdup(filename);
+    if (final_filename)
+        job.final_filename = av_strdup(final_filename);
+    if (!job.data || !job.filename || (final_filename && !job.final_filename)) {
+        hls_job_free(&job);
+        return AVERROR(ENOMEM);
+    }
+    set_http_options(s, &job.options, hls);
+    return hls_job_submit(s, &job);
+}
+
+/**
+ * Hand the buffered data of the ended segment over to the I/O thread and
+ * start buffering the next one.
+ */
+static int hls_submit_segment(AVFormatContext *s, VariantStream *vs,
+                              int use_temp_file)
+{
+    HLSContext *hls = s->priv_data;
+    AVFormatContext *oc = vs->avf;
+    HLSJob job = { .type = HLS_JOB_WRITE };
+    int ret;
+
+    av_write_frame(oc, NULL); /* Flush any buffered data */
+    job.size = avio_close_dyn_buf(oc->pb, &job.data);
+    oc->pb = NULL;
+    job.styp = hls->segment_type == SEGMENT_TYPE_FMP4;
+    job.filename = av_strdup(oc->url);
+    if (!job.data || !job.filename) {
+        hls_job_free(&job);
+        return AVERROR(ENOMEM);
+    }
+    if (use_temp_file) {
+        /* the segment is listed under its final name, as done by
+         * hls_rename_temp_file() */
+        oc->url[strlen(oc->url) - 4] = '\0';
+        job.final_filename = av_strdup(oc->url);
+        if (!job.final_filename) {
+            hls_job_free(&job);
+            return AVERROR(ENOMEM);
+        }
+    }
+    set_http_options(s, &job.options, hls);
+
+    if ((ret = hls_job_submit(s, &job)) < 0)
+        return ret;
+    return avio_open_dyn_buf(&oc->pb);
+}
+
+static int hls_io_start(AVFormatContext *s)
+{
+    HLSContext *hls = s->priv_data;
+    int ret;
+
+    ret = av_thread_message_queue_alloc(&hls->io_queue, 16, sizeof(HLSJob));
+    if (ret < 0)
+        return ret;
+    atomic_init(&hls->io_error, 0);
+
+    ret = pthread_create(&hls->io_thread, NULL, hls_io_thread, s);
+    if (ret) {
+        av_log(s, AV_LOG_ERROR, "Failed to start HLS I/O thread: %s\n",
+               av_err2str(AVERROR(ret)));
+        return AVERROR(ret);
+    }
+    hls->io_thread_started = 1;
+    return 0;
+}
+
+/**
+ * Wait for all pending jobs to complete and stop the I/O thread.
+ *
+ * @return the first error of a background job
+ */
+static int hls_io_stop(AVFormatContext *s)
+{
+    HLSContext *hls = s->priv_data;
+    int ret = 0;
+
+    if (hls->io_thread_started) {
+        /* the thread exits once the queue is drained */
+        av_thread_message_queue_set_err_recv(hls->io_queue, AVERROR_EOF);
+        pthread_join(hls->io_thread, NULL);
+        hls->io_thread_started = 0;
+        ret = atomic_load(&hls->io_error);
+    }
+    av_thread_message_queue_free(&hls->io_queue);
+    return ret;
+}
+#endif
+
+/**
+ * Delete an old segment, in the I/O thread if it is running so that the
+ * deletion is ordered after the uploads referencing it.
+ */
+static int hls_delete_segment_file(AVFormatContext *s, char *path,
+                                   const char *proto)
+{
+    HLSContext *hls = s->priv_data;
+
+#if HAVE_THREADS
+    if (hls_async_active(hls)) {
+        HLSJob job = { .type = HLS_JOB_DELETE, .proto = proto };
+
+        job.filename = av_strdup(path);
+        if (!job.filename)
+            return AVERROR(ENOMEM);
+        return hls_job_submit(s, &job);
+    }
+#endif
+    return hls_delete_file(hls, s, path, proto);
+}
+
 static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls,
                                    VariantStream *vs)
 {
@@ -666,7 +913,7 @@ static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls,
         }
 
         proto = avio_find_protocol_name(s->url);
-        if (ret = hls_delete_file(hls, s, path.str, proto))
+        if (ret = hls_delete_segment_file(s, path.str, proto))
             goto fail;
 
         if ((segment->sub_filename[0] != '\0')) {
@@ -683,7 +930,7 @@ static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls,
                 goto fail;
             }
 
-            if (ret = hls_delete_file(hls, s, path.str, proto))
+            if (ret = hls_delete_segment_file(s, path.str, proto))
                 goto fail;
         }
         av_bprint_clear(&path);
@@ -1408,7 +1655,10 @@ static int create_master_playlist(AVFormatContext *s,
 
     set_http_options(s, &options, hls);
     snprintf(temp_filename, sizeof(temp_filename), use_temp_file ? "%s.tmp" : "%s", hls->master_m3u8_url);
-    ret = hlsenc_io_open(s, &hls->m3u8_out, temp_filename, &options);
+    if (hls_async_active(hls))
+        ret = avio_open_dyn_buf(&hls->m3u8_out);
+    else
+        ret = hlsenc_io_open(s, &hls->m3u8_out, temp_filename, &options);
     av_dict_free(&options);
     if (ret < 0) {
         av_log(s, AV_LOG_ERROR, "Failed to open master play list file '%s'\n",
@@ -1533,6 +1783,13 @@ static int create_master_playlist(AVFormatContext *s,
 fail:
     if (ret >=0)
         hls->master_m3u8_created = 1;
+#if HAVE_THREADS
+    if (hls_async_active(hls)) {
+        int err = hls_submit_dynbuf(s, &hls->m3u8_out, temp_filename,
+                                    use_temp_file ? hls->master_m3u8_url : NULL);
+        return ret < 0 ? ret : err;
+    }
+#endif
     hlsenc_io_close(s, &hls->m3u8_out, temp_filename);
     if (use_temp_file)
         ff_rename(temp_filename, hls->master_m3u8_url, s);
@@ -1587,7 +1844,11 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
 
     set_http_options(s, &options, hls);
     snprintf(temp_filename, sizeof(temp_filename), use_temp_file ? "%s.tmp" : "%s", vs->m3u8_name);
-    if ((ret = hlsenc_io_open(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename, &options)) < 0) {
+    if (hls_async_active(hls))
+        ret = avio_open_dyn_buf(&vs->out);
+    else
+        ret = hlsenc_io_open(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename, &options);
+    if (ret < 0) {
         if (hls->ignore_io_errors)
             ret = 0;
         goto fail;
@@ -1643,7 +1904,11 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
 
     if (vs->vtt_m3u8_name) {
         snprintf(temp_vtt_filename, sizeof(temp_vtt_filename), use_temp_file ? "%s.tmp" : "%s", vs->vtt_m3u8_name);
-        if ((ret = hlsenc_io_open(s, &hls->sub_m3u8_out, temp_vtt_filename, &options)) < 0) {
+        if (hls_async_active(hls))
+            ret = avio_open_dyn_buf(&hls->sub_m3u8_out);
+        else
+            ret = hlsenc_io_open(s, &hls->sub_m3u8_out, temp_vtt_filename, &options);
+        if (ret < 0) {
             if (hls->ignore_io_errors)
                 ret = 0;
             goto fail;
@@ -1666,6 +1931,20 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
 
 fail:
     av_dict_free(&options);
+#if HAVE_THREADS
+    if (hls_async_active(hls)) {
+        /* renamed by the I/O thread once uploaded */
+        ret = hls_submit_dynbuf(s, &vs->out, temp_filename,
+                                use_temp_file ? vs->m3u8_name : NULL);
+        if (ret >= 0)
+            ret = hls_submit_dynbuf(s, &hls->sub_m3u8_out, temp_vtt_filename,
+                                    use_temp_file ? vs->vtt_m3u8_name : NULL);
+        ffio_free_dyn_buf(&hls->sub_m3u8_out);
+        if (ret < 0)
+            return ret;
+        use_temp_file = 0;
+    }
+#endif
     ret = hlsenc_io_close(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename);
     if (ret < 0) {
         return ret;
@@ -2549,6 +2828,13 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
                                       && (hls->flags & HLS_TEMP_FILE);
             }
 
+#if HAVE_THREADS
+            if (hls_async_active(hls)) {
+                if ((ret = hls_submit_segment(s, vs, use_temp_file)) < 0)
+                    return ret;
+                use_temp_file = 0;
+            } else
+#endif
             if ((hls->max_seg_size > 0 && (vs->size + vs->start_pos >= hls->max_seg_size)) || !byterange_mode) {
                 AVDictionary *options = NULL;
                 char *filename = NULL;
@@ -2694,6 +2980,10 @@ static void hls_deinit(AVFormatContext *s)
     int i = 0;
     VariantStream *vs = NULL;
 
+#if HAVE_THREADS
+    hls_io_stop(s);
+#endif
+
     for (i = 0; i < hls->nb_varstreams; i++) {
         vs = &hls->var_streams[i];
 
@@ -2735,6 +3025,12 @@ static int hls_write_trailer(struct AVFormatContext *s)
     VariantStream *vs = NULL;
     AVDictionary *options = NULL;
     int range_length, byterange_mode;
+    int io_ret = 0;
+
+#if HAVE_THREADS
+    /* the last segments and playlists are written synchronously */
+    io_ret = hls_io_stop(s);
+#endif
 
     for (i = 0; i < hls->nb_varstreams; i++) {
         char *filename = NULL;
@@ -2857,7 +3153,7 @@ failed:
         av_free(old_filename);
     }
 
-    return 0;
+    return io_ret;
 }
 
 
@@ -3109,6 +3405,21 @@ static int hls_init(AVFormatContext *s)
         vs->number++;
     }
 
+#if HAVE_THREADS
+    if (hls->async) {
+        if (hls->http_persistent || hls->encrypt || hls->key_info_file ||
+            hls->max_seg_size > 0 ||
+            (hls->flags & (HLS_SINGLE_FILE | HLS_SECOND_LEVEL_SEGMENT_DURATION |
+                           HLS_SECOND_LEVEL_SEGMENT_SIZE))) {
+            av_log(s, AV_LOG_WARNING, "hls_async is not supported with "
+                   "http_persistent, encryption, byte ranges or renamed "
+                   "segments, writing synchronously\n");
+        } else if ((ret = hls_io_start(s)) < 0) {
+            return ret;
+        }
+    }
+#endif
+
     return ret;
 }
 
@@ -3173,6 +3484,7 @@ static const AVOption options[] = {
     {"timeout", "set timeout for socket I/O operations", OFFSET(timeout), AV_OPT_TYPE_DURATION, { .i64 = -1 }, -1, INT_MAX, .flags = E },
     {"ignore_io_errors", "Ignore IO errors for stable long-duration runs with network output", OFFSET(ignore_io_errors), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
     {"headers", "set custom HTTP headers, can override built in default headers", OFFSET(headers), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
+    {"hls_async", "upload segments and playlists in a background thread", OFFSET(async), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
     { NULL },
 };
 
@@ -177,6 +177,12 @@ typedef struct FFFormatContext {
      */
     int prefer_codec_framerate;
 
+    /**
+     * Add every keyframe read to the stream indexes, set by demuxers
+     * which maintain a keyframe index at runtime.
+     */
+    int generic_index;
+
     /**
      * Set if chapter ids are strictly monotonic.
      */
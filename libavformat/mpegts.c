@@ -127,6 +127,14 @@ struct Program {
     int pmt_found;
 };
 
+/** keyframe index of one PID, loaded from a seek index file */
+typedef struct MpegTSIndexStream {
+    int pid;
+    int nb_entries;
+    int64_t *entries;   ///< pairs of position and dts
+    int applied;        ///< whether the entries have been added to a stream
+} MpegTSIndexStream;
+
 struct MpegTSContext {
     const AVClass *class;
     /* user data */
@@ -180,6 +188,18 @@ struct MpegTSContext {
 
     AVStream *epg_stream;
     AVBufferPool* pools[32];
+
+    /** seek index */
+    int seek_index;
+    char *seek_index_file;
+    int64_t file_size;
+    uint32_t file_crc;     ///< CRC of the first packets, identifies the file
+    int64_t index_end;     ///< end of the range read contiguously from the start
+    int index_complete;    ///< whether the whole file has been indexed
+    int nb_index_loaded;   ///< number of entries loaded from the index file
+    int64_t index_loaded_end;
+    MpegTSIndexStream *index_streams;
+    int nb_index_streams;
 };
 
 #define MPEGTS_OPTIONS \
@@ -203,6 +223,10 @@ static const AVOption options[] = {
      {.i64 = 0}, 0, 1, 0 },
     {"max_packet_size", "maximum size of emitted packet", offsetof(MpegTSContext, max_packet_size), AV_OPT_TYPE_INT,
      {.i64 = 204800}, 1, INT_MAX/2, AV_OPT_FLAG_DECODING_PARAM },
+    {"seek_index", "index keyframes while reading and use the index for seeking", offsetof(MpegTSContext, seek_index), AV_OPT_TYPE_BOOL,
+     {.i64 = 0}, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    {"seek_index_file", "load and store the seek index in a file", offsetof(MpegTSContext, seek_index_file), AV_OPT_TYPE_STRING,
+     {.str = NULL}, 0, 0, AV_OPT_FLAG_DECODING_PARAM },
     { NULL },
 };
 
@@ -3087,6 +3111,236 @@ static int parse_pcr(int64_t *ppcr_high, int *ppcr_low, const uint8_t *packet)
     return 0;
 }
 
+#define SEEK_INDEX_TAG           MKBETAG('F', 'T', 'S', 'I')
+#define SEEK_INDEX_VERSION       1
+#define SEEK_INDEX_FLAG_COMPLETE 1
+/** number of packets at the start of the input identifying it */
+#define SEEK_INDEX_ID_PACKETS    32
+
+static void seek_index_free(MpegTSContext *ts)
+{
+    int i;
+
+    for (i = 0; i < ts->nb_index_streams; i++)
+        av_freep(&ts->index_streams[i].entries);
+    av_freep(&ts->index_streams);
+    ts->nb_index_streams = 0;
+}
+
+/** Add the loaded entries to the streams created since the last call. */
+static void seek_index_apply(AVFormatContext *s)
+{
+    MpegTSContext *ts = s->priv_data;
+    int i, j, k;
+
+    for (i = 0; i < ts->nb_index_streams; i++) {
+        MpegTSIndexStream *is = &ts->index_streams[i];
+
+        if (is->applied)
+            continue;
+        for (j = 0; j < s->nb_streams; j++) {
+            AVStream *st = s->streams[j];
+
+            if (st->id != is->pid)
+                continue;
+            for (k = 0; k < is->nb_entries; k++)
+                av_add_index_entry(st, is->entries[2 * k], is->entries[2 * k + 1],
+                                   0, 0, AVINDEX_KEYFRAME);
+            is->applied = 1;
+            break;
+        }
+    }
+}
+
+static int seek_index_load(AVFormatContext *s)
+{
+    MpegTSContext *ts = s->priv_data;
+    AVIOContext *pb = NULL;
+    int64_t index_end;
+    int flags, nb_streams, i, j, ret = 0;
+
+    if (s->io_open(s, &pb, ts->seek_index_file, AVIO_FLAG_READ, NULL) < 0) {
+        av_log(s, AV_LOG_VERBOSE, "No seek index found in '%s'\n",
+               ts->seek_index_file);
+        return 0;
+    }
+
+    if (avio_rb32(pb) != SEEK_INDEX_TAG ||
+        avio_rb32(pb) != SEEK_INDEX_VERSION ||
+        avio_rb64(pb) != ts->file_size ||
+        avio_rb32(pb) != ts->file_crc ||
+        avio_rb32(pb) != ts->raw_packet_size) {
+        av_log(s, AV_LOG_WARNING, "Seek index '%s' does not match the input, ignoring it\n",
+               ts->seek_index_file);
+        goto end;
+    }
+    flags      = avio_rb32(pb);
+    index_end  = avio_rb64(pb);
+    nb_streams = avio_rb32(pb);
+    if (index_end < 0 || index_end > ts->file_size ||
+        nb_streams < 0 || nb_streams > NB_PID_MAX)
+        goto invalid;
+
+    ts->index_streams = av_calloc(nb_streams, sizeof(*ts->index_streams));
+    if (!ts->index_streams) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (i = 0; i < nb_streams; i++) {
+        MpegTSIndexStream *is = &ts->index_streams[i];
+
+        is->pid        = avio_rb32(pb);
+        is->nb_entries = avio_rb32(pb);
+        ts->nb_index_streams++;
+        if (is->nb_entries < 0 || is->nb_entries > ts->file_size / ts->raw_packet_size ||
+            avio_feof(pb))
+            goto invalid;
+        is->entries = av_malloc_array(is->nb_entries, 2 * sizeof(*is->entries));
+        if (!is->entries) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        for (j = 0; j < 2 * is->nb_entries; j++)
+            is->entries[j] = avio_rb64(pb);
+        ts->nb_index_loaded += is->nb_entries;
+    }
+    if (pb->error || avio_feof(pb))
+        goto invalid;
+
+    ts->index_end        = FFMAX(ts->index_end, index_end);
+    ts->index_loaded_end = ts->index_end;
+    ts->index_complete   = !!(flags & SEEK_INDEX_FLAG_COMPLETE);
+    av_log(s, AV_LOG_VERBOSE, "Loaded %d keyframes from seek index '%s'%s\n",
+           ts->nb_index_loaded, ts->seek_index_file,
+           ts->index_complete ? "" : " (partial)");
+    goto end;
+
+invalid:
+    av_log(s, AV_LOG_WARNING, "Invalid seek index '%s', ignoring it\n",
+           ts->seek_index_file);
+    seek_index_free(ts);
+    ts->nb_index_loaded = 0;
+end:
+    ff_format_io_close(s, &pb);
+    return ret;
+}
+
+static int seek_index_open(AVFormatContext *s, int64_t pos)
+{
+    MpegTSContext *ts = s->priv_data;
+    uint8_t buf[SEEK_INDEX_ID_PACKETS * TS_MAX_PACKET_SIZE];
+    int len;
+
+    ts->file_size = avio_size(s->pb);
+    if (ts->file_size <= 0 || !(s->pb->seekable & AVIO_SEEKABLE_NORMAL)) {
+        av_log(s, AV_LOG_WARNING, "Seek index files require a seekable input\n");
+        ts->file_size = 0;
+        return 0;
+    }
+
+    if (avio_seek(s->pb, pos, SEEK_SET) < 0)
+        return 0;
+    len = avio_read(s->pb, buf, SEEK_INDEX_ID_PACKETS * ts->raw_packet_size);
+    if (len <= 0) {
+        ts->file_size = 0;
+        return 0;
+    }
+    ts->file_crc = av_crc(av_crc_get_table(AV_CRC_32_IEEE_LE), UINT32_MAX, buf, len);
+
+    return seek_index_load(s);
+}
+
+static void seek_index_write(AVFormatContext *s)
+{
+    MpegTSContext *ts = s->priv_data;
+    AVIOContext *pb = NULL;
+    int nb_streams = 0, nb_entries = 0;
+    int i, j, k;
+
+    if (!ts->file_size)
+        return;
+
+    /* only the first stream of a PID is stored, the loaded entries of PIDs
+     * which did not show up yet are kept as they are */
+    for (i = 0; i < s->nb_streams; i++) {
+        const FFStream *sti = cffstream(s->streams[i]);
+
+        for (j = 0; j < i && s->streams[j]->id != s->streams[i]->id; j++);
+        if (j < i || !sti->nb_index_entries)
+            continue;
+        nb_streams++;
+        for (k = 0; k < sti->nb_index_entries; k++)
+            nb_entries += !!(sti->index_entries[k].flags & AVINDEX_KEYFRAME);
+    }
+    for (i = 0; i < ts->nb_index_streams; i++) {
+        if (ts->index_streams[i].applied)
+            continue;
+        nb_streams++;
+        nb_entries += ts->index_streams[i].nb_entries;
+    }
+    if (nb_entries == ts->nb_index_loaded && ts->index_end == ts->index_loaded_end)
+        return;
+
+    if (s->io_open(s, &pb, ts->seek_index_file, AVIO_FLAG_WRITE, NULL) < 0) {
+        av_log(s, AV_LOG_ERROR, "Failed to open seek index '%s'\n",
+               ts->seek_index_file);
+        return;
+    }
+    avio_wb32(pb, SEEK_INDEX_TAG);
+    avio_wb32(pb, SEEK_INDEX_VERSION);
+    avio_wb64(pb, ts->file_size);
+    avio_wb32(pb, ts->file_crc);
+    avio_wb32(pb, ts->raw_packet_size);
+    avio_wb32(pb, ts->index_complete ? SEEK_INDEX_FLAG_COMPLETE : 0);
+    avio_wb64(pb, ts->index_end);
+    avio_wb32(pb, nb_streams);
+    for (i = 0; i < s->nb_streams; i++) {
+        const FFStream *sti = cffstream(s->streams[i]);
+        int nb_keyframes = 0;
+
+        for (j = 0; j < i && s->streams[j]->id != s->streams[i]->id; j++);
+        if (j < i || !sti->nb_index_entries)
+            continue;
+        for (k = 0; k < sti->nb_index_entries; k++)
+            nb_keyframes += !!(sti->index_entries[k].flags & AVINDEX_KEYFRAME);
+        avio_wb32(pb, s->streams[i]->id);
+        avio_wb32(pb, nb_keyframes);
+        for (k = 0; k < sti->nb_index_entries; k++) {
+            const AVIndexEntry *e = &sti->index_entries[k];
+            if (!(e->flags & AVINDEX_KEYFRAME))
+                continue;
+            avio_wb64(pb, e->pos);
+            avio_wb64(pb, e->timestamp);
+        }
+    }
+    for (i = 0; i < ts->nb_index_streams; i++) {
+        const MpegTSIndexStream *is = &ts->index_streams[i];
+        if (is->applied)
+            continue;
+        avio_wb32(pb, is->pid);
+        avio_wb32(pb, is->nb_entries);
+        for (j = 0; j < 2 * is->nb_entries; j++)
+            avio_wb64(pb, is->entries[j]);
+    }
+    ff_format_io_close(s, &pb);
+
+    av_log(s, AV_LOG_VERBOSE, "Stored %d keyframes in seek index '%s'\n",
+           nb_entries, ts->seek_index_file);
+}
+
+/**
+ * Extend the range known to be fully indexed if the packets just read
+ * started inside of it.
+ */
+static void seek_index_update_end(MpegTSContext *ts, int64_t pos, int ret)
+{
+    if (pos > ts->index_end)
+        return;
+    ts->index_end = FFMAX(ts->index_end, avio_tell(ts->stream->pb));
+    if (ret == AVERROR_EOF)
+        ts->index_complete = 1;
+}
+
 static void seek_back(AVFormatContext *s, AVIOContext *pb, int64_t pos) {
 
     /* NOTE: We attempt to seek on non-seekable files as well, as the
@@ -3135,6 +3389,18 @@ static int mpegts_read_header(AVFormatContext *s)
         av_log(ts->stream, AV_LOG_TRACE, "tuning done\n");
 
         s->ctx_flags |= AVFMTCTX_NOHEADER;
+
+        if (ts->seek_index_file)
+            ts->seek_index = 1;
+        if (ts->seek_index) {
+            int ret;
+
+            ffformatcontext(s)->generic_index = 1;
+            ts->index_end = pos;
+            if (ts->seek_index_file && (ret = seek_index_open(s, pos)) < 0)
+                return ret;
+            seek_index_apply(s);
+        }
     } else {
         AVStream *st;
         int pcr_pid, pid, nb_packets, nb_pcrs, ret, pcr_l;
@@ -3249,11 +3515,14 @@ static int mpegts_raw_read_packet(AVFormatContext *s, AVPacket *pkt)
 static int mpegts_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MpegTSContext *ts = s->priv_data;
+    int64_t pos = avio_tell(s->pb);
     int ret, i;
 
     pkt->size = -1;
     ts->pkt = pkt;
     ret = handle_packets(ts, 0);
+    if (ts->seek_index)
+        seek_index_update_end(ts, pos, ret);
     if (ret < 0) {
         av_packet_unref(ts->pkt);
         /* flush pes data left */
@@ -3293,10 +3562,42 @@ static void mpegts_free(MpegTSContext *ts)
 static int mpegts_read_close(AVFormatContext *s)
 {
     MpegTSContext *ts = s->priv_data;
+    if (ts->seek_index_file)
+        seek_index_write(s);
+    seek_index_free(ts);
     mpegts_free(ts);
     return 0;
 }
 
+static int mpegts_read_seek(AVFormatContext *s, int stream_index,
+                            int64_t timestamp, int flags)
+{
+    MpegTSContext *ts = s->priv_data;
+    AVStream *st = s->streams[stream_index];
+    FFStream *const sti = ffstream(st);
+    int index, next;
+
+    if (!ts->seek_index || flags & AVSEEK_FLAG_ANY)
+        return -1;
+    seek_index_apply(s);
+
+    index = av_index_search_timestamp(st, timestamp, flags);
+    if (index < 0)
+        return -1;
+    /* unless the whole file was indexed, only trust the index where no
+     * keyframe can be missing, i.e. before the end of the range read
+     * contiguously from the start */
+    if (!ts->index_complete) {
+        next = av_index_search_timestamp(st, timestamp, 0);
+        if (next < 0 || sti->index_entries[next].pos > ts->index_end)
+            return -1;
+    }
+    if (avio_seek(s->pb, sti->index_entries[index].pos, SEEK_SET) < 0)
+        return -1;
+    avpriv_update_cur_dts(s, st, sti->index_entries[index].timestamp);
+    return 0;
+}
+
 static av_unused int64_t mpegts_get_pcr(AVFormatContext *s, int stream_index,
                               int64_t *ppos, int64_t pos_limit)
 {
@@ -3352,8 +3653,11 @@ static int64_t mpegts_get_dts(AVFormatContext *s, int stream_index,
             return AV_NOPTS_VALUE;
         }
         if (pkt->dts != AV_NOPTS_VALUE && pkt->pos >= 0) {
-            ff_reduce_index(s, pkt->stream_index);
-            av_add_index_entry(s->streams[pkt->stream_index], pkt->pos, pkt->dts, 0, 0, AVINDEX_KEYFRAME /* FIXME keyframe? */);
+            /* the seek index only holds actual keyframes */
+            if (!ts->seek_index) {
+                ff_reduce_index(s, pkt->stream_index);
+                av_add_index_entry(s->streams[pkt->stream_index], pkt->pos, pkt->dts, 0, 0, AVINDEX_KEYFRAME /* FIXME keyframe? */);
+            }
             if (pkt->stream_index == stream_index && pkt->pos >= *ppos) {
                 int64_t dts = pkt->dts;
                 *ppos = pkt->pos;
@@ -3433,6 +3737,7 @@ const AVInputFormat ff_mpegts_demuxer = {
     .read_header    = mpegts_read_header,
     .read_packet    = mpegts_read_packet,
     .read_close     = mpegts_read_close,
+    .read_seek      = mpegts_read_seek,
     .read_timestamp = mpegts_get_dts,
     .flags          = AVFMT_SHOW_IDS | AVFMT_TS_DISCONT,
     .priv_class     = &mpegts_class,
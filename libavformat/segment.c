@@ -24,13 +24,16 @@
  * @url{http://tools.ietf.org/id/draft-pantos-http-live-streaming}
  */
 
+#include "config.h"
 #include "config_components.h"
 
+#include <stdatomic.h>
 #include <time.h>
 
 #include "avformat.h"
 #include "internal.h"
 #include "mux.h"
+#include "url.h"
 
 #include "libavutil/avassert.h"
 #include "libavutil/internal.h"
@@ -39,6 +42,8 @@
 #include "libavutil/avstring.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/mathematics.h"
+#include "libavutil/thread.h"
+#include "libavutil/threadmessage.h"
 #include "libavutil/time.h"
 #include "libavutil/timecode.h"
 #include "libavutil/time_internal.h"
@@ -67,6 +72,28 @@ typedef enum {
 #define SEGMENT_LIST_FLAG_CACHE 1
 #define SEGMENT_LIST_FLAG_LIVE  2
 
+typedef enum {
+    SEGMENT_JOB_FINISH,      ///< flush and close a segment, writing its trailer if it has a muxer
+    SEGMENT_JOB_LIST_WRITE,  ///< write a complete list file and rename it in place
+    SEGMENT_JOB_LIST_APPEND, ///< append entries to the list file kept open
+    SEGMENT_JOB_OPEN,        ///< open the next segment ahead of time
+} SegmentJobType;
+
+/**
+ * Unit of work for the segment I/O thread. Jobs are run in submission
+ * order, so a list update never overtakes the segment it references.
+ */
+typedef struct SegmentJob {
+    SegmentJobType type;
+    AVFormatContext *avf;  ///< muxer of a finished segment, owned by the job
+    AVIOContext *pb;       ///< output of a finished segment, or the opened segment
+    uint8_t *data;         ///< list file content
+    int size;
+    char *filename;        ///< segment to open or list file to write
+    char *final_filename;  ///< name to rename the list file to, if any
+    int ret;               ///< result of SEGMENT_JOB_OPEN
+} SegmentJob;
+
 typedef struct SegmentContext {
     const AVClass *class;  /**< Class for private options. */
     int segment_idx;       ///< index of the segment file to write, starting from 0
@@ -126,6 +153,16 @@ typedef struct SegmentContext {
     SegmentListEntry cur_entry;
     SegmentListEntry *segment_list_entries;
     SegmentListEntry *segment_list_entries_end;
+
+    int async;             ///< finish and open segments in a background thread
+#if HAVE_THREADS
+    pthread_t io_thread;
+    int io_thread_started;
+    AVThreadMessageQueue *io_queue; ///< jobs for the I/O thread
+    AVThreadMessageQueue *io_done;  ///< segments opened ahead of time
+    int prefetch_pending;  ///< whether the next segment is being opened
+    atomic_int io_error;   ///< first error of a background job
+#endif
 } SegmentContext;
 
 static void print_csv_escaped_str(AVIOContext *ctx, const char *str)
@@ -233,6 +270,206 @@ static int set_segment_filename(AVFormatContext *s)
     return 0;
 }
 
+#if HAVE_THREADS
+static void segment_job_free(AVFormatContext *s, SegmentJob *job)
+{
+    if (job->avf) {
+        ff_format_io_close(job->avf, &job->avf->pb);
+        avformat_free_context(job->avf);
+        job->avf = NULL;
+    }
+    ff_format_io_close(s, &job->pb);
+    av_freep(&job->data);
+    av_freep(&job->filename);
+    av_freep(&job->final_filename);
+}
+
+static int segment_job_run(AVFormatContext *s, SegmentJob *job)
+{
+    SegmentContext *seg = s->priv_data;
+    int ret = 0;
+
+    switch (job->type) {
+    case SEGMENT_JOB_FINISH:
+        if (job->avf) {
+            av_write_frame(job->avf, NULL); /* Flush any buffered data (fragmented mp4) */
+            ret = av_write_trailer(job->avf);
+            if (ret < 0)
+                av_log(s, AV_LOG_ERROR, "Failure occurred when ending segment '%s'\n",
+                       job->avf->url);
+        }
+        break;
+    case SEGMENT_JOB_LIST_WRITE:
+        ret = s->io_open(s, &job->pb, job->filename, AVIO_FLAG_WRITE, NULL);
+        if (ret < 0) {
+            av_log(s, AV_LOG_ERROR, "Failed to open segment list '%s'\n", seg->list);
+            break;
+        }
+        avio_write(job->pb, job->data, job->size);
+        ff_format_io_close(s, &job->pb);
+        if (job->final_filename)
+            ff_rename(job->filename, job->final_filename, s);
+        break;
+    case SEGMENT_JOB_LIST_APPEND:
+        avio_write(seg->list_pb, job->data, job->size);
+        avio_flush(seg->list_pb);
+        break;
+    case SEGMENT_JOB_OPEN:
+        ret = s->io_open(s, &job->pb, job->filename, AVIO_FLAG_WRITE, NULL);
+        break;
+    }
+    return ret;
+}
+
+static void *segment_io_thread(void *arg)
+{
+    AVFormatContext *s = arg;
+    SegmentContext *seg = s->priv_data;
+    SegmentJob job;
+
+    ff_thread_setname("segment-io");
+
+    while (av_thread_message_queue_recv(seg->io_queue, &job, 0) >= 0) {
+        int ret = segment_job_run(s, &job);
+
+        if (job.type == SEGMENT_JOB_OPEN) {
+            /* handed back to the packet thread, which owns it from now on */
+            job.ret = ret;
+            if (av_thread_message_queue_send(seg->io_done, &job, 0) >= 0)
+                continue;
+        } else if (ret < 0) {
+            int expected = 0;
+            atomic_compare_exchange_strong(&seg->io_error, &expected, ret);
+        }
+        segment_job_free(s, &job);
+    }
+    return NULL;
+}
+
+static int segment_job_submit(AVFormatContext *s, SegmentJob *job)
+{
+    SegmentContext *seg = s->priv_data;
+    int ret = av_thread_message_queue_send(seg->io_queue, job, 0);
+
+    if (ret < 0)
+        segment_job_free(s, job);
+    return ret;
+}
+
+/**
+ * Remove a segment which was opened ahead of time but is not going to be
+ * written, so that no empty file is left behind.
+ */
+static void segment_discard_prefetched(AVFormatContext *s, SegmentJob *job)
+{
+    if (job->ret >= 0) {
+        ff_format_io_close(s, &job->pb);
+        ffurl_delete(job->filename);
+    }
+    segment_job_free(s, job);
+}
+
+static void segment_prefetch_next(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    SegmentJob job = { .type = SEGMENT_JOB_OPEN };
+    char buf[1024];
+    int idx = seg->segment_idx + 1;
+
+    /* With wrapping, the next segment replaces an old one which a live
+     * list may still reference, so it must not be truncated early. */
+    if (!seg->io_thread_started || seg->prefetch_pending || seg->use_strftime ||
+        seg->segment_idx_wrap)
+        return;
+
+    /* Never truncate a file which exists already: the prefetched segment
+     * is removed again if it ends up unused. */
+    if (av_get_frame_filename(buf, sizeof(buf), s->url, idx) < 0 ||
+        avio_check(buf, 0) >= 0)
+        return;
+
+    job.filename = av_strdup(buf);
+    if (!job.filename)
+        return;
+    if (segment_job_submit(s, &job) >= 0)
+        seg->prefetch_pending = 1;
+}
+
+/**
+ * Attach the segment opened ahead of time to oc if it matches the current
+ * segment filename, oc->pb is left untouched otherwise.
+ */
+static void segment_take_prefetched(AVFormatContext *s, AVFormatContext *oc)
+{
+    SegmentContext *seg = s->priv_data;
+    SegmentJob job;
+
+    if (!seg->prefetch_pending)
+        return;
+    seg->prefetch_pending = 0;
+
+    if (av_thread_message_queue_recv(seg->io_done, &job, 0) < 0)
+        return;
+    if (job.ret >= 0 && !strcmp(job.filename, oc->url)) {
+        oc->pb = job.pb;
+        job.pb = NULL;
+        segment_job_free(s, &job);
+    } else {
+        segment_discard_prefetched(s, &job);
+    }
+}
+
+static int segment_io_start(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    int ret;
+
+    ret = av_thread_message_queue_alloc(&seg->io_queue, 16, sizeof(SegmentJob));
+    if (ret < 0)
+        return ret;
+    ret = av_thread_message_queue_alloc(&seg->io_done, 1, sizeof(SegmentJob));
+    if (ret < 0)
+        return ret;
+    atomic_init(&seg->io_error, 0);
+
+    ret = pthread_create(&seg->io_thread, NULL, segment_io_thread, s);
+    if (ret) {
+        av_log(s, AV_LOG_ERROR, "Failed to start segment I/O thread: %s\n",
+               av_err2str(AVERROR(ret)));
+        return AVERROR(ret);
+    }
+    seg->io_thread_started = 1;
+    return 0;
+}
+
+/**
+ * Wait for all pending jobs to complete and stop the I/O thread.
+ *
+ * @return the first error of a background job
+ */
+static int segment_io_stop(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    SegmentJob job;
+
+    if (seg->io_thread_started) {
+        /* the thread exits once the queue is drained */
+        av_thread_message_queue_set_err_recv(seg->io_queue, AVERROR_EOF);
+        pthread_join(seg->io_thread, NULL);
+        seg->io_thread_started = 0;
+
+        if (seg->prefetch_pending &&
+            av_thread_message_queue_recv(seg->io_done, &job, AV_THREAD_MESSAGE_NONBLOCK) >= 0)
+            segment_discard_prefetched(s, &job);
+        seg->prefetch_pending = 0;
+    }
+    av_thread_message_queue_free(&seg->io_queue);
+    av_thread_message_queue_free(&seg->io_done);
+
+    return atomic_load(&seg->io_error);
+}
+#endif
+
 static int segment_start(AVFormatContext *s, int write_header)
 {
     SegmentContext *seg = s->priv_data;
@@ -254,12 +491,19 @@ static int segment_start(AVFormatContext *s, int write_header)
     if ((err = set_segment_filename(s)) < 0)
         return err;
 
-    if ((err = s->io_open(s, &oc->pb, oc->url, AVIO_FLAG_WRITE, NULL)) < 0) {
+#if HAVE_THREADS
+    segment_take_prefetched(s, oc);
+#endif
+    if (!oc->pb &&
+        (err = s->io_open(s, &oc->pb, oc->url, AVIO_FLAG_WRITE, NULL)) < 0) {
         av_log(s, AV_LOG_ERROR, "Failed to open segment '%s'\n", oc->url);
         return err;
     }
     if (!seg->individual_header_trailer)
         oc->pb->seekable = 0;
+#if HAVE_THREADS
+    segment_prefetch_next(s);
+#endif
 
     if (oc->oformat->priv_class && oc->priv_data)
         av_opt_set(oc->priv_data, "mpegts_flags", "+resend_headers", 0);
@@ -278,26 +522,18 @@ static int segment_start(AVFormatContext *s, int write_header)
     return 0;
 }
 
-static int segment_list_open(AVFormatContext *s)
+static void segment_list_print_header(AVFormatContext *s, AVIOContext *list_ioctx)
 {
     SegmentContext *seg = s->priv_data;
-    int ret;
-
-    snprintf(seg->temp_list_filename, sizeof(seg->temp_list_filename), seg->use_rename ? "%s.tmp" : "%s", seg->list);
-    ret = s->io_open(s, &seg->list_pb, seg->temp_list_filename, AVIO_FLAG_WRITE, NULL);
-    if (ret < 0) {
-        av_log(s, AV_LOG_ERROR, "Failed to open segment list '%s'\n", seg->list);
-        return ret;
-    }
 
     if (seg->list_type == LIST_TYPE_M3U8 && seg->segment_list_entries) {
         SegmentListEntry *entry;
         double max_duration = 0;
 
-        avio_printf(seg->list_pb, "#EXTM3U\n");
-        avio_printf(seg->list_pb, "#EXT-X-VERSION:3\n");
-        avio_printf(seg->list_pb, "#EXT-X-MEDIA-SEQUENCE:%d\n", seg->segment_list_entries->index);
-        avio_printf(seg->list_pb, "#EXT-X-ALLOW-CACHE:%s\n",
+        avio_printf(list_ioctx, "#EXTM3U\n");
+        avio_printf(list_ioctx, "#EXT-X-VERSION:3\n");
+        avio_printf(list_ioctx, "#EXT-X-MEDIA-SEQUENCE:%d\n", seg->segment_list_entries->index);
+        avio_printf(list_ioctx, "#EXT-X-ALLOW-CACHE:%s\n",
                     seg->list_flags & SEGMENT_LIST_FLAG_CACHE ? "YES" : "NO");
 
         av_log(s, AV_LOG_VERBOSE, "EXT-X-MEDIA-SEQUENCE:%d\n",
@@ -305,11 +541,26 @@ static int segment_list_open(AVFormatContext *s)
 
         for (entry = seg->segment_list_entries; entry; entry = entry->next)
             max_duration = FFMAX(max_duration, entry->end_time - entry->start_time);
-        avio_printf(seg->list_pb, "#EXT-X-TARGETDURATION:%"PRId64"\n", (int64_t)ceil(max_duration));
+        avio_printf(list_ioctx, "#EXT-X-TARGETDURATION:%"PRId64"\n", (int64_t)ceil(max_duration));
     } else if (seg->list_type == LIST_TYPE_FFCONCAT) {
-        avio_printf(seg->list_pb, "ffconcat version 1.0\n");
+        avio_printf(list_ioctx, "ffconcat version 1.0\n");
+    }
+}
+
+static int segment_list_open(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    int ret;
+
+    snprintf(seg->temp_list_filename, sizeof(seg->temp_list_filename), seg->use_rename ? "%s.tmp" : "%s", seg->list);
+    ret = s->io_open(s, &seg->list_pb, seg->temp_list_filename, AVIO_FLAG_WRITE, NULL);
+    if (ret < 0) {
+        av_log(s, AV_LOG_ERROR, "Failed to open segment list '%s'\n", seg->list);
+        return ret;
     }
 
+    segment_list_print_header(s, seg->list_pb);
+
     return ret;
 }
 
@@ -348,6 +599,71 @@ static void segment_list_print_entry(AVIOContext      *list_ioctx,
     }
 }
 
+#if HAVE_THREADS
+/**
+ * Hand the current segment over to the I/O thread. If a trailer is
+ * requested the whole muxer is handed over and a new one must be created
+ * for the next segment, otherwise only its output is.
+ */
+static int segment_finish_async(AVFormatContext *s, int write_trailer)
+{
+    SegmentContext *seg = s->priv_data;
+    AVFormatContext *oc = seg->avf;
+    SegmentJob job = { .type = SEGMENT_JOB_FINISH };
+
+    if (write_trailer) {
+        job.avf  = oc;
+        seg->avf = NULL;
+    } else {
+        av_write_frame(oc, NULL); /* Flush any buffered data (fragmented mp4) */
+        job.pb  = oc->pb;
+        oc->pb  = NULL;
+    }
+    return segment_job_submit(s, &job);
+}
+
+static int segment_list_write_async(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    SegmentJob job = { .type = SEGMENT_JOB_LIST_WRITE };
+    SegmentListEntry *entry;
+    AVIOContext *dyn_pb;
+    int ret;
+
+    if ((ret = avio_open_dyn_buf(&dyn_pb)) < 0)
+        return ret;
+    segment_list_print_header(s, dyn_pb);
+    for (entry = seg->segment_list_entries; entry; entry = entry->next)
+        segment_list_print_entry(dyn_pb, seg->list_type, entry, s);
+    job.size = avio_close_dyn_buf(dyn_pb, &job.data);
+
+    job.filename = av_asprintf(seg->use_rename ? "%s.tmp" : "%s", seg->list);
+    if (seg->use_rename)
+        job.final_filename = av_strdup(seg->list);
+    if (!job.data || !job.filename || (seg->use_rename && !job.final_filename)) {
+        segment_job_free(s, &job);
+        return AVERROR(ENOMEM);
+    }
+    return segment_job_submit(s, &job);
+}
+
+static int segment_list_append_async(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    SegmentJob job = { .type = SEGMENT_JOB_LIST_APPEND };
+    AVIOContext *dyn_pb;
+    int ret;
+
+    if ((ret = avio_open_dyn_buf(&dyn_pb)) < 0)
+        return ret;
+    segment_list_print_entry(dyn_pb, seg->list_type, &seg->cur_entry, s);
+    job.size = avio_close_dyn_buf(dyn_pb, &job.data);
+    if (!job.data)
+        return AVERROR(ENOMEM);
+    return segment_job_submit(s, &job);
+}
+#endif
+
 static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
 {
     SegmentContext *seg = s->priv_data;
@@ -359,17 +675,37 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
     char buf[AV_TIMECODE_STR_SIZE];
     int i;
     int err;
+    int async = 0;
 
     if (!oc || !oc->pb)
         return AVERROR(EINVAL);
 
-    av_write_frame(oc, NULL); /* Flush any buffered data (fragmented mp4) */
-    if (write_trailer)
-        ret = av_write_trailer(oc);
+#if HAVE_THREADS
+    if (seg->io_thread_started) {
+        /* the last segment is ended synchronously after all pending jobs */
+        ret = is_last ? segment_io_stop(s) : atomic_load(&seg->io_error);
+        if (ret < 0)
+            return ret;
+        async = seg->io_thread_started;
+    }
 
-    if (ret < 0)
-        av_log(s, AV_LOG_ERROR, "Failure occurred when ending segment '%s'\n",
-               oc->url);
+    if (async) {
+        av_log(s, AV_LOG_VERBOSE, "segment:'%s' count:%d ended\n",
+               oc->url, seg->segment_count);
+        ret = segment_finish_async(s, write_trailer);
+        if (write_trailer)
+            oc = NULL;
+    } else
+#endif
+    {
+        av_write_frame(oc, NULL); /* Flush any buffered data (fragmented mp4) */
+        if (write_trailer)
+            ret = av_write_trailer(oc);
+
+        if (ret < 0)
+            av_log(s, AV_LOG_ERROR, "Failure occurred when ending segment '%s'\n",
+                   oc->url);
+    }
 
     if (seg->list) {
         if (seg->list_size || seg->list_type == LIST_TYPE_M3U8) {
@@ -396,23 +732,36 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
                 av_freep(&entry);
             }
 
-            if ((ret = segment_list_open(s)) < 0)
-                goto end;
-            for (entry = seg->segment_list_entries; entry; entry = entry->next)
-                segment_list_print_entry(seg->list_pb, seg->list_type, entry, s);
-            if (seg->list_type == LIST_TYPE_M3U8 && is_last)
-                avio_printf(seg->list_pb, "#EXT-X-ENDLIST\n");
-            ff_format_io_close(s, &seg->list_pb);
-            if (seg->use_rename)
-                ff_rename(seg->temp_list_filename, seg->list, s);
+#if HAVE_THREADS
+            if (async) {
+                if ((ret = segment_list_write_async(s)) < 0)
+                    goto end;
+            } else
+#endif
+            {
+                if ((ret = segment_list_open(s)) < 0)
+                    goto end;
+                for (entry = seg->segment_list_entries; entry; entry = entry->next)
+                    segment_list_print_entry(seg->list_pb, seg->list_type, entry, s);
+                if (seg->list_type == LIST_TYPE_M3U8 && is_last)
+                    avio_printf(seg->list_pb, "#EXT-X-ENDLIST\n");
+                ff_format_io_close(s, &seg->list_pb);
+                if (seg->use_rename)
+                    ff_rename(seg->temp_list_filename, seg->list, s);
+            }
+#if HAVE_THREADS
+        } else if (async) {
+            ret = segment_list_append_async(s);
+#endif
         } else {
             segment_list_print_entry(seg->list_pb, seg->list_type, &seg->cur_entry, s);
             avio_flush(seg->list_pb);
         }
     }
 
-    av_log(s, AV_LOG_VERBOSE, "segment:'%s' count:%d ended\n",
-           seg->avf->url, seg->segment_count);
+    if (!async)
+        av_log(s, AV_LOG_VERBOSE, "segment:'%s' count:%d ended\n",
+               seg->avf->url, seg->segment_count);
     seg->segment_count++;
 
     if (seg->increment_tc) {
@@ -455,7 +804,8 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
     }
 
 end:
-    ff_format_io_close(oc, &oc->pb);
+    if (oc)
+        ff_format_io_close(oc, &oc->pb);
 
     return ret;
 }
@@ -651,6 +1001,9 @@ static void seg_free(AVFormatContext *s)
     SegmentContext *seg = s->priv_data;
     SegmentListEntry *cur;
 
+#if HAVE_THREADS
+    segment_io_stop(s);
+#endif
     ff_format_io_close(s, &seg->list_pb);
     if (seg->avf) {
         if (seg->is_nullctx)
@@ -818,6 +1171,16 @@ static int seg_init(AVFormatContext *s)
     if (oc->avoid_negative_ts > 0 && s->avoid_negative_ts < 0)
         s->avoid_negative_ts = 1;
 
+    if (seg->async) {
+#if HAVE_THREADS
+        int err = segment_io_start(s);
+        if (err < 0)
+            return err;
+#else
+        av_log(s, AV_LOG_WARNING, "segment_async requires threading support, ignoring\n");
+#endif
+    }
+
     return ret;
 }
 
@@ -847,6 +1210,9 @@ static int seg_write_header(AVFormatContext *s)
             oc->pb->seekable = 0;
     }
 
+#if HAVE_THREADS
+    segment_prefetch_next(s);
+#endif
     return 0;
 }
 
@@ -1079,6 +1445,7 @@ static const AVOption options[] = {
     { "reset_timestamps", "reset timestamps at the beginning of each segment", OFFSET(reset_timestamps), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E },
     { "initial_offset", "set initial timestamp offset", OFFSET(initial_offset), AV_OPT_TYPE_DURATION, {.i64 = 0}, -INT64_MAX, INT64_MAX, E },
     { "write_empty_segments", "allow writing empty 'filler' segments", OFFSET(write_empty), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E },
+    { "segment_async", "finish and open segments in a background thread", OFFSET(async), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E },
     { NULL },
 };
 
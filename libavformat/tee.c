@@ -20,9 +20,13 @@
  */
 
 
+#include <stdatomic.h>
+
 #include "libavutil/avutil.h"
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
+#include "libavutil/threadmessage.h"
 #include "libavcodec/bsf.h"
 #include "internal.h"
 #include "avformat.h"
@@ -36,6 +40,11 @@ typedef enum {
 
 #define DEFAULT_SLAVE_FAILURE_POLICY ON_SLAVE_FAILURE_ABORT
 
+typedef enum {
+    QUEUE_POLICY_BLOCK = 0,
+    QUEUE_POLICY_DROP  = 1,
+} SlaveQueuePolicy;
+
 typedef struct {
     AVFormatContext *avf;
     AVBSFContext **bsfs; ///< bitstream filters per stream
@@ -48,6 +57,27 @@ typedef struct {
      * disabled output streams are set to -1 */
     int *stream_map;
     int header_written;
+
+    int use_thread;
+    int queue_size;
+    SlaveQueuePolicy queue_policy;
+#if HAVE_THREADS
+    AVThreadMessageQueue *queue; ///< packets waiting for the writer thread
+    pthread_t writer;
+    int writer_started;
+    int writer_ret;
+    /** per output stream, set after a packet has been dropped */
+    int *drop_until_key;
+
+    /* statistics, the written ones are updated by the writer thread */
+    uint64_t nb_queued;
+    uint64_t nb_dropped;
+    int max_queued;
+    int64_t last_queued_ts;
+    int64_t max_lag;
+    atomic_uint_least64_t nb_written;
+    atomic_int_least64_t last_written_ts;
+#endif
 } TeeSlave;
 
 typedef struct TeeContext {
@@ -57,6 +87,9 @@ typedef struct TeeContext {
     TeeSlave *slaves;
     int use_fifo;
     AVDictionary *fifo_options;
+    int use_threads;
+    int queue_size;
+    int queue_policy;
 } TeeContext;
 
 static const char *const slave_delim     = "|";
@@ -69,6 +102,14 @@ static const AVOption options[] = {
          OFFSET(use_fifo), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
         {"fifo_options", "fifo pseudo-muxer options", OFFSET(fifo_options),
          AV_OPT_TYPE_DICT, {.str = NULL}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM},
+        {"use_threads", "Write each slave from its own thread",
+         OFFSET(use_threads), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
+        {"queue_size", "Number of packets queued for each slave writer thread",
+         OFFSET(queue_size), AV_OPT_TYPE_INT, {.i64 = 256}, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
+        {"queue_policy", "What to do when the queue of a slave writer thread is full",
+         OFFSET(queue_policy), AV_OPT_TYPE_INT, {.i64 = QUEUE_POLICY_BLOCK}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM, "queue_policy"},
+            {"block", "wait for the slave to catch up", 0, AV_OPT_TYPE_CONST, {.i64 = QUEUE_POLICY_BLOCK}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "queue_policy"},
+            {"drop",  "drop packets up to the next keyframe", 0, AV_OPT_TYPE_CONST, {.i64 = QUEUE_POLICY_DROP}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "queue_policy"},
         {NULL}
 };
 
@@ -96,20 +137,209 @@ static inline int parse_slave_failure_policy_option(const char *opt, TeeSlave *t
     return AVERROR(EINVAL);
 }
 
-static int parse_slave_fifo_policy(const char *use_fifo, TeeSlave *tee_slave)
+static int parse_slave_bool_option(const char *opt, int *value)
 {
     /*TODO - change this to use proper function for parsing boolean
      *       options when there is one */
-    if (av_match_name(use_fifo, "true,y,yes,enable,enabled,on,1")) {
-        tee_slave->use_fifo = 1;
-    } else if (av_match_name(use_fifo, "false,n,no,disable,disabled,off,0")) {
-        tee_slave->use_fifo = 0;
+    if (av_match_name(opt, "true,y,yes,enable,enabled,on,1")) {
+        *value = 1;
+    } else if (av_match_name(opt, "false,n,no,disable,disabled,off,0")) {
+        *value = 0;
+    } else {
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+static int parse_slave_fifo_policy(const char *use_fifo, TeeSlave *tee_slave)
+{
+    return parse_slave_bool_option(use_fifo, &tee_slave->use_fifo);
+}
+
+static int parse_slave_queue_size(const char *queue_size, TeeSlave *tee_slave)
+{
+    char *end;
+    long size = strtol(queue_size, &end, 10);
+
+    if (*end || size < 1 || size > INT_MAX)
+        return AVERROR(EINVAL);
+    tee_slave->queue_size = size;
+    return 0;
+}
+
+static int parse_slave_queue_policy(const char *policy, TeeSlave *tee_slave)
+{
+    if (!av_strcasecmp("block", policy)) {
+        tee_slave->queue_policy = QUEUE_POLICY_BLOCK;
+    } else if (!av_strcasecmp("drop", policy)) {
+        tee_slave->queue_policy = QUEUE_POLICY_DROP;
     } else {
         return AVERROR(EINVAL);
     }
     return 0;
 }
 
+#if HAVE_THREADS
+static int64_t slave_packet_ts(const AVFormatContext *avf2, const AVPacket *pkt)
+{
+    int64_t ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+
+    if (ts == AV_NOPTS_VALUE)
+        return AV_NOPTS_VALUE;
+    return av_rescale_q(ts, avf2->streams[pkt->stream_index]->time_base,
+                        AV_TIME_BASE_Q);
+}
+
+static void free_queued_packet(void *msg)
+{
+    av_packet_free(msg);
+}
+
+static void *slave_writer_thread(void *arg)
+{
+    TeeSlave *tee_slave = arg;
+    AVFormatContext *avf2 = tee_slave->avf;
+    AVPacket *pkt;
+    int ret;
+
+    ff_thread_setname("tee-writer");
+
+    while ((ret = av_thread_message_queue_recv(tee_slave->queue, &pkt, 0)) >= 0) {
+        /* a NULL packet requests a flush of the slave */
+        int64_t ts = pkt ? slave_packet_ts(avf2, pkt) : AV_NOPTS_VALUE;
+
+        ret = av_interleaved_write_frame(avf2, pkt);
+        av_packet_free(&pkt);
+        if (ret < 0)
+            break;
+
+        if (ts != AV_NOPTS_VALUE)
+            atomic_store(&tee_slave->last_written_ts, ts);
+        atomic_fetch_add(&tee_slave->nb_written, 1);
+    }
+    if (ret == AVERROR_EOF)
+        ret = 0;
+
+    tee_slave->writer_ret = ret;
+    /* make the next queueing attempt fail with the error */
+    av_thread_message_queue_set_err_send(tee_slave->queue, ret < 0 ? ret : AVERROR_EOF);
+    return NULL;
+}
+
+static int start_slave_writer(AVFormatContext *avf, TeeSlave *tee_slave)
+{
+    int ret;
+
+    ret = av_thread_message_queue_alloc(&tee_slave->queue, tee_slave->queue_size,
+                                        sizeof(AVPacket *));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(tee_slave->queue, free_queued_packet);
+
+    tee_slave->drop_until_key = av_calloc(tee_slave->avf->nb_streams,
+                                          sizeof(*tee_slave->drop_until_key));
+    if (!tee_slave->drop_until_key)
+        return AVERROR(ENOMEM);
+
+    tee_slave->last_queued_ts = AV_NOPTS_VALUE;
+    atomic_init(&tee_slave->nb_written, 0);
+    atomic_init(&tee_slave->last_written_ts, AV_NOPTS_VALUE);
+
+    ret = pthread_create(&tee_slave->writer, NULL, slave_writer_thread, tee_slave);
+    if (ret) {
+        av_log(avf, AV_LOG_ERROR, "Failed to start writer thread: %s\n",
+               av_err2str(AVERROR(ret)));
+        return AVERROR(ret);
+    }
+    tee_slave->writer_started = 1;
+    return 0;
+}
+
+static int stop_slave_writer(void *log_ctx, TeeSlave *tee_slave)
+{
+    int ret = 0;
+
+    if (tee_slave->writer_started) {
+        /* the writer thread exits once the queue is drained */
+        av_thread_message_queue_set_err_recv(tee_slave->queue, AVERROR_EOF);
+        pthread_join(tee_slave->writer, NULL);
+        tee_slave->writer_started = 0;
+        ret = tee_slave->writer_ret;
+
+        av_log(log_ctx, tee_slave->nb_dropped ? AV_LOG_WARNING : AV_LOG_VERBOSE,
+               "Slave '%s': %"PRIu64" packets queued, %"PRIu64" written, "
+               "%"PRIu64" dropped, max queue %d/%d packets, max lag %.3fs\n",
+               tee_slave->avf->url, tee_slave->nb_queued,
+               (uint64_t)atomic_load(&tee_slave->nb_written), tee_slave->nb_dropped,
+               tee_slave->max_queued, tee_slave->queue_size,
+               tee_slave->max_lag / (double)AV_TIME_BASE);
+    }
+    av_thread_message_queue_free(&tee_slave->queue);
+    av_freep(&tee_slave->drop_until_key);
+    return ret;
+}
+
+/**
+ * Hand a filtered packet over to the writer thread of a slave, a NULL packet
+ * requests a flush. Takes ownership of the packet data.
+ */
+static int queue_slave_packet(TeeSlave *tee_slave, AVPacket *pkt)
+{
+    AVPacket *qpkt = NULL;
+    int64_t ts = AV_NOPTS_VALUE, written_ts;
+    int nb_elems, ret;
+
+    if (pkt) {
+        int *const drop_until_key = &tee_slave->drop_until_key[pkt->stream_index];
+
+        if (*drop_until_key) {
+            if (!(pkt->flags & AV_PKT_FLAG_KEY)) {
+                tee_slave->nb_dropped++;
+                av_packet_unref(pkt);
+                return 0;
+            }
+            *drop_until_key = 0;
+        }
+
+        ts   = slave_packet_ts(tee_slave->avf, pkt);
+        qpkt = av_packet_alloc();
+        if (!qpkt) {
+            av_packet_unref(pkt);
+            return AVERROR(ENOMEM);
+        }
+        av_packet_move_ref(qpkt, pkt);
+    }
+
+    /* only data packets may be dropped, a flush request is always queued
+     * (the end of stream is signalled through the queue itself) */
+    ret = av_thread_message_queue_send(tee_slave->queue, &qpkt,
+                                       tee_slave->queue_policy == QUEUE_POLICY_DROP && qpkt ?
+                                       AV_THREAD_MESSAGE_NONBLOCK : 0);
+    if (ret == AVERROR(EAGAIN)) {
+        /* The slave is lagging behind: drop the packet, and the following
+         * ones of that stream until a keyframe arrives. */
+        tee_slave->drop_until_key[qpkt->stream_index] = 1;
+        tee_slave->nb_dropped++;
+        av_packet_free(&qpkt);
+        return 0;
+    } else if (ret < 0) {
+        av_packet_free(&qpkt);
+        return ret == AVERROR_EOF ? tee_slave->writer_ret : ret;
+    }
+
+    tee_slave->nb_queued++;
+    nb_elems = av_thread_message_queue_nb_elems(tee_slave->queue);
+    tee_slave->max_queued = FFMAX(tee_slave->max_queued, nb_elems);
+    if (ts != AV_NOPTS_VALUE) {
+        tee_slave->last_queued_ts = ts;
+        written_ts = atomic_load(&tee_slave->last_written_ts);
+        if (written_ts != AV_NOPTS_VALUE)
+            tee_slave->max_lag = FFMAX(tee_slave->max_lag, ts - written_ts);
+    }
+    return 0;
+}
+#endif
+
 static int parse_slave_fifo_options(const char *fifo_options, TeeSlave *tee_slave)
 {
     return av_dict_parse_string(&tee_slave->fifo_options, fifo_options, "=", ":", 0);
@@ -126,8 +356,15 @@ static int close_slave(TeeSlave *tee_slave)
     if (!avf)
         return 0;
 
-    if (tee_slave->header_written)
-        ret = av_write_trailer(avf);
+#if HAVE_THREADS
+    ret = stop_slave_writer(avf, tee_slave);
+#endif
+
+    if (tee_slave->header_written) {
+        int ret2 = av_write_trailer(avf);
+        if (!ret)
+            ret = ret2;
+    }
 
     if (tee_slave->bsfs) {
         for (i = 0; i < avf->nb_streams; ++i)
@@ -161,6 +398,7 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
     char *filename;
     char *format = NULL, *select = NULL, *on_fail = NULL;
     char *use_fifo = NULL, *fifo_options_str = NULL;
+    char *use_thread = NULL, *queue_size = NULL, *queue_policy = NULL;
     AVFormatContext *avf2 = NULL;
     AVStream *st, *st2;
     int stream_count;
@@ -195,6 +433,16 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
                           av_err2str(ret)););
     PROCESS_OPTION("fifo_options", fifo_options_str,
                    parse_slave_fifo_options(fifo_options_str, tee_slave), ;);
+    PROCESS_OPTION("use_thread", use_thread,
+                   parse_slave_bool_option(use_thread, &tee_slave->use_thread),
+                   av_log(avf, AV_LOG_ERROR, "Invalid use_thread option value\n"););
+    PROCESS_OPTION("queue_size", queue_size,
+                   parse_slave_queue_size(queue_size, tee_slave),
+                   av_log(avf, AV_LOG_ERROR, "Invalid queue_size option value\n"););
+    PROCESS_OPTION("queue_policy", queue_policy,
+                   parse_slave_queue_policy(queue_policy, tee_slave),
+                   av_log(avf, AV_LOG_ERROR, "Invalid queue_policy option value, "
+                          "valid options are 'block' and 'drop'\n"););
     entry = NULL;
     while ((entry = av_dict_get(options, "bsfs", entry, AV_DICT_IGNORE_SUFFIX))) {
         /* trim out strlen("bsfs") characters from key */
@@ -399,6 +647,18 @@ FF_ENABLE_DEPRECATION_WARNINGS
         goto end;
     }
 
+    if (tee_slave->use_thread) {
+#if HAVE_THREADS
+        if ((ret = start_slave_writer(avf, tee_slave)) < 0)
+            goto end;
+#else
+        av_log(avf, AV_LOG_ERROR, "Slave '%s': writer threads are not "
+               "supported on this build\n", slave);
+        ret = AVERROR(ENOSYS);
+        goto end;
+#endif
+    }
+
 end:
     av_free(format);
     av_free(select);
@@ -411,8 +671,9 @@ end:
 static void log_slave(TeeSlave *slave, void *log_ctx, int log_level)
 {
     int i;
-    av_log(log_ctx, log_level, "filename:'%s' format:%s\n",
-           slave->avf->url, slave->avf->oformat->name);
+    av_log(log_ctx, log_level, "filename:'%s' format:%s%s\n",
+           slave->avf->url, slave->avf->oformat->name,
+           slave->use_thread ? " threaded" : "");
     for (i = 0; i < slave->avf->nb_streams; i++) {
         AVStream *st = slave->avf->streams[i];
         AVBSFContext *bsf = slave->bsfs[i];
@@ -481,7 +742,10 @@ static int tee_write_header(AVFormatContext *avf)
 
     for (i = 0; i < nb_slaves; i++) {
 
-        tee->slaves[i].use_fifo = tee->use_fifo;
+        tee->slaves[i].use_fifo     = tee->use_fifo;
+        tee->slaves[i].use_thread   = tee->use_threads;
+        tee->slaves[i].queue_size   = tee->queue_size;
+        tee->slaves[i].queue_policy = tee->queue_policy;
         ret = av_dict_copy(&tee->slaves[i].fifo_options, tee->fifo_options, 0);
         if (ret < 0)
             goto fail;
@@ -549,6 +813,11 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
 
         /* Flush slave if pkt is NULL*/
         if (!pkt) {
+#if HAVE_THREADS
+            if (tee->slaves[i].writer_started)
+                ret = queue_slave_packet(&tee->slaves[i], NULL);
+            else
+#endif
             ret = av_interleaved_write_frame(avf2, NULL);
             if (ret < 0) {
                 ret = tee_process_slave_failure(avf, i, ret);
@@ -592,6 +861,11 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
 
             av_packet_rescale_ts(pkt2, bsfs->time_base_out,
                                  avf2->streams[s2]->time_base);
+#if HAVE_THREADS
+            if (tee->slaves[i].writer_started)
+                ret = queue_slave_packet(&tee->slaves[i], pkt2);
+            else
+#endif
             ret = av_interleaved_write_frame(avf2, pkt2);
             if (ret < 0)
                 break;
@@ -0,0 +1,105 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * UDP loopback test: datagrams of any size must be received completely and
+ * in order, with and without batched receiving.
+ */
+
+#include <stdio.h>
+
+#include "libavutil/mem.h"
+#include "libavformat/avio.h"
+#include "libavformat/url.h"
+
+#define MAX_DGRAM 65507
+
+static const int sizes[] = {
+    1, 188, 1316, 1316, 1316, 1316, 1316, 1316, 1316, 1316,
+    1472, 1473, 1500, 9000, 1316, MAX_DGRAM, 7, 1316,
+};
+
+static void fill(uint8_t *buf, int size, int n)
+{
+    for (int i = 0; i < size; i++)
+        buf[i] = (i * 7 + n * 31) & 0xff;
+}
+
+static int test(const char *opts)
+{
+    char url[256];
+    URLContext *rx = NULL, *tx = NULL;
+    uint8_t *buf = av_malloc(MAX_DGRAM + 1), *ref = av_malloc(MAX_DGRAM);
+    int ret = AVERROR(EINVAL), n;
+
+    if (!buf || !ref) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    snprintf(url, sizeof(url), "udp://127.0.0.1:0?timeout=2000000&%s", opts);
+    ret = ffurl_open_whitelist(&rx, url, AVIO_FLAG_READ, NULL, NULL,
+                               NULL, NULL, NULL);
+    if (ret < 0)
+        goto end;
+    snprintf(url, sizeof(url), "udp://127.0.0.1:%d?pkt_size=%d",
+             ff_udp_get_local_port(rx), MAX_DGRAM);
+    ret = ffurl_open_whitelist(&tx, url, AVIO_FLAG_WRITE, NULL, NULL,
+                               NULL, NULL, NULL);
+    if (ret < 0)
+        goto end;
+
+    for (n = 0; n < FF_ARRAY_ELEMS(sizes); n++) {
+        fill(ref, sizes[n], n);
+        if ((ret = ffurl_write(tx, ref, sizes[n])) < 0)
+            goto end;
+    }
+    for (n = 0; n < FF_ARRAY_ELEMS(sizes); n++) {
+        fill(ref, sizes[n], n);
+        ret = ffurl_read(rx, buf, MAX_DGRAM + 1);
+        if (ret < 0)
+            goto end;
+        if (ret != sizes[n] || memcmp(buf, ref, ret)) {
+            fprintf(stderr, "%s: datagram %d: got %d bytes, expected %d\n",
+                    opts, n, ret, sizes[n]);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+    }
+    ret = 0;
+
+end:
+    printf("%s: %s\n", *opts ? opts : "default", ret < 0 ? "failed" : "ok");
+    ffurl_closep(&tx);
+    ffurl_closep(&rx);
+    av_free(buf);
+    av_free(ref);
+    return ret;
+}
+
+int main(void)
+{
+    int ret = 0;
+
+    ret |= test("");
+    ret |= test("batch_size=8");
+    ret |= test("batch_size=8&pkt_size=188");
+    ret |= test("batch_size=8&pkt_size=65536");
+    ret |= test("batch_size=8&timestamping=1");
+    return ret < 0;
+}
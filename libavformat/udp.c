@@ -26,10 +26,12 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() with glibc */
 
 #include "avformat.h"
 #include "avio_internal.h"
 #include "libavutil/avassert.h"
+#include "libavutil/buffer.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/fifo.h"
 #include "libavutil/intreadwrite.h"
@@ -61,6 +63,10 @@
 #define IPPROTO_UDPLITE                                  136
 #endif
 
+#if HAVE_SENDMMSG
+#include <netinet/udp.h>
+#endif
+
 #if HAVE_W32THREADS
 #undef HAVE_PTHREAD_CANCEL
 #define HAVE_PTHREAD_CANCEL 1
@@ -79,6 +85,27 @@
 #define UDP_RX_BUF_SIZE 393216
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#define UDP_MAX_GSO_SEGMENTS 64
+#define UDP_MAX_GSO_SIZE 65507
+
+#if HAVE_RECVMMSG
+/**
+ * A datagram received by the batched receive thread. The data lives in a
+ * buffer shared by all datagrams received by the same recvmmsg() call.
+ */
+typedef struct UDPDatagram {
+    AVBufferRef *buf;
+    uint8_t *data;
+    int size;
+    int charge;         ///< share of the buffer counted in fifo_bytes
+    int64_t timestamp;
+} UDPDatagram;
+
+typedef union UDPControlBuffer {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(sizeof(struct timespec))];
+} UDPControlBuffer;
+#endif
 
 typedef struct UDPContext {
     const AVClass *class;
@@ -117,6 +144,32 @@ typedef struct UDPContext {
     char *sources;
     char *block;
     IPSourceFilters filters;
+
+    int batch_size;
+    int gso;
+    int timestamping;
+    int64_t last_rx_timestamp;
+#if HAVE_RECVMMSG
+    /* Batched receive, the fifo holds UDPDatagram entries if rx_pool is set */
+    AVBufferPool *rx_pool;
+    AVBufferRef *rx_buf;
+    int rx_slot_size;
+    uint8_t *rx_overflow;   ///< tails of datagrams longer than a slot
+    UDPDatagram *rx_dgs;
+    struct mmsghdr *rx_msgs;
+    struct iovec *rx_iov;
+    struct sockaddr_storage *rx_addrs;
+    UDPControlBuffer *rx_ctrl;
+    int fifo_bytes;
+#endif
+#if HAVE_SENDMMSG
+    /* Batched send, the tx thread gathers several datagrams into tx_buf */
+    uint8_t *tx_buf;
+    int tx_buf_size;
+    int *tx_sizes;
+    struct mmsghdr *tx_msgs;
+    struct iovec *tx_iov;
+#endif
 } UDPContext;
 
 #define OFFSET(x) offsetof(UDPContext, x)
@@ -141,6 +194,10 @@ static const AVOption options[] = {
     { "timeout",        "set raise error timeout, in microseconds (only in read mode)",OFFSET(timeout),         AV_OPT_TYPE_INT,  {.i64 = 0}, 0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
+    { "batch_size",     "Number of datagrams received or sent per system call", OFFSET(batch_size), AV_OPT_TYPE_INT, { .i64 = 1 },    1, 1024,    D|E },
+    { "gso",            "Use UDP generic segmentation offload for batched sends", OFFSET(gso),   AV_OPT_TYPE_BOOL,   { .i64 = 0 },      0, 1,       E },
+    { "timestamping",   "Enable kernel receive timestamps",                OFFSET(timestamping),   AV_OPT_TYPE_BOOL,   { .i64 = 0 },      0, 1,       D },
+    { "last_rx_timestamp", "Kernel receive timestamp of the last datagram read, in microseconds", OFFSET(last_rx_timestamp), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D | AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
     { NULL }
 };
 
@@ -544,6 +601,299 @@ end:
     return NULL;
 }
 
+#if HAVE_RECVMMSG
+static int64_t udp_get_rx_timestamp(struct msghdr *msg)
+{
+#ifdef SCM_TIMESTAMPNS
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            return ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+        }
+    }
+#endif
+    return 0;
+}
+
+static void udp_rx_batch_unref(UDPContext *s)
+{
+    for (int i = 0; i < s->batch_size; i++)
+        av_buffer_unref(&s->rx_dgs[i].buf);
+}
+
+/**
+ * Set up rx_dgs for the nb_msgs datagrams received into rx_buf.
+ *
+ * A batch which fills most of rx_buf is queued without copying, each
+ * datagram being charged an equal share of the whole buffer, so that the
+ * fifo size bounds the memory held by queued datagrams. Datagrams of a
+ * sparse batch are packed into a buffer of their own, and rx_buf is reused
+ * for the next call. Datagrams longer than a slot continue in rx_overflow
+ * and are always copied.
+ */
+static int udp_rx_batch_settle(UDPContext *s, int nb_msgs)
+{
+    const int buf_size = s->batch_size * s->rx_slot_size;
+    AVBufferRef *packed = NULL;
+    int nb_slot = 0, slot_bytes = 0, charge, pos = 0;
+
+    for (int i = 0; i < nb_msgs; i++) {
+        UDPDatagram *dg = &s->rx_dgs[i];
+        const uint8_t *slot = s->rx_iov[2 * i].iov_base;
+        int len = s->rx_msgs[i].msg_len;
+
+        memset(dg, 0, sizeof(*dg));
+        dg->size = len;
+        if (ff_ip_check_source_lists(&s->rx_addrs[i], &s->filters)) {
+            dg->size = -1;
+            continue;
+        }
+        if (len <= s->rx_slot_size) {
+            nb_slot++;
+            slot_bytes += len;
+            continue;
+        }
+        dg->buf = av_buffer_alloc(len);
+        if (!dg->buf)
+            return AVERROR(ENOMEM);
+        dg->data   = dg->buf->data;
+        dg->charge = len;
+        memcpy(dg->data, slot, s->rx_slot_size);
+        memcpy(dg->data + s->rx_slot_size, s->rx_iov[2 * i + 1].iov_base,
+               len - s->rx_slot_size);
+    }
+    if (!nb_slot)
+        return 0;
+
+    if (2 * slot_bytes < buf_size) {
+        packed = av_buffer_alloc(FFMAX(slot_bytes, 1));
+        if (!packed)
+            return AVERROR(ENOMEM);
+    }
+    charge = buf_size / nb_slot;
+    for (int i = 0; i < nb_msgs; i++) {
+        UDPDatagram *dg = &s->rx_dgs[i];
+        const uint8_t *slot = s->rx_iov[2 * i].iov_base;
+
+        if (dg->buf || dg->size < 0)
+            continue;
+        if (packed) {
+            dg->data   = packed->data + pos;
+            dg->charge = dg->size;
+            memcpy(dg->data, slot, dg->size);
+            pos += dg->size;
+            dg->buf = av_buffer_ref(packed);
+        } else {
+            dg->data   = (uint8_t *)slot;
+            /* the first datagram also takes the remainder */
+            dg->charge = charge + (pos ? 0 : buf_size - charge * nb_slot);
+            pos = 1;
+            dg->buf = av_buffer_ref(s->rx_buf);
+        }
+        if (!dg->buf) {
+            av_buffer_unref(&packed);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    if (packed)
+        av_buffer_unref(&packed);
+    else /* referenced by the queued datagrams, a new one is used next */
+        av_buffer_unref(&s->rx_buf);
+    return 0;
+}
+
+/* Receive up to batch_size datagrams per system call directly into pooled
+ * buffers, the fifo only holds references to them. */
+static void *circular_buffer_task_rx_batch( void *_URLContext)
+{
+    URLContext *h = _URLContext;
+    UDPContext *s = h->priv_data;
+    int old_cancelstate, ret;
+
+    ff_thread_setname("udp-rx");
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
+    pthread_mutex_lock(&s->mutex);
+    if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
+        av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
+        s->circular_buffer_error = AVERROR(EIO);
+        goto end;
+    }
+    while(1) {
+        int nb_msgs;
+
+        if (!s->rx_buf) {
+            s->rx_buf = av_buffer_pool_get(s->rx_pool);
+            if (!s->rx_buf) {
+                s->circular_buffer_error = AVERROR(ENOMEM);
+                goto end;
+            }
+        }
+        for (int i = 0; i < s->batch_size; i++) {
+            struct iovec *iov = &s->rx_iov[2 * i];
+
+            iov[0].iov_base = s->rx_buf->data + i * s->rx_slot_size;
+            iov[0].iov_len  = s->rx_slot_size;
+            iov[1].iov_base = s->rx_overflow + i * (UDP_MAX_PKT_SIZE - s->rx_slot_size);
+            iov[1].iov_len  = UDP_MAX_PKT_SIZE - s->rx_slot_size;
+            s->rx_msgs[i].msg_hdr = (struct msghdr) {
+                .msg_name       = &s->rx_addrs[i],
+                .msg_namelen    = sizeof(s->rx_addrs[i]),
+                .msg_iov        = iov,
+                .msg_iovlen     = s->rx_overflow ? 2 : 1,
+                .msg_control    = s->timestamping ? s->rx_ctrl[i].buf : NULL,
+                .msg_controllen = s->timestamping ? sizeof(s->rx_ctrl[i].buf) : 0,
+            };
+        }
+
+        pthread_mutex_unlock(&s->mutex);
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+        nb_msgs = recvmmsg(s->udp_fd, s->rx_msgs, s->batch_size, MSG_WAITFORONE, NULL);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
+        pthread_mutex_lock(&s->mutex);
+        if (nb_msgs < 0) {
+            if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
+                s->circular_buffer_error = ff_neterrno();
+                goto end;
+            }
+            continue;
+        }
+
+        if ((ret = udp_rx_batch_settle(s, nb_msgs)) < 0) {
+            s->circular_buffer_error = ret;
+            goto end;
+        }
+
+        for (int i = 0; i < nb_msgs; i++) {
+            struct msghdr *msg = &s->rx_msgs[i].msg_hdr;
+            UDPDatagram *dg = &s->rx_dgs[i];
+
+            if (!dg->buf)
+                continue;
+            if (!av_fifo_can_write(s->fifo) ||
+                s->fifo_bytes + dg->charge > s->circular_buffer_size) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    av_buffer_unref(&dg->buf);
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    s->circular_buffer_error = AVERROR(EIO);
+                    goto end;
+                }
+            }
+
+            dg->timestamp = s->timestamping ? udp_get_rx_timestamp(msg) : 0;
+            av_fifo_write(s->fifo, dg, 1);
+            s->fifo_bytes += dg->charge;
+            dg->buf = NULL;
+        }
+        udp_rx_batch_unref(s);
+        pthread_cond_signal(&s->cond);
+    }
+
+end:
+    udp_rx_batch_unref(s);
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+    return NULL;
+}
+#endif
+
+#if HAVE_SENDMMSG
+/**
+ * Send nb_pkts datagrams stored back to back in buf, using a single
+ * segmentation offloaded send if possible and sendmmsg() otherwise.
+ */
+static int udp_send_batch(URLContext *h, const uint8_t *buf,
+                          const int *sizes, int nb_pkts)
+{
+    UDPContext *s = h->priv_data;
+    struct sockaddr *dest_addr = s->is_connected ? NULL : (struct sockaddr *)&s->dest_addr;
+    socklen_t dest_addr_len    = s->is_connected ? 0 : s->dest_addr_len;
+    int offset = 0, sent = 0;
+
+#ifdef UDP_SEGMENT
+    if (s->gso && nb_pkts > 1 && nb_pkts <= UDP_MAX_GSO_SEGMENTS) {
+        int total = 0, uniform = 1;
+
+        for (int i = 0; i < nb_pkts; i++) {
+            total += sizes[i];
+            if (i < nb_pkts - 1 ? sizes[i] != sizes[0] : sizes[i] > sizes[0])
+                uniform = 0;
+        }
+        if (uniform && total <= UDP_MAX_GSO_SIZE) {
+            union {
+                struct cmsghdr align;
+                char buf[CMSG_SPACE(sizeof(uint16_t))];
+            } ctrl = { 0 };
+            struct iovec iov = { .iov_base = (uint8_t *)buf, .iov_len = total };
+            struct msghdr msg = {
+                .msg_name       = dest_addr,
+                .msg_namelen    = dest_addr_len,
+                .msg_iov        = &iov,
+                .msg_iovlen     = 1,
+                .msg_control    = ctrl.buf,
+                .msg_controllen = sizeof(ctrl.buf),
+            };
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            uint16_t gso_size    = sizes[0];
+            int ret;
+
+            cmsg->cmsg_level = IPPROTO_UDP;
+            cmsg->cmsg_type  = UDP_SEGMENT;
+            cmsg->cmsg_len   = CMSG_LEN(sizeof(gso_size));
+            memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+
+            do {
+                ret = sendmsg(s->udp_fd, &msg, 0);
+            } while (ret < 0 && (ff_neterrno() == AVERROR(EAGAIN) ||
+                                 ff_neterrno() == AVERROR(EINTR)));
+            if (ret >= 0)
+                return 0;
+            ret = ff_neterrno();
+            if (ret != AVERROR(EIO) && ret != AVERROR(EINVAL) &&
+                ret != AVERROR(EOPNOTSUPP))
+                return ret;
+            av_log(h, AV_LOG_WARNING, "UDP segmentation offload not usable, "
+                   "falling back to sendmmsg()\n");
+            s->gso = 0;
+        }
+    }
+#endif
+
+    for (int i = 0; i < nb_pkts; i++) {
+        s->tx_iov[i].iov_base = (uint8_t *)buf + offset;
+        s->tx_iov[i].iov_len  = sizes[i];
+        s->tx_msgs[i].msg_hdr = (struct msghdr) {
+            .msg_name    = dest_addr,
+            .msg_namelen = dest_addr_len,
+            .msg_iov     = &s->tx_iov[i],
+            .msg_iovlen  = 1,
+        };
+        offset += sizes[i];
+    }
+
+    while (sent < nb_pkts) {
+        int ret = sendmmsg(s->udp_fd, s->tx_msgs + sent, nb_pkts - sent, 0);
+        if (ret >= 0) {
+            sent += ret;
+        } else {
+            ret = ff_neterrno();
+            if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR))
+                return ret;
+        }
+    }
+    return 0;
+}
+#endif
+
 static void *circular_buffer_task_tx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -569,6 +919,9 @@ static void *circular_buffer_task_tx( void *_URLContext)
         const uint8_t *p;
         uint8_t tmp[4];
         int64_t timestamp;
+#if HAVE_SENDMMSG
+        int nb_pkts = 0;
+#endif
 
         len = av_fifo_can_read(s->fifo);
 
@@ -579,13 +932,38 @@ static void *circular_buffer_task_tx( void *_URLContext)
             len = av_fifo_can_read(s->fifo);
         }
 
-        av_fifo_read(s->fifo, tmp, 4);
-        len = AV_RL32(tmp);
+#if HAVE_SENDMMSG
+        if (s->tx_buf) {
+            /* gather as many queued datagrams as fit into one batch */
+            len = 0;
+            do {
+                int size;
+
+                av_fifo_peek(s->fifo, tmp, 4, 0);
+                size = AV_RL32(tmp);
+                av_assert0(size >= 0);
+                av_assert0(size <= s->tx_buf_size);
+                if (len + size > s->tx_buf_size)
+                    break;
+
+                av_fifo_drain2(s->fifo, 4);
+                av_fifo_read(s->fifo, s->tx_buf + len, size);
+                s->tx_sizes[nb_pkts++] = size;
+                len += size;
+            } while (nb_pkts < s->batch_size && av_fifo_can_read(s->fifo) >= 4);
+            /* wake up udp_write() if it waits for free space */
+            pthread_cond_signal(&s->cond);
+        } else
+#endif
+        {
+            av_fifo_read(s->fifo, tmp, 4);
+            len = AV_RL32(tmp);
 
-        av_assert0(len >= 0);
-        av_assert0(len <= sizeof(s->tmp));
+            av_assert0(len >= 0);
+            av_assert0(len <= sizeof(s->tmp));
 
-        av_fifo_read(s->fifo, s->tmp, len);
+            av_fifo_read(s->fifo, s->tmp, len);
+        }
 
         pthread_mutex_unlock(&s->mutex);
 
@@ -609,26 +987,40 @@ static void *circular_buffer_task_tx( void *_URLContext)
             target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
         }
 
-        p = s->tmp;
-        while (len) {
-            int ret;
-            av_assert0(len > 0);
-            if (!s->is_connected) {
-                ret = sendto (s->udp_fd, p, len, 0,
-                            (struct sockaddr *) &s->dest_addr,
-                            s->dest_addr_len);
-            } else
-                ret = send(s->udp_fd, p, len, 0);
-            if (ret >= 0) {
-                len -= ret;
-                p   += ret;
-            } else {
-                ret = ff_neterrno();
-                if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR)) {
-                    pthread_mutex_lock(&s->mutex);
-                    s->circular_buffer_error = ret;
-                    pthread_mutex_unlock(&s->mutex);
-                    return NULL;
+#if HAVE_SENDMMSG
+        if (s->tx_buf) {
+            int ret = udp_send_batch(h, s->tx_buf, s->tx_sizes, nb_pkts);
+            if (ret < 0) {
+                pthread_mutex_lock(&s->mutex);
+                s->circular_buffer_error = ret;
+                pthread_cond_signal(&s->cond);
+                pthread_mutex_unlock(&s->mutex);
+                return NULL;
+            }
+        } else
+#endif
+        {
+            p = s->tmp;
+            while (len) {
+                int ret;
+                av_assert0(len > 0);
+                if (!s->is_connected) {
+                    ret = sendto (s->udp_fd, p, len, 0,
+                                (struct sockaddr *) &s->dest_addr,
+                                s->dest_addr_len);
+                } else
+                    ret = send(s->udp_fd, p, len, 0);
+                if (ret >= 0) {
+                    len -= ret;
+                    p   += ret;
+                } else {
+                    ret = ff_neterrno();
+                    if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR)) {
+                        pthread_mutex_lock(&s->mutex);
+                        s->circular_buffer_error = ret;
+                        pthread_mutex_unlock(&s->mutex);
+                        return NULL;
+                    }
                 }
             }
         }
@@ -644,6 +1036,80 @@ end:
 
 #endif
 
+#if HAVE_RECVMMSG
+static int udp_alloc_rx_batch(UDPContext *s)
+{
+    const int nb = s->batch_size;
+
+    /* pkt_size only sizes the slots, longer datagrams continue in
+     * rx_overflow so that nothing is truncated */
+    s->rx_slot_size = s->pkt_size > 0 ? FFMIN(s->pkt_size, UDP_MAX_PKT_SIZE)
+                                      : UDP_MAX_PKT_SIZE;
+
+    s->fifo     = av_fifo_alloc2(FFMAX(s->circular_buffer_size / 188, nb),
+                                 sizeof(UDPDatagram), 0);
+    s->rx_pool  = av_buffer_pool_init(nb * s->rx_slot_size, NULL);
+    s->rx_dgs   = av_calloc(nb, sizeof(*s->rx_dgs));
+    s->rx_msgs  = av_calloc(nb, sizeof(*s->rx_msgs));
+    s->rx_iov   = av_calloc(2 * nb, sizeof(*s->rx_iov));
+    s->rx_addrs = av_calloc(nb, sizeof(*s->rx_addrs));
+    s->rx_ctrl  = av_calloc(nb, sizeof(*s->rx_ctrl));
+    if (!s->fifo || !s->rx_pool || !s->rx_dgs || !s->rx_msgs || !s->rx_iov ||
+        !s->rx_addrs || !s->rx_ctrl)
+        return AVERROR(ENOMEM);
+    if (s->rx_slot_size < UDP_MAX_PKT_SIZE) {
+        s->rx_overflow = av_malloc(nb * (UDP_MAX_PKT_SIZE - s->rx_slot_size));
+        if (!s->rx_overflow)
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+#endif
+
+#if HAVE_SENDMMSG
+static int udp_alloc_tx_batch(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+    const int nb  = s->batch_size;
+
+    s->tx_buf_size = FFMAX(nb * FFMAX(h->max_packet_size, 0), sizeof(s->tmp));
+    s->tx_buf   = av_malloc(s->tx_buf_size);
+    s->tx_sizes = av_calloc(nb, sizeof(*s->tx_sizes));
+    s->tx_msgs  = av_calloc(nb, sizeof(*s->tx_msgs));
+    s->tx_iov   = av_calloc(nb, sizeof(*s->tx_iov));
+    if (!s->tx_buf || !s->tx_sizes || !s->tx_msgs || !s->tx_iov)
+        return AVERROR(ENOMEM);
+    return 0;
+}
+#endif
+
+static void udp_free_batch(UDPContext *s)
+{
+#if HAVE_RECVMMSG
+    if (s->rx_pool && s->fifo) {
+        UDPDatagram dg;
+        while (av_fifo_read(s->fifo, &dg, 1) >= 0)
+            av_buffer_unref(&dg.buf);
+    }
+    if (s->rx_dgs)
+        udp_rx_batch_unref(s);
+    av_buffer_unref(&s->rx_buf);
+    av_buffer_pool_uninit(&s->rx_pool);
+    av_freep(&s->rx_overflow);
+    av_freep(&s->rx_dgs);
+    av_freep(&s->rx_msgs);
+    av_freep(&s->rx_iov);
+    av_freep(&s->rx_addrs);
+    av_freep(&s->rx_ctrl);
+#endif
+#if HAVE_SENDMMSG
+    av_freep(&s->tx_buf);
+    av_freep(&s->tx_sizes);
+    av_freep(&s->tx_msgs);
+    av_freep(&s->tx_iov);
+#endif
+}
+
 /* put it in UDP context */
 /* return non zero if error */
 static int udp_open(URLContext *h, const char *uri, int flags)
@@ -753,7 +1219,29 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             s->timeout = strtol(buf, NULL, 10);
         if (is_output && av_find_info_tag(buf, sizeof(buf), "broadcast", p))
             s->is_broadcast = strtol(buf, NULL, 10);
+        if (av_find_info_tag(buf, sizeof(buf), "batch_size", p)) {
+            s->batch_size = strtol(buf, NULL, 10);
+            if (s->batch_size < 1 || s->batch_size > 1024) {
+                av_log(h, AV_LOG_ERROR, "batch_size(%d) should be in range [1,1024]\n", s->batch_size);
+                ret = AVERROR(EINVAL);
+                goto fail;
+            }
+        }
+        if (is_output && av_find_info_tag(buf, sizeof(buf), "gso", p))
+            s->gso = strtol(buf, NULL, 10);
+        if (!is_output && av_find_info_tag(buf, sizeof(buf), "timestamping", p))
+            s->timestamping = strtol(buf, NULL, 10);
     }
+    if (s->batch_size > 1 &&
+        (!HAVE_PTHREAD_CANCEL || !(is_output ? HAVE_SENDMMSG : HAVE_RECVMMSG)))
+        av_log(h, AV_LOG_WARNING,
+               "'batch_size' option was set but it is not supported "
+               "on this build (pthread and %s support is required)\n",
+               is_output ? "sendmmsg" : "recvmmsg");
+    if (!is_output && s->timestamping && (!HAVE_PTHREAD_CANCEL || !HAVE_RECVMMSG))
+        av_log(h, AV_LOG_WARNING,
+               "'timestamping' option was set but it is not supported "
+               "on this build (pthread and recvmmsg support is required)\n");
     /* handling needed to support options picking from both AVOption and URL */
     s->circular_buffer_size *= 188;
     if (flags & AVIO_FLAG_WRITE) {
@@ -906,6 +1394,16 @@ static int udp_open(URLContext *h, const char *uri, int flags)
                 av_log(h, AV_LOG_WARNING, "attempted to set receive buffer to size %d but it only ended up set as %d\n", s->buffer_size, tmp);
         }
 
+        if (s->timestamping) {
+#ifdef SO_TIMESTAMPNS
+            tmp = 1;
+            if (setsockopt(udp_fd, SOL_SOCKET, SO_TIMESTAMPNS, &tmp, sizeof(tmp)) < 0)
+                ff_log_net_error(h, AV_LOG_WARNING, "setsockopt(SO_TIMESTAMPNS)");
+#else
+            av_log(h, AV_LOG_WARNING, "Kernel timestamping is not supported on this platform\n");
+#endif
+        }
+
         /* make the socket non-blocking */
         ff_socket_nonblock(udp_fd, 1);
     }
@@ -923,7 +1421,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     /*
       Create thread in case of:
       1. Input and circular_buffer_size is set
-      2. Output and bitrate and circular_buffer_size is set
+      2. Output and bitrate or batch_size and circular_buffer_size is set
     */
 
     if (is_output && s->bitrate && !s->circular_buffer_size) {
@@ -931,13 +1429,31 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         av_log(h, AV_LOG_WARNING,"'bitrate' option was set but 'circular_buffer_size' is not, but required\n");
     }
 
-    if ((!is_output && s->circular_buffer_size) || (is_output && s->bitrate && s->circular_buffer_size)) {
+    if ((!is_output && s->circular_buffer_size) ||
+        (is_output && (s->bitrate || (HAVE_SENDMMSG && s->batch_size > 1)) && s->circular_buffer_size)) {
+        void *(*task)(void *) = is_output ? circular_buffer_task_tx : circular_buffer_task_rx;
+
         /* start the task going */
-        s->fifo = av_fifo_alloc2(s->circular_buffer_size, 1, 0);
-        if (!s->fifo) {
-            ret = AVERROR(ENOMEM);
-            goto fail;
+#if HAVE_RECVMMSG
+        if (!is_output && (s->batch_size > 1 || s->timestamping)) {
+            if ((ret = udp_alloc_rx_batch(s)) < 0)
+                goto fail;
+            task = circular_buffer_task_rx_batch;
+        } else
+#endif
+        {
+            s->fifo = av_fifo_alloc2(s->circular_buffer_size, 1, 0);
+            if (!s->fifo) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
         }
+#if HAVE_SENDMMSG
+        if (is_output && s->batch_size > 1) {
+            if ((ret = udp_alloc_tx_batch(h)) < 0)
+                goto fail;
+        }
+#endif
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -950,7 +1466,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             ret = AVERROR(ret);
             goto cond_fail;
         }
-        ret = pthread_create(&s->circular_buffer_thread, NULL, is_output?circular_buffer_task_tx:circular_buffer_task_rx, h);
+        ret = pthread_create(&s->circular_buffer_thread, NULL, task, h);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", strerror(ret));
             ret = AVERROR(ret);
@@ -970,6 +1486,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
  fail:
     if (udp_fd >= 0)
         closesocket(udp_fd);
+    udp_free_batch(s);
     av_fifo_freep2(&s->fifo);
     ff_ip_reset_filters(&s->filters);
     return ret;
@@ -998,6 +1515,26 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
         pthread_mutex_lock(&s->mutex);
         do {
             avail = av_fifo_can_read(s->fifo);
+#if HAVE_RECVMMSG
+            if (avail && s->rx_pool) {
+                UDPDatagram dg;
+
+                av_fifo_read(s->fifo, &dg, 1);
+                s->fifo_bytes -= dg.charge;
+                pthread_mutex_unlock(&s->mutex);
+
+                avail = dg.size;
+                if (avail > size) {
+                    av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
+                    avail = size;
+                }
+                memcpy(buf, dg.data, avail);
+                if (dg.timestamp)
+                    s->last_rx_timestamp = dg.timestamp;
+                av_buffer_unref(&dg.buf);
+                return avail;
+            } else
+#endif
             if (avail) { // >=size) {
                 uint8_t tmp[4];
 
@@ -1070,6 +1607,23 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
             return err;
         }
 
+#if HAVE_SENDMMSG
+        /* The batched tx thread drains the fifo as fast as the socket
+         * allows, wait for it to make room instead of failing. */
+        while (s->tx_buf && av_fifo_can_write(s->fifo) < size + 4 &&
+               size + 4 <= s->circular_buffer_size) {
+            if (h->flags & AVIO_FLAG_NONBLOCK) {
+                pthread_mutex_unlock(&s->mutex);
+                return AVERROR(EAGAIN);
+            }
+            pthread_cond_wait(&s->cond, &s->mutex);
+            if (s->circular_buffer_error < 0) {
+                int err = s->circular_buffer_error;
+                pthread_mutex_unlock(&s->mutex);
+                return err;
+            }
+        }
+#endif
         if (av_fifo_can_write(s->fifo) < size + 4) {
             /* What about a partial packet tx ? */
             pthread_mutex_unlock(&s->mutex);
@@ -1139,6 +1693,7 @@ static int udp_close(URLContext *h)
     }
 #endif
     closesocket(s->udp_fd);
+    udp_free_batch(s);
     av_fifo_freep2(&s->fifo);
     ff_ip_reset_filters(&s->filters);
     return 0;
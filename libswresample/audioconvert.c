@@ -194,6 +194,13 @@ void swri_audio_convert_free(AudioConvert **ctx)
 
 int swri_audio_convert(AudioConvert *ctx, AudioData *out, AudioData *in, int len)
 {
+    return swri_audio_convert_channels(ctx, out, in, len, 0, ctx->channels);
+}
+
+int swri_audio_convert_channels(AudioConvert *ctx, AudioData *out, AudioData *in, int len,
+                                int ch_start, int ch_end)
+{
+    const int all_channels = !ch_start && ch_end == ctx->channels;
     int ch;
     int off=0;
     const int os= (out->planar ? 1 :out->ch_count) *out->bps;
@@ -218,15 +225,17 @@ int swri_audio_convert(AudioConvert *ctx, AudioData *out, AudioData *in, int len
 
     //FIXME optimize common cases
 
-    if(ctx->simd_f && !ctx->ch_map && !misaligned){
+    /* the interleaved SIMD functions can only process all channels */
+    if(ctx->simd_f && !ctx->ch_map && !misaligned &&
+       (all_channels || (out->planar && in->planar))){
         off = len&~15;
         av_assert1(off>=0);
         av_assert1(off<=len);
         av_assert2(ctx->channels == SWR_CH_MAX || !in->ch[ctx->channels]);
         if(off>0){
             if(out->planar == in->planar){
-                int planes = out->planar ? out->ch_count : 1;
-                for(ch=0; ch<planes; ch++){
+                int planes = out->planar ? ch_end : 1;
+                for(ch=out->planar ? ch_start : 0; ch<planes; ch++){
                     ctx->simd_f(out->ch+ch, (const uint8_t **)in->ch+ch, off * (out->planar ? 1 :out->ch_count));
                 }
             }else{
@@ -237,7 +246,7 @@ int swri_audio_convert(AudioConvert *ctx, AudioData *out, AudioData *in, int len
             return 0;
     }
 
-    for(ch=0; ch<ctx->channels; ch++){
+    for(ch=ch_start; ch<ch_end; ch++){
         const int ich= ctx->ch_map ? ctx->ch_map[ch] : ch;
         const int is= ich < 0 ? 0 : (in->planar ? 1 : in->ch_count) * in->bps;
         const uint8_t *pi= ich < 0 ? ctx->silence : in->ch[ich];
@@ -74,4 +74,12 @@ void swri_audio_convert_free(AudioConvert **ctx);
  */
 int swri_audio_convert(AudioConvert *ctx, AudioData *out, AudioData *in, int len);
 
+/**
+ * Convert the output channels [ch_start, ch_end) between audio sample formats,
+ * otherwise identical to swri_audio_convert(). Ranges that do not cover all
+ * channels only use the SIMD code if both input and output are planar.
+ */
+int swri_audio_convert_channels(AudioConvert *ctx, AudioData *out, AudioData *in, int len,
+                                int ch_start, int ch_end);
+
 #endif /* SWRESAMPLE_AUDIOCONVERT_H */
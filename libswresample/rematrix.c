@@ -524,10 +524,12 @@ av_cold int swri_rematrix_init(SwrContext *s){
         if (maxsum <= 32768) {
             s->mix_1_1_f = (mix_1_1_func_type*)copy_s16;
             s->mix_2_1_f = (mix_2_1_func_type*)sum2_s16;
+            s->mix_sparse_f = (mix_sparse_func_type*)mix_sparse_s16;
             s->mix_any_f = (mix_any_func_type*)get_mix_any_func_s16(s);
         } else {
             s->mix_1_1_f = (mix_1_1_func_type*)copy_clip_s16;
             s->mix_2_1_f = (mix_2_1_func_type*)sum2_clip_s16;
+            s->mix_sparse_f = (mix_sparse_func_type*)mix_sparse_clip_s16;
             s->mix_any_f = (mix_any_func_type*)get_mix_any_func_clip_s16(s);
         }
     }else if(s->midbuf.fmt == AV_SAMPLE_FMT_FLTP){
@@ -541,6 +543,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
         *((float*)s->native_one) = 1.0;
         s->mix_1_1_f = (mix_1_1_func_type*)copy_float;
         s->mix_2_1_f = (mix_2_1_func_type*)sum2_float;
+        s->mix_sparse_f = (mix_sparse_func_type*)mix_sparse_float;
         s->mix_any_f = (mix_any_func_type*)get_mix_any_func_float(s);
     }else if(s->midbuf.fmt == AV_SAMPLE_FMT_DBLP){
         s->native_matrix = av_calloc(nb_in * nb_out, sizeof(double));
@@ -553,6 +556,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
         *((double*)s->native_one) = 1.0;
         s->mix_1_1_f = (mix_1_1_func_type*)copy_double;
         s->mix_2_1_f = (mix_2_1_func_type*)sum2_double;
+        s->mix_sparse_f = (mix_sparse_func_type*)mix_sparse_double;
         s->mix_any_f = (mix_any_func_type*)get_mix_any_func_double(s);
     }else if(s->midbuf.fmt == AV_SAMPLE_FMT_S32P){
         s->native_one    = av_mallocz(sizeof(int));
@@ -575,6 +579,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
         *((int*)s->native_one) = 32768;
         s->mix_1_1_f = (mix_1_1_func_type*)copy_s32;
         s->mix_2_1_f = (mix_2_1_func_type*)sum2_s32;
+        s->mix_sparse_f = (mix_sparse_func_type*)mix_sparse_s32;
         s->mix_any_f = (mix_any_func_type*)get_mix_any_func_s32(s);
     }else
         av_assert0(0);
@@ -589,6 +594,27 @@ av_cold int swri_rematrix_init(SwrContext *s){
         s->matrix_ch[i][0]= ch_in;
     }
 
+    /* the coefficients of the output channels with more than 2 inputs are
+     * packed so mix_sparse only touches the non zero ones */
+    s->native_sparse_stride = nb_in * (s->midbuf.fmt == AV_SAMPLE_FMT_DBLP ? sizeof(double) : sizeof(float));
+    s->native_sparse_matrix = av_calloc(nb_out, s->native_sparse_stride);
+    if (!s->native_sparse_matrix)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < nb_out; i++) {
+        uint8_t *row = s->native_sparse_matrix + i * s->native_sparse_stride;
+
+        for (j = 0; j < s->matrix_ch[i][0]; j++) {
+            int in_i = s->matrix_ch[i][1 + j];
+
+            if (s->midbuf.fmt == AV_SAMPLE_FMT_FLTP)
+                ((float  *)row)[j] = s->matrix_flt[i][in_i];
+            else if (s->midbuf.fmt == AV_SAMPLE_FMT_DBLP)
+                ((double *)row)[j] = s->matrix[i][in_i];
+            else
+                ((int    *)row)[j] = s->matrix32[i][in_i];
+        }
+    }
+
 #if ARCH_X86 && HAVE_X86ASM && HAVE_MMX
     return swri_rematrix_init_x86(s);
 #endif
@@ -601,27 +627,30 @@ av_cold void swri_rematrix_free(SwrContext *s){
     av_freep(&s->native_one);
     av_freep(&s->native_simd_matrix);
     av_freep(&s->native_simd_one);
+    av_freep(&s->native_sparse_matrix);
 }
 
-int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mustcopy){
-    int out_i, in_i, i, j;
+typedef struct RematrixJob {
+    SwrContext *s;
+    AudioData *out, *in;
+    int len, mustcopy;
+} RematrixJob;
+
+static void rematrix_channels(void *arg, int ch_start, int ch_end){
+    RematrixJob *job = arg;
+    SwrContext *s = job->s;
+    AudioData *out = job->out, *in = job->in;
+    int len = job->len, mustcopy = job->mustcopy;
+    int out_i, in_i, j;
     int len1 = 0;
     int off = 0;
 
-    if(s->mix_any_f) {
-        s->mix_any_f(out->ch, (const uint8_t **)in->ch, s->native_matrix, len);
-        return 0;
-    }
-
     if(s->mix_2_1_simd || s->mix_1_1_simd){
         len1= len&~15;
         off = len1 * out->bps;
     }
 
-    av_assert0(s->out_ch_layout.order == AV_CHANNEL_ORDER_UNSPEC || out->ch_count == s->out_ch_layout.nb_channels);
-    av_assert0(s-> in_ch_layout.order == AV_CHANNEL_ORDER_UNSPEC || in ->ch_count == s->in_ch_layout.nb_channels);
-
-    for(out_i=0; out_i<out->ch_count; out_i++){
+    for(out_i=ch_start; out_i<ch_end; out_i++){
         switch(s->matrix_ch[out_i][0]){
         case 0:
             if(mustcopy)
@@ -650,36 +679,40 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
             if(len != len1)
                 s->mix_2_1_f   (out->ch[out_i]+off, in->ch[in_i1]+off, in->ch[in_i2]+off, s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len-len1);
             break;}
-        default:
-            if(s->int_sample_fmt == AV_SAMPLE_FMT_FLTP){
-                for(i=0; i<len; i++){
-                    float v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((float*)in->ch[in_i])[i] * s->matrix_flt[out_i][in_i];
-                    }
-                    ((float*)out->ch[out_i])[i]= v;
-                }
-            }else if(s->int_sample_fmt == AV_SAMPLE_FMT_DBLP){
-                for(i=0; i<len; i++){
-                    double v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((double*)in->ch[in_i])[i] * s->matrix[out_i][in_i];
-                    }
-                    ((double*)out->ch[out_i])[i]= v;
-                }
-            }else{
-                for(i=0; i<len; i++){
-                    int v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((int16_t*)in->ch[in_i])[i] * s->matrix32[out_i][in_i];
-                    }
-                    ((int16_t*)out->ch[out_i])[i]= (v + 16384)>>15;
-                }
+        default: {
+            const uint8_t *src[SWR_CH_MAX];
+            const uint8_t *coeffs = s->native_sparse_matrix + out_i * s->native_sparse_stride;
+            int nb = s->matrix_ch[out_i][0];
+            int done = 0;
+
+            for(j=0; j<nb; j++)
+                src[j] = in->ch[s->matrix_ch[out_i][1+j]];
+            if(s->mix_sparse_simd && len1){
+                s->mix_sparse_simd(out->ch[out_i], (const void **)src, coeffs, nb, len1);
+                done = len1;
+            }
+            if(len != done){
+                for(j=0; j<nb; j++)
+                    src[j] += done * in->bps;
+                s->mix_sparse_f(out->ch[out_i] + done * out->bps, (const void **)src, coeffs, nb, len - done);
             }
+            break;}
         }
     }
+}
+
+int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mustcopy){
+    RematrixJob job = { s, out, in, len, mustcopy };
+
+    if(s->mix_any_f) {
+        s->mix_any_f(out->ch, (const uint8_t **)in->ch, s->native_matrix, len);
+        return 0;
+    }
+
+    av_assert0(s->out_ch_layout.order == AV_CHANNEL_ORDER_UNSPEC || out->ch_count == s->out_ch_layout.nb_channels);
+    av_assert0(s-> in_ch_layout.order == AV_CHANNEL_ORDER_UNSPEC || in ->ch_count == s->in_ch_layout.nb_channels);
+
+    swri_execute(s, rematrix_channels, &job, out->ch_count,
+                 (int64_t)FFMAX(in->ch_count, out->ch_count) * len);
     return 0;
 }
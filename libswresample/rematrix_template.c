@@ -67,6 +67,35 @@ static void RENAME(copy)(SAMPLE *out, const SAMPLE *in, COEFF *coeffp, integer i
         out[i] = R(coeff*in[i]);
 }
 
+/* in and coeffs list the nb inputs with a non zero coefficient, 4 samples are
+ * done per pass over them so the pointers and coefficients are loaded less
+ * often, the summation order is the same as for a single sample */
+static void RENAME(mix_sparse)(SAMPLE *out, const SAMPLE **in, const COEFF *coeffs, integer nb, integer len){
+    integer i, j;
+
+    for(i=0; i+3<len; i+=4){
+        INTER v0 = 0, v1 = 0, v2 = 0, v3 = 0;
+        for(j=0; j<nb; j++){
+            const SAMPLE *src = in[j] + i;
+            INTER coeff = coeffs[j];
+            v0 += src[0] * coeff;
+            v1 += src[1] * coeff;
+            v2 += src[2] * coeff;
+            v3 += src[3] * coeff;
+        }
+        out[i    ] = R(v0);
+        out[i + 1] = R(v1);
+        out[i + 2] = R(v2);
+        out[i + 3] = R(v3);
+    }
+    for(; i<len; i++){
+        INTER v = 0;
+        for(j=0; j<nb; j++)
+            v += in[j][i] * (INTER)coeffs[j];
+        out[i] = R(v);
+    }
+}
+
 static void RENAME(mix6to2)(SAMPLE **out, const SAMPLE **in, COEFF *coeffp, integer len){
     int i;
 
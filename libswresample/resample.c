@@ -28,8 +28,12 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/cpu.h"
+#include "libavutil/mathematics.h"
 #include "resample.h"
 
+/* largest phase count for which the schedule of an exact ratio is cached */
+#define MAX_PHASE_TABLE 4096
+
 static inline double eval_poly(const double *coeff, int size, double x) {
     double sum = coeff[size-1];
     int i;
@@ -282,6 +286,9 @@ static void resample_free(ResampleContext **cc){
     if(!c)
         return;
     av_freep(&c->filter_bank);
+    av_freep(&c->schedule);
+    av_freep(&c->phase_table);
+    av_freep(&c->phase_pos);
     av_freep(cc);
 }
 
@@ -424,6 +431,7 @@ static int rebuild_filter_bank_with_compensation(ResampleContext *c)
     c->dst_incr_mod   = c->dst_incr % c->src_incr;
     c->index         *= phase_count / c->phase_count;
     c->phase_count    = phase_count;
+    c->phase_table_incr = 0;
     av_freep(&c->filter_bank);
     c->filter_bank = new_filter_bank;
     return 0;
@@ -450,8 +458,226 @@ static int set_compensation(ResampleContext *c, int sample_delta, int compensati
     return 0;
 }
 
-static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
-    int i;
+/* With dst_incr_mod == 0, the phase and source position of the output
+ * samples repeat after phase_count / gcd(dst_incr_div, phase_count) of them,
+ * e.g. after 160 samples for 44.1 -> 48 kHz. Cache the schedule of one such
+ * period starting at phase 0, with an extra entry for the start of the next
+ * period, so it does not need to be computed again on every call. */
+static int build_phase_table(ResampleContext *c)
+{
+    int period = c->phase_count / av_gcd(c->dst_incr_div, c->phase_count);
+    int index = 0, sample_index = 0;
+
+    av_freep(&c->phase_table);
+    av_freep(&c->phase_pos);
+    c->phase_table_incr = 0;
+
+    c->phase_table = av_malloc_array(period + 1, 2 * sizeof(*c->phase_table));
+    c->phase_pos   = av_malloc_array(c->phase_count, sizeof(*c->phase_pos));
+    if (!c->phase_table || !c->phase_pos)
+        return AVERROR(ENOMEM);
+
+    memset(c->phase_pos, -1, c->phase_count * sizeof(*c->phase_pos));
+    for (int i = 0; i <= period; i++) {
+        if (i < period)
+            c->phase_pos[index] = i;
+        c->phase_table[2 * i    ] = index * c->filter_alloc;
+        c->phase_table[2 * i + 1] = sample_index;
+
+        index        += c->dst_incr_div;
+        sample_index += index / c->phase_count;
+        index        %= c->phase_count;
+    }
+    c->phase_period     = period;
+    c->phase_table_incr = c->dst_incr_div;
+
+    return 0;
+}
+
+/* same as the position update of resample_common(), for all samples at once */
+static int build_schedule(ResampleContext *c, int n, int *frac_end)
+{
+    int index = c->index;
+    int frac  = c->frac;
+    int sample_index = 0;
+
+    av_fast_malloc(&c->schedule, &c->schedule_size, (n + 1) * 2 * sizeof(*c->schedule));
+    if (!c->schedule)
+        return AVERROR(ENOMEM);
+
+    while (index >= c->phase_count) {
+        sample_index++;
+        index -= c->phase_count;
+    }
+
+    for (int i = 0; ; i++) {
+        c->schedule[2 * i    ] = index * c->filter_alloc;
+        c->schedule[2 * i + 1] = sample_index;
+        if (i == n)
+            break;
+
+        frac  += c->dst_incr_mod;
+        index += c->dst_incr_div;
+        if (frac >= c->src_incr) {
+            frac -= c->src_incr;
+            index++;
+        }
+
+        while (index >= c->phase_count) {
+            sample_index++;
+            index -= c->phase_count;
+        }
+    }
+    *frac_end = frac;
+
+    return 0;
+}
+
+typedef struct ResampleJob {
+    ResampleContext *c;
+    AudioData *dst;
+    const AudioData *src;
+    int n;
+    int64_t index2, incr;               ///< resample_one() position and increment
+    int (*resample_func)(struct ResampleContext *c, void *dst,
+                         const void *src, int n, int update_ctx);
+    const int32_t *tab;                 ///< resample_multi() schedule
+    int period, pos, base;
+} ResampleJob;
+
+static void resample_one_job(void *arg, int start, int end)
+{
+    ResampleJob *job = arg;
+    ResampleContext *c = job->c;
+
+    for (int ch = start; ch < end; ch++)
+        c->dsp.resample_one(job->dst->ch[ch], job->src->ch[ch], job->n, job->index2, job->incr);
+}
+
+static void resample_channels_job(void *arg, int start, int end)
+{
+    ResampleJob *job = arg;
+
+    for (int ch = start; ch < end; ch++)
+        job->resample_func(job->c, job->dst->ch[ch], job->src->ch[ch], job->n, 0);
+}
+
+/* the units are the groups of RESAMPLE_MULTI_CH channels followed by the
+ * remaining channels */
+static void resample_multi_job(void *arg, int start, int end)
+{
+    ResampleJob *job = arg;
+    ResampleContext *c = job->c;
+    const AudioData *src = job->src;
+    AudioData *dst = job->dst;
+    const int groups = dst->ch_count / RESAMPLE_MULTI_CH;
+
+    for (int unit = start; unit < end; unit++) {
+        int ch = unit * RESAMPLE_MULTI_CH;
+        int pos = job->pos, base = job->base;
+
+        if (unit >= groups) {
+            ch = groups * RESAMPLE_MULTI_CH + unit - groups;
+            c->dsp.resample_common(c, dst->ch[ch], src->ch[ch], job->n, 0);
+            continue;
+        }
+
+        for (int done = 0, len; done < job->n; done += len) {
+            uint8_t *d[RESAMPLE_MULTI_CH];
+            const uint8_t *s[RESAMPLE_MULTI_CH];
+
+            len = FFMIN(job->n - done, job->period - pos);
+
+            for (int i = 0; i < RESAMPLE_MULTI_CH; i++) {
+                d[i] = dst->ch[ch + i] + done * c->felem_size;
+                s[i] = src->ch[ch + i] + base * (ptrdiff_t)c->felem_size;
+            }
+            c->dsp.resample_multi(d, s, c->filter_bank, job->tab + 2 * pos,
+                                  c->filter_length, len);
+
+            pos += len;
+            if (pos == job->period) {
+                base += job->tab[2 * job->period + 1];
+                pos   = 0;
+            }
+        }
+    }
+}
+
+/* advance the position by n output samples like resample_common() and
+ * resample_linear() do with update_ctx set, returns the number of consumed
+ * input samples */
+static int advance_position(ResampleContext *c, int n)
+{
+    int64_t frac  = c->frac + n * (int64_t)c->dst_incr_mod;
+    int64_t index = c->index + n * (int64_t)c->dst_incr_div + frac / c->src_incr;
+
+    c->frac  = frac % c->src_incr;
+    c->index = index % c->phase_count;
+
+    return index / c->phase_count;
+}
+
+/* resample groups of RESAMPLE_MULTI_CH channels with dsp.resample_multi and
+ * the remaining ones one by one, returns the number of consumed samples */
+static int multi_channel_resample(SwrContext *s, ResampleContext *c, AudioData *dst,
+                                  const AudioData *src, int n)
+{
+    ResampleJob job = { .c = c, .dst = dst, .src = src, .n = n };
+    const int32_t *tab;
+    int index = c->index, frac = c->frac;
+    int base = 0, period, pos;
+    int ch, ret;
+
+    while (index >= c->phase_count) {
+        base++;
+        index -= c->phase_count;
+    }
+
+    if (!c->dst_incr_mod && c->dst_incr_div && c->phase_count <= MAX_PHASE_TABLE &&
+        (c->phase_table_incr == c->dst_incr_div || build_phase_table(c) >= 0) &&
+        c->phase_pos[index] >= 0) {
+        tab    = c->phase_table;
+        period = c->phase_period;
+        pos    = c->phase_pos[index];
+        base  -= tab[2 * pos + 1];
+    } else {
+        ret = build_schedule(c, n, &frac);
+        if (ret < 0) {
+            for (ch = 0; ch < dst->ch_count; ch++)
+                ret = c->dsp.resample_common(c, dst->ch[ch], src->ch[ch], n, ch + 1 == dst->ch_count);
+            return ret;
+        }
+        tab    = c->schedule;
+        period = n + 1;
+        pos    = base = 0;
+    }
+
+    job.tab    = tab;
+    job.period = period;
+    job.pos    = pos;
+    job.base   = base;
+    swri_execute(s, resample_multi_job, &job,
+                 dst->ch_count / RESAMPLE_MULTI_CH + dst->ch_count % RESAMPLE_MULTI_CH,
+                 (int64_t)dst->ch_count * n * c->filter_length);
+
+    for (int done = 0, len; done < n; done += len) {
+        len  = FFMIN(n - done, period - pos);
+        pos += len;
+        if (pos == period) {
+            base += tab[2 * period + 1];
+            pos   = 0;
+        }
+    }
+
+    c->index = tab[2 * pos] / c->filter_alloc;
+    c->frac  = frac;
+
+    return base + tab[2 * pos + 1];
+}
+
+static int multiple_resample(SwrContext *s, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
+    ResampleContext *c = s->resample;
     int64_t max_src_size = (INT64_MAX/2 / c->phase_count) / c->src_incr;
 
     if (c->compensation_distance)
@@ -467,17 +693,18 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
 
         dst_size = FFMAX(FFMIN(dst_size, new_size), 0);
         if (dst_size > 0) {
-            for (i = 0; i < dst->ch_count; i++) {
-                c->dsp.resample_one(dst->ch[i], src->ch[i], dst_size, index2, incr);
-                if (i+1 == dst->ch_count) {
-                    c->index += dst_size * c->dst_incr_div;
-                    c->index += (c->frac + dst_size * (int64_t)c->dst_incr_mod) / c->src_incr;
-                    av_assert2(c->index >= 0);
-                    *consumed = c->index;
-                    c->frac   = (c->frac + dst_size * (int64_t)c->dst_incr_mod) % c->src_incr;
-                    c->index = 0;
-                }
-            }
+            ResampleJob job = { .c = c, .dst = dst, .src = src, .n = dst_size,
+                                .index2 = index2, .incr = incr };
+
+            swri_execute(s, resample_one_job, &job, dst->ch_count,
+                         (int64_t)dst->ch_count * dst_size);
+
+            c->index += dst_size * c->dst_incr_div;
+            c->index += (c->frac + dst_size * (int64_t)c->dst_incr_mod) / c->src_incr;
+            av_assert2(c->index >= 0);
+            *consumed = c->index;
+            c->frac   = (c->frac + dst_size * (int64_t)c->dst_incr_mod) % c->src_incr;
+            c->index = 0;
         }
     } else {
         int64_t end_index = (1LL + src_size - c->filter_length) * c->phase_count;
@@ -492,8 +719,19 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
              * when frac and dst_incr_mod are zero */
             resample_func = (c->linear && (c->frac || c->dst_incr_mod)) ?
                             c->dsp.resample_linear : c->dsp.resample_common;
-            for (i = 0; i < dst->ch_count; i++)
-                *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            if (resample_func == c->dsp.resample_common && c->dsp.resample_multi &&
+                dst->ch_count >= RESAMPLE_MULTI_CH) {
+                *consumed = multi_channel_resample(s, c, dst, src, dst_size);
+            } else {
+                ResampleJob job = { .c = c, .dst = dst, .src = src, .n = dst_size,
+                                    .resample_func = resample_func };
+
+                /* the position is shared by all channels, so it is updated
+                 * once they are all done */
+                swri_execute(s, resample_channels_job, &job, dst->ch_count,
+                             (int64_t)dst->ch_count * dst_size * c->filter_length);
+                *consumed = advance_position(c, dst_size);
+            }
         }
     }
 
@@ -27,6 +27,9 @@
 
 #include "swresample_internal.h"
 
+/* number of channels processed by one resample_multi() call */
+#define RESAMPLE_MULTI_CH 4
+
 typedef struct ResampleContext {
     const AVClass *av_class;
     uint8_t *filter_bank;
@@ -50,6 +53,13 @@ typedef struct ResampleContext {
     int filter_shift;
     int phase_count_compensation;      /* desired phase_count when compensation is enabled */
 
+    int32_t *schedule;                 /* filter and source offset of each output sample */
+    unsigned int schedule_size;
+    int32_t *phase_table;              /* schedule of one period of an exact ratio */
+    int *phase_pos;                    /* position of each phase in phase_table, or -1 */
+    int phase_period;
+    int phase_table_incr;              /* dst_incr_div phase_table was built for */
+
     struct {
         void (*resample_one)(void *dst, const void *src,
                              int n, int64_t index, int64_t incr);
@@ -57,6 +67,16 @@ typedef struct ResampleContext {
                                const void *src, int n, int update_ctx);
         int (*resample_linear)(struct ResampleContext *c, void *dst,
                                const void *src, int n, int update_ctx);
+        /**
+         * Resample RESAMPLE_MULTI_CH channels at once, sharing the filter
+         * taps between them. Output sample i of each channel is the dot
+         * product of filter_length taps starting at filter_bank +
+         * schedule[2 * i] and the source samples starting at
+         * src[ch] + schedule[2 * i + 1], offsets being counted in samples.
+         */
+        void (*resample_multi)(uint8_t * const *dst, const uint8_t * const *src,
+                               const void *filter_bank, const int32_t *schedule,
+                               int filter_length, int n);
     } dsp;
 } ResampleContext;
 
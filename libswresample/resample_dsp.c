@@ -45,29 +45,42 @@
 
 void swri_resample_dsp_init(ResampleContext *c)
 {
+    int (*resample_common)(ResampleContext *c, void *dst,
+                           const void *src, int n, int update_ctx);
+    void (*resample_multi)(uint8_t * const *dst, const uint8_t * const *src,
+                           const void *filter_bank, const int32_t *schedule,
+                           int filter_length, int n);
+
     switch(c->format){
     case AV_SAMPLE_FMT_S16P:
         c->dsp.resample_one = resample_one_int16;
         c->dsp.resample_common = resample_common_int16;
         c->dsp.resample_linear = resample_linear_int16;
+        c->dsp.resample_multi = resample_multi_int16;
         break;
     case AV_SAMPLE_FMT_S32P:
         c->dsp.resample_one = resample_one_int32;
         c->dsp.resample_common = resample_common_int32;
         c->dsp.resample_linear = resample_linear_int32;
+        c->dsp.resample_multi = resample_multi_int32;
         break;
     case AV_SAMPLE_FMT_FLTP:
         c->dsp.resample_one = resample_one_float;
         c->dsp.resample_common = resample_common_float;
         c->dsp.resample_linear = resample_linear_float;
+        c->dsp.resample_multi = resample_multi_float;
         break;
     case AV_SAMPLE_FMT_DBLP:
         c->dsp.resample_one = resample_one_double;
         c->dsp.resample_common = resample_common_double;
         c->dsp.resample_linear = resample_linear_double;
+        c->dsp.resample_multi = resample_multi_double;
         break;
     }
 
+    resample_common = c->dsp.resample_common;
+    resample_multi  = c->dsp.resample_multi;
+
 #if ARCH_X86
     swri_resample_dsp_x86_init(c);
 #elif ARCH_ARM
@@ -75,4 +88,9 @@ void swri_resample_dsp_init(ResampleContext *c)
 #elif ARCH_AARCH64
     swri_resample_dsp_aarch64_init(c);
 #endif
+
+    /* the C multichannel code is not faster than SIMD single channel code */
+    if (c->dsp.resample_multi == resample_multi &&
+        c->dsp.resample_common != resample_common)
+        c->dsp.resample_multi = NULL;
 }
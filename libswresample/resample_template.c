@@ -200,6 +200,45 @@ static int RENAME(resample_linear)(ResampleContext *c,
     return sample_index;
 }
 
+static void RENAME(resample_multi)(uint8_t * const *dest, const uint8_t * const *source,
+                                   const void *filter_bank, const int32_t *schedule,
+                                   int filter_length, int n)
+{
+    int dst_index, ch, i;
+
+    for (dst_index = 0; dst_index < n; dst_index++) {
+        const FELEM *filter = (const FELEM *)filter_bank + schedule[2 * dst_index];
+        const int sample_index = schedule[2 * dst_index + 1];
+        FELEM2 val[RESAMPLE_MULTI_CH], val2[RESAMPLE_MULTI_CH];
+
+        for (ch = 0; ch < RESAMPLE_MULTI_CH; ch++) {
+            val[ch]  = FOFFSET;
+            val2[ch] = 0;
+        }
+        for (i = 0; i + 1 < filter_length; i += 2) {
+            for (ch = 0; ch < RESAMPLE_MULTI_CH; ch++) {
+                const DELEM *src = (const DELEM *)source[ch] + sample_index;
+                val[ch]  += src[i    ] * (FELEM2)filter[i    ];
+                val2[ch] += src[i + 1] * (FELEM2)filter[i + 1];
+            }
+        }
+        if (i < filter_length) {
+            for (ch = 0; ch < RESAMPLE_MULTI_CH; ch++) {
+                const DELEM *src = (const DELEM *)source[ch] + sample_index;
+                val[ch]  += src[i    ] * (FELEM2)filter[i    ];
+            }
+        }
+        for (ch = 0; ch < RESAMPLE_MULTI_CH; ch++) {
+            DELEM *dst = (DELEM *)dest[ch];
+#ifdef FELEML
+            OUT(dst[dst_index], val[ch] + (FELEML)val2[ch]);
+#else
+            OUT(dst[dst_index], val[ch] + val2[ch]);
+#endif
+        }
+    }
+}
+
 #undef RENAME
 #undef FILTER_SHIFT
 #undef DELEM
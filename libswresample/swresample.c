@@ -29,6 +29,11 @@
 
 #define ALIGN 32
 
+/* minimum work of a job, in processed samples weighted by their cost, to be
+ * worth splitting across threads, below that waking up the threads costs
+ * more than it saves */
+#define THREAD_MIN_WORK (1 << 14)
+
 int swr_set_channel_mapping(struct SwrContext *s, const int *channel_map){
     if(!s || s->in_convert) // s needs to be allocated but not initialized
         return AVERROR(EINVAL);
@@ -166,6 +171,8 @@ static void clear_context(SwrContext *s){
     swri_audio_convert_free(&s->out_convert);
     swri_audio_convert_free(&s->full_convert);
     swri_rematrix_free(s);
+    avpriv_slicethread_free(&s->slicethread);
+    s->thread_count = 0;
 
     s->delayed_samples_fixup = 0;
     s->flushed = 0;
@@ -190,6 +197,31 @@ av_cold void swr_close(SwrContext *s){
     clear_context(s);
 }
 
+static void thread_worker(void *priv, int jobnr, int threadnr,
+                          int nb_jobs, int nb_threads)
+{
+    SwrContext *s = priv;
+    int start = (int64_t)s->job_count *  jobnr      / nb_jobs;
+    int end   = (int64_t)s->job_count * (jobnr + 1) / nb_jobs;
+
+    s->job_func(s->job_arg, start, end);
+}
+
+void swri_execute(SwrContext *s, swri_job_func *func, void *arg, int count, int64_t work)
+{
+    int nb_jobs = FFMIN(s->thread_count, count);
+
+    if (nb_jobs <= 1 || work < THREAD_MIN_WORK) {
+        func(arg, 0, count);
+        return;
+    }
+
+    s->job_func  = func;
+    s->job_arg   = arg;
+    s->job_count = count;
+    avpriv_slicethread_execute(s->slicethread, nb_jobs, 0);
+}
+
 av_cold int swr_init(struct SwrContext *s){
     int ret;
     char l1[1024], l2[1024];
@@ -455,6 +487,20 @@ av_assert0(s->out.ch_count);
         return 0;
     }
 
+    if (s->nb_threads != 1 && FFMAX(s->used_ch_layout.nb_channels, s->out.ch_count) > 1) {
+        ret = avpriv_slicethread_create(&s->slicethread, s, thread_worker,
+                                        NULL, s->nb_threads);
+        if (ret == AVERROR(ENOSYS)) {
+            av_log(s, AV_LOG_WARNING, "Threads are not supported, using one thread\n");
+        } else if (ret < 0) {
+            goto fail;
+        } else if (ret > 1) {
+            s->thread_count = ret;
+        } else {
+            avpriv_slicethread_free(&s->slicethread);
+        }
+    }
+
     s->in_convert = swri_audio_convert_alloc(s->int_sample_fmt,
                                              s-> in_sample_fmt, s->used_ch_layout.nb_channels, s->channel_map, 0);
     s->out_convert= swri_audio_convert_alloc(s->out_sample_fmt,
@@ -628,7 +674,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
         int ret, size, consumed;
         if(!s->resample_in_constraint && s->in_buffer_count){
             buf_set(&tmp, &s->in_buffer, s->in_buffer_index);
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &tmp, s->in_buffer_count, &consumed);
+            ret= s->resampler->multiple_resample(s, &out, out_count, &tmp, s->in_buffer_count, &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
@@ -648,7 +694,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
 
         if((s->flushed || in_count > padless) && !s->in_buffer_count){
             s->in_buffer_index=0;
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &in, FFMAX(in_count-padless, 0), &consumed);
+            ret= s->resampler->multiple_resample(s, &out, out_count, &in, FFMAX(in_count-padless, 0), &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
@@ -693,6 +739,68 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
     return ret_sum;
 }
 
+typedef struct ConvertJob {
+    struct AudioConvert *ctx;
+    AudioData *out, *in;
+    int len;
+} ConvertJob;
+
+static void convert_job(void *arg, int start, int end)
+{
+    ConvertJob *job = arg;
+    swri_audio_convert_channels(job->ctx, job->out, job->in, job->len, start, end);
+}
+
+static void convert(SwrContext *s, struct AudioConvert *ctx, AudioData *out, AudioData *in, int len)
+{
+    /* packed data is converted by the SIMD code for all channels at once,
+     * splitting it by channel would lose that */
+    if (out->planar && in->planar) {
+        ConvertJob job = { ctx, out, in, len };
+        swri_execute(s, convert_job, &job, out->ch_count, (int64_t)out->ch_count * len);
+    } else
+        swri_audio_convert(ctx, out, in, len);
+}
+
+typedef struct DitherJob {
+    SwrContext *s;
+    AudioData *dst, *src;
+    int count;
+} DitherJob;
+
+static void dither_job(void *arg, int start, int end)
+{
+    DitherJob *job = arg;
+    SwrContext *s = job->s;
+    AudioData *conv_src = job->dst, *preout = job->src;
+    int out_count = job->count;
+    int ch;
+
+    if (s->dither.method < SWR_DITHER_NS){
+        if (s->mix_2_1_simd) {
+            int len1= out_count&~15;
+            int off = len1 * preout->bps;
+
+            if(len1)
+                for(ch=start; ch<end; ch++)
+                    s->mix_2_1_simd(conv_src->ch[ch], preout->ch[ch], s->dither.noise.ch[ch] + s->dither.noise.bps * s->dither.noise_pos, s->native_simd_one, 0, 0, len1);
+            if(out_count != len1)
+                for(ch=start; ch<end; ch++)
+                    s->mix_2_1_f(conv_src->ch[ch] + off, preout->ch[ch] + off, s->dither.noise.ch[ch] + s->dither.noise.bps * s->dither.noise_pos + off, s->native_one, 0, 0, out_count - len1);
+        } else {
+            for(ch=start; ch<end; ch++)
+                s->mix_2_1_f(conv_src->ch[ch], preout->ch[ch], s->dither.noise.ch[ch] + s->dither.noise.bps * s->dither.noise_pos, s->native_one, 0, 0, out_count);
+        }
+    } else {
+        switch(s->int_sample_fmt) {
+        case AV_SAMPLE_FMT_S16P :swri_noise_shaping_int16(s, conv_src, preout, &s->dither.noise, out_count, start, end); break;
+        case AV_SAMPLE_FMT_S32P :swri_noise_shaping_int32(s, conv_src, preout, &s->dither.noise, out_count, start, end); break;
+        case AV_SAMPLE_FMT_FLTP :swri_noise_shaping_float(s, conv_src, preout, &s->dither.noise, out_count, start, end); break;
+        case AV_SAMPLE_FMT_DBLP :swri_noise_shaping_double(s,conv_src, preout, &s->dither.noise, out_count, start, end); break;
+        }
+    }
+}
+
 static int swr_convert_internal(struct SwrContext *s, AudioData *out, int out_count,
                                                       AudioData *in , int  in_count){
     AudioData *postin, *midbuf, *preout;
@@ -752,7 +860,7 @@ static int swr_convert_internal(struct SwrContext *s, AudioData *out, int out_co
     }
 
     if(in != postin){
-        swri_audio_convert(s->in_convert, postin, in, in_count);
+        convert(s, s->in_convert, postin, in, in_count);
     }
 
     if(s->resample_first){
@@ -792,33 +900,16 @@ static int swr_convert_internal(struct SwrContext *s, AudioData *out, int out_co
             if(s->dither.noise_pos + out_count > s->dither.noise.count)
                 s->dither.noise_pos = 0;
 
-            if (s->dither.method < SWR_DITHER_NS){
-                if (s->mix_2_1_simd) {
-                    int len1= out_count&~15;
-                    int off = len1 * preout->bps;
-
-                    if(len1)
-                        for(ch=0; ch<preout->ch_count; ch++)
-                            s->mix_2_1_simd(conv_src->ch[ch], preout->ch[ch], s->dither.noise.ch[ch] + s->dither.noise.bps * s->dither.noise_pos, s->native_simd_one, 0, 0, len1);
-                    if(out_count != len1)
-                        for(ch=0; ch<preout->ch_count; ch++)
-                            s->mix_2_1_f(conv_src->ch[ch] + off, preout->ch[ch] + off, s->dither.noise.ch[ch] + s->dither.noise.bps * s->dither.noise_pos + off, s->native_one, 0, 0, out_count - len1);
-                } else {
-                    for(ch=0; ch<preout->ch_count; ch++)
-                        s->mix_2_1_f(conv_src->ch[ch], preout->ch[ch], s->dither.noise.ch[ch] + s->dither.noise.bps * s->dither.noise_pos, s->native_one, 0, 0, out_count);
-                }
-            } else {
-                switch(s->int_sample_fmt) {
-                case AV_SAMPLE_FMT_S16P :swri_noise_shaping_int16(s, conv_src, preout, &s->dither.noise, out_count); break;
-                case AV_SAMPLE_FMT_S32P :swri_noise_shaping_int32(s, conv_src, preout, &s->dither.noise, out_count); break;
-                case AV_SAMPLE_FMT_FLTP :swri_noise_shaping_float(s, conv_src, preout, &s->dither.noise, out_count); break;
-                case AV_SAMPLE_FMT_DBLP :swri_noise_shaping_double(s,conv_src, preout, &s->dither.noise, out_count); break;
-                }
+            {
+                DitherJob job = { s, conv_src, preout, out_count };
+                swri_execute(s, dither_job, &job, preout->ch_count, (int64_t)preout->ch_count * out_count);
             }
+            if (s->dither.method >= SWR_DITHER_NS)
+                s->dither.ns_pos = (s->dither.ns_pos + s->dither.ns_taps - out_count % s->dither.ns_taps) % s->dither.ns_taps;
             s->dither.noise_pos += out_count;
         }
 //FIXME packed doesn't need more than 1 chan here!
-        swri_audio_convert(s->out_convert, out, conv_src, out_count);
+        convert(s, s->out_convert, out, conv_src, out_count);
     }
     return out_count;
 }
@@ -23,6 +23,7 @@
 
 #include "swresample.h"
 #include "libavutil/channel_layout.h"
+#include "libavutil/slicethread.h"
 #include "config.h"
 
 #define SWR_CH_MAX 64
@@ -40,8 +41,15 @@ typedef int integer;
 typedef void (mix_1_1_func_type)(void *out, const void *in, void *coeffp, integer index, integer len);
 typedef void (mix_2_1_func_type)(void *out, const void *in1, const void *in2, void *coeffp, integer index1, integer index2, integer len);
 
+/**
+ * Process the units [start, end) of a job split by swri_execute().
+ */
+typedef void (swri_job_func)(void *arg, int start, int end);
+
 typedef void (mix_any_func_type)(uint8_t **out, const uint8_t **in1, void *coeffp, integer len);
 
+typedef void (mix_sparse_func_type)(void *out, const void **in, const void *coeffs, integer nb, integer len);
+
 typedef struct AudioData{
     uint8_t *ch[SWR_CH_MAX];    ///< samples buffer per channel
     uint8_t *data;              ///< samples buffer
@@ -71,7 +79,7 @@ struct DitherContext {
 typedef struct ResampleContext * (* resample_init_func)(struct ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff, enum AVSampleFormat format, enum SwrFilterType filter_type, double kaiser_beta, double precision, int cheby, int exact_rational);
 typedef void    (* resample_free_func)(struct ResampleContext **c);
-typedef int     (* multiple_resample_func)(struct ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
+typedef int     (* multiple_resample_func)(struct SwrContext *s, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
 typedef int     (* resample_flush_func)(struct SwrContext *c);
 typedef int     (* set_compensation_func)(struct ResampleContext *c, int sample_delta, int compensation_distance);
 typedef int64_t (* get_delay_func)(struct SwrContext *s, int64_t base);
@@ -189,16 +197,41 @@ struct SwrContext {
 
     mix_any_func_type *mix_any_f;
 
+    uint8_t *native_sparse_matrix;                  ///< per output channel, the non zero coefficients in matrix_ch order
+    int native_sparse_stride;                       ///< size in bytes of a native_sparse_matrix row
+    mix_sparse_func_type *mix_sparse_f;
+    mix_sparse_func_type *mix_sparse_simd;
+
+    int nb_threads;                                 ///< user set number of threads, 0 for automatic
+    int thread_count;                               ///< number of threads actually used, 0 without thread pool
+    AVSliceThread *slicethread;                     ///< thread pool running the per channel jobs
+    swri_job_func *job_func;                        ///< job of the current swri_execute() call
+    void *job_arg;
+    int job_count;
+
     /* TODO: callbacks for ASM optimizations */
 };
 
 av_warn_unused_result
 int swri_realloc_audio(AudioData *a, int count);
 
-void swri_noise_shaping_int16 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
-void swri_noise_shaping_int32 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
-void swri_noise_shaping_float (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
-void swri_noise_shaping_double(SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
+/**
+ * Run func over count independent units, typically channels, split into
+ * contiguous ranges across the threads of s. The job runs on the calling
+ * thread if there is no thread pool or if work, the total number of samples
+ * processed weighted by their cost, is too small to amortize waking up the
+ * threads.
+ */
+void swri_execute(SwrContext *s, swri_job_func *func, void *arg, int count, int64_t work);
+
+void swri_noise_shaping_int16 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count,
+                                int ch_start, int ch_end);
+void swri_noise_shaping_int32 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count,
+                                int ch_start, int ch_end);
+void swri_noise_shaping_float (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count,
+                                int ch_start, int ch_end);
+void swri_noise_shaping_double(SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count,
+                                int ch_start, int ch_end);
 
 av_warn_unused_result
 int swri_rematrix_init(SwrContext *s);
@@ -0,0 +1,191 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the throughput of swr_convert() for planar multichannel audio,
+ * in millions of input samples (summed over all channels) per second, with
+ * one thread and with the given number of threads (default: one per CPU).
+ *
+ * usage: resample_bench [seconds [cpuflags [threads]]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/cpu.h"
+#include "libavutil/error.h"
+#include "libavutil/lfg.h"
+#include "libavutil/log.h"
+#include "libavutil/macros.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
+
+#include "libswresample/swresample.h"
+
+#define NB_SAMPLES 4096
+
+static const struct {
+    enum AVSampleFormat fmt;
+    int channels, in_rate, out_rate;
+    int out_channels;               ///< downmix to this many channels if set
+} tests[] = {
+    { AV_SAMPLE_FMT_FLTP,  2, 44100, 48000 },
+    { AV_SAMPLE_FMT_FLTP,  8, 44100, 48000 },
+    { AV_SAMPLE_FMT_FLTP, 16, 44100, 48000 },
+    { AV_SAMPLE_FMT_FLTP, 32, 44100, 48000 },
+    { AV_SAMPLE_FMT_FLTP, 64, 44100, 48000 },
+    { AV_SAMPLE_FMT_FLTP, 16, 48000, 44100 },
+    { AV_SAMPLE_FMT_FLTP, 16, 48000, 96000 },
+    { AV_SAMPLE_FMT_FLTP, 16, 44100, 47999 },
+    { AV_SAMPLE_FMT_S16P, 16, 44100, 48000 },
+    { AV_SAMPLE_FMT_FLTP, 64, 48000, 48000, 16 },
+    { AV_SAMPLE_FMT_FLTP, 64, 44100, 48000, 16 },
+    { AV_SAMPLE_FMT_FLTP, 64, 44100, 48000,  2 },
+    { AV_SAMPLE_FMT_S16P, 64, 44100, 48000, 16 },
+};
+
+/* mix the input channel i into the output channel i % out_channels */
+static int set_downmix_matrix(SwrContext *swr, int in_channels, int out_channels)
+{
+    double *matrix = av_calloc(in_channels * out_channels, sizeof(*matrix));
+    int ret;
+
+    if (!matrix)
+        return AVERROR(ENOMEM);
+    for (int i = 0; i < in_channels; i++)
+        matrix[i % out_channels * in_channels + i] = (double)out_channels / in_channels;
+    ret = swr_set_matrix(swr, matrix, in_channels);
+    av_free(matrix);
+
+    return ret;
+}
+
+static int run(int idx, int threads, double seconds, double *msps)
+{
+    const int channels = tests[idx].channels;
+    const int out_channels = tests[idx].out_channels ? tests[idx].out_channels : channels;
+    const enum AVSampleFormat fmt = tests[idx].fmt;
+    SwrContext *swr = NULL;
+    AVChannelLayout layout, out_layout;
+    uint8_t **src = NULL, **dst = NULL;
+    int dst_samples = av_rescale_rnd(NB_SAMPLES, tests[idx].out_rate,
+                                     tests[idx].in_rate, AV_ROUND_UP) + 64;
+    int64_t t0, elapsed, samples = 0;
+    AVLFG lfg;
+    int ret;
+
+    av_channel_layout_default(&layout, channels);
+    av_channel_layout_default(&out_layout, out_channels);
+
+    ret = swr_alloc_set_opts2(&swr, &out_layout, fmt, tests[idx].out_rate,
+                              &layout, fmt, tests[idx].in_rate, 0, NULL);
+    if (ret < 0)
+        goto end;
+    if ((ret = av_opt_set_int(swr, "threads", threads, 0)) < 0)
+        goto end;
+    if (out_channels != channels &&
+        (ret = set_downmix_matrix(swr, channels, out_channels)) < 0)
+        goto end;
+    if ((ret = swr_init(swr)) < 0)
+        goto end;
+
+    if ((ret = av_samples_alloc_array_and_samples(&src, NULL, channels, NB_SAMPLES, fmt, 0)) < 0 ||
+        (ret = av_samples_alloc_array_and_samples(&dst, NULL, out_channels, dst_samples, fmt, 0)) < 0)
+        goto end;
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+    for (int ch = 0; ch < channels; ch++) {
+        for (int i = 0; i < NB_SAMPLES; i++) {
+            int v = (int)av_lfg_get(&lfg) >> 18;
+            if (fmt == AV_SAMPLE_FMT_FLTP)
+                ((float *)src[ch])[i] = v / 16384.0f;
+            else
+                ((int16_t *)src[ch])[i] = v;
+        }
+    }
+
+    t0 = av_gettime_relative();
+    do {
+        ret = swr_convert(swr, dst, dst_samples, (const uint8_t **)src, NB_SAMPLES);
+        if (ret < 0)
+            goto end;
+        samples += NB_SAMPLES * channels;
+        elapsed = av_gettime_relative() - t0;
+    } while (elapsed < seconds * 1000000);
+
+    *msps = (double)samples / FFMAX(elapsed, 1);
+    ret   = 0;
+end:
+    swr_free(&swr);
+    if (src)
+        av_freep(&src[0]);
+    av_freep(&src);
+    if (dst)
+        av_freep(&dst[0]);
+    av_freep(&dst);
+    av_channel_layout_uninit(&layout);
+    av_channel_layout_uninit(&out_layout);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    int threads = argc > 3 ? atoi(argv[3]) : av_cpu_count();
+
+    if (seconds <= 0 || threads <= 0) {
+        fprintf(stderr, "usage: %s [seconds [cpuflags [threads]]]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 2 && *argv[2]) {
+        unsigned flags = av_get_cpu_flags();
+        if (av_parse_cpu_caps(&flags, argv[2]) < 0) {
+            fprintf(stderr, "Invalid cpu flags: %s\n", argv[2]);
+            return 1;
+        }
+        av_force_cpu_flags(flags);
+    }
+
+    av_log_set_level(AV_LOG_WARNING);
+
+    printf("%-40s %10s %7s %10s %8s\n", "conversion", "MSmp/s", "threads", "MSmp/s", "speedup");
+    for (int i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        char name[64];
+        double msps1, msps;
+        int ret;
+
+        snprintf(name, sizeof(name), "%s %dch %d -> ", av_get_sample_fmt_name(tests[i].fmt),
+                 tests[i].channels, tests[i].in_rate);
+        if (tests[i].out_channels)
+            av_strlcatf(name, sizeof(name), "%dch ", tests[i].out_channels);
+        av_strlcatf(name, sizeof(name), "%d", tests[i].out_rate);
+
+        if ((ret = run(i, 1, seconds, &msps1)) < 0 ||
+            (ret = run(i, threads, seconds, &msps)) < 0) {
+            fprintf(stderr, "%s failed: %s\n", name, av_err2str(ret));
+            return 1;
+        }
+        printf("%-40s %10.1f %7d %10.1f %7.2fx\n", name, msps1, threads, msps, msps / msps1);
+    }
+
+    return 0;
+}
@@ -223,12 +223,49 @@ mix_2_1_int16_u_int %+ SUFFIX:
 %endmacro
 
 
+%if ARCH_X86_64
+; void mix_sparse_float(float *out, const float **in, const float *coeffs,
+;                       integer nb, integer len)
+; out = sum of in[k] * coeffs[k] over the nb inputs, in this order
+%macro MIX_SPARSE_FLT 0
+cglobal mix_sparse_float, 5, 8, 5, out, in, coeffs, nb, len, pos, k, src
+    shl lenq    , 2
+    xor posq    , posq
+.next:
+    xorps        m0, m0, m0
+    xorps        m1, m1, m1
+    xor          kq, kq
+.tap:
+    mov        srcq, [inq + kq*gprsize]
+    VBROADCASTSS m4, [coeffsq + kq*4]
+    movu         m2, [srcq + posq         ]
+    movu         m3, [srcq + posq + mmsize]
+    mulps        m2, m2, m4
+    mulps        m3, m3, m4
+    addps        m0, m0, m2
+    addps        m1, m1, m3
+    add          kq, 1
+    cmp          kq, nbq
+        jl .tap
+    movu  [outq + posq         ], m0
+    movu  [outq + posq + mmsize], m1
+    add        posq, mmsize*2
+    cmp        posq, lenq
+        jl .next
+    RET
+%endmacro
+%endif
+
 INIT_XMM sse
 MIX2_FLT u
 MIX2_FLT a
 MIX1_FLT u
 MIX1_FLT a
 
+%if ARCH_X86_64
+MIX_SPARSE_FLT
+%endif
+
 INIT_XMM sse2
 MIX1_INT16 u
 MIX1_INT16 a
@@ -241,4 +278,7 @@ MIX2_FLT u
 MIX2_FLT a
 MIX1_FLT u
 MIX1_FLT a
+%if ARCH_X86_64
+MIX_SPARSE_FLT
+%endif
 %endif
@@ -30,6 +30,9 @@ D(float, sse)
 D(float, avx)
 D(int16, sse2)
 
+mix_sparse_func_type ff_mix_sparse_float_sse;
+mix_sparse_func_type ff_mix_sparse_float_avx;
+
 av_cold int swri_rematrix_init_x86(struct SwrContext *s){
 #if HAVE_X86ASM
     int mm_flags = av_get_cpu_flags();
@@ -40,6 +43,7 @@ av_cold int swri_rematrix_init_x86(struct SwrContext *s){
 
     s->mix_1_1_simd = NULL;
     s->mix_2_1_simd = NULL;
+    s->mix_sparse_simd = NULL;
 
     if (s->midbuf.fmt == AV_SAMPLE_FMT_S16P){
         if(EXTERNAL_SSE2(mm_flags)) {
@@ -68,10 +72,16 @@ av_cold int swri_rematrix_init_x86(struct SwrContext *s){
         if(EXTERNAL_SSE(mm_flags)) {
             s->mix_1_1_simd = ff_mix_1_1_a_float_sse;
             s->mix_2_1_simd = ff_mix_2_1_a_float_sse;
+#if ARCH_X86_64
+            s->mix_sparse_simd = ff_mix_sparse_float_sse;
+#endif
         }
         if(EXTERNAL_AVX_FAST(mm_flags)) {
             s->mix_1_1_simd = ff_mix_1_1_a_float_avx;
             s->mix_2_1_simd = ff_mix_2_1_a_float_avx;
+#if ARCH_X86_64
+            s->mix_sparse_simd = ff_mix_sparse_float_avx;
+#endif
         }
         s->native_simd_matrix = av_calloc(num, sizeof(float));
         s->native_simd_one = av_mallocz(sizeof(float));
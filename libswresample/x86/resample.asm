@@ -612,3 +612,110 @@ RESAMPLE_FNS double, 8, 3, d, pdbl_1
 INIT_YMM fma3
 RESAMPLE_FNS double, 8, 3, d, pdbl_1
 %endif
+
+%if ARCH_X86_64
+; void resample_multi_float(float *const *dst, const float *const *src,
+;                           const float *filter_bank, const int32_t *schedule,
+;                           int filter_length, int n)
+; processes 4 channels, each filter tap is loaded once for all of them
+%macro RESAMPLE_MULTI_FLOAT 0
+cglobal resample_multi_float, 6, 14, 5, dst, src, filter_bank, schedule, len, n, \
+                                        src0, src1, src2, src3, filter, count, \
+                                        dst_idx, tmp
+    ; the filters are zero-padded to a multiple of 8 taps
+    add                        lend, 7
+    and                        lend, ~7
+    shl                        lend, 2
+    xor                    dst_idxd, dst_idxd
+
+.loop:
+    movsxd                     tmpq, dword [scheduleq+4]
+    movsxd                  filterq, dword [scheduleq]
+    lea                        tmpq, [lenq+tmpq*4]
+    lea                     filterq, [filter_bankq+filterq*4]
+    mov                       src0q, [srcq+0*gprsize]
+    mov                       src1q, [srcq+1*gprsize]
+    mov                       src2q, [srcq+2*gprsize]
+    mov                       src3q, [srcq+3*gprsize]
+    add                     filterq, lenq
+    add                       src0q, tmpq
+    add                       src1q, tmpq
+    add                       src2q, tmpq
+    add                       src3q, tmpq
+    mov                      countq, lenq
+    neg                      countq
+    xorps                        m0, m0, m0
+    xorps                        m1, m1, m1
+    xorps                        m2, m2, m2
+    xorps                        m3, m3, m3
+%if mmsize == 64
+    ; odd number of 8-tap blocks, do the first one with ymm
+    test                       lend, 32
+    jz .inner_loop
+    movu                        ym4, [filterq+countq]
+    fmaddps                     ym0, ym4, [src0q+countq], ym0
+    fmaddps                     ym1, ym4, [src1q+countq], ym1
+    fmaddps                     ym2, ym4, [src2q+countq], ym2
+    fmaddps                     ym3, ym4, [src3q+countq], ym3
+    add                      countq, 32
+    jz .sum
+%endif
+
+    align 16
+.inner_loop:
+    movu                         m4, [filterq+countq]
+    fmaddps                      m0, m4, [src0q+countq], m0
+    fmaddps                      m1, m4, [src1q+countq], m1
+    fmaddps                      m2, m4, [src2q+countq], m2
+    fmaddps                      m3, m4, [src3q+countq], m3
+    add                      countq, mmsize
+    js .inner_loop
+
+.sum:
+%if mmsize == 64
+    vextractf32x8               ym4, m0, 1
+    addps                       ym0, ym4
+    vextractf32x8               ym4, m1, 1
+    addps                       ym1, ym4
+    vextractf32x8               ym4, m2, 1
+    addps                       ym2, ym4
+    vextractf32x8               ym4, m3, 1
+    addps                       ym3, ym4
+%endif
+    vextractf128                xm4, ym0, 1
+    addps                       xm0, xm4
+    vextractf128                xm4, ym1, 1
+    addps                       xm1, xm4
+    vextractf128                xm4, ym2, 1
+    addps                       xm2, xm4
+    vextractf128                xm4, ym3, 1
+    addps                       xm3, xm4
+    haddps                      xm0, xm1
+    haddps                      xm2, xm3
+    haddps                      xm0, xm2
+
+    mov                        tmpq, [dstq+0*gprsize]
+    movss       [tmpq+dst_idxq*4], xm0
+    mov                        tmpq, [dstq+1*gprsize]
+    extractps   [tmpq+dst_idxq*4], xm0, 1
+    mov                        tmpq, [dstq+2*gprsize]
+    extractps   [tmpq+dst_idxq*4], xm0, 2
+    mov                        tmpq, [dstq+3*gprsize]
+    extractps   [tmpq+dst_idxq*4], xm0, 3
+
+    add                   scheduleq, 8
+    inc                    dst_idxd
+    cmp                    dst_idxd, nd
+    jl .loop
+    RET
+%endmacro
+
+%if HAVE_FMA3_EXTERNAL
+INIT_YMM fma3
+RESAMPLE_MULTI_FLOAT
+%endif
+%if HAVE_AVX512_EXTERNAL
+INIT_ZMM avx512
+RESAMPLE_MULTI_FLOAT
+%endif
+%endif ; ARCH_X86_64
@@ -35,6 +35,11 @@ int ff_resample_common_##type##_##opt(ResampleContext *c, void *dst, \
 int ff_resample_linear_##type##_##opt(ResampleContext *c, void *dst, \
                                       const void *src, int sz, int upd)
 
+#define RESAMPLE_MULTI_FUNC(type, opt) \
+void ff_resample_multi_##type##_##opt(uint8_t * const *dst, const uint8_t * const *src, \
+                                     const void *filter_bank, const int32_t *schedule, \
+                                     int filter_length, int n)
+
 RESAMPLE_FUNCS(int16,  sse2);
 RESAMPLE_FUNCS(int16,  xop);
 RESAMPLE_FUNCS(float,  sse);
@@ -45,6 +50,9 @@ RESAMPLE_FUNCS(double, sse2);
 RESAMPLE_FUNCS(double, avx);
 RESAMPLE_FUNCS(double, fma3);
 
+RESAMPLE_MULTI_FUNC(float, fma3);
+RESAMPLE_MULTI_FUNC(float, avx512);
+
 av_cold void swri_resample_dsp_x86_init(ResampleContext *c)
 {
     int av_unused mm_flags = av_get_cpu_flags();
@@ -77,6 +85,12 @@ av_cold void swri_resample_dsp_x86_init(ResampleContext *c)
             c->dsp.resample_linear = ff_resample_linear_float_fma4;
             c->dsp.resample_common = ff_resample_common_float_fma4;
         }
+#if ARCH_X86_64
+        if (EXTERNAL_FMA3_FAST(mm_flags))
+            c->dsp.resample_multi = ff_resample_multi_float_fma3;
+        if (EXTERNAL_AVX512(mm_flags))
+            c->dsp.resample_multi = ff_resample_multi_float_avx512;
+#endif
         break;
     case AV_SAMPLE_FMT_DBLP:
         if (EXTERNAL_SSE2(mm_flags)) {
@@ -0,0 +1,230 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Fused scaling of planar 4:2:0 to planar or semi-planar 4:2:0.
+ *
+ * Each output line is filtered vertically from the source planes into a
+ * single line buffer, then filtered horizontally straight into the
+ * destination. Unlike the generic path, no horizontally scaled line ring
+ * buffers are kept, and for semi-planar output the chroma planes are
+ * interleaved on the fly.
+ */
+
+#include "libavutil/common.h"
+#include "libavutil/pixfmt.h"
+
+#include "swscale.h"
+#include "swscale_internal.h"
+
+/* The vertical filter has 12 bit coefficients and leaves 15 bits, the
+ * horizontal filter has 14 bit coefficients, like in the generic path. */
+#define VSHIFT(depth) ((depth) + 12 - 15)
+#define HSHIFT(depth) (15 + 14 - (depth))
+
+#define READ(row, x) (depth > 8 ? ((const uint16_t *)(row))[x] : (row)[x])
+
+static av_always_inline void vfilter(int32_t *dst, const uint8_t *src,
+                                     int stride, int w,
+                                     const int16_t *filter, int filterPos,
+                                     int filterSize, int depth)
+{
+    const int sh = VSHIFT(depth);
+    const uint8_t *row = src + filterPos * (ptrdiff_t)stride;
+    int last = filterSize - 1;
+    int x, j;
+
+    /* taps past the last source line have zero coefficients */
+    while (last > 0 && !filter[last])
+        last--;
+
+    if (!last) {
+        for (x = 0; x < w; x++)
+            dst[x] = av_clip_int16((READ(row, x) * filter[0] + (1 << (sh - 1))) >> sh);
+        return;
+    }
+
+    for (x = 0; x < w; x++)
+        dst[x] = READ(row, x) * filter[0] + (1 << (sh - 1));
+    /* two lines per pass to halve the accesses to dst */
+    for (j = 1; j + 1 < last; j += 2) {
+        const uint8_t *row2 = src + (filterPos + j + 1) * (ptrdiff_t)stride;
+
+        row = src + (filterPos + j) * (ptrdiff_t)stride;
+        for (x = 0; x < w; x++)
+            dst[x] += READ(row, x) * filter[j] + READ(row2, x) * filter[j + 1];
+    }
+    if (j < last) {
+        row = src + (filterPos + j) * (ptrdiff_t)stride;
+        for (x = 0; x < w; x++)
+            dst[x] += READ(row, x) * filter[j];
+    }
+    row = src + (filterPos + last) * (ptrdiff_t)stride;
+    for (x = 0; x < w; x++)
+        dst[x] = av_clip_int16((dst[x] + READ(row, x) * filter[last]) >> sh);
+}
+
+static av_always_inline void store(uint8_t *dst, int i, int val, int depth)
+{
+    if (depth > 8)
+        ((uint16_t *)dst)[i] = av_clip_uintp2(val >> HSHIFT(depth), depth) << (16 - depth);
+    else
+        dst[i] = av_clip_uint8(val >> HSHIFT(depth));
+}
+
+/* Filter src1 into dst, or src1 and src2 into interleaved dst if src2 is set. */
+static av_always_inline void hfilter(uint8_t *dst, const int32_t *src1,
+                                     const int32_t *src2, int dstW,
+                                     const int16_t *filter, const int32_t *filterPos,
+                                     int filterSize, int depth)
+{
+    for (int i = 0; i < dstW; i++) {
+        const int32_t *s1 = src1 + filterPos[i];
+        int u = 1 << (HSHIFT(depth) - 1);
+
+        if (src2) {
+            const int32_t *s2 = src2 + filterPos[i];
+            int v = 1 << (HSHIFT(depth) - 1);
+
+            for (int j = 0; j < filterSize; j++) {
+                u += s1[j] * filter[j];
+                v += s2[j] * filter[j];
+            }
+            store(dst, 2 * i,     u, depth);
+            store(dst, 2 * i + 1, v, depth);
+        } else {
+            for (int j = 0; j < filterSize; j++)
+                u += s1[j] * filter[j];
+            store(dst, i, u, depth);
+        }
+        filter += filterSize;
+    }
+}
+
+static av_always_inline void hfilter_line(uint8_t *dst, const int32_t *src1,
+                                          const int32_t *src2, int dstW,
+                                          const int16_t *filter, const int32_t *filterPos,
+                                          int filterSize, int depth)
+{
+    /* unrolled for the sizes of bicubic upscaling and of the common
+     * downscaling by 1.5, 2 and 3 (1080p to 720p, 540p and 360p) */
+    switch (filterSize) {
+    case 4:
+        hfilter(dst, src1, src2, dstW, filter, filterPos, 4, depth);
+        break;
+    case 6:
+        hfilter(dst, src1, src2, dstW, filter, filterPos, 6, depth);
+        break;
+    case 8:
+        hfilter(dst, src1, src2, dstW, filter, filterPos, 8, depth);
+        break;
+    case 12:
+        hfilter(dst, src1, src2, dstW, filter, filterPos, 12, depth);
+        break;
+    default:
+        hfilter(dst, src1, src2, dstW, filter, filterPos, filterSize, depth);
+    }
+}
+
+static av_always_inline int fused_scale(SwsContext *c, const uint8_t *src[],
+                                        const int srcStride[], uint8_t *dst[],
+                                        const int dstStride[], int dstSliceY,
+                                        int dstSliceH, int depth, int packed)
+{
+    /* the horizontal filters may read filterSize - 1 zeroes past the end */
+    int32_t *lum = c->fused_tmp;
+    int32_t *u   = lum + c->srcW    + c->fusedLumFilterSize;
+    int32_t *v   = u   + c->chrSrcW + c->fusedChrFilterSize;
+    const int chrSliceY = dstSliceY >> 1;
+    const int chrSliceH = AV_CEIL_RSHIFT(dstSliceY + dstSliceH, 1) - chrSliceY;
+
+    for (int y = 0; y < dstSliceH; y++) {
+        const int dstY = dstSliceY + y;
+
+        vfilter(lum, src[0], srcStride[0], c->srcW,
+                c->vLumFilter + dstY * c->vLumFilterSize,
+                c->vLumFilterPos[dstY], c->vLumFilterSize, depth);
+        hfilter_line(dst[0] + y * dstStride[0], lum, NULL, c->dstW,
+                     c->fusedLumFilter, c->fusedLumFilterPos,
+                     c->fusedLumFilterSize, depth);
+    }
+
+    for (int y = 0; y < chrSliceH; y++) {
+        const int dstY = chrSliceY + y;
+        const int16_t *filter = c->vChrFilter + dstY * c->vChrFilterSize;
+
+        vfilter(u, src[1], srcStride[1], c->chrSrcW, filter,
+                c->vChrFilterPos[dstY], c->vChrFilterSize, depth);
+        vfilter(v, src[2], srcStride[2], c->chrSrcW, filter,
+                c->vChrFilterPos[dstY], c->vChrFilterSize, depth);
+        if (packed) {
+            hfilter_line(dst[1] + y * dstStride[1], u, v, c->chrDstW,
+                         c->fusedChrFilter, c->fusedChrFilterPos,
+                         c->fusedChrFilterSize, depth);
+        } else {
+            hfilter_line(dst[1] + y * dstStride[1], u, NULL, c->chrDstW,
+                         c->fusedChrFilter, c->fusedChrFilterPos,
+                         c->fusedChrFilterSize, depth);
+            hfilter_line(dst[2] + y * dstStride[2], v, NULL, c->chrDstW,
+                         c->fusedChrFilter, c->fusedChrFilterPos,
+                         c->fusedChrFilterSize, depth);
+        }
+    }
+
+    return dstSliceH;
+}
+
+static int yuv420p_to_nv12(SwsContext *c, const uint8_t *src[],
+                           const int srcStride[], uint8_t *dst[],
+                           const int dstStride[], int dstSliceY, int dstSliceH)
+{
+    return fused_scale(c, src, srcStride, dst, dstStride, dstSliceY, dstSliceH, 8, 1);
+}
+
+static int yuv420p_to_yuv420p(SwsContext *c, const uint8_t *src[],
+                              const int srcStride[], uint8_t *dst[],
+                              const int dstStride[], int dstSliceY, int dstSliceH)
+{
+    return fused_scale(c, src, srcStride, dst, dstStride, dstSliceY, dstSliceH, 8, 0);
+}
+
+static int yuv420p10_to_p010(SwsContext *c, const uint8_t *src[],
+                             const int srcStride[], uint8_t *dst[],
+                             const int dstStride[], int dstSliceY, int dstSliceH)
+{
+    return fused_scale(c, src, srcStride, dst, dstStride, dstSliceY, dstSliceH, 10, 1);
+}
+
+av_cold void ff_sws_init_fused(SwsContext *c)
+{
+    c->convert_fused = NULL;
+
+    /* The output differs from the generic path, so it is only used on
+     * request. There is no range conversion, the ranges are checked for
+     * each frame as sws_setColorspaceDetails() may change them. */
+    if (!c->fused || c->vChrDrop || (c->flags & SWS_FAST_BILINEAR))
+        return;
+
+    if (c->srcFormat == AV_PIX_FMT_YUV420P && c->dstFormat == AV_PIX_FMT_NV12)
+        c->convert_fused = yuv420p_to_nv12;
+    else if (c->srcFormat == AV_PIX_FMT_YUV420P && c->dstFormat == AV_PIX_FMT_YUV420P)
+        c->convert_fused = yuv420p_to_yuv420p;
+    else if (c->srcFormat == AV_PIX_FMT_YUV420P10 && c->dstFormat == AV_PIX_FMT_P010)
+        c->convert_fused = yuv420p10_to_p010;
+}
@@ -23,9 +23,10 @@
 typedef struct GammaContext
 {
     uint16_t *table;
+    int alpha;              ///< the lines are RGBA64, leave alpha untouched
 } GammaContext;
 
-// gamma_convert expects 16 bit rgb format
+// gamma_convert expects native endian RGB48 or RGBA64
 // it writes directly in src slice thus it must be modifiable (done through cascade context)
 static int gamma_convert(SwsContext *c, SwsFilterDescriptor *desc, int sliceY, int sliceH)
 {
@@ -40,16 +41,16 @@ static int gamma_convert(SwsContext *c, SwsFilterDescriptor *desc, int sliceY, i
 
         uint16_t *src1 = (uint16_t*)*(src+src_pos);
         int j;
-        for (j = 0; j < srcW; ++j) {
-            uint16_t r = AV_RL16(src1 + j*4 + 0);
-            uint16_t g = AV_RL16(src1 + j*4 + 1);
-            uint16_t b = AV_RL16(src1 + j*4 + 2);
-
-            AV_WL16(src1 + j*4 + 0, table[r]);
-            AV_WL16(src1 + j*4 + 1, table[g]);
-            AV_WL16(src1 + j*4 + 2, table[b]);
+        if (instance->alpha) {
+            for (j = 0; j < srcW; ++j) {
+                src1[j*4 + 0] = table[src1[j*4 + 0]];
+                src1[j*4 + 1] = table[src1[j*4 + 1]];
+                src1[j*4 + 2] = table[src1[j*4 + 2]];
+            }
+        } else {
+            for (j = 0; j < 3 * srcW; ++j)
+                src1[j] = table[src1[j]];
         }
-
     }
     return sliceH;
 }
@@ -61,6 +62,7 @@ int ff_init_gamma_convert(SwsFilterDescriptor *desc, SwsSlice * src, uint16_t *t
     if (!li)
         return AVERROR(ENOMEM);
     li->table = table;
+    li->alpha = isALPHA(src->fmt);
 
     desc->instance = li;
     desc->src = src;
@@ -70,3 +72,66 @@ int ff_init_gamma_convert(SwsFilterDescriptor *desc, SwsSlice * src, uint16_t *t
     return 0;
 }
 
+int ff_sws_gamma_linearize_supported(enum AVPixelFormat format)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+    int i;
+
+    if (!desc || !(desc->flags & AV_PIX_FMT_FLAG_RGB) || desc->nb_components < 3 ||
+        (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM |
+                        AV_PIX_FMT_FLAG_FLOAT | AV_PIX_FMT_FLAG_BAYER)))
+        return 0;
+
+    for (i = 0; i < desc->nb_components; i++) {
+        const AVComponentDescriptor *comp = &desc->comp[i];
+
+        if (comp->shift || comp->depth != desc->comp[0].depth)
+            return 0;
+        // bytes, or native endian words holding 9 to 12 bits
+        if (comp->depth != 8 &&
+            (comp->depth < 8 || comp->depth > 12 || comp->step != 2 ||
+             !(desc->flags & AV_PIX_FMT_FLAG_BE) != !HAVE_BIGENDIAN))
+            return 0;
+    }
+
+    return 1;
+}
+
+// converts the input directly to the RGB48 or RGBA64 lines the gamma correct
+// scaler works on, with a table indexed by the input values, which is
+// much smaller than the 16 bit one gamma_convert() uses
+void ff_sws_gamma_linearize(SwsContext *c, const uint8_t * const src[],
+                            const int srcStride[], int srcSliceY, int srcSliceH,
+                            uint8_t * const dst[], const int dstStride[])
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->srcFormat);
+    const uint16_t *table = c->gamma;
+    const int depth = desc->comp[0].depth;
+    const int mask = (1 << depth) - 1;
+    const int nb_comps = isALPHA(c->cascaded_context[1]->srcFormat) ? 4 : 3;
+    int y, i, x;
+
+    for (y = 0; y < srcSliceH; y++) {
+        uint16_t *out = (uint16_t *)(dst[0] + (srcSliceY + y) * dstStride[0]);
+
+        for (i = 0; i < nb_comps; i++) {
+            const AVComponentDescriptor *comp = &desc->comp[i];
+            const uint8_t *in = src[comp->plane] + y * srcStride[comp->plane] + comp->offset;
+            const int step = comp->step;
+
+            if (i == 3) {
+                // alpha is scaled as is, only widen it to 16 bits
+                for (x = 0; x < c->srcW; x++) {
+                    int a = depth == 8 ? in[step * x] : AV_RN16(in + step * x) & mask;
+                    out[4 * x + 3] = a << (16 - depth) | a >> (2 * depth - 16);
+                }
+            } else if (depth == 8) {
+                for (x = 0; x < c->srcW; x++)
+                    out[nb_comps * x + i] = table[in[step * x]];
+            } else {
+                for (x = 0; x < c->srcW; x++)
+                    out[nb_comps * x + i] = table[AV_RN16(in + step * x) & mask];
+            }
+        }
+    }
+}
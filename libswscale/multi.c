@@ -0,0 +1,254 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Scaling of one source to several outputs
+ *
+ * Every output has its own scaling context, whose slice contexts are run by
+ * the threads of the multi context. The outputs are grouped into levels:
+ * level 0 is scaled from the source, level n from outputs of level n - 1.
+ * The slice jobs of a level process the same slice of all its outputs in a
+ * row, so the corresponding source rows are still in the cache when the
+ * next output reads them.
+ */
+
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/slicethread.h"
+
+#include "swscale.h"
+#include "swscale_internal.h"
+
+typedef struct MultiOutput {
+    SwsContext *ctx;
+    int parent;             ///< output this one is scaled from, -1 for the source
+    int level;
+} MultiOutput;
+
+struct SwsMultiContext {
+    AVSliceThread *slicethread;
+    int nb_threads;
+    int *thread_err;
+
+    MultiOutput *outputs;
+    int nb_outputs;
+    int nb_levels;
+    int cur_level;
+
+    int src_w, src_h;
+    enum AVPixelFormat src_format;
+};
+
+static void multi_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads)
+{
+    SwsMultiContext *m = priv;
+
+    for (int i = 0; i < m->nb_outputs; i++) {
+        SwsContext *c = m->outputs[i].ctx;
+        int err;
+
+        if (m->outputs[i].level != m->cur_level)
+            continue;
+
+        if (c->nb_slice_ctx > 1)
+            err = ff_sws_scale_job(c, c->slice_ctx[threadnr], jobnr, nb_jobs);
+        else if (!jobnr) /* single-threaded, e.g. for bit-exact error diffusion */
+            err = ff_sws_scale_job(c, c->nb_slice_ctx ? c->slice_ctx[0] : c, 0, 1);
+        else
+            continue;
+
+        if (err < 0)
+            m->thread_err[threadnr] = err;
+    }
+}
+
+/* find the smallest output at least twice as large as output idx in both
+ * dimensions with the same format, below that the scaler would need to
+ * filter an already scaled image by less than 2:1, which costs sharpness */
+static int find_parent(int nb_outputs, const int *dst_w, const int *dst_h,
+                       const enum AVPixelFormat *dst_format, int idx)
+{
+    int best = -1;
+
+    for (int i = 0; i < nb_outputs; i++) {
+        if (dst_format[i] != dst_format[idx] ||
+            dst_w[i] < 2 * dst_w[idx] || dst_h[i] < 2 * dst_h[idx])
+            continue;
+        if (best < 0 || (int64_t)dst_w[i] * dst_h[i] < (int64_t)dst_w[best] * dst_h[best])
+            best = i;
+    }
+
+    return best;
+}
+
+int sws_multi_create(SwsMultiContext **pm, const struct SwsContext *opts,
+                     int nb_outputs, const int *dst_w, const int *dst_h,
+                     const enum AVPixelFormat *dst_format, int flags)
+{
+    SwsMultiContext *m;
+    int ret;
+
+    *pm = NULL;
+
+    if (nb_outputs <= 0)
+        return AVERROR(EINVAL);
+
+    m = av_mallocz(sizeof(*m));
+    if (!m)
+        return AVERROR(ENOMEM);
+
+    m->src_w      = opts->srcW;
+    m->src_h      = opts->srcH;
+    m->src_format = opts->srcFormat;
+
+    ret = avpriv_slicethread_create(&m->slicethread, m, multi_worker, NULL,
+                                    opts->nb_threads);
+    if (ret == AVERROR(ENOSYS))
+        ret = 1;
+    else if (ret < 0)
+        goto fail;
+    m->nb_threads = ret;
+
+    m->thread_err = av_calloc(m->nb_threads, sizeof(*m->thread_err));
+    m->outputs    = av_calloc(nb_outputs, sizeof(*m->outputs));
+    if (!m->thread_err || !m->outputs) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    m->nb_outputs = nb_outputs;
+
+    for (int i = 0; i < nb_outputs; i++) {
+        m->outputs[i].parent = flags & SWS_MULTI_PYRAMID ?
+            find_parent(nb_outputs, dst_w, dst_h, dst_format, i) : -1;
+    }
+
+    for (int i = 0; i < nb_outputs; i++) {
+        MultiOutput *out = &m->outputs[i];
+        SwsContext *c;
+
+        /* parents are strictly larger, so this terminates */
+        for (int p = out->parent; p >= 0; p = m->outputs[p].parent)
+            out->level++;
+        m->nb_levels = FFMAX(m->nb_levels, out->level + 1);
+
+        out->ctx = c = sws_alloc_context();
+        if (!c) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+
+        ret = av_opt_copy(c, opts);
+        if (ret < 0)
+            goto fail;
+
+        c->dstW           = dst_w[i];
+        c->dstH           = dst_h[i];
+        c->dstFormat      = dst_format[i];
+        c->nb_threads     = m->nb_threads;
+        c->shared_threads = 1;
+
+        if (out->parent >= 0) {
+            c->srcW          = dst_w[out->parent];
+            c->srcH          = dst_h[out->parent];
+            c->srcFormat     = dst_format[out->parent];
+            c->srcRange      = opts->dstRange;
+            c->src_h_chr_pos = opts->dst_h_chr_pos;
+            c->src_v_chr_pos = opts->dst_v_chr_pos;
+
+            av_log(c, AV_LOG_VERBOSE, "output %d: %dx%d scaled from output %d\n",
+                   i, dst_w[i], dst_h[i], out->parent);
+        }
+
+        ret = sws_init_context(c, NULL, NULL);
+        if (ret < 0)
+            goto fail;
+    }
+
+    *pm = m;
+    return 0;
+
+fail:
+    sws_multi_free(&m);
+    return ret;
+}
+
+int sws_multi_scale_frame(SwsMultiContext *m, AVFrame **dst, const AVFrame *src)
+{
+    int ret = 0;
+
+    if (src->width != m->src_w || src->height != m->src_h ||
+        src->format != m->src_format)
+        return AVERROR(EINVAL);
+
+    for (m->cur_level = 0; m->cur_level < m->nb_levels && ret >= 0; m->cur_level++) {
+        for (int i = 0; i < m->nb_outputs; i++) {
+            const MultiOutput *out = &m->outputs[i];
+
+            if (out->level != m->cur_level)
+                continue;
+
+            ret = sws_frame_start(out->ctx, dst[i], out->parent >= 0 ? dst[out->parent] : src);
+            if (ret < 0)
+                break;
+            out->ctx->dst_slice_start  = 0;
+            out->ctx->dst_slice_height = out->ctx->dstH;
+        }
+
+        if (ret >= 0) {
+            memset(m->thread_err, 0, m->nb_threads * sizeof(*m->thread_err));
+            if (m->slicethread)
+                avpriv_slicethread_execute(m->slicethread, m->nb_threads, 0);
+            else
+                multi_worker(m, 0, 0, 1, 1);
+
+            for (int i = 0; i < m->nb_threads; i++) {
+                if (m->thread_err[i] < 0) {
+                    ret = m->thread_err[i];
+                    break;
+                }
+            }
+        }
+
+        for (int i = 0; i < m->nb_outputs; i++) {
+            if (m->outputs[i].level == m->cur_level)
+                sws_frame_end(m->outputs[i].ctx);
+        }
+    }
+
+    return ret;
+}
+
+void sws_multi_free(SwsMultiContext **pm)
+{
+    SwsMultiContext *m = *pm;
+
+    if (!m)
+        return;
+
+    avpriv_slicethread_free(&m->slicethread);
+
+    for (int i = 0; i < m->nb_outputs; i++)
+        sws_freeContext(m->outputs[i].ctx);
+    av_freep(&m->outputs);
+    av_freep(&m->thread_err);
+    av_freep(pm);
+}
@@ -255,6 +255,7 @@ int ff_init_filters(SwsContext * c)
     int need_lum_conv = c->lumToYV12 || c->readLumPlanar || c->alpToYV12 || c->readAlpPlanar;
     int need_chr_conv = c->chrToYV12 || c->readChrPlanar;
     int need_gamma = c->is_internal_gamma;
+    int need_in_gamma = need_gamma && c->gamma;
     int srcIdx, dstIdx;
     int dst_stride = FFALIGN(c->dstW * sizeof(int16_t) + 66, 16);
 
@@ -278,9 +279,9 @@ int ff_init_filters(SwsContext * c)
     num_cdesc = need_chr_conv ? 2 : 1;
 
     c->numSlice = FFMAX(num_ydesc, num_cdesc) + 2;
-    c->numDesc = num_ydesc + num_cdesc + num_vdesc + (need_gamma ? 2 : 0);
-    c->descIndex[0] = num_ydesc + (need_gamma ? 1 : 0);
-    c->descIndex[1] = num_ydesc + num_cdesc + (need_gamma ? 1 : 0);
+    c->numDesc = num_ydesc + num_cdesc + num_vdesc + need_gamma + need_in_gamma;
+    c->descIndex[0] = num_ydesc + need_in_gamma;
+    c->descIndex[1] = num_ydesc + num_cdesc + need_in_gamma;
 
     if (isFloat16(c->srcFormat)) {
         c->h2f_tables = av_malloc(sizeof(*c->h2f_tables));
@@ -324,8 +325,8 @@ int ff_init_filters(SwsContext * c)
     srcIdx = 0;
     dstIdx = 1;
 
-    if (need_gamma) {
-        res = ff_init_gamma_convert(c->desc + index, c->slice + srcIdx, c->inv_gamma);
+    if (need_in_gamma) {
+        res = ff_init_gamma_convert(c->desc + index, c->slice + srcIdx, c->gamma);
         if (res < 0) goto cleanup;
         ++index;
     }
@@ -374,7 +375,7 @@ int ff_init_filters(SwsContext * c)
 
     ++index;
     if (need_gamma) {
-        res = ff_init_gamma_convert(c->desc + index, c->slice + dstIdx, c->gamma);
+        res = ff_init_gamma_convert(c->desc + index, c->slice + dstIdx, c->inv_gamma);
         if (res < 0) goto cleanup;
     }
 
@@ -601,6 +601,8 @@ void ff_sws_init_scale(SwsContext *c)
 #elif ARCH_LOONGARCH64
     ff_sws_init_swscale_loongarch(c);
 #endif
+
+    ff_sws_init_fused(c);
 }
 
 static void reset_ptr(const uint8_t *src[], enum AVPixelFormat format)
@@ -831,19 +833,28 @@ static int scale_gamma(SwsContext *c,
                        uint8_t * const dstSlice[], const int dstStride[],
                        int dstSliceY, int dstSliceH)
 {
-    int ret = scale_internal(c->cascaded_context[0],
+    // the intermediate images are written at the position of the slice
+    const uint8_t *tmp[4]  = { c->cascaded_tmp[0] + srcSliceY * c->cascaded_tmpStride[0] };
+    const uint8_t *tmp1[4] = { NULL };
+    int ret = 0;
+
+    if (c->cascaded_context[0])
+        ret = scale_internal(c->cascaded_context[0],
                              srcSlice, srcStride, srcSliceY, srcSliceH,
                              c->cascaded_tmp, c->cascaded_tmpStride, 0, c->srcH);
+    else
+        ff_sws_gamma_linearize(c, srcSlice, srcStride, srcSliceY, srcSliceH,
+                               c->cascaded_tmp, c->cascaded_tmpStride);
 
     if (ret < 0)
         return ret;
 
     if (c->cascaded_context[2])
-        ret = scale_internal(c->cascaded_context[1], (const uint8_t * const *)c->cascaded_tmp,
+        ret = scale_internal(c->cascaded_context[1], tmp,
                              c->cascaded_tmpStride, srcSliceY, srcSliceH,
                              c->cascaded1_tmp, c->cascaded1_tmpStride, 0, c->dstH);
     else
-        ret = scale_internal(c->cascaded_context[1], (const uint8_t * const *)c->cascaded_tmp,
+        ret = scale_internal(c->cascaded_context[1], tmp,
                              c->cascaded_tmpStride, srcSliceY, srcSliceH,
                              dstSlice, dstStride, dstSliceY, dstSliceH);
 
@@ -851,9 +862,11 @@ static int scale_gamma(SwsContext *c,
         return ret;
 
     if (c->cascaded_context[2]) {
-        ret = scale_internal(c->cascaded_context[2], (const uint8_t * const *)c->cascaded1_tmp,
-                             c->cascaded1_tmpStride, c->cascaded_context[1]->dstY - ret,
-                             c->cascaded_context[1]->dstY,
+        const int y = c->cascaded_context[1]->dstY - ret;
+
+        tmp1[0] = c->cascaded1_tmp[0] + y * c->cascaded1_tmpStride[0];
+        ret = scale_internal(c->cascaded_context[2], tmp1,
+                             c->cascaded1_tmpStride, y, ret,
                              dstSlice, dstStride, dstSliceY, dstSliceH);
     }
     return ret;
@@ -928,7 +941,7 @@ static int scale_internal(SwsContext *c,
     if (srcSliceH == 0)
         return 0;
 
-    if (c->gamma_flag && c->cascaded_context[0])
+    if (c->gamma_flag && c->cascaded_context[1])
         return scale_gamma(c, srcSlice, srcStride, srcSliceY, srcSliceH,
                            dstSlice, dstStride, dstSliceY, dstSliceH);
 
@@ -1041,6 +1054,12 @@ static int scale_internal(SwsContext *c,
                                   dst2, dstStride2);
         if (scale_dst)
             dst2[0] += dstSliceY * dstStride2[0];
+    } else if (c->convert_fused && c->sliceDir == 1 &&
+               srcSliceY == 0 && srcSliceH == c->srcH &&
+               c->srcRange == c->dstRange) {
+        // dstSliceY is 0 unless scale_dst, dst2 points to line dstSliceY
+        ret = c->convert_fused(c, src2, srcStride2, dst2, dstStride2,
+                               dstSliceY, dstSliceH);
     } else {
         ret = swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH,
                       dst2, dstStride2, dstSliceY, dstSliceH);
@@ -1149,7 +1168,7 @@ int sws_receive_slice(struct SwsContext *c, unsigned int slice_start,
     }
 
     if (c->slicethread) {
-        int nb_jobs = c->slice_ctx[0]->dither == SWS_DITHER_ED ? 1 : c->nb_slice_ctx;
+        int nb_jobs = c->nb_slice_ctx;
         int ret = 0;
 
         c->dst_slice_start  = slice_start;
@@ -1213,21 +1232,31 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
                           dst, dstStride, 0, c->dstH);
 }
 
-void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
-                         int nb_jobs, int nb_threads)
+int ff_sws_scale_job(SwsContext *parent, SwsContext *c, int jobnr, int nb_jobs)
 {
-    SwsContext *parent = priv;
-    SwsContext      *c = parent->slice_ctx[threadnr];
-
     const int slice_height = FFALIGN(FFMAX((parent->dst_slice_height + nb_jobs - 1) / nb_jobs, 1),
                                      c->dst_slice_align);
     const int slice_start  = jobnr * slice_height;
     const int slice_end    = FFMIN((jobnr + 1) * slice_height, parent->dst_slice_height);
-    int err = 0;
 
     if (slice_end > slice_start) {
+        const int dst_y = parent->dst_slice_start + slice_start;
         uint8_t *dst[4] = { NULL };
 
+        /* error diffusion carries the error of each line over to the next
+         * one; scale the lines above the slice into a scratch buffer first,
+         * so the slice starts with nearly the same error as it would get
+         * when scaling the whole image in one go */
+        if (c->ed_warmup_lines && dst_y > 0) {
+            const int lines = FFMIN(c->ed_warmup_lines, dst_y);
+            int ret = scale_internal(c, (const uint8_t * const *)parent->frame_src->data,
+                                     parent->frame_src->linesize, 0, c->srcH,
+                                     c->ed_warmup, c->ed_warmup_stride,
+                                     dst_y - lines, lines);
+            if (ret < 0)
+                return ret;
+        }
+
         for (int i = 0; i < FF_ARRAY_ELEMS(dst) && parent->frame_dst->data[i]; i++) {
             const int vshift = (i == 1 || i == 2) ? c->chrDstVSubSample : 0;
             const ptrdiff_t offset = parent->frame_dst->linesize[i] *
@@ -1236,11 +1265,20 @@ void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
             dst[i] = parent->frame_dst->data[i] + offset;
         }
 
-        err = scale_internal(c, (const uint8_t * const *)parent->frame_src->data,
-                             parent->frame_src->linesize, 0, c->srcH,
-                             dst, parent->frame_dst->linesize,
-                             parent->dst_slice_start + slice_start, slice_end - slice_start);
+        return scale_internal(c, (const uint8_t * const *)parent->frame_src->data,
+                              parent->frame_src->linesize, 0, c->srcH,
+                              dst, parent->frame_dst->linesize,
+                              dst_y, slice_end - slice_start);
     }
 
-    parent->slice_err[threadnr] = err;
+    return 0;
+}
+
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads)
+{
+    SwsContext *parent = priv;
+
+    parent->slice_err[threadnr] = ff_sws_scale_job(parent, parent->slice_ctx[threadnr],
+                                                   jobnr, nb_jobs);
 }
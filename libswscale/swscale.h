@@ -325,6 +325,64 @@ int sws_receive_slice(struct SwsContext *c, unsigned int slice_start,
  */
 unsigned int sws_receive_slice_alignment(const struct SwsContext *c);
 
+/**
+ * Context scaling one source to several outputs, see sws_multi_create().
+ */
+typedef struct SwsMultiContext SwsMultiContext;
+
+/**
+ * Allow outputs to be scaled from a larger output instead of the source.
+ */
+#define SWS_MULTI_PYRAMID 1
+
+/**
+ * Create a context scaling one source frame to several outputs (e.g. the
+ * renditions of an adaptive streaming ladder) in one call of
+ * sws_multi_scale_frame().
+ *
+ * Outputs scaled from the source are processed slice by slice in lockstep,
+ * so every part of the source is read from memory once for all of them.
+ * The filtering itself depends on the output size and is done per output.
+ * With SWS_MULTI_PYRAMID, an output is instead scaled from the smallest other
+ * output that has the same pixel format and is at least twice as large in
+ * both dimensions, if there is one. This is faster, but not as accurate as
+ * scaling from the source.
+ *
+ * @param pm          pointer to the new context, set to NULL on failure
+ * @param opts        an uninitialized scaling context (see sws_alloc_context())
+ *                    with the source size and format and the options common
+ *                    to all outputs (flags, "threads", ranges, ...) set;
+ *                    its destination size and format are ignored. It can be
+ *                    freed after this call.
+ * @param nb_outputs  number of outputs
+ * @param dst_w       array of nb_outputs output widths
+ * @param dst_h       array of nb_outputs output heights
+ * @param dst_format  array of nb_outputs output pixel formats
+ * @param flags       a combination of SWS_MULTI_* flags
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int sws_multi_create(SwsMultiContext **pm, const struct SwsContext *opts,
+                     int nb_outputs, const int *dst_w, const int *dst_h,
+                     const enum AVPixelFormat *dst_format, int flags);
+
+/**
+ * Scale a source frame to all outputs of a multi-output context.
+ *
+ * @param m   the context
+ * @param dst array of the output frames, in the order they were given to
+ *            sws_multi_create(); a frame without buffers gets new ones
+ *            allocated, as with sws_frame_start()
+ * @param src the source frame, with the size and format the context was
+ *            created for
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int sws_multi_scale_frame(SwsMultiContext *m, AVFrame **dst, const AVFrame *src);
+
+/**
+ * Free a multi-output context and set the pointer to NULL.
+ */
+void sws_multi_free(SwsMultiContext **pm);
+
 /**
  * @param c the scaling context
  * @param dstRange flag indicating the while-black range of the output (1=jpeg / 0=mpeg)
@@ -64,8 +64,14 @@
 
 #define RETCODE_USE_CASCADE -12345
 
+/* lines scaled above a slice to seed its error diffusion state; the share
+ * of the error passed down decays by about 9/16 per line */
+#define ED_WARMUP_LINES 8
+
 struct SwsContext;
 
+typedef struct SwsFilterCacheEntry SwsFilterCacheEntry;
+
 typedef enum SwsDither {
     SWS_DITHER_NONE = 0,
     SWS_DITHER_AUTO,
@@ -100,6 +106,15 @@ typedef int (*SwsFunc)(struct SwsContext *context, const uint8_t *src[],
                        int srcStride[], int srcSliceY, int srcSliceH,
                        uint8_t *dst[], int dstStride[]);
 
+/**
+ * Scale a whole source frame to the destination lines dstSliceY to
+ * dstSliceY + dstSliceH - 1 in a single pass, dst points to line dstSliceY.
+ * Returns the number of lines written.
+ */
+typedef int (*SwsFusedFunc)(struct SwsContext *c, const uint8_t *src[],
+                            const int srcStride[], uint8_t *dst[],
+                            const int dstStride[], int dstSliceY, int dstSliceH);
+
 /**
  * Write one line of horizontally scaled data to planar output
  * without any additional vertical scaling (or point-scaling).
@@ -308,6 +323,7 @@ typedef struct SwsContext {
     struct SwsContext **slice_ctx;
     int                *slice_err;
     int              nb_slice_ctx;
+    int              shared_threads; ///< slice contexts are run by a SwsMultiContext's threads
 
     // values passed to current sws_receive_slice() call
     int dst_slice_start;
@@ -677,11 +693,39 @@ typedef struct SwsContext {
     uint8_t     *xyz_scratch;
     unsigned int xyz_scratch_allocated;
 
+    // lines above a slice are scaled into this buffer before the slice
+    // itself, to seed the error diffusion state of a slice context
+    uint8_t     *ed_warmup[4];
+    int          ed_warmup_stride[4];
+    int          ed_warmup_lines;
+    int          ed_slices;      // allow the approximation above in slice threads
+
     unsigned int dst_slice_align;
     atomic_int   stride_unaligned_warned;
     atomic_int   data_unaligned_warned;
 
     Half2FloatTables *h2f_tables;
+
+    // shared filters in use for hLum, hChr, vLum and vChr,
+    // NULL if the filter is owned by this context
+    SwsFilterCacheEntry *filter_cache[4];
+
+    int fused;                    ///< use convert_fused if there is one for the formats
+    SwsFusedFunc convert_fused;   ///< scale in one pass, only used for whole source frames of equal ranges
+
+    /**
+     * @name Horizontal filters of convert_fused
+     * Same as hLumFilter and hChrFilter, but never padded or shuffled for SIMD.
+     */
+    //@{
+    int16_t *fusedLumFilter;
+    int16_t *fusedChrFilter;
+    int32_t *fusedLumFilterPos;
+    int32_t *fusedChrFilterPos;
+    int fusedLumFilterSize;
+    int fusedChrFilterSize;
+    //@}
+    int32_t *fused_tmp;           ///< vertically filtered luma line, then both chroma lines
 } SwsContext;
 //FIXME check init (where 0)
 
@@ -970,6 +1014,12 @@ void ff_get_unscaled_swscale_aarch64(SwsContext *c);
 
 void ff_sws_init_scale(SwsContext *c);
 
+/**
+ * Set c->convert_fused to a fused scale function if one exists for the
+ * formats and flags and if the fused option is set.
+ */
+void ff_sws_init_fused(SwsContext *c);
+
 void ff_sws_init_input_funcs(SwsContext *c);
 void ff_sws_init_output_funcs(SwsContext *c,
                               yuv2planar1_fn *yuv2plane1,
@@ -1130,6 +1180,17 @@ int ff_rotate_slice(SwsSlice *s, int lum, int chr);
 /// initializes gamma conversion descriptor
 int ff_init_gamma_convert(SwsFilterDescriptor *desc, SwsSlice * src, uint16_t *table);
 
+/// returns 1 if ff_sws_gamma_linearize() can read the given input format
+int ff_sws_gamma_linearize_supported(enum AVPixelFormat format);
+
+/**
+ * Convert a slice of 8 to 12 bit RGB input to the linear light intermediate
+ * image of the gamma correct scaler, using the table in c->gamma.
+ */
+void ff_sws_gamma_linearize(SwsContext *c, const uint8_t * const src[],
+                            const int srcStride[], int srcSliceY, int srcSliceH,
+                            uint8_t * const dst[], const int dstStride[]);
+
 /// initializes lum pixel format conversion descriptor
 int ff_init_desc_fmt_convert(SwsFilterDescriptor *desc, SwsSlice * src, SwsSlice *dst, uint32_t *pal);
 
@@ -1155,6 +1216,12 @@ void ff_init_vscale_pfn(SwsContext *c, yuv2planar1_fn yuv2plane1, yuv2planarX_fn
 void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
                          int nb_jobs, int nb_threads);
 
+/**
+ * Scale slice jobnr out of nb_jobs of the frames and destination range set
+ * on parent, using the slice context c (which may be parent itself).
+ */
+int ff_sws_scale_job(SwsContext *parent, SwsContext *c, int jobnr, int nb_jobs);
+
 //number of extra lines to process
 #define MAX_LINES_AHEAD 4
 
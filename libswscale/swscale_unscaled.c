@@ -272,6 +272,55 @@ static int planarToP01xWrapper(SwsContext *c, const uint8_t *src8[],
     return srcSliceH;
 }
 
+static int p01xToPlanarWrapper(SwsContext *c, const uint8_t *src8[],
+                               int srcStride[], int srcSliceY,
+                               int srcSliceH, uint8_t *dstParam8[],
+                               int dstStride[])
+{
+    const AVPixFmtDescriptor *src_format = av_pix_fmt_desc_get(c->srcFormat);
+    const AVPixFmtDescriptor *dst_format = av_pix_fmt_desc_get(c->dstFormat);
+    const uint16_t *srcY  = (const uint16_t*)src8[0];
+    const uint16_t *srcUV = (const uint16_t*)src8[1];
+    uint16_t *dstY = (uint16_t*)(dstParam8[0] + dstStride[0] * srcSliceY);
+    uint16_t *dstU = (uint16_t*)(dstParam8[1] + dstStride[1] * srcSliceY / 2);
+    uint16_t *dstV = (uint16_t*)(dstParam8[2] + dstStride[2] * srcSliceY / 2);
+    int x, y;
+
+    /* Calculate net shift required for values. */
+    const int shift[3] = {
+        src_format->comp[0].depth + src_format->comp[0].shift -
+        dst_format->comp[0].depth - dst_format->comp[0].shift,
+        src_format->comp[1].depth + src_format->comp[1].shift -
+        dst_format->comp[1].depth - dst_format->comp[1].shift,
+        src_format->comp[2].depth + src_format->comp[2].shift -
+        dst_format->comp[2].depth - dst_format->comp[2].shift,
+    };
+
+    av_assert0(!(srcStride[0] % 2 || srcStride[1] % 2 ||
+                 dstStride[0] % 2 || dstStride[1] % 2 || dstStride[2] % 2));
+
+    /* Luma and chroma of a line pair are converted in the same pass, so the
+     * source rows are read only once while they are still in the cache. */
+    for (y = 0; y < srcSliceH; y++) {
+        for (x = 0; x < c->srcW; x++)
+            dstY[x] = srcY[x] >> shift[0];
+        srcY += srcStride[0] / 2;
+        dstY += dstStride[0] / 2;
+
+        if (!(y & 1)) {
+            for (x = 0; x < c->chrSrcW; x++) {
+                dstU[x] = srcUV[2 * x    ] >> shift[1];
+                dstV[x] = srcUV[2 * x + 1] >> shift[2];
+            }
+            srcUV += srcStride[1] / 2;
+            dstU  += dstStride[1] / 2;
+            dstV  += dstStride[2] / 2;
+        }
+    }
+
+    return srcSliceH;
+}
+
 #if AV_HAVE_BIGENDIAN
 #define output_pixel(p, v) do { \
         uint16_t *pp = (p); \
@@ -2016,9 +2065,16 @@ void ff_get_unscaled_swscale(SwsContext *c)
          srcFormat == AV_PIX_FMT_YUV420P12 ||
          srcFormat == AV_PIX_FMT_YUV420P14 ||
          srcFormat == AV_PIX_FMT_YUV420P16 || srcFormat == AV_PIX_FMT_YUVA420P16) &&
-        (dstFormat == AV_PIX_FMT_P010 || dstFormat == AV_PIX_FMT_P016)) {
+        (dstFormat == AV_PIX_FMT_P010 || dstFormat == AV_PIX_FMT_P012 ||
+         dstFormat == AV_PIX_FMT_P016)) {
         c->convert_unscaled = planarToP01xWrapper;
     }
+    /* p01x_to_yuv420p1x */
+    if ((srcFormat == AV_PIX_FMT_P010 && dstFormat == AV_PIX_FMT_YUV420P10) ||
+        (srcFormat == AV_PIX_FMT_P012 && dstFormat == AV_PIX_FMT_YUV420P12) ||
+        (srcFormat == AV_PIX_FMT_P016 && dstFormat == AV_PIX_FMT_YUV420P16)) {
+        c->convert_unscaled = p01xToPlanarWrapper;
+    }
     /* yuv420p_to_p01xle */
     if ((srcFormat == AV_PIX_FMT_YUV420P || srcFormat == AV_PIX_FMT_YUVA420P) &&
         (dstFormat == AV_PIX_FMT_P010LE || dstFormat == AV_PIX_FMT_P016LE)) {
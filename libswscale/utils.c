@@ -789,6 +789,153 @@ done:
     return ret;
 }
 
+/* Filters are shared by all contexts initialized with the same parameters,
+ * e.g. the slice contexts of a threaded context, or the contexts of several
+ * streams scaled to the same size. A few unused filters are kept around, so
+ * that short-lived contexts created one after another do not need to
+ * compute them again. */
+#define FILTER_CACHE_MAX_IDLE 16
+
+typedef struct FilterKey {
+    int xInc, srcW, dstW, filterAlign, one, flags, cpu_flags;
+    double param[2];
+    int srcPos, dstPos;
+    int srcBpc, dstBpc;     ///< for horizontal filters, which may get shuffled
+} FilterKey;
+
+struct SwsFilterCacheEntry {
+    struct SwsFilterCacheEntry *next;
+    int refcount;           ///< number of contexts using the filter
+    FilterKey key;
+
+    int16_t *filter;
+    int32_t *filterPos;
+    int filterSize;
+};
+
+static AVMutex filter_cache_mutex = AV_MUTEX_INITIALIZER;
+static SwsFilterCacheEntry *filter_cache;  ///< most recently used first
+static int filter_cache_idle;              ///< number of entries with refcount 0
+
+static void filter_cache_entry_free(SwsFilterCacheEntry *e)
+{
+    av_free(e->filter);
+    av_free(e->filterPos);
+    av_free(e);
+}
+
+static av_cold int initFilterCached(SwsContext *c, SwsFilterCacheEntry **entry,
+                                    int16_t **outFilter, int32_t **filterPos,
+                                    int *outFilterSize, int xInc, int srcW,
+                                    int dstW, int filterAlign, int one,
+                                    int flags, int cpu_flags,
+                                    SwsVector *srcFilter, SwsVector *dstFilter,
+                                    double param[2], int srcPos, int dstPos,
+                                    int horizontal)
+{
+    SwsFilterCacheEntry *e, **prev;
+    FilterKey key;
+    int ret;
+
+    /* user supplied filter vectors are not part of the key */
+    if (!srcFilter && !dstFilter) {
+        memset(&key, 0, sizeof(key));
+        key.xInc        = xInc;
+        key.srcW        = srcW;
+        key.dstW        = dstW;
+        key.filterAlign = filterAlign;
+        key.one         = one;
+        key.flags       = flags;
+        key.cpu_flags   = cpu_flags;
+        key.param[0]    = param[0];
+        key.param[1]    = param[1];
+        key.srcPos      = srcPos;
+        key.dstPos      = dstPos;
+        if (horizontal) {
+            key.srcBpc  = c->srcBpc;
+            key.dstBpc  = c->dstBpc;
+        }
+
+        ff_mutex_lock(&filter_cache_mutex);
+        for (prev = &filter_cache; (e = *prev); prev = &e->next) {
+            if (!memcmp(&e->key, &key, sizeof(key))) {
+                if (!e->refcount++)
+                    filter_cache_idle--;
+                *prev = e->next;
+                e->next = filter_cache;
+                filter_cache = e;
+                break;
+            }
+        }
+        ff_mutex_unlock(&filter_cache_mutex);
+
+        if (e) {
+            *outFilter     = e->filter;
+            *filterPos     = e->filterPos;
+            *outFilterSize = e->filterSize;
+            *entry         = e;
+            return 0;
+        }
+    }
+
+    ret = initFilter(outFilter, filterPos, outFilterSize, xInc, srcW, dstW,
+                     filterAlign, one, flags, cpu_flags, srcFilter, dstFilter,
+                     param, srcPos, dstPos);
+    if (ret < 0)
+        return ret;
+    if (horizontal &&
+        ff_shuffle_filter_coefficients(c, *filterPos, *outFilterSize, *outFilter, dstW) < 0)
+        return AVERROR(ENOMEM);
+
+    /* if the entry cannot be allocated, the context keeps its own filter */
+    if (srcFilter || dstFilter || !(e = av_mallocz(sizeof(*e))))
+        return 0;
+
+    e->refcount   = 1;
+    e->key        = key;
+    e->filter     = *outFilter;
+    e->filterPos  = *filterPos;
+    e->filterSize = *outFilterSize;
+
+    ff_mutex_lock(&filter_cache_mutex);
+    e->next      = filter_cache;
+    filter_cache = e;
+    ff_mutex_unlock(&filter_cache_mutex);
+
+    *entry = e;
+    return 0;
+}
+
+static void releaseFilterCached(SwsFilterCacheEntry **entry,
+                                int16_t **filter, int32_t **filterPos)
+{
+    SwsFilterCacheEntry *e = *entry, *drop = NULL, **prev;
+
+    if (!e)
+        return;
+
+    ff_mutex_lock(&filter_cache_mutex);
+    if (!--e->refcount && ++filter_cache_idle > FILTER_CACHE_MAX_IDLE) {
+        /* drop the least recently used idle entry */
+        SwsFilterCacheEntry **drop_prev = NULL;
+
+        for (prev = &filter_cache; *prev; prev = &(*prev)->next)
+            if (!(*prev)->refcount)
+                drop_prev = prev;
+        drop       = *drop_prev;
+        *drop_prev = drop->next;
+        filter_cache_idle--;
+    }
+    ff_mutex_unlock(&filter_cache_mutex);
+
+    if (drop)
+        filter_cache_entry_free(drop);
+
+    *entry     = NULL;
+    *filter    = NULL;
+    *filterPos = NULL;
+}
+
 static void fill_rgb2yuv_table(SwsContext *c, const int table[4], int dstRange)
 {
     int64_t W, V, Z, Cy, Cu, Cv;
@@ -1189,16 +1336,17 @@ SwsContext *sws_alloc_context(void)
     return c;
 }
 
-static uint16_t * alloc_gamma_tbl(double e)
+static uint16_t * alloc_gamma_tbl(double e, int depth)
 {
     int i = 0;
+    int max = (1 << depth) - 1;
     uint16_t * tbl;
-    tbl = (uint16_t*)av_malloc(sizeof(uint16_t) * 1 << 16);
+    tbl = (uint16_t*)av_malloc(sizeof(uint16_t) << depth);
     if (!tbl)
         return NULL;
 
-    for (i = 0; i < 65536; ++i) {
-        tbl[i] = pow(i / 65535.0, e) * 65535.0;
+    for (i = 0; i <= max; ++i) {
+        tbl[i] = lrint(pow(i / (double)max, e) * 65535.0);
     }
     return tbl;
 }
@@ -1561,10 +1709,11 @@ static av_cold int sws_init_single_context(SwsContext *c, SwsFilter *srcFilter,
 
     // hardcoded for now
     c->gamma_value = 2.2;
-    tmpFmt = AV_PIX_FMT_RGBA64LE;
+    // scaling alpha is only needed if it is kept
+    tmpFmt = isALPHA(srcFormat) && isALPHA(dstFormat) ? AV_PIX_FMT_RGBA64 : AV_PIX_FMT_RGB48;
 
 
-    if (!unscaled && c->gamma_flag && (srcFormat != tmpFmt || dstFormat != tmpFmt)) {
+    if (!unscaled && c->gamma_flag) {
         SwsContext *c2;
         c->cascaded_context[0] = NULL;
 
@@ -1573,11 +1722,21 @@ static av_cold int sws_init_single_context(SwsContext *c, SwsFilter *srcFilter,
         if (ret < 0)
             return ret;
 
-        c->cascaded_context[0] = sws_getContext(srcW, srcH, srcFormat,
-                                                srcW, srcH, tmpFmt,
-                                                flags, NULL, NULL, c->param);
-        if (!c->cascaded_context[0]) {
-            return AVERROR(ENOMEM);
+        // RGB input is converted to linear light right away, other
+        // formats are converted to tmpFmt first
+        if (ff_sws_gamma_linearize_supported(srcFormat)) {
+            const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(srcFormat);
+
+            c->gamma = alloc_gamma_tbl(c->gamma_value, desc->comp[0].depth);
+            if (!c->gamma)
+                return AVERROR(ENOMEM);
+        } else {
+            c->cascaded_context[0] = sws_getContext(srcW, srcH, srcFormat,
+                                                    srcW, srcH, tmpFmt,
+                                                    flags, NULL, NULL, c->param);
+            if (!c->cascaded_context[0]) {
+                return AVERROR(ENOMEM);
+            }
         }
 
         c->cascaded_context[1] = sws_getContext(srcW, srcH, tmpFmt,
@@ -1587,11 +1746,17 @@ static av_cold int sws_init_single_context(SwsContext *c, SwsFilter *srcFilter,
         if (!c->cascaded_context[1])
             return AVERROR(ENOMEM);
 
+        // the scaler works on linear light: c2->gamma decodes its input,
+        // unless that is done above, c2->inv_gamma encodes its output again
         c2 = c->cascaded_context[1];
         c2->is_internal_gamma = 1;
-        c2->gamma     = alloc_gamma_tbl(    c->gamma_value);
-        c2->inv_gamma = alloc_gamma_tbl(1.f/c->gamma_value);
-        if (!c2->gamma || !c2->inv_gamma)
+        if (c->cascaded_context[0]) {
+            c2->gamma = alloc_gamma_tbl(c->gamma_value, 16);
+            if (!c2->gamma)
+                return AVERROR(ENOMEM);
+        }
+        c2->inv_gamma = alloc_gamma_tbl(1.f/c->gamma_value, 16);
+        if (!c2->inv_gamma)
             return AVERROR(ENOMEM);
 
         // is_internal_flag is set after creating the context
@@ -1808,28 +1973,26 @@ static av_cold int sws_init_single_context(SwsContext *c, SwsFilter *srcFilter,
                                     have_neon(cpu_flags)   ? 4 :
                                     have_lasx(cpu_flags)   ? 8 : 1;
 
-            if ((ret = initFilter(&c->hLumFilter, &c->hLumFilterPos,
+            if ((ret = initFilterCached(c, &c->filter_cache[0],
+                           &c->hLumFilter, &c->hLumFilterPos,
                            &c->hLumFilterSize, c->lumXInc,
                            srcW, dstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
                            cpu_flags, srcFilter->lumH, dstFilter->lumH,
                            c->param,
                            get_local_pos(c, 0, 0, 0),
-                           get_local_pos(c, 0, 0, 0))) < 0)
+                           get_local_pos(c, 0, 0, 0), 1)) < 0)
                 goto fail;
-            if (ff_shuffle_filter_coefficients(c, c->hLumFilterPos, c->hLumFilterSize, c->hLumFilter, dstW) < 0)
-                goto nomem;
-            if ((ret = initFilter(&c->hChrFilter, &c->hChrFilterPos,
+            if ((ret = initFilterCached(c, &c->filter_cache[1],
+                           &c->hChrFilter, &c->hChrFilterPos,
                            &c->hChrFilterSize, c->chrXInc,
                            c->chrSrcW, c->chrDstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
                            cpu_flags, srcFilter->chrH, dstFilter->chrH,
                            c->param,
                            get_local_pos(c, c->chrSrcHSubSample, c->src_h_chr_pos, 0),
-                           get_local_pos(c, c->chrDstHSubSample, c->dst_h_chr_pos, 0))) < 0)
+                           get_local_pos(c, c->chrDstHSubSample, c->dst_h_chr_pos, 0), 1)) < 0)
                 goto fail;
-            if (ff_shuffle_filter_coefficients(c, c->hChrFilterPos, c->hChrFilterSize, c->hChrFilter, c->chrDstW) < 0)
-                goto nomem;
         }
     } // initialize horizontal stuff
 
@@ -1839,22 +2002,24 @@ static av_cold int sws_init_single_context(SwsContext *c, SwsFilter *srcFilter,
                                 PPC_ALTIVEC(cpu_flags) ? 8 :
                                 have_neon(cpu_flags)   ? 2 : 1;
 
-        if ((ret = initFilter(&c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
+        if ((ret = initFilterCached(c, &c->filter_cache[2],
+                       &c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
                        c->lumYInc, srcH, dstH, filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
                        cpu_flags, srcFilter->lumV, dstFilter->lumV,
                        c->param,
                        get_local_pos(c, 0, 0, 1),
-                       get_local_pos(c, 0, 0, 1))) < 0)
+                       get_local_pos(c, 0, 0, 1), 0)) < 0)
             goto fail;
-        if ((ret = initFilter(&c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
+        if ((ret = initFilterCached(c, &c->filter_cache[3],
+                       &c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
                        c->chrYInc, c->chrSrcH, c->chrDstH,
                        filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
                        cpu_flags, srcFilter->chrV, dstFilter->chrV,
                        c->param,
                        get_local_pos(c, c->chrSrcVSubSample, c->src_v_chr_pos, 1),
-                       get_local_pos(c, c->chrDstVSubSample, c->dst_v_chr_pos, 1))) < 0)
+                       get_local_pos(c, c->chrDstVSubSample, c->dst_v_chr_pos, 1), 0)) < 0)
 
             goto fail;
 
@@ -1938,6 +2103,31 @@ static av_cold int sws_init_single_context(SwsContext *c, SwsFilter *srcFilter,
 
     ff_sws_init_scale(c);
 
+    if (c->convert_fused) {
+        /* even sizes, so that downscaling by 3 gets the unrolled 12 taps */
+        if ((ret = initFilter(&c->fusedLumFilter, &c->fusedLumFilterPos,
+                              &c->fusedLumFilterSize, c->lumXInc,
+                              srcW, dstW, 2, 1 << 14,
+                              (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
+                              cpu_flags, srcFilter->lumH, dstFilter->lumH,
+                              c->param,
+                              get_local_pos(c, 0, 0, 0),
+                              get_local_pos(c, 0, 0, 0))) < 0)
+            goto fail;
+        if ((ret = initFilter(&c->fusedChrFilter, &c->fusedChrFilterPos,
+                              &c->fusedChrFilterSize, c->chrXInc,
+                              c->chrSrcW, c->chrDstW, 2, 1 << 14,
+                              (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
+                              cpu_flags, srcFilter->chrH, dstFilter->chrH,
+                              c->param,
+                              get_local_pos(c, c->chrSrcHSubSample, c->src_h_chr_pos, 0),
+                              get_local_pos(c, c->chrDstHSubSample, c->dst_h_chr_pos, 0))) < 0)
+            goto fail;
+        if (!FF_ALLOCZ_TYPED_ARRAY(c->fused_tmp, srcW + c->fusedLumFilterSize +
+                                   2 * (c->chrSrcW + c->fusedChrFilterSize)))
+            goto nomem;
+    }
+
     return ff_init_filters(c);
 nomem:
     ret = AVERROR(ENOMEM);
@@ -1979,15 +2169,17 @@ static int context_init_threaded(SwsContext *c,
 {
     int ret;
 
-    ret = avpriv_slicethread_create(&c->slicethread, (void*)c,
-                                    ff_sws_slice_worker, NULL, c->nb_threads);
-    if (ret == AVERROR(ENOSYS)) {
-        c->nb_threads = 1;
-        return 0;
-    } else if (ret < 0)
-        return ret;
+    if (!c->shared_threads) {
+        ret = avpriv_slicethread_create(&c->slicethread, (void*)c,
+                                        ff_sws_slice_worker, NULL, c->nb_threads);
+        if (ret == AVERROR(ENOSYS)) {
+            c->nb_threads = 1;
+            return 0;
+        } else if (ret < 0)
+            return ret;
 
-    c->nb_threads = ret;
+        c->nb_threads = ret;
+    }
 
     c->slice_ctx = av_calloc(c->nb_threads, sizeof(*c->slice_ctx));
     c->slice_err = av_calloc(c->nb_threads, sizeof(*c->slice_err));
@@ -2014,9 +2206,24 @@ static int context_init_threaded(SwsContext *c,
         c->nb_slice_ctx++;
 
         if (c->slice_ctx[i]->dither == SWS_DITHER_ED) {
-            av_log(c, AV_LOG_VERBOSE,
-                   "Error-diffusion dither is in use, scaling will be single-threaded.");
-            break;
+            SwsContext *s = c->slice_ctx[i];
+
+            /* slices only approximate the error carried over from the lines
+             * above them, so the output depends on the number of threads;
+             * cascaded contexts would have to redo the first pass for every
+             * slice */
+            if (!c->ed_slices || (c->flags & SWS_BITEXACT) ||
+                s->cascaded_context[1]) {
+                av_log(c, AV_LOG_VERBOSE,
+                       "Error-diffusion dither is in use, scaling will be single-threaded.\n");
+                break;
+            }
+
+            s->ed_warmup_lines = FFALIGN(ED_WARMUP_LINES, s->dst_slice_align);
+            ret = av_image_alloc(s->ed_warmup, s->ed_warmup_stride,
+                                 s->dstW, s->ed_warmup_lines, s->dstFormat, 16);
+            if (ret < 0)
+                return ret;
         }
     }
 
@@ -2433,6 +2640,11 @@ void sws_freeContext(SwsContext *c)
 
     av_freep(&c->src_ranges.ranges);
 
+    releaseFilterCached(&c->filter_cache[0], &c->hLumFilter, &c->hLumFilterPos);
+    releaseFilterCached(&c->filter_cache[1], &c->hChrFilter, &c->hChrFilterPos);
+    releaseFilterCached(&c->filter_cache[2], &c->vLumFilter, &c->vLumFilterPos);
+    releaseFilterCached(&c->filter_cache[3], &c->vChrFilter, &c->vChrFilterPos);
+
     av_freep(&c->vLumFilter);
     av_freep(&c->vChrFilter);
     av_freep(&c->hLumFilter);
@@ -2447,6 +2659,12 @@ void sws_freeContext(SwsContext *c)
     av_freep(&c->hLumFilterPos);
     av_freep(&c->hChrFilterPos);
 
+    av_freep(&c->fusedLumFilter);
+    av_freep(&c->fusedChrFilter);
+    av_freep(&c->fusedLumFilterPos);
+    av_freep(&c->fusedChrFilterPos);
+    av_freep(&c->fused_tmp);
+
 #if HAVE_MMX_INLINE
 #if USE_MMAP
     if (c->lumMmxextFilterCode)
@@ -2481,6 +2699,7 @@ void sws_freeContext(SwsContext *c)
 
     av_freep(&c->rgb0_scratch);
     av_freep(&c->xyz_scratch);
+    av_freep(&c->ed_warmup[0]);
 
     ff_free_filters(c);
 
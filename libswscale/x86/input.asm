@@ -341,8 +341,13 @@ RGB24_FUNCS 11, 13
 ; %2-5 = rgba, bgra, argb or abgr (in individual characters)
 %macro RGB32_TO_Y_FN 5-6
 cglobal %2%3%4%5 %+ ToY, 6, 6, %1, dst, src, u1, u2, w, table
+%if mmsize == 64
+    vbroadcasti128 m5, [rgba_Ycoeff_%2%4]
+    vbroadcasti128 m6, [rgba_Ycoeff_%3%5]
+%else
     mova           m5, [rgba_Ycoeff_%2%4]
     mova           m6, [rgba_Ycoeff_%3%5]
+%endif
 %if %0 == 6
     jmp mangle(private_prefix %+ _ %+ %6 %+ ToY %+ SUFFIX).body
 %else ; %0 == 6
@@ -355,8 +360,13 @@ cglobal %2%3%4%5 %+ ToY, 6, 6, %1, dst, src, u1, u2, w, table
     lea          srcq, [srcq+wq*2]
     add          dstq, wq
     neg            wq
+%if mmsize == 64
+    vpbroadcastd   m4, [rgb_Yrnd]
+    vpternlogd     m7, m7, m7, 0xff
+%else
     mova           m4, [rgb_Yrnd]
     pcmpeqb        m7, m7
+%endif
     psrlw          m7, 8                  ; (word) { 0x00ff } x4
 .loop:
     ; FIXME check alignment and use mova
@@ -373,8 +383,14 @@ cglobal %2%3%4%5 %+ ToY, 6, 6, %1, dst, src, u1, u2, w, table
     paddd          m2, m3                 ; (dword) { Y[4-7] }
     psrad          m0, 9
     psrad          m2, 9
+%if mmsize == 64
+    ; packssdw would interleave the 128-bit lanes
+    vpmovsdw [dstq+wq], m0                ; (word) { Y[0-15] }
+    vpmovsdw [dstq+wq+mmsize/2], m2       ; (word) { Y[16-31] }
+%else
     packssdw       m0, m2                 ; (word) { Y[0-7] }
     mova    [dstq+wq], m0
+%endif
     add            wq, mmsize
     jl .loop
     sub            wq, mmsize - 1
@@ -382,7 +398,7 @@ cglobal %2%3%4%5 %+ ToY, 6, 6, %1, dst, src, u1, u2, w, table
     add            srcq, 2*mmsize - 2
     add            dstq, mmsize - 1
 .loop2:
-    movd           m0, [srcq+wq*2+0]      ; (byte) { Bx, Gx, Rx, xx }[0-3]
+    movd          xm0, [srcq+wq*2+0]      ; (byte) { Bx, Gx, Rx, xx }[0-3]
     DEINTB          1,  0,  3,  2,  7     ; (word) { Gx, xx (m0/m2) or Bx, Rx (m1/m3) }[0-3]/[4-7]
     pmaddwd        m1, m5                 ; (dword) { Bx*BY + Rx*RY }[0-3]
     pmaddwd        m0, m6                 ; (dword) { Gx*GY }[0-3]
@@ -390,7 +406,7 @@ cglobal %2%3%4%5 %+ ToY, 6, 6, %1, dst, src, u1, u2, w, table
     paddd          m0, m1                 ; (dword) { Y[0-3] }
     psrad          m0, 9
     packssdw       m0, m0                 ; (word) { Y[0-7] }
-    movd    [dstq+wq], m0
+    movd    [dstq+wq], xm0
     add            wq, 2
     jl .loop2
 .end:
@@ -402,7 +418,16 @@ cglobal %2%3%4%5 %+ ToY, 6, 6, %1, dst, src, u1, u2, w, table
 ; %2-5 = rgba, bgra, argb or abgr (in individual characters)
 %macro RGB32_TO_UV_FN 5-6
 cglobal %2%3%4%5 %+ ToUV, 7, 7, %1, dstU, dstV, u1, src, u2, w, table
-%if ARCH_X86_64
+%if mmsize == 64
+    vbroadcasti128 m8, [rgba_Ucoeff_%2%4]
+    vbroadcasti128 m9, [rgba_Ucoeff_%3%5]
+    vbroadcasti128 m10, [rgba_Vcoeff_%2%4]
+    vbroadcasti128 m11, [rgba_Vcoeff_%3%5]
+%define coeffU1 m8
+%define coeffU2 m9
+%define coeffV1 m10
+%define coeffV2 m11
+%elif ARCH_X86_64
     mova           m8, [rgba_Ucoeff_%2%4]
     mova           m9, [rgba_Ucoeff_%3%5]
     mova          m10, [rgba_Vcoeff_%2%4]
@@ -432,9 +457,15 @@ cglobal %2%3%4%5 %+ ToUV, 7, 7, %1, dstU, dstV, u1, src, u2, w, table
     add         dstVq, wq
     lea          srcq, [srcq+wq*2]
     neg            wq
+%if mmsize == 64
+    vpternlogd     m7, m7, m7, 0xff
+    psrlw          m7, 8                  ; (word) { 0x00ff } x4
+    vpbroadcastd   m6, [rgb_UVrnd]
+%else
     pcmpeqb        m7, m7
     psrlw          m7, 8                  ; (word) { 0x00ff } x4
     mova           m6, [rgb_UVrnd]
+%endif
 .loop:
     ; FIXME check alignment and use mova
     movu           m0, [srcq+wq*2+0]      ; (byte) { Bx, Gx, Rx, xx }[0-3]
@@ -460,10 +491,18 @@ cglobal %2%3%4%5 %+ ToUV, 7, 7, %1, dstU, dstV, u1, src, u2, w, table
     psrad          m2, 9
     psrad          m4, 9
     psrad          m1, 9
+%if mmsize == 64
+    ; packssdw would interleave the 128-bit lanes
+    vpmovsdw [dstUq+wq], m0               ; (word) { U[0-15] }
+    vpmovsdw [dstUq+wq+mmsize/2], m4      ; (word) { U[16-31] }
+    vpmovsdw [dstVq+wq], m2               ; (word) { V[0-15] }
+    vpmovsdw [dstVq+wq+mmsize/2], m1      ; (word) { V[16-31] }
+%else
     packssdw       m0, m4                 ; (word) { U[0-7] }
     packssdw       m2, m1                 ; (word) { V[0-7] }
     mova   [dstUq+wq], m0
     mova   [dstVq+wq], m2
+%endif
     add            wq, mmsize
     jl .loop
     sub            wq, mmsize - 1
@@ -472,7 +511,7 @@ cglobal %2%3%4%5 %+ ToUV, 7, 7, %1, dstU, dstV, u1, src, u2, w, table
     add            dstUq, mmsize - 1
     add            dstVq, mmsize - 1
 .loop2:
-    movd           m0, [srcq+wq*2]        ; (byte) { Bx, Gx, Rx, xx }[0-3]
+    movd          xm0, [srcq+wq*2]        ; (byte) { Bx, Gx, Rx, xx }[0-3]
     DEINTB          1,  0,  5,  4,  7     ; (word) { Gx, xx (m0/m4) or Bx, Rx (m1/m5) }[0-3]/[4-7]
     pmaddwd        m3, m1, coeffV1        ; (dword) { Bx*BV + Rx*RV }[0-3]
     pmaddwd        m2, m0, coeffV2        ; (dword) { Gx*GV }[0-3]
@@ -486,8 +525,8 @@ cglobal %2%3%4%5 %+ ToUV, 7, 7, %1, dstU, dstV, u1, src, u2, w, table
     psrad          m2, 9
     packssdw       m0, m0                 ; (word) { U[0-7] }
     packssdw       m2, m2                 ; (word) { V[0-7] }
-    movd   [dstUq+wq], m0
-    movd   [dstVq+wq], m2
+    movd   [dstUq+wq], xm0
+    movd   [dstVq+wq], xm2
     add            wq, 2
     jl .loop2
 .end:
@@ -517,6 +556,11 @@ INIT_XMM avx
 RGB32_FUNCS 8, 12
 %endif
 
+%if ARCH_X86_64 && HAVE_AVX512ICL_EXTERNAL
+INIT_ZMM avx512icl
+RGB32_FUNCS 8, 12
+%endif
+
 ;-----------------------------------------------------------------------------
 ; YUYV/UYVY/NV12/NV21 packed pixel shuffling.
 ;
@@ -701,6 +745,93 @@ NVXX_TO_UV_FN 5, nv12
 NVXX_TO_UV_FN 5, nv21
 %endif
 
+;-----------------------------------------------------------------------------
+; P010/P012/P016 (little-endian, data in the high bits) to Y/UV
+;
+; void <fmt>LEToY_<opt>(uint8_t *dst, const uint8_t *src, const uint8_t *unused1,
+;                       const uint8_t *unused2, int w, uint32_t *unused, void *opq)
+; void <fmt>LEToUV_<opt>(uint8_t *dstU, uint8_t *dstV, const uint8_t *unused0,
+;                        const uint8_t *src1, const uint8_t *src2, int w,
+;                        uint32_t *unused, void *opq)
+;-----------------------------------------------------------------------------
+
+; %1 = p010 or p012
+; %2 = shift
+%macro P01X_TO_Y_FN 2
+cglobal %1LEToY, 5, 5, 2, dst, src, unused1, unused2, w
+%if ARCH_X86_64
+    movsxd         wq, wd
+%endif
+    lea          srcq, [srcq+wq*2]
+    lea          dstq, [dstq+wq*2]
+    neg            wq
+.loop:
+    movu           m0, [srcq+wq*2]
+    movu           m1, [srcq+wq*2+mmsize]
+    psrlw          m0, %2
+    psrlw          m1, %2
+    movu [dstq+wq*2], m0
+    movu [dstq+wq*2+mmsize], m1
+    add            wq, mmsize
+    jl .loop
+    RET
+%endmacro
+
+; %1 = p010, p012 or p016
+; %2 = shift
+%macro P01X_TO_UV_FN 2
+cglobal %1LEToUV, 4, 5, 4, dstU, dstV, unused, src, w
+%if ARCH_X86_64
+    movsxd         wq, dword r5m
+%else ; x86-32
+    mov            wq, r5m
+%endif
+    lea          srcq, [srcq+wq*4]
+    lea         dstUq, [dstUq+wq*2]
+    lea         dstVq, [dstVq+wq*2]
+    neg            wq
+.loop:
+    movu           m0, [srcq+wq*4]        ; (word) { U0, V0, U1, V1, ... }
+    movu           m1, [srcq+wq*4+mmsize]
+    pslld          m2, m0, 16
+    pslld          m3, m1, 16
+    psrad          m2, 16                 ; (dword) { U0, U1, ... }
+    psrad          m3, 16
+    psrad          m0, 16                 ; (dword) { V0, V1, ... }
+    psrad          m1, 16
+    packssdw       m2, m3
+    packssdw       m0, m1
+%if mmsize == 32
+    vpermq         m2, m2, q3120
+    vpermq         m0, m0, q3120
+%endif
+%if %2
+    psrlw          m2, %2
+    psrlw          m0, %2
+%endif
+    movu [dstUq+wq*2], m2
+    movu [dstVq+wq*2], m0
+    add            wq, mmsize / 2
+    jl .loop
+    RET
+%endmacro
+
+INIT_XMM sse2
+P01X_TO_Y_FN  p010, 6
+P01X_TO_Y_FN  p012, 4
+P01X_TO_UV_FN p010, 6
+P01X_TO_UV_FN p012, 4
+P01X_TO_UV_FN p016, 0
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+P01X_TO_Y_FN  p010, 6
+P01X_TO_Y_FN  p012, 4
+P01X_TO_UV_FN p010, 6
+P01X_TO_UV_FN p012, 4
+P01X_TO_UV_FN p016, 0
+%endif
+
 %if ARCH_X86_64
 %define RY_IDX 0
 %define GY_IDX 1
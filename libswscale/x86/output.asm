@@ -27,8 +27,10 @@ SECTION_RODATA 32
 
 minshort:      times 8 dw 0x8000
 yuv2yuvX_16_start:  times 4 dd 0x4000 - 0x40000000
+yuv2yuvX_12_start:  times 4 dd 0x4000
 yuv2yuvX_10_start:  times 4 dd 0x10000
 yuv2yuvX_9_start:   times 4 dd 0x20000
+yuv2yuvX_12_upper:  times 8 dw 0xfff
 yuv2yuvX_10_upper:  times 8 dw 0x3ff
 yuv2yuvX_9_upper:   times 8 dw 0x1ff
 pd_4:          times 4 dd 4
@@ -38,6 +40,8 @@ pw_32:         times 8 dw 32
 pd_255:        times 8 dd 255
 pw_512:        times 8 dw 512
 pw_1024:       times 8 dw 1024
+pw_4:          times 8 dw 4
+pw_4096:       times 8 dw 4096
 pd_65535_invf:             times 8 dd 0x37800080 ;1.0/65535.0
 pd_yuv2gbrp16_start:       times 8 dd -0x40000000
 pd_yuv2gbrp_y_start:       times 8 dd  (1 << 9)
@@ -92,6 +96,7 @@ yuv2nv21_shuffle_mask: times 2 db 4,  0, 12,  8, \
                                  -1, -1, -1, -1, \
                                  -1, -1, -1, -1
 yuv2nv12_permute_mask: dd 0, 4, 1, 2, 3, 5, 6, 7
+yuv2p01x_interleave_mask: db 0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15
 
 SECTION .text
 
@@ -106,11 +111,15 @@ SECTION .text
 ;                                     const uint8_t *dither, int offset)
 ;
 ; Scale one or $filterSize lines of source data to generate one line of output
-; data. The input is 15 bits in int16_t if $output_size is [8,10] and 19 bits in
+; data. The input is 15 bits in int16_t if $output_size is [8,12] and 19 bits in
 ; int32_t if $output_size is 16. $filter is 12 bits. $filterSize is a multiple
 ; of 2. $offset is either 0 or 3. $dither holds 8 values.
+;
+; The yuv2p0<output_size>l1/lX variants write the luma plane of the P01x
+; formats, which store $output_size bits in the high bits of each word.
 ;-----------------------------------------------------------------------------
-%macro yuv2planeX_mainloop 2
+; %1 = output-bpc, %2 = alignment (u/a), %3 = output shift (p01x)
+%macro yuv2planeX_mainloop 3
 .pixelloop_%2:
 %assign %%i 0
     ; the rep here is for the 8-bit output MMX case, where dither covers
@@ -133,10 +142,10 @@ SECTION .text
     mova            m2,  m8
     mova            m1,  m_dith
 %endif ; x86-32/64
-%else ; %1 == 9/10/16
+%else ; %1 == 9/10/12/16
     mova            m1, [yuv2yuvX_%1_start]
     mova            m2,  m1
-%endif ; %1 == 8/9/10/16
+%endif ; %1 == 8/9/10/12/16
     movsx     cntr_reg,  fltsizem
 .filterloop_%2_ %+ %%i:
     ; input pixels
@@ -203,7 +212,7 @@ SECTION .text
 %if %1 == 16
     packssdw        m2,  m1
     paddw           m2, [minshort]
-%else ; %1 == 9/10
+%else ; %1 == 9/10/12
 %if cpuflag(sse4)
     packusdw        m2,  m1
 %else ; mmxext/sse2
@@ -211,7 +220,10 @@ SECTION .text
     pmaxsw          m2,  m6
 %endif ; mmxext/sse2/sse4/avx
     pminsw          m2, [yuv2yuvX_%1_upper]
-%endif ; %1 == 9/10/16
+%if %3
+    psllw           m2,  %3
+%endif ; p01x
+%endif ; %1 == 9/10/12/16
     mov%2   [dstq+r5*2],  m2
 %endif ; %1 == 8/9/10/16
 
@@ -223,7 +235,9 @@ SECTION .text
     jg .pixelloop_%2
 %endmacro
 
-%macro yuv2planeX_fn 3
+; %1 = output-bpc, %2 = nr. of XMM registers, %3 = nr. of arguments,
+; %4 = output shift (0 for planar formats, 16 - %1 for p01x)
+%macro yuv2planeX_fn 3-4 0
 
 %if ARCH_X86_32
 %define cntr_reg fltsizeq
@@ -233,10 +247,14 @@ SECTION .text
 %define movsx movsxd
 %endif
 
+%if %4
+cglobal yuv2p0%1lX, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
+%else
 cglobal yuv2planeX_%1, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
-%if %1 == 8 || %1 == 9 || %1 == 10
+%endif
+%if %1 == 8 || %1 == 9 || %1 == 10 || %1 == 12
     pxor            m6,  m6
-%endif ; %1 == 8/9/10
+%endif ; %1 == 8/9/10/12
 
 %if %1 == 8
 %if ARCH_X86_32
@@ -292,14 +310,14 @@ cglobal yuv2planeX_%1, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
     xor             r5,  r5
 
 %if mmsize == 8 || %1 == 8
-    yuv2planeX_mainloop %1, a
+    yuv2planeX_mainloop %1, a, %4
 %else ; mmsize == 16
     test          dstq, 15
     jnz .unaligned
-    yuv2planeX_mainloop %1, a
+    yuv2planeX_mainloop %1, a, %4
     RET
 .unaligned:
-    yuv2planeX_mainloop %1, u
+    yuv2planeX_mainloop %1, u, %4
 %endif ; mmsize == 8/16
 
 %if %1 == 8
@@ -323,11 +341,15 @@ INIT_XMM sse2
 yuv2planeX_fn  8, 10, 7
 yuv2planeX_fn  9,  7, 5
 yuv2planeX_fn 10,  7, 5
+yuv2planeX_fn 10,  7, 5, 6
+yuv2planeX_fn 12,  7, 5, 4
 
 INIT_XMM sse4
 yuv2planeX_fn  8, 10, 7
 yuv2planeX_fn  9,  7, 5
 yuv2planeX_fn 10,  7, 5
+yuv2planeX_fn 10,  7, 5, 6
+yuv2planeX_fn 12,  7, 5, 4
 yuv2planeX_fn 16,  8, 5
 
 %if HAVE_AVX_EXTERNAL
@@ -335,10 +357,12 @@ INIT_XMM avx
 yuv2planeX_fn  8, 10, 7
 yuv2planeX_fn  9,  7, 5
 yuv2planeX_fn 10,  7, 5
+yuv2planeX_fn 10,  7, 5, 6
+yuv2planeX_fn 12,  7, 5, 4
 %endif
 
-; %1=outout-bpc, %2=alignment (u/a)
-%macro yuv2plane1_mainloop 2
+; %1=outout-bpc, %2=alignment (u/a), %3=output shift (p01x)
+%macro yuv2plane1_mainloop 3
 .loop_%2:
 %if %1 == 8
     paddsw          m0, m2, [srcq+wq*2+mmsize*0]
@@ -367,7 +391,7 @@ yuv2planeX_fn 10,  7, 5
 %endif ; mmx/sse2/sse4/avx
     mov%2    [dstq+wq*2+mmsize*0], m0
     mov%2    [dstq+wq*2+mmsize*1], m2
-%else ; %1 == 9/10
+%else ; %1 == 9/10/12
     paddsw          m0, m2, [srcq+wq*2+mmsize*0]
     paddsw          m1, m2, [srcq+wq*2+mmsize*1]
     psraw           m0, 15 - %1
@@ -376,6 +400,10 @@ yuv2planeX_fn 10,  7, 5
     pmaxsw          m1, m4
     pminsw          m0, m3
     pminsw          m1, m3
+%if %3
+    psllw           m0, %3
+    psllw           m1, %3
+%endif ; p01x
     mov%2    [dstq+wq*2+mmsize*0], m0
     mov%2    [dstq+wq*2+mmsize*1], m1
 %endif
@@ -383,8 +411,14 @@ yuv2planeX_fn 10,  7, 5
     jl .loop_%2
 %endmacro
 
-%macro yuv2plane1_fn 3
+; %1 = output-bpc, %2 = nr. of XMM registers, %3 = nr. of arguments,
+; %4 = output shift (0 for planar formats, 16 - %1 for p01x)
+%macro yuv2plane1_fn 3-4 0
+%if %4
+cglobal yuv2p0%1l1, %3, %3, %2, src, dst, w, dither, offset
+%else
 cglobal yuv2plane1_%1, %3, %3, %2, src, dst, w, dither, offset
+%endif
     movsxdifnidn    wq, wd
     add             wq, mmsize - 1
     and             wq, ~(mmsize - 1)
@@ -420,6 +454,10 @@ cglobal yuv2plane1_%1, %3, %3, %2, src, dst, w, dither, offset
     pxor            m4, m4
     mova            m3, [pw_1024]
     mova            m2, [pw_16]
+%elif %1 == 12
+    pxor            m4, m4
+    mova            m3, [pw_4096]
+    mova            m2, [pw_4]
 %else ; %1 == 16
 %if cpuflag(sse4) ; sse4/avx
     mova            m4, [pd_4]
@@ -432,10 +470,10 @@ cglobal yuv2plane1_%1, %3, %3, %2, src, dst, w, dither, offset
     ; actual pixel scaling
     test          dstq, 15
     jnz .unaligned
-    yuv2plane1_mainloop %1, a
+    yuv2plane1_mainloop %1, a, %4
     RET
 .unaligned:
-    yuv2plane1_mainloop %1, u
+    yuv2plane1_mainloop %1, u, %4
     RET
 %endmacro
 
@@ -443,6 +481,8 @@ INIT_XMM sse2
 yuv2plane1_fn  8, 5, 5
 yuv2plane1_fn  9, 5, 3
 yuv2plane1_fn 10, 5, 3
+yuv2plane1_fn 10, 5, 3, 6
+yuv2plane1_fn 12, 5, 3, 4
 yuv2plane1_fn 16, 6, 3
 
 INIT_XMM sse4
@@ -453,6 +493,8 @@ INIT_XMM avx
 yuv2plane1_fn  8, 5, 5
 yuv2plane1_fn  9, 5, 3
 yuv2plane1_fn 10, 5, 3
+yuv2plane1_fn 10, 5, 3, 6
+yuv2plane1_fn 12, 5, 3, 4
 yuv2plane1_fn 16, 5, 3
 %endif
 
@@ -570,6 +612,129 @@ yuv2nv12cX_fn yuv2nv21
 %endif
 %endif ; ARCH_X86_64
 
+;-----------------------------------------------------------------------------
+; AVX2 yuv2p01xcX implementation
+;
+; void ff_yuv2p0<output_size>cX_avx2(enum AVPixelFormat format, const uint8_t *dither,
+;                                    const int16_t *filter, int filterSize,
+;                                    const int16_t **u, const int16_t **v,
+;                                    uint8_t *dst, int dstWidth)
+;
+; Interleaved chroma of the P010/P012/P016 family (little-endian). The input is
+; 15 bits in int16_t if $output_size is 10 or 12 and 19 bits in int32_t if it
+; is 16. $filterSize may be odd. $dither is not used.
+;-----------------------------------------------------------------------------
+
+%if ARCH_X86_64
+%macro yuv2p01xcX_fn 1
+cglobal yuv2p0%1cX, 8, 12, 9, fltEven, tmp, filter, filterSize, u, v, dst, dstWidth, x, j, src1, src2
+    vpbroadcastd     m6, [yuv2yuvX_%1_start]
+%if %1 == 16
+    vpbroadcastw     m7, [minshort]
+%else
+    vpbroadcastw     m7, [yuv2yuvX_%1_upper]
+    mov        fltEvend, filterSized
+    and        fltEvend, ~1                 ; coefficients done in pairs
+%endif
+    vbroadcasti128   m5, [yuv2p01x_interleave_mask]
+    xor              xq, xq
+
+.outer:
+    mova             m2, m6                 ; u
+    mova             m3, m6                 ; v
+    xor              jq, jq
+
+%if %1 == 16
+.inner:
+    vpbroadcastw    xm0, [filterq+jq*2]
+    pmovsxwd         m0, xm0                ; filter
+    mov           src1q, [uq+jq*gprsize]
+    mov           src2q, [vq+jq*gprsize]
+    pmulld           m1, m0, [src1q+xq*4]
+    pmulld           m4, m0, [src2q+xq*4]
+    paddd            m2, m1
+    paddd            m3, m4
+    inc              jd
+    cmp              jd, filterSized
+    jl .inner
+
+    psrad            m2, 15
+    psrad            m3, 15
+    packssdw         m2, m3                 ; u0-3 v0-3 | u4-7 v4-7
+    pshufb           m2, m5
+    paddw            m2, m7
+%else ; %1 == 10/12
+.inner:
+    cmp              jd, fltEvend
+    jge .tail
+    vpbroadcastd     m0, [filterq+jq*2]     ; filter[j], filter[j+1]
+    mov           src1q, [uq+jq*gprsize]
+    mov           src2q, [uq+jq*gprsize+gprsize]
+    movu            xm1, [src1q+xq*2]
+    movu            xm4, [src2q+xq*2]
+    punpckhwd       xm8, xm1, xm4
+    punpcklwd       xm1, xm1, xm4
+    vinserti128      m1, m1, xm8, 1
+    pmaddwd          m1, m0
+    paddd            m2, m1
+    mov           src1q, [vq+jq*gprsize]
+    mov           src2q, [vq+jq*gprsize+gprsize]
+    movu            xm1, [src1q+xq*2]
+    movu            xm4, [src2q+xq*2]
+    punpckhwd       xm8, xm1, xm4
+    punpcklwd       xm1, xm1, xm4
+    vinserti128      m1, m1, xm8, 1
+    pmaddwd          m1, m0
+    paddd            m3, m1
+    add              jd, 2
+    jmp .inner
+
+.tail:
+    cmp              jd, filterSized
+    jge .filter_done
+    movzx         tmpd, word [filterq+jq*2]
+    movd            xm0, tmpd
+    vpbroadcastd     m0, xm0                ; filter[j], 0
+    mov           src1q, [uq+jq*gprsize]
+    mov           src2q, [vq+jq*gprsize]
+    movu            xm1, [src1q+xq*2]
+    punpckhwd       xm8, xm1, xm1
+    punpcklwd       xm1, xm1, xm1
+    vinserti128      m1, m1, xm8, 1
+    pmaddwd          m1, m0
+    paddd            m2, m1
+    movu            xm1, [src2q+xq*2]
+    punpckhwd       xm8, xm1, xm1
+    punpcklwd       xm1, xm1, xm1
+    vinserti128      m1, m1, xm8, 1
+    pmaddwd          m1, m0
+    paddd            m3, m1
+
+.filter_done:
+    psrad            m2, 27 - %1
+    psrad            m3, 27 - %1
+    packusdw         m2, m3                 ; u0-3 v0-3 | u4-7 v4-7
+    pminuw           m2, m7
+    psllw            m2, 16 - %1
+    pshufb           m2, m5
+%endif ; %1 == 10/12/16
+
+    movu         [dstq], m2
+    add            dstq, mmsize
+    add              xd, mmsize / 4
+    cmp              xd, dstWidthd
+    jl .outer
+    RET
+%endmacro
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+yuv2p01xcX_fn 10
+yuv2p01xcX_fn 12
+yuv2p01xcX_fn 16
+%endif
+%endif ; ARCH_X86_64
+
 ;-----------------------------------------------------------------------------
 ; planar grb yuv2anyX functions
 ; void ff_yuv2<gbr_format>_full_X_<opt>(SwsContext *c, const int16_t *lumFilter,
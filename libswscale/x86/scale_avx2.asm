@@ -22,10 +22,18 @@
 
 %include "libavutil/x86/x86util.asm"
 
-SECTION_RODATA 32
+SECTION_RODATA 64
 
+; undo the swap of filterPos[2,3] <-> [4,5] and [10,11] <-> [12,13] done by
+; ff_shuffle_filter_coefficients() for the AVX2 functions
+unswap_pos: dd 0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15
+even_dwords: dd 0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30
 swizzle: dd 0, 4, 1, 5, 2, 6, 3, 7
 four: times 8 dd 4
+lane_dwords: dd 0, 1, 2, 3, 4, 5, 6, 7
+max_19bit_int: dd 0x7ffff
+minshort: times 2 dw 0x8000
+unicoeff: dd 0x20000000
 
 SECTION .text
 
@@ -147,10 +155,230 @@ cglobal hscale8to15_%1, 7, 9, 16, pos0, dst, w, srcmem, filter, fltpos, fltsize,
 RET
 %endmacro
 
+; The AVX-512 version takes the same filter layout as the AVX2 one. Pixels are
+; gathered in their natural order, so the 4 taps of each pixel end up next to
+; each other after zero extension, and the horizontal adds are done with
+; shifts, instead of vphaddd, which has no EVEX form.
+%macro SCALE_FUNC_AVX512 1
+cglobal hscale8to15_%1, 7, 9, 16, pos0, dst, w, srcmem, filter, fltpos, fltsize, count, inner
+    mova m15, [unswap_pos]
+    mova m14, [even_dwords]
+    vpbroadcastd m13, [four]
+    xor countq, countq
+    movsxd wq, wd
+%ifidn %1, X4
+    shr fltsized, 2
+%endif
+    cmp wq, 0x10
+    jl .tail_loop
+    sub wq, 0x10
+.loop:
+    vpermd m1, m15, [fltposq]
+%ifidn %1, X4
+    pxor m9, m9
+    pxor m10, m10
+    xor innerq, innerq
+.innerloop:
+%endif
+    kxnorw k1, k1, k1
+    vpgatherdd m3{k1}, [srcmemq + m1]
+    vextracti64x4 ym4, m3, 1
+    vpmovzxbw m5, ym3
+    vpmovzxbw m6, ym4
+    vpmaddwd m5, m5, [filterq]
+    vpmaddwd m6, m6, [filterq + 64]
+    add filterq, 0x80
+%ifidn %1, X4
+    paddd m9, m5
+    paddd m10, m6
+    paddd m1, m13
+    add innerq, 1
+    cmp innerq, fltsizeq
+    jl .innerloop
+    vpsrlq m7, m9, 32
+    vpsrlq m8, m10, 32
+    paddd m5, m9, m7
+    paddd m6, m10, m8
+%else
+    vpsrlq m7, m5, 32
+    vpsrlq m8, m6, 32
+    paddd m5, m7
+    paddd m6, m8
+%endif
+    vpermt2d m5, m14, m6
+    vpsrad m5, 7
+    vpmovsdw [dstq + countq * 2], m5
+    add fltposq, 0x40
+    add countq, 0x10
+    cmp countq, wq
+    jle .loop
+
+    add wq, 0x10
+    cmp countq, wq
+    jge .end
+
+.tail_loop:
+    movu xm1, [fltposq]
+%ifidn %1, X4
+    pxor ym9, ym9
+    xor innerq, innerq
+.tail_innerloop:
+%endif
+    kxnorw k1, k1, k1
+    vpgatherdd xm3{k1}, [srcmemq + xm1]
+    vpmovzxbw ym5, xm3
+    vpmaddwd ym5, ym5, [filterq]
+    add filterq, 0x20
+%ifidn %1, X4
+    paddd ym9, ym5
+    paddd xm1, xm13
+    add innerq, 1
+    cmp innerq, fltsizeq
+    jl .tail_innerloop
+    vpsrlq ym7, ym9, 32
+    paddd ym5, ym9, ym7
+%else
+    vpsrlq ym7, ym5, 32
+    paddd ym5, ym7
+%endif
+    vpmovqd xm5, ym5
+    vpsrad xm5, 7
+    vpackssdw xm5, xm5, xm5
+    vmovq [dstq + countq * 2], xm5
+    add fltposq, 0x10
+    add countq, 0x4
+    cmp countq, wq
+    jl .tail_loop
+.end:
+RET
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void hscale<source_width>to19_<filterSize>_<opt>
+;                   (SwsContext *c, int32_t *dst,
+;                    int dstW, const uint16_t *src,
+;                    const int16_t *filter,
+;                    const int32_t *filterPos, int filterSize);
+;
+; Scale one horizontal line of 9 to 16-bit input to 19 bits (in int32_t). The
+; filter is not shuffled for these, so the 4 taps of each pixel are gathered
+; as one qword, from the source and, for X4, from the filter. The last block
+; of less than 16 pixels is done with masks.
+;-----------------------------------------------------------------------------
+
+; %1 = source width, %2 = filter size (4 or X4)
+%macro SCALE_FUNC_19_AVX512 2
+cglobal hscale%1to19_%2, 7, 10, 18, pos0, dst, w, srcmem, filter, fltpos, fltsize, count, inner, tmp
+    mova m15, [even_dwords]
+    vpbroadcastd m17, [max_19bit_int]
+%if %1 == 16
+    vpbroadcastd m11, [minshort]
+    vpbroadcastd m16, [unicoeff]
+%endif
+    vpbroadcastd ym14, [four]
+    xor countq, countq
+    movsxd wq, wd
+%ifidn %2, X4
+    ; word offsets of the filters of pixels 0-7 and 8-15
+    vpbroadcastd ym12, fltsized
+    vpmulld ym12, ym12, [lane_dwords]
+    lea tmpd, [fltsizeq*8]
+    vpbroadcastd ym13, tmpd
+    paddd ym13, ym12
+    mov pos0d, fltsized
+    shl pos0d, 5
+    shr fltsized, 2
+%endif
+    kxnorw k3, k3, k3
+.loop:
+    mov tmpd, wd
+    sub tmpd, countd
+    cmp tmpd, 0x10
+    jge .block
+    mov innerd, -1
+    bzhi innerd, innerd, tmpd
+    kmovw k3, innerd
+.block:
+    kshiftrw k4, k3, 8
+    vmovdqu32 m1{k3}{z}, [fltposq + countq * 4]
+    vextracti32x8 ym2, m1, 1
+%ifidn %2, X4
+    pxor m9, m9
+    pxor m10, m10
+    mov tmpq, filterq
+    mov innerd, fltsized
+.innerloop:
+%endif
+    kmovw k1, k3
+    kmovw k2, k4
+    pxor m3, m3
+    pxor m4, m4
+    vpgatherdq m3{k1}, [srcmemq + ym1 * 2]
+    vpgatherdq m4{k2}, [srcmemq + ym2 * 2]
+%if %1 == 16
+    pxor m3, m11
+    pxor m4, m11
+%endif
+%ifidn %2, X4
+    kmovw k1, k3
+    kmovw k2, k4
+    pxor m5, m5
+    pxor m6, m6
+    vpgatherdq m5{k1}, [tmpq + ym12 * 2]
+    vpgatherdq m6{k2}, [tmpq + ym13 * 2]
+    vpmaddwd m3, m3, m5
+    vpmaddwd m4, m4, m6
+    paddd m9, m3
+    paddd m10, m4
+    paddd ym1, ym14
+    paddd ym2, ym14
+    add tmpq, 8
+    sub innerd, 1
+    jg .innerloop
+    add filterq, pos0q
+%else
+    vmovdqu64 m5{k3}{z}, [filterq]
+    vmovdqu64 m6{k4}{z}, [filterq + 64]
+    vpmaddwd m9, m3, m5
+    vpmaddwd m10, m4, m6
+    add filterq, 0x80
+%endif
+    vpsrlq m7, m9, 32
+    vpsrlq m8, m10, 32
+    paddd m9, m7
+    paddd m10, m8
+    vpermt2d m9, m15, m10
+%if %1 == 16
+    paddd m9, m16
+%endif
+    vpsrad m9, %1 - 5
+    vpminsd m9, m17
+    vmovdqu32 [dstq + countq * 4]{k3}, m9
+    add countq, 0x10
+    cmp countq, wq
+    jl .loop
+RET
+%endmacro
+
 %if ARCH_X86_64
 %if HAVE_AVX2_EXTERNAL
 INIT_YMM avx2
 SCALE_FUNC 4
 SCALE_FUNC X4
 %endif
+%if HAVE_AVX512ICL_EXTERNAL
+INIT_ZMM avx512icl
+SCALE_FUNC_AVX512 4
+SCALE_FUNC_AVX512 X4
+SCALE_FUNC_19_AVX512  9, 4
+SCALE_FUNC_19_AVX512  9, X4
+SCALE_FUNC_19_AVX512 10, 4
+SCALE_FUNC_19_AVX512 10, X4
+SCALE_FUNC_19_AVX512 12, 4
+SCALE_FUNC_19_AVX512 12, X4
+SCALE_FUNC_19_AVX512 14, 4
+SCALE_FUNC_19_AVX512 14, X4
+SCALE_FUNC_19_AVX512 16, 4
+SCALE_FUNC_19_AVX512 16, X4
+%endif
 %endif
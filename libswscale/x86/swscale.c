@@ -225,6 +225,9 @@ YUV2YUVX_FUNC(sse3, 32)
 #if HAVE_AVX2_EXTERNAL
 YUV2YUVX_FUNC(avx2, 64)
 #endif
+#if HAVE_AVX512ICL_EXTERNAL
+YUV2YUVX_FUNC(avx512icl, 128)
+#endif
 
 #define SCALE_FUNC(filter_n, from_bpc, to_bpc, opt) \
 void ff_hscale ## from_bpc ## to ## to_bpc ## _ ## filter_n ## _ ## opt( \
@@ -264,15 +267,33 @@ SCALE_FUNCS_SSE(sse4);
 
 SCALE_FUNC(4, 8, 15, avx2);
 SCALE_FUNC(X4, 8, 15, avx2);
+SCALE_FUNC(4, 8, 15, avx512icl);
+SCALE_FUNC(X4, 8, 15, avx512icl);
+
+#define SCALE_FUNCS_19(filter_n, opt) \
+    SCALE_FUNC(filter_n,  9, 19, opt); \
+    SCALE_FUNC(filter_n, 10, 19, opt); \
+    SCALE_FUNC(filter_n, 12, 19, opt); \
+    SCALE_FUNC(filter_n, 14, 19, opt); \
+    SCALE_FUNC(filter_n, 16, 19, opt)
+
+SCALE_FUNCS_19(4, avx512icl);
+SCALE_FUNCS_19(X4, avx512icl);
 
 #define VSCALEX_FUNC(size, opt) \
 void ff_yuv2planeX_ ## size ## _ ## opt(const int16_t *filter, int filterSize, \
                                         const int16_t **src, uint8_t *dest, int dstW, \
                                         const uint8_t *dither, int offset)
+#define VSCALEX_P01X_FUNC(size, opt) \
+void ff_yuv2p0 ## size ## lX_ ## opt(const int16_t *filter, int filterSize, \
+                                     const int16_t **src, uint8_t *dest, int dstW, \
+                                     const uint8_t *dither, int offset)
 #define VSCALEX_FUNCS(opt) \
     VSCALEX_FUNC(8,  opt); \
     VSCALEX_FUNC(9,  opt); \
-    VSCALEX_FUNC(10, opt)
+    VSCALEX_FUNC(10, opt); \
+    VSCALEX_P01X_FUNC(10, opt); \
+    VSCALEX_P01X_FUNC(12, opt)
 
 VSCALEX_FUNC(8, mmxext);
 VSCALEX_FUNCS(sse2);
@@ -283,10 +304,15 @@ VSCALEX_FUNCS(avx);
 #define VSCALE_FUNC(size, opt) \
 void ff_yuv2plane1_ ## size ## _ ## opt(const int16_t *src, uint8_t *dst, int dstW, \
                                         const uint8_t *dither, int offset)
+#define VSCALE_P01X_FUNC(size, opt) \
+void ff_yuv2p0 ## size ## l1_ ## opt(const int16_t *src, uint8_t *dst, int dstW, \
+                                     const uint8_t *dither, int offset)
 #define VSCALE_FUNCS(opt1, opt2) \
     VSCALE_FUNC(8,  opt1); \
     VSCALE_FUNC(9,  opt2); \
     VSCALE_FUNC(10, opt2); \
+    VSCALE_P01X_FUNC(10, opt2); \
+    VSCALE_P01X_FUNC(12, opt2); \
     VSCALE_FUNC(16, opt1)
 
 VSCALE_FUNCS(sse2, sse2);
@@ -321,6 +347,18 @@ void ff_ ## fmt ## ToUV_ ## opt(uint8_t *dstU, uint8_t *dstV, \
 INPUT_FUNCS(sse2);
 INPUT_FUNCS(ssse3);
 INPUT_FUNCS(avx);
+INPUT_FUNC(rgba, avx512icl);
+INPUT_FUNC(bgra, avx512icl);
+INPUT_FUNC(argb, avx512icl);
+INPUT_FUNC(abgr, avx512icl);
+
+#define INPUT_P01X_FUNCS(opt) \
+    INPUT_FUNC(p010LE, opt); \
+    INPUT_FUNC(p012LE, opt); \
+    INPUT_UV_FUNC(p016LE, opt)
+
+INPUT_P01X_FUNCS(sse2);
+INPUT_P01X_FUNCS(avx2);
 
 #if ARCH_X86_64
 #define YUV2NV_DECL(fmt, opt) \
@@ -331,6 +369,9 @@ void ff_yuv2 ## fmt ## cX_ ## opt(enum AVPixelFormat format, const uint8_t *dith
 
 YUV2NV_DECL(nv12, avx2);
 YUV2NV_DECL(nv21, avx2);
+YUV2NV_DECL(p010, avx2);
+YUV2NV_DECL(p012, avx2);
+YUV2NV_DECL(p016, avx2);
 
 #define YUV2GBRP_FN_DECL(fmt, opt)                                                      \
 void ff_yuv2##fmt##_full_X_ ##opt(SwsContext *c, const int16_t *lumFilter,           \
@@ -467,6 +508,10 @@ av_cold void ff_sws_init_swscale_x86(SwsContext *c)
 #if HAVE_AVX2_EXTERNAL
         if (EXTERNAL_AVX2_FAST(cpu_flags))
             c->yuv2planeX = yuv2yuvX_avx2;
+#endif
+#if HAVE_AVX512ICL_EXTERNAL
+        if (EXTERNAL_AVX512ICL(cpu_flags))
+            c->yuv2planeX = yuv2yuvX_avx512icl;
 #endif
     }
 #if ARCH_X86_32 && !HAVE_ALIGNED_STACK
@@ -503,14 +548,16 @@ av_cold void ff_sws_init_swscale_x86(SwsContext *c)
 #define ASSIGN_VSCALEX_FUNC(vscalefn, opt, do_16_case, condition_8bit) \
 switch(c->dstBpc){ \
     case 16:                          do_16_case;                          break; \
-    case 10: if (!isBE(c->dstFormat) && !isSemiPlanarYUV(c->dstFormat)) vscalefn = ff_yuv2planeX_10_ ## opt; break; \
+    case 12: if (!isBE(c->dstFormat) && isSemiPlanarYUV(c->dstFormat)) vscalefn = ff_yuv2p012lX_ ## opt; break; \
+    case 10: if (!isBE(c->dstFormat)) vscalefn = isSemiPlanarYUV(c->dstFormat) ? ff_yuv2p010lX_ ## opt : ff_yuv2planeX_10_ ## opt; break; \
     case 9:  if (!isBE(c->dstFormat)) vscalefn = ff_yuv2planeX_9_  ## opt; break; \
     case 8: if ((condition_8bit) && !c->use_mmx_vfilter) vscalefn = ff_yuv2planeX_8_  ## opt; break; \
     }
 #define ASSIGN_VSCALE_FUNC(vscalefn, opt) \
     switch(c->dstBpc){ \
     case 16: if (!isBE(c->dstFormat)) vscalefn = ff_yuv2plane1_16_ ## opt; break; \
-    case 10: if (!isBE(c->dstFormat) && !isSemiPlanarYUV(c->dstFormat)) vscalefn = ff_yuv2plane1_10_ ## opt; break; \
+    case 12: if (!isBE(c->dstFormat) && isSemiPlanarYUV(c->dstFormat)) vscalefn = ff_yuv2p012l1_ ## opt; break; \
+    case 10: if (!isBE(c->dstFormat)) vscalefn = isSemiPlanarYUV(c->dstFormat) ? ff_yuv2p010l1_ ## opt : ff_yuv2plane1_10_ ## opt; break; \
     case 9:  if (!isBE(c->dstFormat)) vscalefn = ff_yuv2plane1_9_  ## opt;  break; \
     case 8:                           vscalefn = ff_yuv2plane1_8_  ## opt;  break; \
     default: av_assert0(c->dstBpc>8); \
@@ -557,6 +604,21 @@ switch(c->dstBpc){ \
         case AV_PIX_FMT_NV21:
             c->chrToYV12 = ff_nv21ToUV_sse2;
             break;
+        case AV_PIX_FMT_P010LE:
+        case AV_PIX_FMT_P210LE:
+        case AV_PIX_FMT_P410LE:
+            c->lumToYV12 = ff_p010LEToY_sse2;
+            c->chrToYV12 = ff_p010LEToUV_sse2;
+            break;
+        case AV_PIX_FMT_P012LE:
+            c->lumToYV12 = ff_p012LEToY_sse2;
+            c->chrToYV12 = ff_p012LEToUV_sse2;
+            break;
+        case AV_PIX_FMT_P016LE:
+        case AV_PIX_FMT_P216LE:
+        case AV_PIX_FMT_P416LE:
+            c->chrToYV12 = ff_p016LEToUV_sse2;
+            break;
         case_rgb(rgb24, RGB24, sse2);
         case_rgb(bgr24, BGR24, sse2);
         case_rgb(bgra,  BGRA,  sse2);
@@ -619,17 +681,60 @@ switch(c->dstBpc){ \
     }
 
 #if ARCH_X86_64
-#define ASSIGN_AVX2_SCALE_FUNC(hscalefn, filtersize) \
+#define ASSIGN_AVX2_SCALE_FUNC(hscalefn, filtersize, opt) \
     switch (filtersize) { \
-    case 4:  hscalefn = ff_hscale8to15_4_avx2; break; \
-    default:  hscalefn = ff_hscale8to15_X4_avx2; break; \
+    case 4:  hscalefn = ff_hscale8to15_4_ ## opt; break; \
+    default:  hscalefn = ff_hscale8to15_X4_ ## opt; break; \
              break; \
     }
+#define ASSIGN_SCALE19_FUNC(hscalefn, filtersize, opt) do { \
+    if (c->srcBpc == 9) { \
+        hscalefn = ff_hscale9to19_ ## filtersize ## _ ## opt; \
+    } else if (c->srcBpc == 10) { \
+        hscalefn = ff_hscale10to19_ ## filtersize ## _ ## opt; \
+    } else if (c->srcBpc == 12) { \
+        hscalefn = ff_hscale12to19_ ## filtersize ## _ ## opt; \
+    } else if (c->srcBpc == 14 || ((c->srcFormat==AV_PIX_FMT_PAL8||isAnyRGB(c->srcFormat)) && av_pix_fmt_desc_get(c->srcFormat)->comp[0].depth<16)) { \
+        hscalefn = ff_hscale14to19_ ## filtersize ## _ ## opt; \
+    } else { /* c->srcBpc == 16 */ \
+        av_assert0(c->srcBpc == 16);\
+        hscalefn = ff_hscale16to19_ ## filtersize ## _ ## opt; \
+    } \
+} while (0)
+#define ASSIGN_AVX512_SCALE19_FUNC(hscalefn, filtersize, opt) \
+    switch (filtersize) { \
+    case 4:  ASSIGN_SCALE19_FUNC(hscalefn, 4, opt); break; \
+    default: ASSIGN_SCALE19_FUNC(hscalefn, X4, opt); break; \
+    }
 
     if (EXTERNAL_AVX2_FAST(cpu_flags) && !(cpu_flags & AV_CPU_FLAG_SLOW_GATHER)) {
         if ((c->srcBpc == 8) && (c->dstBpc <= 14)) {
-            ASSIGN_AVX2_SCALE_FUNC(c->hcScale, c->hChrFilterSize);
-            ASSIGN_AVX2_SCALE_FUNC(c->hyScale, c->hLumFilterSize);
+            ASSIGN_AVX2_SCALE_FUNC(c->hcScale, c->hChrFilterSize, avx2);
+            ASSIGN_AVX2_SCALE_FUNC(c->hyScale, c->hLumFilterSize, avx2);
+        }
+    }
+
+    /* same filter layout as the AVX2 functions, see ff_shuffle_filter_coefficients() */
+    if (EXTERNAL_AVX512ICL(cpu_flags) && !(cpu_flags & AV_CPU_FLAG_SLOW_GATHER)) {
+        if ((c->srcBpc == 8) && (c->dstBpc <= 14)) {
+            ASSIGN_AVX2_SCALE_FUNC(c->hcScale, c->hChrFilterSize, avx512icl);
+            ASSIGN_AVX2_SCALE_FUNC(c->hyScale, c->hLumFilterSize, avx512icl);
+        }
+        /* not shuffled, the 4 taps of a pixel are contiguous */
+        if ((c->srcBpc > 8) && (c->dstBpc > 14)) {
+            ASSIGN_AVX512_SCALE19_FUNC(c->hcScale, c->hChrFilterSize, avx512icl);
+            ASSIGN_AVX512_SCALE19_FUNC(c->hyScale, c->hLumFilterSize, avx512icl);
+        }
+    }
+
+    if (EXTERNAL_AVX512ICL(cpu_flags)) {
+        switch (c->srcFormat) {
+        case_rgb(bgra,  BGRA,  avx512icl);
+        case_rgb(rgba,  RGBA,  avx512icl);
+        case_rgb(abgr,  ABGR,  avx512icl);
+        case_rgb(argb,  ARGB,  avx512icl);
+        default:
+            break;
         }
     }
 
@@ -643,6 +748,39 @@ switch(c->dstBpc){ \
         case AV_PIX_FMT_NV42:
             c->yuv2nv12cX = ff_yuv2nv21cX_avx2;
             break;
+        case AV_PIX_FMT_P010LE:
+        case AV_PIX_FMT_P210LE:
+        case AV_PIX_FMT_P410LE:
+            c->yuv2nv12cX = ff_yuv2p010cX_avx2;
+            break;
+        case AV_PIX_FMT_P012LE:
+            c->yuv2nv12cX = ff_yuv2p012cX_avx2;
+            break;
+        case AV_PIX_FMT_P016LE:
+        case AV_PIX_FMT_P216LE:
+        case AV_PIX_FMT_P416LE:
+            c->yuv2nv12cX = ff_yuv2p016cX_avx2;
+            break;
+        default:
+            break;
+        }
+
+        switch (c->srcFormat) {
+        case AV_PIX_FMT_P010LE:
+        case AV_PIX_FMT_P210LE:
+        case AV_PIX_FMT_P410LE:
+            c->lumToYV12 = ff_p010LEToY_avx2;
+            c->chrToYV12 = ff_p010LEToUV_avx2;
+            break;
+        case AV_PIX_FMT_P012LE:
+            c->lumToYV12 = ff_p012LEToY_avx2;
+            c->chrToYV12 = ff_p012LEToUV_avx2;
+            break;
+        case AV_PIX_FMT_P016LE:
+        case AV_PIX_FMT_P216LE:
+        case AV_PIX_FMT_P416LE:
+            c->chrToYV12 = ff_p016LEToUV_avx2;
+            break;
         default:
             break;
         }
@@ -22,6 +22,11 @@
 
 %include "libavutil/x86/x86util.asm"
 
+SECTION_RODATA 64
+
+; qword order to undo the in-lane packuswb for 512-bit registers
+pack_permq: dq 0, 2, 4, 6, 1, 3, 5, 7
+
 SECTION .text
 
 ;-----------------------------------------------------------------------------
@@ -34,7 +39,7 @@ SECTION .text
 ;-----------------------------------------------------------------------------
 
 %macro YUV2YUVX_FUNC 0
-cglobal yuv2yuvX, 7, 7, 8, filter, filterSize, src, dest, dstW, dither, offset
+cglobal yuv2yuvX, 7, 7, 8+cpuflag(avx512), filter, filterSize, src, dest, dstW, dither, offset
 %if notcpuflag(sse3)
 %define movr mova
 %define unroll 1
@@ -69,6 +74,9 @@ cglobal yuv2yuvX, 7, 7, 8, filter, filterSize, src, dest, dstW, dither, offset
     psllw                m1, m1, 3
     paddw                m3, m3, m1
     psraw                m7, m3, 4
+%if cpuflag(avx512)
+    mova                 m8, [pack_permq]
+%endif
 .outerloop:
     mova                 m4, m7
     mova                 m3, m7
@@ -109,7 +117,10 @@ cglobal yuv2yuvX, 7, 7, 8, filter, filterSize, src, dest, dstW, dither, offset
     packuswb             m6, m6, m1
 %endif
     mov                  srcq, [filterq]
-%if cpuflag(avx2)
+%if cpuflag(avx512)
+    vpermq               m3, m8, m3
+    vpermq               m6, m8, m6
+%elif cpuflag(avx2)
     vpermq               m3, m3, 216
     vpermq               m6, m6, 216
 %endif
@@ -132,3 +143,7 @@ YUV2YUVX_FUNC
 INIT_YMM avx2
 YUV2YUVX_FUNC
 %endif
+%if HAVE_AVX512ICL_EXTERNAL
+INIT_ZMM avx512icl
+YUV2YUVX_FUNC
+%endif
@@ -0,0 +1,234 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * H.264 low_memory test: decode a generated stream without VUI bitstream
+ * restrictions, with one reference frame and reordered pictures, and print
+ * the reorder delay and the memory held with and without the option.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavutil/opt.h"
+
+#define NB_PICS 9
+
+/* picture order counts in decoding order, a two level hierarchy */
+static const int pocs[NB_PICS] = { 0, 8, 4, 2, 6, 16, 12, 10, 14 };
+
+typedef struct BitWriter {
+    uint8_t buf[64];
+    int bits;
+} BitWriter;
+
+static void put_bits(BitWriter *bw, int n, unsigned val)
+{
+    while (n--) {
+        if (val >> n & 1)
+            bw->buf[bw->bits >> 3] |= 0x80 >> (bw->bits & 7);
+        bw->bits++;
+    }
+}
+
+static void put_ue(BitWriter *bw, unsigned val)
+{
+    int len = 0;
+
+    while ((val + 1) >> (len + 1))
+        len++;
+    put_bits(bw, len, 0);
+    put_bits(bw, len + 1, val + 1);
+}
+
+/* Append the NAL unit with an Annex B start code and emulation prevention. */
+static int put_nal(uint8_t *dst, int nal_header, BitWriter *bw)
+{
+    int size = 0, zeros = 0;
+
+    put_bits(bw, 1, 1); /* rbsp_stop_one_bit */
+    dst[size++] = 0;
+    dst[size++] = 0;
+    dst[size++] = 1;
+    dst[size++] = nal_header;
+    for (int i = 0; i < (bw->bits + 7) >> 3; i++) {
+        if (zeros == 2 && bw->buf[i] <= 3) {
+            dst[size++] = 3;
+            zeros = 0;
+        }
+        zeros = bw->buf[i] ? 0 : zeros + 1;
+        dst[size++] = bw->buf[i];
+    }
+    return size;
+}
+
+/* Generate the stream, ends[i] is the end of the packet of picture i. */
+static void make_stream(uint8_t *dst, int *ends)
+{
+    BitWriter bw;
+    int size = 0;
+
+    /* SPS: baseline, level 1.0, one 16x16 macroblock, one reference frame,
+     * no VUI */
+    memset(&bw, 0, sizeof(bw));
+    put_bits(&bw, 8, 66);  /* profile_idc */
+    put_bits(&bw, 8, 0);   /* constraint flags */
+    put_bits(&bw, 8, 10);  /* level_idc */
+    put_ue(&bw, 0);        /* seq_parameter_set_id */
+    put_ue(&bw, 0);        /* log2_max_frame_num_minus4 */
+    put_ue(&bw, 0);        /* pic_order_cnt_type */
+    put_ue(&bw, 4);        /* log2_max_pic_order_cnt_lsb_minus4 */
+    put_ue(&bw, 1);        /* max_num_ref_frames */
+    put_bits(&bw, 1, 0);   /* gaps_in_frame_num_value_allowed_flag */
+    put_ue(&bw, 0);        /* pic_width_in_mbs_minus1 */
+    put_ue(&bw, 0);        /* pic_height_in_map_units_minus1 */
+    put_bits(&bw, 1, 1);   /* frame_mbs_only_flag */
+    put_bits(&bw, 1, 1);   /* direct_8x8_inference_flag */
+    put_bits(&bw, 1, 0);   /* frame_cropping_flag */
+    put_bits(&bw, 1, 0);   /* vui_parameters_present_flag */
+    size += put_nal(dst + size, 0x67, &bw);
+
+    /* PPS: CAVLC, deblocking control present */
+    memset(&bw, 0, sizeof(bw));
+    put_ue(&bw, 0);        /* pic_parameter_set_id */
+    put_ue(&bw, 0);        /* seq_parameter_set_id */
+    put_bits(&bw, 1, 0);   /* entropy_coding_mode_flag */
+    put_bits(&bw, 1, 0);   /* bottom_field_pic_order_in_frame_present_flag */
+    put_ue(&bw, 0);        /* num_slice_groups_minus1 */
+    put_ue(&bw, 0);        /* num_ref_idx_l0_default_active_minus1 */
+    put_ue(&bw, 0);        /* num_ref_idx_l1_default_active_minus1 */
+    put_bits(&bw, 1, 0);   /* weighted_pred_flag */
+    put_bits(&bw, 2, 0);   /* weighted_bipred_idc */
+    put_ue(&bw, 0);        /* pic_init_qp_minus26 */
+    put_ue(&bw, 0);        /* pic_init_qs_minus26 */
+    put_ue(&bw, 0);        /* chroma_qp_index_offset */
+    put_bits(&bw, 1, 1);   /* deblocking_filter_control_present_flag */
+    put_bits(&bw, 1, 0);   /* constrained_intra_pred_flag */
+    put_bits(&bw, 1, 0);   /* redundant_pic_cnt_present_flag */
+    size += put_nal(dst + size, 0x68, &bw);
+
+    for (int i = 0; i < NB_PICS; i++) {
+        int idr = !i;
+
+        memset(&bw, 0, sizeof(bw));
+        put_ue(&bw, 0);               /* first_mb_in_slice */
+        put_ue(&bw, idr ? 7 : 5);     /* slice_type: I or P */
+        put_ue(&bw, 0);               /* pic_parameter_set_id */
+        put_bits(&bw, 4, i);          /* frame_num */
+        if (idr)
+            put_ue(&bw, 0);           /* idr_pic_id */
+        put_bits(&bw, 8, pocs[i]);    /* pic_order_cnt_lsb */
+        if (!idr) {
+            put_bits(&bw, 1, 0);      /* num_ref_idx_active_override_flag */
+            put_bits(&bw, 1, 0);      /* ref_pic_list_modification_flag_l0 */
+        }
+        put_bits(&bw, 1, 0);          /* no_output_of_prior_pics_flag or
+                                         adaptive_ref_pic_marking_mode_flag */
+        if (idr)
+            put_bits(&bw, 1, 0);      /* long_term_reference_flag */
+        put_ue(&bw, 0);               /* slice_qp_delta */
+        put_ue(&bw, 1);               /* disable_deblocking_filter_idc */
+        if (idr) {
+            put_ue(&bw, 3);           /* mb_type: I_16x16_2_0_0, DC prediction */
+            put_ue(&bw, 0);           /* intra_chroma_pred_mode */
+            put_ue(&bw, 0);           /* mb_qp_delta */
+            put_bits(&bw, 1, 1);      /* luma DC coeff_token, no coefficients */
+        } else {
+            put_ue(&bw, 1);           /* mb_skip_run */
+        }
+        size += put_nal(dst + size, idr ? 0x65 : 0x41, &bw);
+        ends[i] = size;
+    }
+}
+
+static int decode(const uint8_t *data, const int *ends, int low_memory,
+                  int strict, int64_t *allocated)
+{
+    const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+    AVPacket *pkt = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    int ret, nb_frames = 0, has_b_frames = 0;
+
+    *allocated = 0;
+    if (!avctx || !pkt || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    avctx->thread_count = 1;
+    avctx->strict_std_compliance = strict ? FF_COMPLIANCE_STRICT : FF_COMPLIANCE_NORMAL;
+    av_opt_set_int(avctx->priv_data, "low_memory", low_memory, 0);
+    if ((ret = avcodec_open2(avctx, codec, NULL)) < 0)
+        goto end;
+
+    for (int i = 0; i <= NB_PICS; i++) {
+        if (i < NB_PICS) {
+            pkt->data = (uint8_t *)data + (i ? ends[i - 1] : 0);
+            pkt->size = ends[i] - (i ? ends[i - 1] : 0);
+        }
+        if ((ret = avcodec_send_packet(avctx, i < NB_PICS ? pkt : NULL)) < 0)
+            goto end;
+        while ((ret = avcodec_receive_frame(avctx, frame)) >= 0) {
+            int64_t bytes;
+
+            /* sampled while the reorder buffer is full */
+            av_opt_get_int(avctx->priv_data, "allocated_bytes", 0, &bytes);
+            *allocated   = FFMAX(*allocated, bytes);
+            has_b_frames = FFMAX(has_b_frames, avctx->has_b_frames);
+            nb_frames++;
+            av_frame_unref(frame);
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            goto end;
+    }
+
+    printf("low_memory=%d strict=%d: has_b_frames %d, %d frames\n",
+           low_memory, strict, has_b_frames, nb_frames);
+    ret = 0;
+
+end:
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    avcodec_free_context(&avctx);
+    return ret;
+}
+
+int main(void)
+{
+    uint8_t stream[1024];
+    int64_t allocated[2];
+    int ends[NB_PICS];
+
+    make_stream(stream, ends);
+
+    for (int strict = 0; strict < 2; strict++) {
+        for (int low_memory = 0; low_memory < 2; low_memory++) {
+            if (decode(stream, ends, low_memory, strict, &allocated[low_memory]) < 0) {
+                fprintf(stderr, "Decoding failed\n");
+                return 1;
+            }
+        }
+        printf("strict=%d: low_memory holds %s memory\n", strict,
+               allocated[1] < allocated[0] ? "less" :
+               allocated[1] == allocated[0] ? "the same" : "more");
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * av_parser_parse_ref() test: frames that lie inside the input buffer must
+ * reference it, frames straddling input buffers must be copied.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavutil/mem.h"
+
+#define NB_FRAMES 4
+
+/* SOI, a COM segment carrying the frame number, EOI */
+static int make_frame(uint8_t *dst, int n)
+{
+    static const uint8_t hdr[] = { 0xFF, 0xD8, 0xFF, 0xFE, 0x00, 0x06 };
+    memcpy(dst, hdr, sizeof(hdr));
+    dst[6] = 'F';
+    dst[7] = '0' + n;
+    dst[8] = 0x55;
+    dst[9] = 0xAA;
+    dst[10] = 0xFF;
+    dst[11] = 0xD9;
+    return 12;
+}
+
+static AVBufferRef *make_input(const uint8_t *data, int size)
+{
+    AVBufferRef *buf = av_buffer_allocz(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (buf)
+        memcpy(buf->data, data, size);
+    return buf;
+}
+
+static int check_frame(const AVPacket *pkt, const AVBufferRef *in,
+                       const uint8_t *stream, int *offset)
+{
+    int referenced = in && pkt->buf->data == in->data;
+
+    printf("frame at %d: size %d, %s\n", *offset, pkt->size,
+           referenced ? "referenced" : "copied");
+    if (memcmp(pkt->data, stream + *offset, pkt->size)) {
+        fprintf(stderr, "frame at %d has wrong content\n", *offset);
+        return -1;
+    }
+    if (!referenced && pkt->buf->data != pkt->data) {
+        fprintf(stderr, "copied frame at %d does not own its data\n", *offset);
+        return -1;
+    }
+    *offset += pkt->size;
+    return 0;
+}
+
+int main(void)
+{
+    uint8_t stream[NB_FRAMES * 12];
+    int sizes[2], stream_size = 0, offset = 0, ret = 1;
+    AVCodecParserContext *parser;
+    AVCodecContext *avctx;
+    AVBufferRef *in[2] = { NULL };
+    AVPacket *pkt;
+
+    for (int i = 0; i < NB_FRAMES; i++)
+        stream_size += make_frame(stream + stream_size, i);
+
+    /* The first input holds two whole frames and half of the third. */
+    sizes[0] = 2 * 12 + 6;
+    sizes[1] = stream_size - sizes[0];
+
+    parser = av_parser_init(AV_CODEC_ID_MJPEG);
+    avctx  = avcodec_alloc_context3(NULL);
+    pkt    = av_packet_alloc();
+    in[0]  = make_input(stream, sizes[0]);
+    in[1]  = make_input(stream + sizes[0], sizes[1]);
+    if (!parser || !avctx || !pkt || !in[0] || !in[1]) {
+        fprintf(stderr, "Allocation failed\n");
+        goto end;
+    }
+
+    for (int i = 0; i <= 2; i++) {
+        AVBufferRef *buf = i < 2 ? in[i] : NULL;
+        const uint8_t *data = buf ? buf->data : NULL;
+        int size = i < 2 ? sizes[i] : 0;
+
+        do {
+            int len = av_parser_parse_ref(parser, avctx, pkt, buf, data, size,
+                                          AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+            if (len < 0) {
+                fprintf(stderr, "Parsing failed\n");
+                goto end;
+            }
+            if (len) {
+                data += len;
+                size -= len;
+            }
+            if (pkt->size) {
+                if (check_frame(pkt, buf, stream, &offset) < 0)
+                    goto end;
+                av_packet_unref(pkt);
+            }
+        } while (size > 0);
+    }
+
+    if (offset != stream_size) {
+        fprintf(stderr, "Parsed %d of %d bytes\n", offset, stream_size);
+        goto end;
+    }
+    ret = 0;
+
+end:
+    av_buffer_unref(&in[0]);
+    av_buffer_unref(&in[1]);
+    av_packet_free(&pkt);
+    avcodec_free_context(&avctx);
+    av_parser_close(parser);
+    return ret;
+}
@@ -0,0 +1,255 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * Shared thread pool test: encode a generated MPEG-2 stream, then decode it
+ * with several decoders attached to one pool, each one driven by its own
+ * thread, and compare the output with a decoder without a pool.
+ */
+
+#include <stdio.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavutil/adler32.h"
+#include "libavutil/thread.h" // not public
+
+#define WIDTH       176
+#define HEIGHT      144
+#define NB_FRAMES   24
+#define NB_DECODERS 4
+
+typedef struct Stream {
+    AVPacket *pkts[NB_FRAMES + 1];
+    int nb_pkts;
+} Stream;
+
+typedef struct Decoder {
+    pthread_t tid;
+    const Stream *stream;
+    AVBufferRef *pool;
+    int thread_type;
+    int active_thread_type;
+    int nb_frames;
+    unsigned long checksum;
+    int ret;
+} Decoder;
+
+static void fill_frame(AVFrame *frame, int n)
+{
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+            frame->data[0][y * frame->linesize[0] + x] = x + y + n * 3;
+    for (int y = 0; y < HEIGHT / 2; y++) {
+        for (int x = 0; x < WIDTH / 2; x++) {
+            frame->data[1][y * frame->linesize[1] + x] = 128 + y + n * 2;
+            frame->data[2][y * frame->linesize[2] + x] = 64 + x + n * 5;
+        }
+    }
+}
+
+static int encode(Stream *stream)
+{
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MPEG2VIDEO);
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+    AVFrame *frame = av_frame_alloc();
+    int ret;
+
+    if (!avctx || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    avctx->width          = WIDTH;
+    avctx->height         = HEIGHT;
+    avctx->pix_fmt        = AV_PIX_FMT_YUV420P;
+    avctx->time_base      = (AVRational){ 1, 25 };
+    avctx->gop_size       = 12;
+    avctx->max_b_frames   = 2;
+    avctx->flags         |= AV_CODEC_FLAG_QSCALE | AV_CODEC_FLAG_BITEXACT;
+    avctx->global_quality = FF_QP2LAMBDA * 4;
+    avctx->thread_count   = 1;
+    if ((ret = avcodec_open2(avctx, codec, NULL)) < 0)
+        goto end;
+
+    frame->format = avctx->pix_fmt;
+    frame->width  = avctx->width;
+    frame->height = avctx->height;
+    if ((ret = av_frame_get_buffer(frame, 0)) < 0)
+        goto end;
+
+    for (int i = 0; i <= NB_FRAMES; i++) {
+        if (i < NB_FRAMES) {
+            if ((ret = av_frame_make_writable(frame)) < 0)
+                goto end;
+            fill_frame(frame, i);
+            frame->pts = i;
+        }
+        if ((ret = avcodec_send_frame(avctx, i < NB_FRAMES ? frame : NULL)) < 0)
+            goto end;
+        for (;;) {
+            AVPacket *pkt = av_packet_alloc();
+
+            if (!pkt) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            ret = avcodec_receive_packet(avctx, pkt);
+            if (ret < 0) {
+                av_packet_free(&pkt);
+                break;
+            }
+            stream->pkts[stream->nb_pkts++] = pkt;
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            goto end;
+    }
+    ret = 0;
+
+end:
+    av_frame_free(&frame);
+    avcodec_free_context(&avctx);
+    return ret;
+}
+
+static int decode(Decoder *dec)
+{
+    const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_MPEG2VIDEO);
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+    AVFrame *frame = av_frame_alloc();
+    int ret;
+
+    dec->checksum = av_adler32_update(0, NULL, 0);
+    if (!avctx || !frame) {
+        av_buffer_unref(&dec->pool);
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    avctx->flags       |= AV_CODEC_FLAG_BITEXACT;
+    avctx->thread_count = dec->pool ? 0 : 1;
+    avctx->thread_type  = dec->thread_type;
+    avctx->thread_pool  = dec->pool;
+    dec->pool = NULL;
+    if ((ret = avcodec_open2(avctx, codec, NULL)) < 0)
+        goto end;
+    dec->active_thread_type = avctx->active_thread_type;
+
+    for (int i = 0; i <= dec->stream->nb_pkts; i++) {
+        const AVPacket *pkt = i < dec->stream->nb_pkts ? dec->stream->pkts[i] : NULL;
+
+        if ((ret = avcodec_send_packet(avctx, pkt)) < 0)
+            goto end;
+        while ((ret = avcodec_receive_frame(avctx, frame)) >= 0) {
+            for (int p = 0; p < 3; p++) {
+                int w = p ? WIDTH  / 2 : WIDTH;
+                int h = p ? HEIGHT / 2 : HEIGHT;
+
+                for (int y = 0; y < h; y++)
+                    dec->checksum = av_adler32_update(dec->checksum,
+                                                      frame->data[p] + y * frame->linesize[p], w);
+            }
+            dec->nb_frames++;
+            av_frame_unref(frame);
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            goto end;
+    }
+    ret = 0;
+
+end:
+    av_frame_free(&frame);
+    avcodec_free_context(&avctx);
+    return ret;
+}
+
+static void *decoder_thread(void *arg)
+{
+    Decoder *dec = arg;
+
+    dec->ret = decode(dec);
+    return NULL;
+}
+
+int main(void)
+{
+    Stream stream = { 0 };
+    Decoder ref = { .stream = &stream }, decs[NB_DECODERS] = { { 0 } };
+    AVBufferRef *pool = NULL;
+    int ret;
+
+    if ((ret = encode(&stream)) < 0) {
+        fprintf(stderr, "Encoding failed\n");
+        goto end;
+    }
+    if ((ret = decode(&ref)) < 0) {
+        fprintf(stderr, "Decoding failed\n");
+        goto end;
+    }
+    /* the checksum depends on the DSP functions used by the encoder */
+    printf("no pool: %d frames\n", ref.nb_frames);
+
+    if ((ret = avcodec_thread_pool_create(&pool, 2)) < 0) {
+        fprintf(stderr, "Failed to create the thread pool\n");
+        goto end;
+    }
+    for (int i = 0; i < NB_DECODERS; i++) {
+        decs[i] = (Decoder){ .stream = &stream };
+        /* frame threading is not available with a pool, and must fall back
+         * to slice threading */
+        decs[i].thread_type = i & 1 ? FF_THREAD_FRAME | FF_THREAD_SLICE : FF_THREAD_SLICE;
+        decs[i].pool = av_buffer_ref(pool);
+        if (!decs[i].pool) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    }
+    for (int i = 0; i < NB_DECODERS; i++) {
+        if ((ret = pthread_create(&decs[i].tid, NULL, decoder_thread, &decs[i]))) {
+            fprintf(stderr, "pthread_create failed: %s\n", av_err2str(AVERROR(ret)));
+            ret = AVERROR(ret);
+            for (int j = 0; j < i; j++)
+                pthread_join(decs[j].tid, NULL);
+            goto end;
+        }
+    }
+    for (int i = 0; i < NB_DECODERS; i++)
+        pthread_join(decs[i].tid, NULL);
+
+    for (int i = 0; i < NB_DECODERS; i++) {
+        if (decs[i].ret < 0) {
+            fprintf(stderr, "Decoder %d failed\n", i);
+            ret = decs[i].ret;
+            goto end;
+        }
+        printf("pool decoder %d: thread_type %s, active %s, %d frames, %s\n", i,
+               decs[i].thread_type & FF_THREAD_FRAME ? "frame+slice" : "slice",
+               decs[i].active_thread_type == FF_THREAD_SLICE ? "slice" :
+               decs[i].active_thread_type ? "frame" : "none", decs[i].nb_frames,
+               decs[i].nb_frames == ref.nb_frames && decs[i].checksum == ref.checksum ?
+               "identical" : "different");
+    }
+    ret = 0;
+
+end:
+    av_buffer_unref(&pool);
+    for (int i = 0; i < NB_DECODERS; i++)
+        av_buffer_unref(&decs[i].pool);
+    for (int i = 0; i < stream.nb_pkts; i++)
+        av_packet_free(&stream.pkts[i]);
+    return ret < 0;
+}
@@ -206,6 +206,10 @@ static const struct {
     { "sw_rgb", checkasm_check_sw_rgb },
     { "sw_scale", checkasm_check_sw_scale },
 #endif
+#if CONFIG_SWRESAMPLE
+    { "swr_rematrix", checkasm_check_swr_rematrix },
+    { "swr_resample", checkasm_check_swr_resample },
+#endif
 #if CONFIG_AVUTIL
         { "fixed_dsp", checkasm_check_fixed_dsp },
         { "float_dsp", checkasm_check_float_dsp },
@@ -22,6 +22,7 @@
 #include "libavutil/common.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem_internal.h"
+#include "libavutil/pixdesc.h"
 
 #include "libswscale/swscale.h"
 #include "libswscale/swscale_internal.h"
@@ -253,6 +254,294 @@ static void check_yuv2yuvX(int accurate)
 #undef FILTER_SIZES
 }
 
+static void check_yuv2p01x(void)
+{
+    static const enum AVPixelFormat formats[] = {
+        AV_PIX_FMT_P010LE, AV_PIX_FMT_P012LE, AV_PIX_FMT_P016LE,
+    };
+#define LARGEST_FILTER 16
+    static const int filter_sizes[] = {1, 2, 3, 4, 8, 16};
+#define LARGEST_INPUT_SIZE 512
+    static const int input_sizes[] = {8, 24, 128, 144, 256, 512};
+    struct SwsContext *ctx;
+    int fi, fsi, isi, i;
+
+    // the input is int32_t for p016 and int16_t otherwise
+    LOCAL_ALIGNED_32(int32_t, u_pixels, [LARGEST_FILTER * LARGEST_INPUT_SIZE]);
+    LOCAL_ALIGNED_32(int32_t, v_pixels, [LARGEST_FILTER * LARGEST_INPUT_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, filter, [LARGEST_FILTER]);
+    LOCAL_ALIGNED_32(uint16_t, dst0, [2 * LARGEST_INPUT_SIZE + 32]);
+    LOCAL_ALIGNED_32(uint16_t, dst1, [2 * LARGEST_INPUT_SIZE + 32]);
+    LOCAL_ALIGNED_8(uint8_t, dither, [8]);
+    const int16_t *src_u[LARGEST_FILTER], *src_v[LARGEST_FILTER];
+
+    randomize_buffers((uint8_t*)dither, 8);
+
+    for (fi = 0; fi < FF_ARRAY_ELEMS(formats); fi++) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(formats[fi]);
+        int bits = desc->comp[0].depth;
+
+        ctx = sws_alloc_context();
+        if (sws_init_context(ctx, NULL, NULL) < 0)
+            fail();
+        ctx->dstFormat = formats[fi];
+        ctx->dstBpc    = bits;
+        ff_sws_init_scale(ctx);
+
+        if (bits == 16) {
+            // 19 bits of signed input
+            for (i = 0; i < LARGEST_FILTER * LARGEST_INPUT_SIZE; i++) {
+                u_pixels[i] = (int32_t)(rnd() & 0x7ffff) - 0x40000;
+                v_pixels[i] = (int32_t)(rnd() & 0x7ffff) - 0x40000;
+            }
+            for (i = 0; i < LARGEST_FILTER; i++) {
+                src_u[i] = (const int16_t*)&u_pixels[i * LARGEST_INPUT_SIZE];
+                src_v[i] = (const int16_t*)&v_pixels[i * LARGEST_INPUT_SIZE];
+            }
+        } else {
+            randomize_buffers((uint8_t*)u_pixels, LARGEST_FILTER * LARGEST_INPUT_SIZE * sizeof(int32_t));
+            randomize_buffers((uint8_t*)v_pixels, LARGEST_FILTER * LARGEST_INPUT_SIZE * sizeof(int32_t));
+            for (i = 0; i < LARGEST_FILTER; i++) {
+                src_u[i] = (const int16_t*)u_pixels + i * LARGEST_INPUT_SIZE;
+                src_v[i] = (const int16_t*)v_pixels + i * LARGEST_INPUT_SIZE;
+            }
+        }
+
+        for (fsi = 0; fsi < FF_ARRAY_ELEMS(filter_sizes); fsi++) {
+            int filter_size = filter_sizes[fsi];
+
+            // same filter shape as in check_yuv2yuvX(): coefficients summing
+            // up to 1 << 12, with negative values
+            for (i = 0; i < filter_size; i++)
+                filter[i] = filter_size == 1 ? 1 << 12 : -((1 << 12) / (filter_size - 1));
+            if (filter_size > 1)
+                filter[rnd() % filter_size] = (1 << 13) - 1;
+
+            for (isi = 0; isi < FF_ARRAY_ELEMS(input_sizes); isi++) {
+                int dstW = input_sizes[isi];
+                declare_func(void, enum AVPixelFormat format, const uint8_t *dither,
+                             const int16_t *filter, int filterSize,
+                             const int16_t **u, const int16_t **v,
+                             uint8_t *dst, int dstWidth);
+
+                if (check_func(ctx->yuv2nv12cX, "yuv2%s_cX_%d_%d",
+                               desc->name, filter_size, dstW)) {
+                    memset(dst0, 0, (2 * LARGEST_INPUT_SIZE + 32) * sizeof(dst0[0]));
+                    memset(dst1, 0, (2 * LARGEST_INPUT_SIZE + 32) * sizeof(dst1[0]));
+
+                    call_ref(formats[fi], dither, filter, filter_size,
+                             src_u, src_v, (uint8_t*)dst0, dstW);
+                    call_new(formats[fi], dither, filter, filter_size,
+                             src_u, src_v, (uint8_t*)dst1, dstW);
+                    if (memcmp(dst0, dst1, 2 * dstW * sizeof(dst0[0]))) {
+                        fail();
+                        printf("failed: yuv2%s_cX_%d_%d\n", desc->name, filter_size, dstW);
+                        show_differences((uint8_t*)dst0, (uint8_t*)dst1,
+                                         2 * dstW * sizeof(dst0[0]));
+                    }
+                    if (dstW == LARGEST_INPUT_SIZE)
+                        bench_new(formats[fi], dither, filter, filter_size,
+                                  src_u, src_v, (uint8_t*)dst1, dstW);
+                }
+            }
+        }
+
+        // the luma plane of p016 is written by the planar 16-bit functions
+        if (bits == 16) {
+            sws_freeContext(ctx);
+            continue;
+        }
+
+        for (isi = 0; isi < FF_ARRAY_ELEMS(input_sizes); isi++) {
+            int dstW = input_sizes[isi];
+            declare_func_emms(AV_CPU_FLAG_MMX, void, const int16_t *src, uint8_t *dest,
+                              int dstW, const uint8_t *dither, int offset);
+
+            if (check_func(ctx->yuv2plane1, "yuv2%s_l1_%d", desc->name, dstW)) {
+                memset(dst0, 0, LARGEST_INPUT_SIZE * sizeof(dst0[0]));
+                memset(dst1, 0, LARGEST_INPUT_SIZE * sizeof(dst1[0]));
+
+                call_ref(src_u[0], (uint8_t*)dst0, dstW, dither, 0);
+                call_new(src_u[0], (uint8_t*)dst1, dstW, dither, 0);
+                if (memcmp(dst0, dst1, dstW * sizeof(dst0[0])))
+                    fail();
+                if (dstW == LARGEST_INPUT_SIZE)
+                    bench_new(src_u[0], (uint8_t*)dst1, dstW, dither, 0);
+            }
+        }
+
+        for (fsi = 0; fsi < FF_ARRAY_ELEMS(filter_sizes); fsi++) {
+            int filter_size = filter_sizes[fsi];
+
+            // the vertical luma filter size is even on x86
+            if (filter_size & 1)
+                continue;
+            for (i = 0; i < filter_size; i++)
+                filter[i] = -((1 << 12) / (filter_size - 1));
+            filter[rnd() % filter_size] = (1 << 13) - 1;
+
+            for (isi = 0; isi < FF_ARRAY_ELEMS(input_sizes); isi++) {
+                int dstW = input_sizes[isi];
+                declare_func_emms(AV_CPU_FLAG_MMX, void, const int16_t *filter,
+                                  int filterSize, const int16_t **src, uint8_t *dest,
+                                  int dstW, const uint8_t *dither, int offset);
+
+                if (check_func(ctx->yuv2planeX, "yuv2%s_lX_%d_%d",
+                               desc->name, filter_size, dstW)) {
+                    memset(dst0, 0, LARGEST_INPUT_SIZE * sizeof(dst0[0]));
+                    memset(dst1, 0, LARGEST_INPUT_SIZE * sizeof(dst1[0]));
+
+                    call_ref(filter, filter_size, src_u, (uint8_t*)dst0, dstW, dither, 0);
+                    call_new(filter, filter_size, src_u, (uint8_t*)dst1, dstW, dither, 0);
+                    if (memcmp(dst0, dst1, dstW * sizeof(dst0[0])))
+                        fail();
+                    if (dstW == LARGEST_INPUT_SIZE)
+                        bench_new(filter, filter_size, src_u, (uint8_t*)dst1, dstW, dither, 0);
+                }
+            }
+        }
+        sws_freeContext(ctx);
+    }
+}
+
+static void check_p01x_input(void)
+{
+    static const enum AVPixelFormat formats[] = {
+        AV_PIX_FMT_P010LE, AV_PIX_FMT_P012LE, AV_PIX_FMT_P016LE,
+    };
+    static const int input_sizes[] = {8, 24, 128, 144, 256, 512};
+    struct SwsContext *ctx;
+    int fi, isi;
+
+    LOCAL_ALIGNED_32(uint8_t, src, [4 * LARGEST_INPUT_SIZE + 64]);
+    LOCAL_ALIGNED_32(uint16_t, dst0_y, [LARGEST_INPUT_SIZE + 32]);
+    LOCAL_ALIGNED_32(uint16_t, dst1_y, [LARGEST_INPUT_SIZE + 32]);
+    LOCAL_ALIGNED_32(uint16_t, dst0_u, [LARGEST_INPUT_SIZE + 32]);
+    LOCAL_ALIGNED_32(uint16_t, dst0_v, [LARGEST_INPUT_SIZE + 32]);
+    LOCAL_ALIGNED_32(uint16_t, dst1_u, [LARGEST_INPUT_SIZE + 32]);
+    LOCAL_ALIGNED_32(uint16_t, dst1_v, [LARGEST_INPUT_SIZE + 32]);
+
+    randomize_buffers(src, 4 * LARGEST_INPUT_SIZE + 64);
+
+    for (fi = 0; fi < FF_ARRAY_ELEMS(formats); fi++) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(formats[fi]);
+
+        ctx = sws_alloc_context();
+        if (sws_init_context(ctx, NULL, NULL) < 0)
+            fail();
+        ctx->srcFormat = formats[fi];
+        ff_sws_init_scale(ctx);
+
+        for (isi = 0; isi < FF_ARRAY_ELEMS(input_sizes); isi++) {
+            int w = input_sizes[isi];
+
+            if (ctx->lumToYV12) {
+                declare_func(void, uint8_t *dst, const uint8_t *src,
+                             const uint8_t *unused1, const uint8_t *unused2,
+                             int width, uint32_t *pal, void *opq);
+
+                if (check_func(ctx->lumToYV12, "%sToY_%d", desc->name, w)) {
+                    call_ref((uint8_t*)dst0_y, src, NULL, NULL, w, NULL, NULL);
+                    call_new((uint8_t*)dst1_y, src, NULL, NULL, w, NULL, NULL);
+                    if (memcmp(dst0_y, dst1_y, w * sizeof(dst0_y[0])))
+                        fail();
+                    if (w == LARGEST_INPUT_SIZE)
+                        bench_new((uint8_t*)dst1_y, src, NULL, NULL, w, NULL, NULL);
+                }
+            }
+            {
+                declare_func(void, uint8_t *dstU, uint8_t *dstV,
+                             const uint8_t *unused0, const uint8_t *src1,
+                             const uint8_t *src2, int width, uint32_t *pal, void *opq);
+
+                if (check_func(ctx->chrToYV12, "%sToUV_%d", desc->name, w)) {
+                    call_ref((uint8_t*)dst0_u, (uint8_t*)dst0_v, NULL, src, src, w, NULL, NULL);
+                    call_new((uint8_t*)dst1_u, (uint8_t*)dst1_v, NULL, src, src, w, NULL, NULL);
+                    if (memcmp(dst0_u, dst1_u, w * sizeof(dst0_u[0])) ||
+                        memcmp(dst0_v, dst1_v, w * sizeof(dst0_v[0])))
+                        fail();
+                    if (w == LARGEST_INPUT_SIZE)
+                        bench_new((uint8_t*)dst1_u, (uint8_t*)dst1_v, NULL, src, src, w, NULL, NULL);
+                }
+            }
+        }
+        sws_freeContext(ctx);
+    }
+}
+
+static void check_rgb32_input(void)
+{
+    static const enum AVPixelFormat formats[] = {
+        AV_PIX_FMT_RGBA, AV_PIX_FMT_BGRA, AV_PIX_FMT_ARGB, AV_PIX_FMT_ABGR,
+    };
+    static const int input_sizes[] = {8, 24, 127, 144, 255, 512};
+    struct SwsContext *ctx;
+    int fi, isi;
+
+    LOCAL_ALIGNED_32(uint8_t, src, [4 * LARGEST_INPUT_SIZE + 64]);
+    LOCAL_ALIGNED_32(uint16_t, dst0_y, [LARGEST_INPUT_SIZE + 32]);
+    LOCAL_ALIGNED_32(uint16_t, dst1_y, [LARGEST_INPUT_SIZE + 32]);
+    LOCAL_ALIGNED_32(uint16_t, dst0_u, [LARGEST_INPUT_SIZE + 32]);
+    LOCAL_ALIGNED_32(uint16_t, dst0_v, [LARGEST_INPUT_SIZE + 32]);
+    LOCAL_ALIGNED_32(uint16_t, dst1_u, [LARGEST_INPUT_SIZE + 32]);
+    LOCAL_ALIGNED_32(uint16_t, dst1_v, [LARGEST_INPUT_SIZE + 32]);
+
+    randomize_buffers(src, 4 * LARGEST_INPUT_SIZE + 64);
+
+    for (fi = 0; fi < FF_ARRAY_ELEMS(formats); fi++) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(formats[fi]);
+        uint32_t *table;
+
+        // full chroma input, so that the chroma reader is not the
+        // horizontally subsampling one
+        ctx = sws_getContext(LARGEST_INPUT_SIZE, 2, formats[fi],
+                             LARGEST_INPUT_SIZE, 2, AV_PIX_FMT_YUV444P,
+                             SWS_BILINEAR | SWS_FULL_CHR_H_INP, NULL, NULL, NULL);
+        if (!ctx) {
+            fail();
+            continue;
+        }
+        table = (uint32_t *)ctx->input_rgb2yuv_table;
+
+        for (isi = 0; isi < FF_ARRAY_ELEMS(input_sizes); isi++) {
+            int w = input_sizes[isi];
+
+            {
+                declare_func(void, uint8_t *dst, const uint8_t *src,
+                             const uint8_t *unused1, const uint8_t *unused2,
+                             int width, uint32_t *rgb2yuv, void *opq);
+
+                if (check_func(ctx->lumToYV12, "%sToY_%d", desc->name, w)) {
+                    call_ref((uint8_t*)dst0_y, src, NULL, NULL, w, table, NULL);
+                    call_new((uint8_t*)dst1_y, src, NULL, NULL, w, table, NULL);
+                    if (memcmp(dst0_y, dst1_y, w * sizeof(dst0_y[0])))
+                        fail();
+                    if (w == LARGEST_INPUT_SIZE)
+                        bench_new((uint8_t*)dst1_y, src, NULL, NULL, w, table, NULL);
+                }
+            }
+            {
+                declare_func(void, uint8_t *dstU, uint8_t *dstV,
+                             const uint8_t *unused0, const uint8_t *src1,
+                             const uint8_t *src2, int width, uint32_t *rgb2yuv, void *opq);
+
+                if (check_func(ctx->chrToYV12, "%sToUV_%d", desc->name, w)) {
+                    call_ref((uint8_t*)dst0_u, (uint8_t*)dst0_v, NULL, src, src, w, table, NULL);
+                    call_new((uint8_t*)dst1_u, (uint8_t*)dst1_v, NULL, src, src, w, table, NULL);
+                    if (memcmp(dst0_u, dst1_u, w * sizeof(dst0_u[0])) ||
+                        memcmp(dst0_v, dst1_v, w * sizeof(dst0_v[0])))
+                        fail();
+                    if (w == LARGEST_INPUT_SIZE)
+                        bench_new((uint8_t*)dst1_u, (uint8_t*)dst1_v, NULL, src, src, w, table, NULL);
+                }
+            }
+        }
+        sws_freeContext(ctx);
+    }
+}
+
+#undef SRC_PIXELS
+#define SRC_PIXELS 512
 #undef SRC_PIXELS
 #define SRC_PIXELS 512
 
@@ -262,10 +551,15 @@ static void check_hscale(void)
 #define FILTER_SIZES 6
     static const int filter_sizes[FILTER_SIZES] = { 4, 8, 12, 16, 32, 40 };
 
-#define HSCALE_PAIRS 2
+#define HSCALE_PAIRS 4
     static const int hscale_pairs[HSCALE_PAIRS][2] = {
         { 8, 14 },
         { 8, 18 },
+        { 10, 18 },
+        { 16, 18 },
+    };
+    static const enum AVPixelFormat hscale_formats[HSCALE_PAIRS] = {
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV420P10, AV_PIX_FMT_YUV420P16,
     };
 
 #define LARGEST_INPUT_SIZE 512
@@ -277,6 +571,7 @@ static void check_hscale(void)
 
     // padded
     LOCAL_ALIGNED_32(uint8_t, src, [FFALIGN(SRC_PIXELS + MAX_FILTER_WIDTH - 1, 4)]);
+    LOCAL_ALIGNED_32(uint16_t, src16, [FFALIGN(SRC_PIXELS + MAX_FILTER_WIDTH - 1, 4)]);
     LOCAL_ALIGNED_32(uint32_t, dst0, [SRC_PIXELS]);
     LOCAL_ALIGNED_32(uint32_t, dst1, [SRC_PIXELS]);
 
@@ -299,10 +594,20 @@ static void check_hscale(void)
     randomize_buffers(src, SRC_PIXELS + MAX_FILTER_WIDTH - 1);
 
     for (hpi = 0; hpi < HSCALE_PAIRS; hpi++) {
+        const int src_bpc = hscale_pairs[hpi][0];
+        const uint8_t *input = src;
+
+        if (src_bpc > 8) {
+            randomize_buffers((uint8_t *)src16, 2 * (SRC_PIXELS + MAX_FILTER_WIDTH - 1));
+            for (i = 0; i < SRC_PIXELS + MAX_FILTER_WIDTH - 1; i++)
+                src16[i] &= (1 << src_bpc) - 1;
+            input = (const uint8_t *)src16;
+        }
         for (fsi = 0; fsi < FILTER_SIZES; fsi++) {
             for (dstWi = 0; dstWi < INPUT_SIZES; dstWi++) {
                 width = filter_sizes[fsi];
 
+                ctx->srcFormat = hscale_formats[hpi];
                 ctx->srcBpc = hscale_pairs[hpi][0];
                 ctx->dstBpc = hscale_pairs[hpi][1];
                 ctx->hLumFilterSize = ctx->hChrFilterSize = width;
@@ -328,6 +633,18 @@ static void check_hscale(void)
                         filter[i * width + j] = -((1 << 14) / (width - 1));
                     }
                     filter[i * width + (rnd() % width)] = ((1 << 15) - 1);
+
+                    // The 16-bit functions offset the input to signed and
+                    // undo it assuming a filter sum of exactly 1 << 14, as
+                    // initFilter() makes it.
+                    if (src_bpc == 16) {
+                        int sum = 0;
+                        for (j = 0; j < width; j++)
+                            sum += filter[i * width + j];
+                        for (j = 0; filter[i * width + j] > 0; j++)
+                            ;
+                        filter[i * width + j] += (1 << 14) - sum;
+                    }
                 }
 
                 for (i = 0; i < MAX_FILTER_WIDTH; i++) {
@@ -346,11 +663,11 @@ static void check_hscale(void)
                     memset(dst0, 0, SRC_PIXELS * sizeof(dst0[0]));
                     memset(dst1, 0, SRC_PIXELS * sizeof(dst1[0]));
 
-                    call_ref(NULL, dst0, ctx->dstW, src, filter, filterPos, width);
-                    call_new(NULL, dst1, ctx->dstW, src, filterAvx2, filterPosAvx, width);
+                    call_ref(ctx, dst0, ctx->dstW, input, filter, filterPos, width);
+                    call_new(ctx, dst1, ctx->dstW, input, filterAvx2, filterPosAvx, width);
                     if (memcmp(dst0, dst1, ctx->dstW * sizeof(dst0[0])))
                         fail();
-                    bench_new(NULL, dst0, ctx->dstW, src, filter, filterPosAvx, width);
+                    bench_new(ctx, dst0, ctx->dstW, input, filter, filterPosAvx, width);
                 }
             }
         }
@@ -368,4 +685,10 @@ void checkasm_check_sw_scale(void)
     check_yuv2yuvX(0);
     check_yuv2yuvX(1);
     report("yuv2yuvX");
+    check_yuv2p01x();
+    report("yuv2p01x");
+    check_p01x_input();
+    report("p01x_input");
+    check_rgb32_input();
+    report("rgb32_input");
 }
@@ -0,0 +1,97 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/channel_layout.h"
+#include "libavutil/common.h"
+#include "libavutil/mem_internal.h"
+
+#include "libswresample/swresample.h"
+#include "libswresample/swresample_internal.h"
+
+#include "checkasm.h"
+
+#define MAX_INPUTS 16
+#define NB_SAMPLES 64
+
+#define randomize_floats(buf, size)                             \
+    do {                                                        \
+        for (int j = 0; j < size; j++)                          \
+            buf[j] = (int)(rnd() & 0xffff) / 32768.0f - 1.0f;   \
+    } while (0)
+
+static void check_mix_sparse(void)
+{
+    static const int nb_inputs[] = { 3, 5, 16 };
+    LOCAL_ALIGNED_32(float, src,  [MAX_INPUTS], [NB_SAMPLES]);
+    LOCAL_ALIGNED_32(float, dst0, [NB_SAMPLES]);
+    LOCAL_ALIGNED_32(float, dst1, [NB_SAMPLES]);
+    const AVChannelLayout mono = AV_CHANNEL_LAYOUT_MONO;
+    AVChannelLayout layout;
+    const void *srcp[MAX_INPUTS];
+    float coeffs[MAX_INPUTS];
+    mix_sparse_func_type *mix_sparse;
+    SwrContext *s = NULL;
+
+    declare_func(void, void *out, const void **in, const void *coeffs,
+                 integer nb, integer len);
+
+    /* mixing many channels to mono makes swr_init() set up the sparse
+     * mixing functions for the current cpu flags */
+    av_channel_layout_default(&layout, MAX_INPUTS);
+    if (swr_alloc_set_opts2(&s, &mono, AV_SAMPLE_FMT_FLTP, 48000,
+                            &layout, AV_SAMPLE_FMT_FLTP, 48000, 0, NULL) < 0 ||
+        swr_init(s) < 0) {
+        fail();
+        goto end;
+    }
+    mix_sparse = s->mix_sparse_simd ? s->mix_sparse_simd : s->mix_sparse_f;
+
+    for (int i = 0; i < MAX_INPUTS; i++) {
+        randomize_floats(src[i], NB_SAMPLES);
+        srcp[i] = src[i];
+    }
+    randomize_floats(coeffs, MAX_INPUTS);
+
+    for (int k = 0; k < FF_ARRAY_ELEMS(nb_inputs); k++) {
+        const int nb = nb_inputs[k];
+
+        if (check_func(mix_sparse, "mix_sparse_float_%d", nb)) {
+            memset(dst0, 0, sizeof(dst0[0]) * NB_SAMPLES);
+            memset(dst1, 0, sizeof(dst1[0]) * NB_SAMPLES);
+
+            call_ref(dst0, srcp, coeffs, nb, NB_SAMPLES);
+            call_new(dst1, srcp, coeffs, nb, NB_SAMPLES);
+            if (!float_near_abs_eps_array(dst0, dst1, 1e-6, NB_SAMPLES))
+                fail();
+            bench_new(dst1, srcp, coeffs, nb, NB_SAMPLES);
+        }
+    }
+
+    report("mix_sparse");
+
+end:
+    swr_free(&s);
+    av_channel_layout_uninit(&layout);
+}
+
+void checkasm_check_swr_rematrix(void)
+{
+    check_mix_sparse();
+}
@@ -0,0 +1,101 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem_internal.h"
+
+#include "libswresample/resample.h"
+
+#include "checkasm.h"
+
+#define PHASES      16
+#define FILTER_MAX  40
+#define NB_SAMPLES  64
+#define SRC_LEN     (2 * NB_SAMPLES + FILTER_MAX)
+
+#define randomize_floats(buf, size)                             \
+    do {                                                        \
+        for (int j = 0; j < size; j++)                          \
+            buf[j] = (int)(rnd() & 0xffff) / 32768.0f - 1.0f;   \
+    } while (0)
+
+static void check_resample_multi(void)
+{
+    static const int filter_lengths[] = { 1, 8, 17, 32, 40 };
+    LOCAL_ALIGNED_32(float, filter, [(PHASES + 1) * FILTER_MAX]);
+    LOCAL_ALIGNED_32(float, src,  [RESAMPLE_MULTI_CH], [SRC_LEN]);
+    LOCAL_ALIGNED_32(float, dst0, [RESAMPLE_MULTI_CH], [NB_SAMPLES]);
+    LOCAL_ALIGNED_32(float, dst1, [RESAMPLE_MULTI_CH], [NB_SAMPLES]);
+    uint8_t *dst0p[RESAMPLE_MULTI_CH], *dst1p[RESAMPLE_MULTI_CH];
+    const uint8_t *srcp[RESAMPLE_MULTI_CH];
+    int32_t schedule[2 * NB_SAMPLES];
+    ResampleContext c = { .format = AV_SAMPLE_FMT_FLTP };
+
+    declare_func(void, uint8_t * const *dst, const uint8_t * const *src,
+                 const void *filter_bank, const int32_t *schedule,
+                 int filter_length, int n);
+
+    swri_resample_dsp_init(&c);
+
+    for (int i = 0; i < RESAMPLE_MULTI_CH; i++) {
+        randomize_floats(src[i], SRC_LEN);
+        srcp[i]  = (const uint8_t *)src[i];
+        dst0p[i] = (uint8_t *)dst0[i];
+        dst1p[i] = (uint8_t *)dst1[i];
+    }
+
+    for (int k = 0; k < FF_ARRAY_ELEMS(filter_lengths); k++) {
+        const int filter_length = filter_lengths[k];
+        const int filter_alloc  = FFALIGN(filter_length, 8);
+
+        /* the filters are zero-padded up to filter_alloc */
+        memset(filter, 0, sizeof(filter[0]) * (PHASES + 1) * FILTER_MAX);
+        for (int p = 0; p <= PHASES; p++)
+            randomize_floats((filter + p * filter_alloc), filter_length);
+
+        for (int i = 0, pos = 0; i < NB_SAMPLES; i++) {
+            schedule[2 * i    ] = rnd() % PHASES * filter_alloc;
+            schedule[2 * i + 1] = pos;
+            pos += rnd() % 3;
+        }
+
+        if (check_func(c.dsp.resample_multi, "resample_multi_float_%d", filter_length)) {
+            memset(dst0, 0, sizeof(dst0[0]) * RESAMPLE_MULTI_CH);
+            memset(dst1, 0, sizeof(dst1[0]) * RESAMPLE_MULTI_CH);
+
+            call_ref(dst0p, srcp, filter, schedule, filter_length, NB_SAMPLES);
+            call_new(dst1p, srcp, filter, schedule, filter_length, NB_SAMPLES);
+            for (int i = 0; i < RESAMPLE_MULTI_CH; i++) {
+                if (!float_near_abs_eps_array(dst0[i], dst1[i], 1e-5, NB_SAMPLES)) {
+                    fail();
+                    break;
+                }
+            }
+            bench_new(dst1p, srcp, filter, schedule, filter_length, NB_SAMPLES);
+        }
+    }
+
+    report("resample_multi");
+}
+
+void checkasm_check_swr_resample(void)
+{
+    check_resample_multi();
+}
@@ -572,6 +572,18 @@ venc_data(){
     run tools/venc_data_dump${EXECSUF} ${file} ${stream} ${frames} ${threads} ${thread_type}
 }
 
+seek_index_file(){
+    srcfile=$1
+    shift
+    indexfile="${outdir}/${test}.idx"
+    cleanfiles="$indexfile"
+
+    # the first run builds and stores the index, the second one loads it
+    rm -f $indexfile
+    run libavformat/tests/seek${EXECSUF} $srcfile -seek_index_file $(target_path $indexfile) "$@" || return
+    run libavformat/tests/seek${EXECSUF} $srcfile -seek_index_file $(target_path $indexfile) "$@"
+}
+
 null(){
     :
 }
@@ -232,6 +232,18 @@ fate-aac-pred-encode: CMP_TARGET = 662
 fate-aac-pred-encode: FUZZ = 12
 fate-aac-pred-encode: SIZE_TOLERANCE = 3560
 
+# 5.1 encoding, serial and with channel elements coded in slice threads
+FATE_AAC_ENCODE_51 = fate-aac-51-encode-threads1 fate-aac-51-encode-threads4
+$(FATE_AAC_ENCODE_51): tests/data/asynth-44100-6.wav
+$(FATE_AAC_ENCODE_51): CMD = enc_dec_pcm adts wav s16le $(TARGET_PATH)/tests/data/asynth-44100-6.wav -c:a aac -aac_pns 1 -aac_is 1 -b:a 256k -threads $(@:fate-aac-51-encode-threads%=%) -fflags +bitexact -flags +bitexact
+$(FATE_AAC_ENCODE_51): CMP = stddev
+$(FATE_AAC_ENCODE_51): REF = ./tests/data/asynth-44100-6.wav
+$(FATE_AAC_ENCODE_51): CMP_SHIFT = -12288
+$(FATE_AAC_ENCODE_51): SIZE_TOLERANCE = 12288
+$(FATE_AAC_ENCODE_51): FUZZ = 40
+fate-aac-51-encode-threads1: CMP_TARGET = 5398
+fate-aac-51-encode-threads4: CMP_TARGET = 5437
+
 FATE_AAC_LATM += fate-aac-latm_000000001180bc60
 fate-aac-latm_000000001180bc60: CMD = pcm -i $(TARGET_SAMPLES)/aac/latm_000000001180bc60.mpg
 fate-aac-latm_000000001180bc60: REF = $(SAMPLES)/aac/latm_000000001180bc60.s16
@@ -254,10 +266,12 @@ $(FATE_AAC_ALL): CMP  = oneoff
 $(FATE_AAC_ALL): FUZZ = 2
 
 FATE_AAC_ENCODE-$(call ENCMUX, AAC, ADTS) += $(FATE_AAC_ENCODE)
+FATE_AAC_ENCODE_51-$(call ENCMUX, AAC, ADTS) += $(FATE_AAC_ENCODE_51)
 
 FATE_AAC_BSF-$(call ALLYES, AAC_DEMUXER AAC_ADTSTOASC_BSF MATROSKA_MUXER) += fate-aac-autobsf-adtstoasc
 
 FATE_SAMPLES_FFMPEG += $(FATE_AAC_ALL) $(FATE_AAC_ENCODE-yes) $(FATE_AAC_BSF-yes)
+FATE_FFMPEG += $(FATE_AAC_ENCODE_51-yes)
 
-fate-aac: $(FATE_AAC_ALL) $(FATE_AAC_ENCODE) $(FATE_AAC_BSF-yes)
+fate-aac: $(FATE_AAC_ALL) $(FATE_AAC_ENCODE) $(FATE_AAC_ENCODE_51-yes) $(FATE_AAC_BSF-yes)
 fate-aac-latm: $(FATE_AAC_LATM-yes)
@@ -3,6 +3,14 @@ fate-api-flac: $(APITESTSDIR)/api-flac-test$(EXESUF)
 fate-api-flac: CMD = run $(APITESTSDIR)/api-flac-test$(EXESUF)
 fate-api-flac: CMP = null
 
+FATE_API_LIBAVCODEC-$(CONFIG_H264_DECODER) += fate-api-h264-lowmem
+fate-api-h264-lowmem: $(APITESTSDIR)/api-h264-lowmem-test$(EXESUF)
+fate-api-h264-lowmem: CMD = run $(APITESTSDIR)/api-h264-lowmem-test$(EXESUF)
+
+FATE_API_LIBAVCODEC-$(CONFIG_MJPEG_PARSER) += fate-api-parser
+fate-api-parser: $(APITESTSDIR)/api-parser-test$(EXESUF)
+fate-api-parser: CMD = run $(APITESTSDIR)/api-parser-test$(EXESUF)
+
 FATE_API_SAMPLES_LIBAVFORMAT-$(call DEMDEC, FLV, FLV) += fate-api-band
 fate-api-band: $(APITESTSDIR)/api-band-test$(EXESUF)
 fate-api-band: CMD = run $(APITESTSDIR)/api-band-test$(EXESUF) $(TARGET_SAMPLES)/mpeg4/resize_down-up.h263
@@ -27,6 +35,10 @@ fate-api-threadmessage: $(APITESTSDIR)/api-threadmessage-test$(EXESUF)
 fate-api-threadmessage: CMD = run $(APITESTSDIR)/api-threadmessage-test$(EXESUF) 3 10 30 50 2 20 40
 fate-api-threadmessage: CMP = null
 
+FATE_API_LIBAVCODEC-$(if $(HAVE_THREADS),$(call ALLYES, MPEG2VIDEO_ENCODER MPEG2VIDEO_DECODER)) += fate-api-threadpool
+fate-api-threadpool: $(APITESTSDIR)/api-threadpool-test$(EXESUF)
+fate-api-threadpool: CMD = run $(APITESTSDIR)/api-threadpool-test$(EXESUF)
+
 FATE_API_SAMPLES-$(CONFIG_AVFORMAT) += $(FATE_API_SAMPLES_LIBAVFORMAT-yes)
 
 ifdef SAMPLES
@@ -48,6 +48,37 @@ fate-force_key_frames: CMD = enc_dec \
   avi "-c mpeg4 -g 240 -qscale 10 -force_key_frames 0.5,0:00:01.5" \
   framecrc "" "-skip_frame nokey"
 
+# GOP threading: the packets of the chunks encoded in parallel must come out
+# in order with monotonic DTS, and every chunk must start with a keyframe.
+FATE_GOP_THREADS-$(call TRANSCODE, MPEG2VIDEO, NUT, RAWVIDEO_DEMUXER) += fate-mpeg2video-gop-threads
+FATE_GOP_THREADS-$(call TRANSCODE, MPEG4, NUT, RAWVIDEO_DEMUXER) += fate-mpeg4-gop-threads
+$(FATE_GOP_THREADS-yes): tests/data/vsynth1.yuv
+$(FATE_GOP_THREADS-yes): CMD = transcode \
+  "rawvideo -s 352x288 -pix_fmt yuv420p" tests/data/vsynth1.yuv nut \
+  "-c:v $(@:fate-%-gop-threads=%) -qscale 10 -bf 2 -g 12 -dct fastint -threads 4 -thread_type gop" \
+  "-c copy" "-show_entries frame=pts,key_frame,pict_type -select_streams v"
+FATE_FFMPEG_FFPROBE += $(FATE_GOP_THREADS-yes)
+fate-gop-threads: $(FATE_GOP_THREADS-yes)
+
+# The GOP time codes must continue across the chunks given to each thread.
+FATE_GOP_TIMECODE-$(call TRANSCODE, MPEG2VIDEO, MPEG2VIDEO MPEGVIDEO, RAWVIDEO_DEMUXER) += fate-mpeg2video-gop-threads-timecode
+fate-mpeg2video-gop-threads-timecode: tests/data/vsynth1.yuv
+fate-mpeg2video-gop-threads-timecode: CMD = transcode \
+  "rawvideo -s 352x288 -pix_fmt yuv420p" tests/data/vsynth1.yuv mpeg2video \
+  "-c:v mpeg2video -qscale 10 -bf 2 -g 12 -dct fastint -timecode 01:00:00:00 -threads 4 -thread_type gop" \
+  "-c copy" "-show_entries frame_side_data=timecode -of flat"
+FATE_FFMPEG_FFPROBE += $(FATE_GOP_TIMECODE-yes)
+fate-gop-threads: $(FATE_GOP_TIMECODE-yes)
+
+# MJPEG with one restart interval per macroblock row, decoded with the
+# intervals distributed over the slice threads.
+FATE_FFMPEG-$(call TRANSCODE, MJPEG, AVI, RAWVIDEO_DEMUXER) += fate-mjpeg-slice-threads
+fate-mjpeg-slice-threads: tests/data/vsynth1.yuv
+fate-mjpeg-slice-threads: CMD = transcode \
+  "rawvideo -s 352x288 -pix_fmt yuvj420p" tests/data/vsynth1.yuv avi \
+  "-c:v mjpeg -q:v 9 -threads 4 -thread_type slice -slices 4" \
+  "" "" "" "-threads 4 -thread_type slice"
+
 # Tests that the video is properly autorotated using the contained
 # display matrix and that the generated file does not contain
 # a display matrix any more.
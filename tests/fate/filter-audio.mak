@@ -228,6 +228,30 @@ FATE_AFILTER-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FIL
 fate-filter-hls-append: tests/data/hls-list-append.m3u8
 fate-filter-hls-append: CMD = framecrc -flags +bitexact -i $(TARGET_PATH)/tests/data/hls-list-append.m3u8 -af asetpts=N*23,aresample
 
+# the same segments and list as for fate-filter-hls, finished and listed
+# by the background I/O thread of the segment muxer
+tests/data/hls-list-async.m3u8: TAG = GEN
+tests/data/hls-list-async.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+        -f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=20" -f segment -segment_time 10 -map 0 -flags +bitexact -codec:a mp2fixed \
+        -segment_async 1 -segment_list $(TARGET_PATH)/$@ -y $(TARGET_PATH)/tests/data/hls-async-out-%03d.ts 2>/dev/null
+
+FATE_AFILTER-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-filter-hls-async
+fate-filter-hls-async: tests/data/hls-list-async.m3u8
+fate-filter-hls-async: CMD = framecrc -flags +bitexact -i $(TARGET_PATH)/tests/data/hls-list-async.m3u8 -af aresample
+fate-filter-hls-async: REF = $(SRC_PATH)/tests/ref/fate/filter-hls
+
+# list entries appended by the I/O thread, with a segment per 3 seconds
+tests/data/segment-list-async.ffconcat: TAG = GEN
+tests/data/segment-list-async.ffconcat: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+        -f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=20" -f segment -segment_time 3 -map 0 -flags +bitexact -codec:a mp2fixed \
+        -segment_async 1 -segment_list $(TARGET_PATH)/$@ -y $(TARGET_PATH)/tests/data/segment-async-out-%03d.ts 2>/dev/null
+
+FATE_AFILTER-$(call ALLYES, CONCAT_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-filter-segment-async
+fate-filter-segment-async: tests/data/segment-list-async.ffconcat
+fate-filter-segment-async: CMD = framecrc -flags +bitexact -safe 0 -i $(TARGET_PATH)/tests/data/segment-list-async.ffconcat -af asetpts=N*1152,aresample
+
 FATE_AMIX += fate-filter-amix-simple
 fate-filter-amix-simple: CMD = ffmpeg -auto_conversion_filters -filter_complex amix -i $(SRC) -ss 3 -i $(SRC1) -f f32le -
 fate-filter-amix-simple: REF = $(SAMPLES)/filter/amix_simple.pcm
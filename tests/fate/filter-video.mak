@@ -76,6 +76,12 @@ fate-filter-lavd-testsrc: CMD = framecrc -f lavfi -i testsrc=r=7:n=2:d=10
 FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2) += $(addprefix fate-filter-testsrc2-, yuv420p yuv444p rgb24 rgba)
 fate-filter-testsrc2-%: CMD = framecrc -lavfi testsrc2=r=7:d=10 -pix_fmt $(word 4, $(subst -, ,$(@)))
 
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 FORMAT MULTISCALE) += fate-filter-multiscale
+fate-filter-multiscale: CMD = framecrc -lavfi "testsrc2=s=640x360:r=5:d=1,format=yuv420p,multiscale=sizes=320x180|240x136|160x90:flags=bicubic+bitexact+accurate_rnd[a][b][c]" -map "[a]" -map "[b]" -map "[c]"
+
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 FORMAT MULTISCALE) += fate-filter-multiscale-pyramid
+fate-filter-multiscale-pyramid: CMD = framecrc -lavfi "testsrc2=s=640x360:r=5:d=1,format=yuv420p,multiscale=sizes=320x180|240x136|160x90:flags=bicubic+bitexact+accurate_rnd:pyramid=1[a][b][c]" -map "[a]" -map "[b]" -map "[c]"
+
 FATE_FILTER-$(call FILTERFRAMECRC, ALLRGB) += fate-filter-allrgb
 fate-filter-allrgb: CMD = framecrc -lavfi allrgb=rate=5:duration=1 -pix_fmt rgb24
 
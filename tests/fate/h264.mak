@@ -199,8 +199,22 @@ FATE_H264  := $(FATE_H264:%=fate-h264-conformance-%)                    \
               fate-h264-ref-pic-mod-overflow                            \
               fate-h264-timecode                                        \
 
+# Slice threading with the deblocking filter running behind reconstruction;
+# the output must match the single-threaded refs.
+FATE_H264_SLICE_THREADS := ba1_ft_c                                     \
+                           ba3_sva_c                                    \
+                           mr1_bt_a                                     \
+                           sl1_sva_b                                    \
+                           sva_nl2_e                                    \
+
+FATE_H264_SLICE_THREADS := $(FATE_H264_SLICE_THREADS:%=fate-h264-slice-threads-%)
+$(FATE_H264_SLICE_THREADS): THREADS = 4
+$(FATE_H264_SLICE_THREADS): THREAD_TYPE = slice
+$(FATE_H264_SLICE_THREADS): REF = $(SRC_PATH)/tests/ref/fate/$(@:fate-h264-slice-threads-%=h264-conformance-%)
+
 FATE_H264-$(call FRAMECRC, H264, H264, H264_PARSER SCALE_FILTER) += $(FATE_H264_REINIT_TESTS:%=fate-h264-reinit-%)
 FATE_H264-$(call FRAMECRC, H264, H264, H264_PARSER) += $(FATE_H264)
+FATE_H264-$(call FRAMECRC, H264, H264, H264_PARSER) += $(FATE_H264_SLICE_THREADS)
 FATE_H264-$(call FRAMEMD5, H264, H264, H264_PARSER) += fate-h264-extreme-plane-pred
 FATE_H264-$(call FRAMEMD5, MOV,  H264) += fate-h264-crop-to-container
 FATE_H264-$(call DEMDEC,   H264, H264, H264_PARSER)   += fate-h264-encparams
@@ -425,6 +439,12 @@ fate-h264-conformance-sva_fm1_e:                  CMD = framecrc -i $(TARGET_SAM
 fate-h264-conformance-sva_nl1_b:                  CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/SVA_NL1_B.264
 fate-h264-conformance-sva_nl2_e:                  CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/SVA_NL2_E.264
 
+fate-h264-slice-threads-ba1_ft_c:                 CMD = framecrc -framerate 19 -i $(TARGET_SAMPLES)/h264-conformance/BA1_FT_C.264
+fate-h264-slice-threads-ba3_sva_c:                CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/BA3_SVA_C.264
+fate-h264-slice-threads-mr1_bt_a:                 CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/MR1_BT_A.h264
+fate-h264-slice-threads-sl1_sva_b:                CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/SL1_SVA_B.264
+fate-h264-slice-threads-sva_nl2_e:                CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/SVA_NL2_E.264
+
 fate-h264-bsf-mp4toannexb:                        CMD = md5 -i $(TARGET_SAMPLES)/h264/interlaced_crop.mp4 -c:v copy -f h264
 
 fate-h264-crop-to-container:                      CMD = framemd5 -i $(TARGET_SAMPLES)/h264/crop-to-container-dims-canon.mov
@@ -210,6 +210,26 @@ FATE_HEVC-$(call FRAMECRC, HEVC, HEVC, HEVC_PARSER SCALE_FILTER) +=         \
                                                     $(HEVC_TESTS_422_10BIN) \
                                                     $(HEVC_TESTS_444_12BIT) \
 
+# Slice threading: the tiles of a slice are decoded concurrently on the slice
+# threads, and slice segments without entry points run deblocking and SAO
+# behind reconstruction; the output must match the single-threaded refs.
+HEVC_SAMPLES_SLICE_THREADS =    \
+    DBLK_A_SONY_3               \
+    DBLK_E_VIXS_2               \
+    SAO_A_MediaTek_4            \
+    SAO_D_Samsung_5             \
+    SLICES_A_Rovi_3             \
+    TILES_A_Cisco_2             \
+    TILES_B_Cisco_1             \
+
+HEVC_TESTS_SLICE_THREADS := $(addprefix fate-hevc-slice-threads-, $(HEVC_SAMPLES_SLICE_THREADS))
+$(HEVC_TESTS_SLICE_THREADS): THREADS = 4
+$(HEVC_TESTS_SLICE_THREADS): THREAD_TYPE = slice
+$(HEVC_TESTS_SLICE_THREADS): CMD = framecrc -flags unaligned -i $(TARGET_SAMPLES)/hevc-conformance/$(subst fate-hevc-slice-threads-,,$(@)).bit -pix_fmt yuv420p
+$(HEVC_TESTS_SLICE_THREADS): REF = $(SRC_PATH)/tests/ref/fate/$(subst fate-hevc-slice-threads-,hevc-conformance-,$(@))
+
+FATE_HEVC-$(call FRAMECRC, HEVC, HEVC, HEVC_PARSER) += $(HEVC_TESTS_SLICE_THREADS)
+
 fate-hevc-paramchange-yuv420p-yuv420p10: CMD = framecrc -vsync passthrough -i $(TARGET_SAMPLES)/hevc/paramchange_yuv420p_yuv420p10.hevc -sws_flags area+accurate_rnd+bitexact
 FATE_HEVC-$(call FRAMECRC, HEVC, HEVC, HEVC_PARSER SCALE_FILTER LARGE_TESTS) += fate-hevc-paramchange-yuv420p-yuv420p10
 
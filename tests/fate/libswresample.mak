@@ -1094,5 +1094,33 @@ fate-swr-audioconvert: CMP = stddev
 fate-swr-audioconvert: FUZZ = 0
 
 FATE_SWR += $(FATE_SWR_AUDIOCONVERT-yes)
+
+# the output must not depend on the number of threads, so the threaded runs
+# are compared byte for byte with the same conversion done with one thread
+SWR_THREADS_PAN = pan=FL+FR+FC+LFE+BL+BR+SL+SR+TFL+TFR+TBC|c0=c0|c1=c1|c2=c2|c3=c3|c4=c4|c5=c5|c6=c6|c7=c7|c8=c8|c9=c9|c10=c10
+SWR_THREADS_AF-s16  = $(SWR_THREADS_PAN),asetnsamples=n=4096,aresample=48000:dither_method=triangular:threads=THREADS,aformat=sample_fmts=s16:channel_layouts=stereo
+SWR_THREADS_AF-flt = $(SWR_THREADS_PAN),asetnsamples=n=4096,aresample=48000:threads=THREADS,aformat=sample_fmts=flt:channel_layouts=5.1
+SWR_THREADS_CODEC-s16  = pcm_s16le
+SWR_THREADS_CODEC-flt = pcm_f32le
+
+define SWR_THREADS
+tests/data/swr-threads-$(1).wav: TAG = GEN
+tests/data/swr-threads-$(1).wav: ffmpeg$(PROGSSUF)$(EXESUF) tests/data/asynth-44100-11.wav | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$$< -nostdin -i $(TARGET_PATH)/tests/data/asynth-44100-11.wav \
+        -af "atrim=end_sample=20480,$(subst THREADS,1,$(SWR_THREADS_AF-$(1)))" \
+        -flags +bitexact -fflags +bitexact -f wav -c:a $(SWR_THREADS_CODEC-$(1)) - >$$@ 2>/dev/null
+
+FATE_SWR_THREADS += fate-swr-threads-$(1)
+fate-swr-threads-$(1): tests/data/swr-threads-$(1).wav
+fate-swr-threads-$(1): CMD = ffmpeg -i $(TARGET_PATH)/tests/data/asynth-44100-11.wav -af "atrim=end_sample=20480,$(subst THREADS,4,$(SWR_THREADS_AF-$(1)))" -flags +bitexact -fflags +bitexact -f wav -c:a $(SWR_THREADS_CODEC-$(1)) -
+fate-swr-threads-$(1): CMP = rawdiff
+fate-swr-threads-$(1): REF = tests/data/swr-threads-$(1).wav
+endef
+
+$(foreach F,s16 flt,$(eval $(call SWR_THREADS,$(F))))
+
+FATE_SWR_THREADS-$(call FILTERDEMDECENCMUX, ATRIM PAN ASETNSAMPLES ARESAMPLE AFORMAT, WAV, PCM_S16LE, PCM_S16LE, WAV, PCM_F32LE_ENCODER) += $(FATE_SWR_THREADS)
+fate-swr-threads: $(FATE_SWR_THREADS-yes)
+FATE_SWR += $(FATE_SWR_THREADS-yes)
 FATE_FFMPEG += $(FATE_SWR)
 fate-swr: $(FATE_SWR)
@@ -33,6 +33,40 @@ fate-sws-yuv-range: CMD = framecrc \
   -frames 1 \
   -vf scale=in_color_matrix=bt601:in_range=limited:out_color_matrix=bt601:out_range=full:flags=+accurate_rnd+bitexact
 
+# error diffusion dither is single-threaded unless ed_slices is set, so the
+# output must not depend on the number of threads
+SWS_ED_THREADS = 1 4
+FATE_LIBSWSCALE-$(call FILTERFRAMECRC, TESTSRC2 SCALE FORMAT) += $(SWS_ED_THREADS:%=fate-sws-ed-threads%)
+fate-sws-ed-threads%: CMD = framecrc -lavfi testsrc2=s=128x96:r=5:d=1,format=yuv420p,scale=sws_dither=ed:threads=$(@:fate-sws-ed-threads%=%),format=rgb8
+fate-sws-ed-threads%: REF = $(SRC_PATH)/tests/ref/fate/sws-ed-threads
+
+FATE_LIBSWSCALE-$(call FILTERFRAMECRC, TESTSRC2 SCALE FORMAT) += fate-sws-ed-slices
+fate-sws-ed-slices: CMD = framecrc -lavfi testsrc2=s=128x96:r=5:d=1,format=yuv420p,scale=sws_dither=ed:threads=4:ed_slices=1,format=rgb8
+
+# gamma correct scaling, in linear light
+SWS_GAMMA_FORMATS = rgb24 yuv420p10le
+FATE_LIBSWSCALE-$(call FILTERFRAMECRC, TESTSRC2 SCALE FORMAT) += $(SWS_GAMMA_FORMATS:%=fate-sws-gamma-%)
+fate-sws-gamma-%: CMD = framecrc -lavfi testsrc2=s=320x240:r=5:d=1,format=$(@:fate-sws-gamma-%=%),scale=176x144:gamma=1:flags=bicubic+bitexact+accurate_rnd,format=$(@:fate-sws-gamma-%=%)
+
+# a black and white checkerboard averages to 50% linear light, which is
+# 187 in sRGB-like gamma, rather than 128
+FATE_LIBSWSCALE-$(call FILTERFRAMECRC, COLOR GEQ SCALE FORMAT) += fate-sws-gamma-checkerboard
+fate-sws-gamma-checkerboard: CMD = framecrc -lavfi "color=black:s=64x64:d=0.2,format=gbrp,geq=r=255*mod(X+Y\,2):g=255*mod(X+Y\,2):b=255*mod(X+Y\,2),scale=32x32:gamma=1:flags=area+bitexact,format=rgb24"
+
+# fused scale and pack, slice threads must not change the output
+SWS_FUSED = yuv420p nv12 p010le yuv420p-threads nv12-threads p010le-threads
+FATE_LIBSWSCALE-$(call FILTERFRAMECRC, TESTSRC2 SCALE FORMAT) += $(SWS_FUSED:%=fate-sws-fused-%)
+fate-sws-fused-%: FMT = $(firstword $(subst -, ,$(@:fate-sws-fused-%=%)))
+fate-sws-fused-%: SRC = $(if $(filter p010le,$(FMT)),yuv420p10le,yuv420p)
+fate-sws-fused-%: THREADS = $(if $(findstring threads,$@),4,1)
+fate-sws-fused-%: CMD = framecrc -lavfi testsrc2=s=320x240:r=5:d=1,format=$(SRC),scale=176x144:fused=1:threads=$(THREADS):flags=bicubic+bitexact+accurate_rnd,format=$(FMT)
+fate-sws-fused-%-threads: REF = $(SRC_PATH)/tests/ref/fate/sws-fused-$(FMT)
+
+# frames that need a range conversion are not fused
+FATE_LIBSWSCALE-$(call FILTERFRAMECRC, TESTSRC2 SCALE FORMAT) += fate-sws-range-nv12 fate-sws-range-nv12-fused
+fate-sws-range-nv12 fate-sws-range-nv12-fused: CMD = framecrc -lavfi testsrc2=s=320x240:r=5:d=1,format=yuv420p,scale=176x144:in_range=full:out_range=limited:fused=$(if $(findstring fused,$@),1,0):flags=bicubic+bitexact+accurate_rnd,format=nv12
+fate-sws-range-nv12-fused: REF = $(SRC_PATH)/tests/ref/fate/sws-range-nv12
+
 FATE_LIBSWSCALE += $(FATE_LIBSWSCALE-yes)
 FATE_LIBSWSCALE_SAMPLES += $(FATE_LIBSWSCALE_SAMPLES-yes)
 FATE-$(CONFIG_SWSCALE) += $(FATE_LIBSWSCALE)
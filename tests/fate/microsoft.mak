@@ -68,7 +68,21 @@ fate-vc1_sa20021: CMD = framecrc -i $(TARGET_SAMPLES)/vc1/SA20021.vc1
 FATE_VC1 += fate-vc1_ilaced_twomv
 fate-vc1_ilaced_twomv: CMD = framecrc -flags +bitexact -i $(TARGET_SAMPLES)/vc1/ilaced_twomv.vc1
 
-FATE_VC1-$(call FRAMECRC, VC1, VC1, VC1_PARSER EXTRACT_EXTRADATA_BSF) += $(FATE_VC1)
+# Frame and slice threading must give the same output as a single thread,
+# including for the field interlaced B pictures predicted from a picture
+# still being decoded and for the slices and fields decoded in parallel.
+FATE_VC1_THREADS = $(FATE_VC1:%=%-frame-threads) $(FATE_VC1:%=%-slice-threads)
+$(FATE_VC1_THREADS): THREADS = 4
+$(FATE_VC1_THREADS): THREAD_TYPE = $(if $(findstring slice,$@),slice,frame)
+$(FATE_VC1_THREADS): REF = $(SRC_PATH)/tests/ref/fate/$(firstword $(subst -, ,$(@:fate-%=%)))
+fate-vc1_sa00040-frame-threads fate-vc1_sa00040-slice-threads: CMD = framecrc -i $(TARGET_SAMPLES)/vc1/SA00040.vc1
+fate-vc1_sa00050-frame-threads fate-vc1_sa00050-slice-threads: CMD = framecrc -i $(TARGET_SAMPLES)/vc1/SA00050.vc1
+fate-vc1_sa10091-frame-threads fate-vc1_sa10091-slice-threads: CMD = framecrc -i $(TARGET_SAMPLES)/vc1/SA10091.vc1
+fate-vc1_sa10143-frame-threads fate-vc1_sa10143-slice-threads: CMD = framecrc -i $(TARGET_SAMPLES)/vc1/SA10143.vc1
+fate-vc1_sa20021-frame-threads fate-vc1_sa20021-slice-threads: CMD = framecrc -i $(TARGET_SAMPLES)/vc1/SA20021.vc1
+fate-vc1_ilaced_twomv-frame-threads fate-vc1_ilaced_twomv-slice-threads: CMD = framecrc -flags +bitexact -i $(TARGET_SAMPLES)/vc1/ilaced_twomv.vc1
+
+FATE_VC1-$(call FRAMECRC, VC1, VC1, VC1_PARSER EXTRACT_EXTRADATA_BSF) += $(FATE_VC1) $(FATE_VC1_THREADS)
 
 FATE_VC1-$(call FRAMECRC, VC1T, WMV3) += fate-vc1test_smm0005 fate-vc1test_smm0015
 fate-vc1test_smm0005: CMD = framecrc -i $(TARGET_SAMPLES)/vc1/SMM0005.rcv
@@ -198,6 +198,13 @@ fate-seek-mkv-codec-delay:   CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_
 
 FATE_SEEK_EXTRA += $(FATE_SEEK_EXTRA-yes)
 
+# mpegts keyframe index, built while reading and stored in a sidecar file
+FATE_SEEK_TS_INDEX := fate-seek-lavf-ts-seek_index fate-seek-lavf-ts-seek_index_file
+FATE_SEEK_TS_INDEX := $(if $(filter fate-seek-lavf-ts, $(FATE_SEEK)), $(FATE_SEEK_TS_INDEX))
+$(FATE_SEEK_TS_INDEX): fate-lavf-ts libavformat/tests/seek$(EXESUF)
+fate-seek-lavf-ts-seek_index:      CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.ts -seek_index 1
+fate-seek-lavf-ts-seek_index_file: CMD = seek_index_file $(TARGET_PATH)/tests/data/lavf/lavf.ts
+
 
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA): libavformat/tests/seek$(EXESUF)
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/$(SRC)
@@ -205,6 +212,6 @@ $(FATE_SEEK) $(FATE_SAMPLES_SEEK): fate-seek-%: fate-%
 $(subst fate-seek-,fate-,$(FATE_SAMPLES_SEEK) $(FATE_SEEK)): KEEP_FILES ?= 1
 fate-seek-%: REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%=%)
 
-FATE_AVCONV += $(FATE_SEEK)
+FATE_AVCONV += $(FATE_SEEK) $(FATE_SEEK_TS_INDEX)
 FATE_SAMPLES_AVCONV += $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
-fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
+fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA) $(FATE_SEEK_TS_INDEX)
@@ -0,0 +1,177 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the real-time factor of the native AAC encoder for stereo,
+ * 5.1 and 7.1 input, single-threaded and with the given thread count.
+ *
+ * usage: aacenc_bench [seconds [threads [encoder options]]]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libavutil/channel_layout.h"
+#include "libavutil/dict.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/lfg.h"
+#include "libavutil/log.h"
+#include "libavutil/macros.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/time.h"
+
+#include "libavcodec/avcodec.h"
+
+#define SAMPLE_RATE 48000
+
+static const struct {
+    const char *name;
+    AVChannelLayout layout;
+} layouts[] = {
+    { "stereo", AV_CHANNEL_LAYOUT_STEREO        },
+    { "5.1",    AV_CHANNEL_LAYOUT_5POINT1_BACK },
+    { "7.1",    AV_CHANNEL_LAYOUT_7POINT1       },
+};
+
+/* a different tone per channel on top of some noise, so that all coding
+ * tools of the encoder get exercised */
+static void fill_frame(AVFrame *frame, AVLFG *lfg, int64_t start)
+{
+    for (int ch = 0; ch < frame->ch_layout.nb_channels; ch++) {
+        float *dst = (float *)frame->extended_data[ch];
+        double freq = 220.0 * (ch + 1);
+
+        for (int i = 0; i < frame->nb_samples; i++) {
+            double t     = (double)(start + i) / SAMPLE_RATE;
+            double noise = av_lfg_get(lfg) / (double)UINT32_MAX - 0.5;
+            dst[i] = 0.4 * sin(2 * M_PI * freq * t) + 0.1 * noise;
+        }
+    }
+}
+
+static int run(const AVCodec *codec, const AVChannelLayout *layout,
+               double seconds, int threads, const char *opts, double *rtf)
+{
+    AVCodecContext *avctx = NULL;
+    AVFrame *frame = NULL;
+    AVPacket *pkt = NULL;
+    AVDictionary *dict = NULL;
+    AVLFG lfg;
+    int64_t nb_samples = seconds * SAMPLE_RATE, pos = 0, t0, elapsed;
+    int ret;
+
+    avctx = avcodec_alloc_context3(codec);
+    frame = av_frame_alloc();
+    pkt   = av_packet_alloc();
+    if (!avctx || !frame || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    avctx->sample_fmt   = AV_SAMPLE_FMT_FLTP;
+    avctx->sample_rate  = SAMPLE_RATE;
+    avctx->thread_count = threads;
+    avctx->thread_type  = FF_THREAD_SLICE;
+    if ((ret = av_channel_layout_copy(&avctx->ch_layout, layout)) < 0)
+        goto end;
+    if (opts && (ret = av_dict_parse_string(&dict, opts, "=", ":", 0)) < 0)
+        goto end;
+    if ((ret = avcodec_open2(avctx, codec, &dict)) < 0)
+        goto end;
+
+    frame->format     = avctx->sample_fmt;
+    frame->nb_samples = avctx->frame_size;
+    if ((ret = av_channel_layout_copy(&frame->ch_layout, layout)) < 0 ||
+        (ret = av_frame_get_buffer(frame, 0)) < 0)
+        goto end;
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+    t0 = av_gettime_relative();
+    while (1) {
+        if (pos < nb_samples) {
+            if ((ret = av_frame_make_writable(frame)) < 0)
+                goto end;
+            fill_frame(frame, &lfg, pos);
+            frame->pts = pos;
+            pos += frame->nb_samples;
+            ret = avcodec_send_frame(avctx, frame);
+        } else {
+            ret = avcodec_send_frame(avctx, NULL);
+            if (ret == AVERROR_EOF)
+                ret = 0;
+        }
+        if (ret < 0)
+            goto end;
+
+        while ((ret = avcodec_receive_packet(avctx, pkt)) >= 0)
+            av_packet_unref(pkt);
+        if (ret == AVERROR_EOF)
+            break;
+        if (ret != AVERROR(EAGAIN))
+            goto end;
+    }
+    elapsed = av_gettime_relative() - t0;
+
+    *rtf = seconds * 1000000.0 / FFMAX(elapsed, 1);
+    ret  = 0;
+end:
+    av_dict_free(&dict);
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    avcodec_free_context(&avctx);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    const AVCodec *codec;
+    double seconds = argc > 1 ? atof(argv[1]) : 30.0;
+    int threads    = argc > 2 ? atoi(argv[2]) : 0;
+    const char *opts = argc > 3 ? argv[3] : NULL;
+
+    if (seconds <= 0) {
+        fprintf(stderr, "usage: %s [seconds [threads [encoder options]]]\n", argv[0]);
+        return 1;
+    }
+
+    av_log_set_level(AV_LOG_WARNING);
+
+    codec = avcodec_find_encoder_by_name("aac");
+    if (!codec) {
+        fprintf(stderr, "AAC encoder not available\n");
+        return 1;
+    }
+
+    printf("%-8s %12s %12s %8s\n", "layout", "rtf (1t)", "rtf (mt)", "speedup");
+    for (int i = 0; i < FF_ARRAY_ELEMS(layouts); i++) {
+        double rtf_st, rtf_mt;
+        int ret;
+
+        if ((ret = run(codec, &layouts[i].layout, seconds, 1, opts, &rtf_st)) < 0 ||
+            (ret = run(codec, &layouts[i].layout, seconds, threads, opts, &rtf_mt)) < 0) {
+            fprintf(stderr, "Encoding %s failed: %s\n", layouts[i].name, av_err2str(ret));
+            return 1;
+        }
+        printf("%-8s %11.2fx %11.2fx %7.2fx\n", layouts[i].name,
+               rtf_st, rtf_mt, rtf_mt / rtf_st);
+    }
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the throughput of sws_scale() for a set of common conversions,
+ * in megapixels of source image per second.
+ *
+ * usage: scale_bench [seconds [cpuflags]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libavutil/cpu.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/lfg.h"
+#include "libavutil/log.h"
+#include "libavutil/macros.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/time.h"
+
+#include "libswscale/swscale.h"
+
+static const struct {
+    enum AVPixelFormat src_fmt, dst_fmt;
+    int src_w, src_h, dst_w, dst_h;
+    const char *opts;
+} tests[] = {
+    { AV_PIX_FMT_YUV420P,   AV_PIX_FMT_NV12,      1920, 1080, 1920, 1080 },
+    { AV_PIX_FMT_NV12,      AV_PIX_FMT_YUV420P,   1920, 1080, 1920, 1080 },
+    { AV_PIX_FMT_YUV420P,   AV_PIX_FMT_YUV420P,   1920, 1080, 1280,  720, "fused=0" },
+    { AV_PIX_FMT_YUV420P,   AV_PIX_FMT_YUV420P,   1920, 1080, 1280,  720, "fused=1" },
+    { AV_PIX_FMT_YUV420P,   AV_PIX_FMT_YUV420P,   1920, 1080,  960,  540, "fused=0" },
+    { AV_PIX_FMT_YUV420P,   AV_PIX_FMT_YUV420P,   1920, 1080,  960,  540, "fused=1" },
+    { AV_PIX_FMT_YUV420P,   AV_PIX_FMT_YUV420P,   1920, 1080,  640,  360, "fused=0" },
+    { AV_PIX_FMT_YUV420P,   AV_PIX_FMT_YUV420P,   1920, 1080,  640,  360, "fused=1" },
+    { AV_PIX_FMT_YUV420P,   AV_PIX_FMT_NV12,      1920, 1080, 1280,  720, "fused=0" },
+    { AV_PIX_FMT_YUV420P,   AV_PIX_FMT_NV12,      1920, 1080, 1280,  720, "fused=1" },
+    { AV_PIX_FMT_YUV420P10, AV_PIX_FMT_P010,      1920, 1080, 1920, 1080 },
+    { AV_PIX_FMT_P010,      AV_PIX_FMT_YUV420P10, 1920, 1080, 1920, 1080 },
+    { AV_PIX_FMT_YUV420P10, AV_PIX_FMT_P010,      1920, 1080, 1280,  720, "fused=0" },
+    { AV_PIX_FMT_YUV420P10, AV_PIX_FMT_P010,      1920, 1080, 1280,  720, "fused=1" },
+};
+
+static void fill_frame(AVFrame *frame, AVLFG *lfg)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    int mask = (1 << desc->comp[0].depth) - 1;
+
+    for (int p = 0; p < 4 && frame->data[p]; p++) {
+        int h = p == 1 || p == 2 ? AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h)
+                                 : frame->height;
+        for (int y = 0; y < h; y++) {
+            uint8_t *row = frame->data[p] + y * frame->linesize[p];
+            if (desc->comp[0].depth > 8) {
+                uint16_t *row16 = (uint16_t *)row;
+                for (int x = 0; x < frame->linesize[p] / 2; x++)
+                    row16[x] = (av_lfg_get(lfg) & mask) << desc->comp[0].shift;
+            } else {
+                for (int x = 0; x < frame->linesize[p]; x++)
+                    row[x] = av_lfg_get(lfg);
+            }
+        }
+    }
+}
+
+static AVFrame *alloc_frame(enum AVPixelFormat fmt, int w, int h)
+{
+    AVFrame *frame = av_frame_alloc();
+
+    if (!frame)
+        return NULL;
+    frame->format = fmt;
+    frame->width  = w;
+    frame->height = h;
+    if (av_frame_get_buffer(frame, 0) < 0)
+        av_frame_free(&frame);
+    return frame;
+}
+
+static int run(int idx, double seconds, double *mpps)
+{
+    struct SwsContext *sws;
+    AVFrame *src, *dst;
+    AVLFG lfg;
+    int64_t t0, elapsed, pixels = 0;
+    int ret = 0;
+
+    src = alloc_frame(tests[idx].src_fmt, tests[idx].src_w, tests[idx].src_h);
+    dst = alloc_frame(tests[idx].dst_fmt, tests[idx].dst_w, tests[idx].dst_h);
+    sws = sws_alloc_context();
+    if (!src || !dst || !sws) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    av_opt_set_int(sws, "srcw",       tests[idx].src_w,   0);
+    av_opt_set_int(sws, "srch",       tests[idx].src_h,   0);
+    av_opt_set_int(sws, "src_format", tests[idx].src_fmt, 0);
+    av_opt_set_int(sws, "dstw",       tests[idx].dst_w,   0);
+    av_opt_set_int(sws, "dsth",       tests[idx].dst_h,   0);
+    av_opt_set_int(sws, "dst_format", tests[idx].dst_fmt, 0);
+    av_opt_set_int(sws, "sws_flags",  SWS_BICUBIC,        0);
+    if (tests[idx].opts &&
+        (ret = av_set_options_string(sws, tests[idx].opts, "=", ":")) < 0)
+        goto end;
+    if ((ret = sws_init_context(sws, NULL, NULL)) < 0)
+        goto end;
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+    fill_frame(src, &lfg);
+
+    t0 = av_gettime_relative();
+    do {
+        ret = sws_scale(sws, (const uint8_t * const *)src->data, src->linesize,
+                        0, src->height, dst->data, dst->linesize);
+        if (ret < 0)
+            goto end;
+        pixels += src->width * src->height;
+        elapsed = av_gettime_relative() - t0;
+    } while (elapsed < seconds * 1000000);
+
+    *mpps = (double)pixels / FFMAX(elapsed, 1);
+    ret   = 0;
+end:
+    sws_freeContext(sws);
+    av_frame_free(&src);
+    av_frame_free(&dst);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+
+    if (seconds <= 0) {
+        fprintf(stderr, "usage: %s [seconds [cpuflags]]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 2) {
+        unsigned flags = av_get_cpu_flags();
+        if (av_parse_cpu_caps(&flags, argv[2]) < 0) {
+            fprintf(stderr, "Invalid cpu flags: %s\n", argv[2]);
+            return 1;
+        }
+        av_force_cpu_flags(flags);
+    }
+
+    av_log_set_level(AV_LOG_WARNING);
+
+    printf("%-56s %10s\n", "conversion", "MPix/s");
+    for (int i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        char name[64];
+        double mpps;
+        int ret;
+
+        snprintf(name, sizeof(name), "%s %dx%d -> %s %dx%d %s",
+                 av_get_pix_fmt_name(tests[i].src_fmt), tests[i].src_w, tests[i].src_h,
+                 av_get_pix_fmt_name(tests[i].dst_fmt), tests[i].dst_w, tests[i].dst_h,
+                 tests[i].opts ? tests[i].opts : "");
+        if ((ret = run(i, seconds, &mpps)) < 0) {
+            fprintf(stderr, "%s failed: %s\n", name, av_err2str(ret));
+            return 1;
+        }
+        printf("%-56s %10.1f\n", name, mpps);
+    }
+
+    return 0;
+}